@@ -2,7 +2,13 @@
 #include <dballe/file.h>
 #include <dballe/core/benchmark.h>
 #include <dballe/msg/msg.h>
+#include <dballe/db/v7/db.h>
+#include <dballe/sql/sqlite.h>
 #include <vector>
+#include "config.h"
+#ifdef HAVE_LIBPQ
+#include <dballe/sql/postgresql.h>
+#endif
 
 struct BenchmarkImport : public dballe::benchmark::Task
 {
@@ -50,6 +56,72 @@ struct BenchmarkImport : public dballe::benchmark::Task
     }
 };
 
+#ifdef HAVE_LIBPQ
+/**
+ * Import into PostgreSQL, comparing bulk inserts done with COPY with those
+ * done with INSERT.
+ *
+ * It uses the database in DBA_DB_POSTGRESQL.
+ */
+struct BenchmarkDBImport : public BenchmarkImport
+{
+    std::string m_task_name;
+    bool use_copy;
+
+    BenchmarkDBImport(const char* name, const char* pathname, bool use_copy, unsigned hours=24, unsigned minutes=1)
+        : BenchmarkImport(name, pathname, hours, minutes), use_copy(use_copy)
+    {
+        m_task_name = std::string("db_import_") + name + (use_copy ? "_copy" : "_insert");
+        auto options = dballe::DBConnectOptions::test_create("POSTGRESQL");
+        db = dballe::db::DB::downcast(dballe::DB::connect(*options));
+    }
+
+    const char* name() const override { return m_task_name.c_str(); }
+
+    void setup() override
+    {
+        auto v7db = std::dynamic_pointer_cast<dballe::db::v7::DB>(db);
+        auto conn = v7db ? std::dynamic_pointer_cast<dballe::sql::PostgreSQLConnection>(v7db->conn) : nullptr;
+        if (!conn)
+            throw std::runtime_error("db_import needs DBA_DB_POSTGRESQL to point to a PostgreSQL database");
+        if (!use_copy)
+            conn->copy_min_rows = 0;
+        BenchmarkImport::setup();
+    }
+};
+#endif
+
+/**
+ * Import into SQLite, comparing bulk inserts done with multi-row INSERT
+ * statements with those done with one INSERT per row.
+ */
+struct BenchmarkSQLiteImport : public BenchmarkImport
+{
+    std::string m_task_name;
+    bool multi_row;
+
+    BenchmarkSQLiteImport(const char* name, const char* pathname, bool multi_row, unsigned hours=24, unsigned minutes=1)
+        : BenchmarkImport(name, pathname, hours, minutes), multi_row(multi_row)
+    {
+        m_task_name = std::string("sqlite_import_") + name + (multi_row ? "_multirow" : "_single");
+        auto options = dballe::DBConnectOptions::test_create("SQLITE");
+        db = dballe::db::DB::downcast(dballe::DB::connect(*options));
+    }
+
+    const char* name() const override { return m_task_name.c_str(); }
+
+    void setup() override
+    {
+        auto v7db = std::dynamic_pointer_cast<dballe::db::v7::DB>(db);
+        auto conn = v7db ? std::dynamic_pointer_cast<dballe::sql::SQLiteConnection>(v7db->conn) : nullptr;
+        if (!conn)
+            throw std::runtime_error("sqlite_import needs a SQLite database");
+        if (!multi_row)
+            conn->max_rows_per_insert = 1;
+        BenchmarkImport::setup();
+    }
+};
+
 int main(int argc, const char* argv[])
 {
     using namespace dballe::benchmark;
@@ -57,6 +129,16 @@ int main(int argc, const char* argv[])
         new BenchmarkImport("synop", "extra/bufr/synop-rad1.bufr"),
         new BenchmarkImport("temp", "extra/bufr/temp-huge.bufr", 2),
         new BenchmarkImport("acars", "extra/bufr/gts-acars2.bufr", 24, 15),
+        new BenchmarkSQLiteImport("synop", "extra/bufr/synop-rad1.bufr", false),
+        new BenchmarkSQLiteImport("synop", "extra/bufr/synop-rad1.bufr", true),
+        new BenchmarkSQLiteImport("temp", "extra/bufr/temp-huge.bufr", false, 2),
+        new BenchmarkSQLiteImport("temp", "extra/bufr/temp-huge.bufr", true, 2),
+        new BenchmarkSQLiteImport("acars", "extra/bufr/gts-acars2.bufr", false, 24, 15),
+        new BenchmarkSQLiteImport("acars", "extra/bufr/gts-acars2.bufr", true, 24, 15),
+#ifdef HAVE_LIBPQ
+        new BenchmarkDBImport("temp", "extra/bufr/temp-huge.bufr", false, 2),
+        new BenchmarkDBImport("temp", "extra/bufr/temp-huge.bufr", true, 2),
+#endif
     };
 
     Benchmark benchmark;
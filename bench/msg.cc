@@ -0,0 +1,210 @@
+#include <dballe/file.h>
+#include <dballe/importer.h>
+#include <dballe/core/benchmark.h>
+#include <dballe/core/json.h>
+#include <dballe/msg/msg.h>
+#include <dballe/msg/json_codec.h>
+#include <dballe/var.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Decode all the messages in a file
+ */
+struct BenchmarkDecode : public dballe::benchmark::Task
+{
+    std::string m_name;
+    const char* m_pathname;
+    std::vector<dballe::BinaryMessage> raw;
+    std::unique_ptr<dballe::Importer> importer;
+
+    BenchmarkDecode(const char* name, const char* pathname)
+        : m_name(std::string("decode_") + name), m_pathname(pathname)
+    {
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    void setup() override
+    {
+        importer = dballe::Importer::create(dballe::Encoding::BUFR, "accurate");
+        auto in = dballe::File::create(dballe::Encoding::BUFR, m_pathname, "rb");
+        in->foreach([&](const dballe::BinaryMessage& rmsg) {
+            raw.push_back(rmsg);
+            return true;
+        });
+    }
+
+    void run_once() override
+    {
+        for (const auto& rmsg: raw)
+            importer->from_binary(rmsg);
+    }
+
+    void teardown() override
+    {
+        raw.clear();
+        importer.reset();
+    }
+};
+
+/**
+ * Build a sounding with the given number of pressure levels, adding levels
+ * from the ground up like the TEMP importer does
+ */
+struct BenchmarkBuildSounding : public dballe::benchmark::Task
+{
+    std::string m_name;
+    unsigned levels;
+
+    BenchmarkBuildSounding(unsigned levels)
+        : m_name("build_sounding_" + std::to_string(levels)), levels(levels)
+    {
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    void run_once() override
+    {
+        for (unsigned rep = 0; rep < 20; ++rep)
+        {
+            dballe::impl::Message msg;
+            for (unsigned i = 0; i < levels; ++i)
+            {
+                dballe::Level level(100, 110000 - i * 30);
+                msg.set(level, dballe::Trange::instant(), dballe::newvar(WR_VAR(0, 10, 8), 1000.0 + i));
+                msg.set(level, dballe::Trange::instant(), dballe::newvar(WR_VAR(0, 12, 101), 300.0 - i * 0.1));
+                msg.set(level, dballe::Trange::instant(), dballe::newvar(WR_VAR(0, 12, 103), 290.0 - i * 0.1));
+                msg.set(level, dballe::Trange::instant(), dballe::newvar(WR_VAR(0, 11, 1), (int)(i % 360)));
+            }
+            msg.data.sort();
+        }
+    }
+};
+
+/**
+ * Encode and decode JSON, using the messages of a BUFR file as input
+ */
+struct BenchmarkJSON : public dballe::benchmark::Task
+{
+    enum Mode {
+        /// Parse with the std::istream parser
+        PARSE_STREAM,
+        /// Parse from a memory buffer
+        PARSE_BUFFER,
+        /// Decode messages with JsonImporter
+        DECODE,
+        /// Encode messages with JsonExporter
+        ENCODE,
+    };
+
+    /// JSONReader that ignores all events
+    struct NullReader : public dballe::core::JSONReader
+    {
+        void on_start_list() override {}
+        void on_end_list() override {}
+        void on_start_mapping() override {}
+        void on_end_mapping() override {}
+        void on_add_null() override {}
+        void on_add_bool(bool val) override {}
+        void on_add_int(int val) override {}
+        void on_add_double(double val) override {}
+        void on_add_string(const std::string& val) override {}
+    };
+
+    std::string m_name;
+    const char* m_pathname;
+    Mode mode;
+    dballe::benchmark::Messages messages;
+    std::vector<dballe::BinaryMessage> encoded;
+    dballe::impl::msg::JsonImporter importer;
+    dballe::impl::msg::JsonExporter exporter;
+
+    BenchmarkJSON(const char* name, const char* pathname, Mode mode)
+        : m_name(name), m_pathname(pathname), mode(mode)
+    {
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    void setup() override
+    {
+        messages.load(m_pathname);
+        for (const auto& msgs: messages)
+        {
+            dballe::BinaryMessage raw(dballe::Encoding::JSON);
+            raw.data = exporter.to_binary(msgs);
+            encoded.emplace_back(raw);
+        }
+    }
+
+    void run_once() override
+    {
+        for (unsigned rep = 0; rep < 10; ++rep)
+        {
+            switch (mode)
+            {
+                case PARSE_STREAM:
+                    for (const auto& raw: encoded)
+                    {
+                        NullReader reader;
+                        std::stringstream in(raw.data);
+                        reader.parse(in);
+                    }
+                    break;
+                case PARSE_BUFFER:
+                {
+                    NullReader reader;
+                    for (const auto& raw: encoded)
+                    {
+                        const char* begin = raw.data.data();
+                        reader.parse(begin, begin + raw.data.size());
+                    }
+                    break;
+                }
+                case DECODE:
+                    for (const auto& raw: encoded)
+                        importer.from_binary(raw);
+                    break;
+                case ENCODE:
+                    for (const auto& msgs: messages)
+                        exporter.to_binary(msgs);
+                    break;
+            }
+        }
+    }
+
+    void teardown() override
+    {
+        messages.clear();
+        encoded.clear();
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    using namespace dballe::benchmark;
+    dballe::benchmark::Task* tasks[] = {
+        new BenchmarkDecode("temp", "extra/bufr/temp-huge.bufr"),
+        new BenchmarkDecode("acars", "extra/bufr/gts-acars2.bufr"),
+        new BenchmarkBuildSounding(30),
+        new BenchmarkBuildSounding(300),
+        new BenchmarkBuildSounding(3000),
+        new BenchmarkJSON("json_parse_stream", "extra/bufr/temp-huge.bufr", BenchmarkJSON::PARSE_STREAM),
+        new BenchmarkJSON("json_parse_buffer", "extra/bufr/temp-huge.bufr", BenchmarkJSON::PARSE_BUFFER),
+        new BenchmarkJSON("json_decode", "extra/bufr/temp-huge.bufr", BenchmarkJSON::DECODE),
+        new BenchmarkJSON("json_encode", "extra/bufr/temp-huge.bufr", BenchmarkJSON::ENCODE),
+    };
+
+    Benchmark benchmark;
+    dballe::benchmark::Whitelist whitelist(argc, argv);
+
+    for (auto task: tasks)
+        if (whitelist.has(task->name()))
+            benchmark.timeit(*task, 5);
+
+    benchmark.print_timings();
+    return 0;
+}
@@ -1,8 +1,15 @@
 #include <dballe/db/db.h>
+#include <dballe/db/v7/db.h>
 #include <dballe/file.h>
 #include <dballe/core/benchmark.h>
 #include <dballe/core/query.h>
 #include <dballe/msg/msg.h>
+#include <dballe/sql/sqlite.h>
+#include <dballe/var.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
 #include <vector>
 
 struct BenchmarkQuery : public dballe::benchmark::Task
@@ -13,9 +20,11 @@ struct BenchmarkQuery : public dballe::benchmark::Task
     unsigned months;
     unsigned hours;
     unsigned minutes;
+    /// Create SQLite databases with the packed data layout
+    bool packed;
 
-    BenchmarkQuery(const char* name, const char* pathname, unsigned months=12, unsigned hours=24, unsigned minutes=1)
-        : m_name(name), m_pathname(pathname), months(months), hours(hours), minutes(minutes)
+    BenchmarkQuery(const char* name, const char* pathname, unsigned months=12, unsigned hours=24, unsigned minutes=1, bool packed=false)
+        : m_name(name), m_pathname(pathname), months(months), hours(hours), minutes(minutes), packed(packed)
     {
         auto options = dballe::DBConnectOptions::test_create();
         db = dballe::db::DB::downcast(dballe::DB::connect(*options));
@@ -25,7 +34,9 @@ struct BenchmarkQuery : public dballe::benchmark::Task
 
     void setup() override
     {
+        if (packed) setenv("DBA_SQLITE_PACKED", "1", 1);
         db->reset();
+        if (packed) unsetenv("DBA_SQLITE_PACKED");
         dballe::benchmark::Messages messages;
         messages.load(m_pathname);
 
@@ -59,6 +70,145 @@ struct BenchmarkQuery : public dballe::benchmark::Task
     }
 };
 
+/**
+ * Run the same data query from multiple threads at the same time, each in its
+ * own read-only transaction.
+ *
+ * Threads use a connection pool where available (PostgreSQL and MySQL);
+ * otherwise the queries run one after the other, to give a baseline.
+ */
+struct BenchmarkConcurrentQuery : public BenchmarkQuery
+{
+    unsigned threads;
+    bool pooled = false;
+
+    BenchmarkConcurrentQuery(const char* name, const char* pathname, unsigned threads)
+        : BenchmarkQuery(name, pathname, 1, 24), threads(threads)
+    {
+        auto v7db = std::dynamic_pointer_cast<dballe::db::v7::DB>(db);
+        switch (v7db->conn->server_type)
+        {
+            case dballe::sql::ServerType::POSTGRES:
+            case dballe::sql::ServerType::MYSQL:
+                v7db->enable_pool(threads);
+                pooled = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void query()
+    {
+        auto tr = std::dynamic_pointer_cast<dballe::db::Transaction>(db->transaction(true));
+        dballe::core::Query query;
+        auto cur = tr->query_data(query);
+        while (cur->next())
+            ;
+        tr->rollback();
+    }
+
+    void run_once() override
+    {
+        if (!pooled)
+        {
+            for (unsigned i = 0; i < threads; ++i)
+                query();
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back([this] { query(); });
+        for (auto& w: workers)
+            w.join();
+    }
+};
+
+/**
+ * Decode datetime and value of each row of a SQLite table shaped like data,
+ * as done by the data cursors
+ */
+struct BenchmarkDecode : public dballe::benchmark::Task
+{
+    enum Mode {
+        /// Text columns, decoded with sscanf as in previous versions
+        SSCANF,
+        /// Text columns
+        TEXT,
+        /// Packed integer columns
+        PACKED,
+    };
+
+    std::shared_ptr<dballe::sql::SQLiteConnection> conn;
+    const char* m_name;
+    Mode mode;
+    unsigned rows;
+    /// Sum of decoded values, so that decoding cannot be optimized away
+    long checksum = 0;
+
+    BenchmarkDecode(const char* name, Mode mode, unsigned rows=200000)
+        : conn(dballe::sql::SQLiteConnection::create()), m_name(name), mode(mode), rows(rows)
+    {
+        conn->open_memory();
+        conn->packed_datetime = mode == PACKED;
+    }
+
+    const char* name() const override { return m_name; }
+
+    void setup() override
+    {
+        bool packed = mode == PACKED;
+        conn->exec(std::string("CREATE TABLE data (datetime ") + (packed ? "INTEGER" : "TEXT") + " NOT NULL,"
+                   " code INTEGER NOT NULL, value " + (packed ? "" : "VARCHAR(255)") + " NOT NULL)");
+        auto tr = conn->transaction();
+        auto stm = conn->sqlitestatement("INSERT INTO data (datetime, code, value) VALUES (?, ?, ?)");
+        wreport::Var var(dballe::varinfo(WR_VAR(0, 12, 101)));
+        for (unsigned i = 0; i < rows; ++i)
+        {
+            var.seti(27315 + i % 1000);
+            stm->bind_val(1, dballe::Datetime(2016, 1 + i % 12, 1 + i % 28, i % 24, i % 60, 0));
+            stm->bind_val(2, var.code());
+            if (packed)
+                stm->bind_val(3, var.enqi());
+            else
+                stm->bind_val(3, var.enqc());
+            stm->execute();
+        }
+        tr->commit();
+    }
+
+    void run_once() override
+    {
+        auto stm = conn->sqlitestatement("SELECT datetime, code, value FROM data");
+        while (stm->step())
+        {
+            dballe::Datetime dt;
+            if (mode == SSCANF)
+            {
+                std::string str = stm->column_string(0);
+                sscanf(str.c_str(), "%04hu-%02hhu-%02hhu %02hhu:%02hhu:%02hhu",
+                        &dt.year, &dt.month, &dt.day, &dt.hour, &dt.minute, &dt.second);
+            } else
+                dt = stm->column_datetime(0);
+
+            wreport::Varcode code = stm->column_int(1);
+            std::unique_ptr<wreport::Var> var;
+            if (sqlite3_column_type(*stm, 2) == SQLITE_INTEGER)
+                var.reset(new wreport::Var(dballe::varinfo(code), stm->column_int(2)));
+            else
+                var = dballe::newvar(code, stm->column_string(2));
+
+            checksum += dt.day + var->enqi();
+        }
+    }
+
+    void teardown() override
+    {
+        conn->exec("DROP TABLE data");
+    }
+};
+
 int main(int argc, const char* argv[])
 {
     using namespace dballe::benchmark;
@@ -66,6 +216,14 @@ int main(int argc, const char* argv[])
         new BenchmarkQuery("synop", "extra/bufr/synop-rad1.bufr", 1, 24),
         new BenchmarkQuery("temp", "extra/bufr/temp-huge.bufr", 1, 1),
         new BenchmarkQuery("acars", "extra/bufr/gts-acars2.bufr", 12, 24, 10),
+        new BenchmarkQuery("synop_packed", "extra/bufr/synop-rad1.bufr", 1, 24, 1, true),
+        new BenchmarkQuery("acars_packed", "extra/bufr/gts-acars2.bufr", 12, 24, 10, true),
+        new BenchmarkConcurrentQuery("synop_threads1", "extra/bufr/synop-rad1.bufr", 1),
+        new BenchmarkConcurrentQuery("synop_threads4", "extra/bufr/synop-rad1.bufr", 4),
+        new BenchmarkConcurrentQuery("synop_threads8", "extra/bufr/synop-rad1.bufr", 8),
+        new BenchmarkDecode("decode_sscanf", BenchmarkDecode::SSCANF),
+        new BenchmarkDecode("decode_text", BenchmarkDecode::TEXT),
+        new BenchmarkDecode("decode_packed", BenchmarkDecode::PACKED),
     };
 
     Benchmark benchmark;
@@ -5,6 +5,8 @@
 #include "dballe/exporter.h"
 #include "dballe/msg/msg.h"
 #include "dballe/msg/context.h"
+#include "dballe/msg/json_codec.h"
+#include "dballe/core/file.h"
 
 #include <wreport/bulletin.h>
 
@@ -24,6 +26,18 @@ void Converter::set_exporter(dballe::Encoding encoding, const impl::ExporterOpti
 {
     exporter = Exporter::create(encoding, opts).release();
     bexporter = dynamic_cast<const BulletinExporter*>(exporter);
+    jexporter = dynamic_cast<const impl::msg::JsonExporter*>(exporter);
+    exporter_encoding = encoding;
+    exporter_opts = opts;
+}
+
+void Converter::start_workers(unsigned count)
+{
+    worker_exporters.clear();
+    // With a single worker, prepare() can use the main exporter
+    if (count < 2 || !exporter) return;
+    for (unsigned i = 0; i < count; ++i)
+        worker_exporters.emplace_back(Exporter::create(exporter_encoding, exporter_opts));
 }
 
 void Converter::process_bufrex_msg(const BinaryMessage& orig, const Bulletin& msg)
@@ -37,15 +51,13 @@ void Converter::process_bufrex_msg(const BinaryMessage& orig, const Bulletin& ms
     file->write(raw);
 }
 
-void Converter::process_dba_msg(const BinaryMessage& orig, const std::vector<std::shared_ptr<dballe::Message>>& msgs)
+std::string Converter::encode_dba_msg(const Exporter& exporter, const BinaryMessage& orig, const std::vector<std::shared_ptr<dballe::Message>>& msgs) const
 {
-    string raw;
     try {
-        raw = exporter->to_binary(msgs);
+        return exporter.to_binary(msgs);
     } catch (std::exception& e) {
         throw ProcessingException(orig.pathname, orig.index, e);
     }
-    file->write(raw);
 }
 
 // Recompute data_category and data_subcategory according to WMO international values
@@ -176,13 +188,10 @@ static void compute_bufr2netcdf_categories(Bulletin& b, const Bulletin& orig, co
 }
 
 
-void Converter::process_dba_msg_from_bulletin(const BinaryMessage& orig, const Bulletin& bulletin, const std::vector<std::shared_ptr<dballe::Message>>& msgs)
+std::string Converter::encode_dba_msg_from_bulletin(const BulletinExporter& exporter, const BinaryMessage& orig, const Bulletin& bulletin, const std::vector<std::shared_ptr<dballe::Message>>& msgs) const
 {
-    if (!bexporter)
-        throw error_consistency("process_dba_msg_from_bulletin called with a non-bulleting exporter");
-    string raw;
     try {
-        unique_ptr<Bulletin> b1 = bexporter->to_bulletin(msgs);
+        unique_ptr<Bulletin> b1 = exporter.to_bulletin(msgs);
         if (bufr2netcdf_categories)
         {
             compute_wmo_categories(*b1, bulletin, msgs);
@@ -193,15 +202,63 @@ void Converter::process_dba_msg_from_bulletin(const BinaryMessage& orig, const B
             b1->data_subcategory_local = bulletin.data_subcategory_local;
         }
 
-        raw = b1->encode();
+        return b1->encode();
     } catch (std::exception& e) {
         throw ProcessingException(orig.pathname, orig.index, e);
     }
-    file->write(raw);
+}
+
+void Converter::force_dest_type(const cmdline::Item& item) const
+{
+    if (dest_rep_memo == NULL)
+        return;
+
+    // Force message type (will also influence choice of template later)
+    MessageType type = impl::Message::type_from_repmemo(dest_rep_memo);
+    for (auto& msg: *item.msgs)
+        impl::Message::downcast(msg)->type = type;
+}
+
+std::string Converter::encode(const Exporter& exporter, const cmdline::Item& item) const
+{
+    force_dest_type(item);
+
+    const BulletinExporter* bulletin_exporter = dynamic_cast<const BulletinExporter*>(&exporter);
+    if (bulletin_exporter and item.bulletin and dest_rep_memo == NULL)
+        return encode_dba_msg_from_bulletin(*bulletin_exporter, *item.rmsg, *item.bulletin, *item.msgs);
+    else
+        return encode_dba_msg(exporter, *item.rmsg, *item.msgs);
+}
+
+void Converter::prepare(cmdline::Item& item, unsigned worker)
+{
+    // Items without decoded messages are recoded at the bufrex level by
+    // operator(), which also reports why
+    if (item.msgs == NULL || item.msgs->size() == 0)
+        return;
+
+    if (worker < worker_exporters.size())
+        item.encoded = encode(*worker_exporters[worker], item);
+    else if (!json_output())
+        item.encoded = encode(*exporter, item);
+    // JSON output without worker threads is streamed by operator()
+}
+
+core::JsonFile* Converter::json_output() const
+{
+    if (!jexporter)
+        return nullptr;
+    return dynamic_cast<core::JsonFile*>(file);
 }
 
 bool Converter::operator()(const cmdline::Item& item)
 {
+    if (!item.encoded.empty())
+    {
+        file->write(item.encoded);
+        return true;
+    }
+
     if (item.msgs == NULL || item.msgs->size() == 0)
     {
         fprintf(stderr, "No interpreted information available: is a recoding enough?\n");
@@ -242,19 +299,18 @@ bool Converter::operator()(const cmdline::Item& item)
         return true;
     }
 
-    if (dest_rep_memo != NULL)
+    if (core::JsonFile* jfile = json_output())
     {
-        // Force message type (will also influence choice of template later)
-        MessageType type = impl::Message::type_from_repmemo(dest_rep_memo);
-        for (auto& msg: *item.msgs)
-            impl::Message::downcast(msg)->type = type;
+        force_dest_type(item);
+        try {
+            jfile->write_stream([&](std::ostream& out) { jexporter->write(*item.msgs, out); });
+        } catch (std::exception& e) {
+            throw ProcessingException(item.rmsg->pathname, item.rmsg->index, e);
+        }
+        return true;
     }
 
-    if (bexporter and item.bulletin and dest_rep_memo == NULL)
-        process_dba_msg_from_bulletin(*item.rmsg, *item.bulletin, *item.msgs);
-    else
-        process_dba_msg(*item.rmsg, *item.msgs);
-
+    file->write(encode(*exporter, item));
     return true;
 }
 
@@ -2,6 +2,10 @@
 #define DBALLE_CMDLINE_CONVERSION_H
 
 #include <dballe/cmdline/processor.h>
+#include <dballe/exporter.h>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace wreport {
 struct Bulletin;
@@ -10,6 +14,16 @@ struct Bulletin;
 namespace dballe {
 struct File;
 
+namespace core {
+class JsonFile;
+}
+
+namespace impl {
+namespace msg {
+class JsonExporter;
+}
+}
+
 namespace cmdline {
 
 struct Converter : public Action
@@ -24,15 +38,30 @@ struct Converter : public Action
 
     void set_exporter(dballe::Encoding encoding, const impl::ExporterOptions& opts);
 
+    /// Create an exporter for each worker thread
+    void start_workers(unsigned count) override;
+
     /**
-     * Convert the item as configured in the Converter, and write it to the
-     * output file
+     * Convert the decoded messages of the item as configured in the
+     * Converter, storing the result in item.encoded
      */
-    virtual bool operator()(const cmdline::Item& item);
+    void prepare(cmdline::Item& item, unsigned worker) override;
+
+    /**
+     * Convert the item as configured in the Converter, if prepare() has not
+     * done it already, and write it to the output file
+     */
+    bool operator()(const cmdline::Item& item) override;
 
 protected:
     Exporter* exporter = nullptr;
     const BulletinExporter* bexporter = nullptr;
+    const impl::msg::JsonExporter* jexporter = nullptr;
+    /// Encoding and options of the exporter, used to create worker exporters
+    dballe::Encoding exporter_encoding;
+    impl::ExporterOptions exporter_opts;
+    /// Exporters used by prepare(), one per worker thread
+    std::vector<std::unique_ptr<Exporter>> worker_exporters;
 
     /**
      * Perform conversion at the encoding level only (e.g. BUFR->CREX)
@@ -48,13 +77,22 @@ protected:
      * Perform conversion of decoded data, auto-inferring
      * type/subtype/localsubtype from the Messages contents
      */
-    void process_dba_msg(const BinaryMessage& orig, const std::vector<std::shared_ptr<dballe::Message>>& msgs);
+    std::string encode_dba_msg(const Exporter& exporter, const BinaryMessage& orig, const std::vector<std::shared_ptr<dballe::Message>>& msgs) const;
 
     /**
      * Perform conversion of decded data, using the original bulletin for
      * type/subtype/localsubtype information
      */
-    void process_dba_msg_from_bulletin(const BinaryMessage& orig, const wreport::Bulletin& bulletin, const std::vector<std::shared_ptr<dballe::Message>>& msgs);
+    std::string encode_dba_msg_from_bulletin(const BulletinExporter& exporter, const BinaryMessage& orig, const wreport::Bulletin& bulletin, const std::vector<std::shared_ptr<dballe::Message>>& msgs) const;
+
+    /// Convert decoded messages with the given exporter
+    std::string encode(const Exporter& exporter, const cmdline::Item& item) const;
+
+    /// Set the type of the decoded messages to the one of dest_rep_memo, if set
+    void force_dest_type(const cmdline::Item& item) const;
+
+    /// Return the output file if JSON output can be streamed to it, else nullptr
+    core::JsonFile* json_output() const;
 };
 
 }
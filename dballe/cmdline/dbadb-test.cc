@@ -1,6 +1,10 @@
 #include "dballe/db/tests.h"
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/driver.h"
+#include "dballe/sql/sql.h"
+#include "dballe/sql/sqlite.h"
+#include "dballe/core/data.h"
 #include "dballe/cmdline/dbadb.h"
 #include "dballe/core/arrayfile.h"
 #include "dballe/msg/msg.h"
@@ -66,6 +70,222 @@ this->add_method("import", [](Fixture& f) {
     wassert(actual(var->enq<std::string>()) == "ship");
 });
 
+this->add_method("export_parallel", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+
+    cmdline::ReaderOptions opts;
+    cmdline::Reader reader(opts);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/db-messages1.bufr"), reader, DBImportOptions::defaults)) == 0);
+
+    // Encoding with many threads gives the same output, in the same order.
+    // The parallel export runs first, so that in a new process it is the
+    // first to use the export templates
+    core::Query query;
+    core::ArrayFile parallel(Encoding::BUFR);
+    wassert(actual(dbadb.do_export(query, parallel, "", nullptr, 4)) == 0);
+    core::ArrayFile serial(Encoding::BUFR);
+    wassert(actual(dbadb.do_export(query, serial, "", nullptr)) == 0);
+
+    wassert(actual(serial.msgs.size()) > 1u);
+    wassert(actual(parallel.msgs.size()) == serial.msgs.size());
+    for (unsigned i = 0; i < serial.msgs.size(); ++i)
+        wassert(actual(parallel.msgs[i].data) == serial.msgs[i].data);
+});
+
+this->add_method("export_parallel_new_process", [this](Fixture& f) {
+    // Run export_parallel in a process where nothing has been exported yet
+    wassert_true(run_test_in_new_process(this->name + ".export_parallel"));
+});
+
+this->add_method("explain", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+
+    cmdline::ReaderOptions opts;
+    cmdline::Reader reader(opts);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/obs0-1.22.bufr"), reader, DBImportOptions::defaults)) == 0);
+
+    // Explain before and after creating the covering index, which can be
+    // repeated
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        if (i > 0)
+        {
+            FILE* out = fopen("/dev/null", "w");
+            wassert(actual(dbadb.do_covering_index(out)) == 0);
+            fclose(out);
+        }
+
+        char* buf = nullptr;
+        size_t size = 0;
+        FILE* out = open_memstream(&buf, &size);
+        core::Query query;
+        wassert(actual(dbadb.do_explain(query, out)) == 0);
+        fclose(out);
+        std::string res(buf, size);
+        free(buf);
+
+        wassert(actual(res).contains("# query_stations\n"));
+        wassert(actual(res).contains("# query_data\n"));
+        wassert(actual(res).contains("# query_summary\n"));
+        wassert(actual(res).contains(" of 5 queries need a temporary sort"));
+    }
+});
+
+this->add_method("typed_values", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+    cmdline::ReaderOptions opts;
+    cmdline::Reader reader(opts);
+    auto count = [&](const char* query) {
+        return (unsigned)f.db->query_data(core_query_from_string(query))->remaining();
+    };
+
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/obs0-1.22.bufr"), reader, DBImportOptions::defaults)) == 0);
+    unsigned all = count("var=B12101");
+    unsigned warm = count("data_filter=B12101>273.15");
+    wassert(actual(all) > 0u);
+
+    // A string value that looks like an integer
+    {
+        auto tr = dynamic_pointer_cast<db::Transaction>(f.db->transaction());
+        core::Data vals;
+        vals.station.report = "synop";
+        vals.station.coords = Coords(45.0, 11.0);
+        vals.datetime = Datetime(2001, 2, 3, 4, 5, 6);
+        vals.level = Level(1);
+        vals.trange = Trange::instant();
+        vals.values.set("B01019", "1234");
+        wassert(tr->insert_data(vals));
+        tr->commit();
+    }
+
+    // Adding typed values can be repeated
+    FILE* out = fopen("/dev/null", "w");
+    wassert(actual(dbadb.do_typed_values(out)) == 0);
+    wassert(actual(dbadb.do_typed_values(out)) == 0);
+    fclose(out);
+    wassert_true(f.db->driver().has_typed_values());
+
+    if (f.db->conn->server_type == sql::ServerType::SQLITE)
+    {
+        // Existing values get ivalue only for numeric variables
+        auto& conn = dynamic_cast<sql::SQLiteConnection&>(*f.db->conn);
+        auto count_ivalues = [&](Varcode code) {
+            unsigned res = 0;
+            auto stm = conn.sqlitestatement("SELECT COUNT(*) FROM data WHERE code=? AND ivalue IS NOT NULL");
+            stm->bind_val(1, code);
+            stm->execute([&]() { res = stm->column_int(0); });
+            return res;
+        };
+        wassert(actual(count_ivalues(WR_VAR(0, 12, 101))) == all);
+        wassert(actual(count_ivalues(WR_VAR(0, 1, 19))) == 0u);
+    }
+
+    // Filters on existing values give the same results
+    wassert(actual(count("data_filter=B12101>273.15")) == warm);
+    wassert(actual(count("data_filter=B12101<=273.15")) == all - warm);
+
+    // Typed values are kept up to date on new values
+    auto tr = dynamic_pointer_cast<db::Transaction>(f.db->transaction());
+    tr->remove_all();
+    tr->commit();
+    wassert(actual(count("var=B12101")) == 0u);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/obs0-1.22.bufr"), reader, DBImportOptions::defaults)) == 0);
+    wassert(actual(count("data_filter=B12101>273.15")) == warm);
+    wassert(actual(count("data_filter=B12101<=273.15")) == all - warm);
+});
+
+this->add_method("typed_values_partitioned", [](Fixture& f) {
+    // Typed values on a partitioned data table work on existing and new
+    // partitions
+    if (f.db->conn->server_type != sql::ServerType::POSTGRES) return;
+
+    setenv("DBA_POSTGRESQL_PARTITIONED", "1", 1);
+    f.db->reset();
+    unsetenv("DBA_POSTGRESQL_PARTITIONED");
+
+    auto insert = [&](int month) {
+        auto tr = dynamic_pointer_cast<db::Transaction>(f.db->transaction());
+        core::Data vals;
+        vals.station.report = "synop";
+        vals.station.coords = Coords(44.5, 11.5);
+        vals.level = Level(1);
+        vals.trange = Trange::instant();
+        vals.datetime = Datetime(2016, month, 15, 12);
+        vals.values.set("B12101", 270.0 + month);
+        wassert(tr->insert_data(vals));
+        tr->commit();
+    };
+    auto count = [&](const char* query) {
+        return (unsigned)f.db->query_data(core_query_from_string(query))->remaining();
+    };
+
+    insert(1);
+    Dbadb dbadb(*f.db);
+    FILE* out = fopen("/dev/null", "w");
+    wassert(actual(dbadb.do_typed_values(out)) == 0);
+    fclose(out);
+    insert(2);
+    insert(3);
+
+    wassert(actual(count("data_filter=B12101>270.5")) == 3u);
+    wassert(actual(count("data_filter=B12101>271.5")) == 2u);
+
+    // Recreate the default layout for the other tests
+    f.db->reset();
+});
+
+this->add_method("drop_partitions", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+    FILE* out = fopen("/dev/null", "w");
+
+    if (f.db->conn->server_type != sql::ServerType::POSTGRES)
+    {
+        wassert_throws(error_unimplemented, dbadb.do_drop_partitions(Datetime(2000, 1, 1), out));
+        fclose(out);
+        return;
+    }
+
+    // Without partitioning there is nothing to drop
+    wassert_throws(error_consistency, dbadb.do_drop_partitions(Datetime(2000, 1, 1), out));
+
+    setenv("DBA_POSTGRESQL_PARTITIONED", "1", 1);
+    f.db->reset();
+    unsetenv("DBA_POSTGRESQL_PARTITIONED");
+
+    // Insert values in three different months
+    auto tr = dynamic_pointer_cast<db::Transaction>(f.db->transaction());
+    for (unsigned month: { 1, 2, 3 })
+    {
+        core::Data vals;
+        vals.station.report = "synop";
+        vals.station.coords = Coords(44.5, 11.5);
+        vals.level = Level(1);
+        vals.trange = Trange::instant();
+        vals.datetime = Datetime(2016, month, 15, 12);
+        vals.values.set("B12101", 270.0 + month);
+        tr->insert_data(vals);
+    }
+    tr->commit();
+
+    // Partitions ending after the given datetime are kept
+    wassert(actual(dbadb.do_drop_partitions(Datetime(2016, 2, 10), out)) == 0);
+    fclose(out);
+
+    auto cur = f.db->query_data(core::Query());
+    wassert(actual(cur->remaining()) == 2u);
+    wassert(actual(cur->next()).istrue());
+    wassert(actual(cur->get_datetime()) == Datetime(2016, 2, 15, 12));
+
+    // The summary follows
+    auto sum = f.db->query_summary(core::Query());
+    wassert(actual(sum->next()).istrue());
+    wassert(actual(sum->get_count()) == 2u);
+    wassert(actual(sum->get_datetimerange().min) == Datetime(2016, 2, 15, 12));
+
+    // Recreate the default layout for the other tests
+    f.db->reset();
+});
+
 this->add_method("issue62", [](Fixture& f) {
     // https://github.com/ARPA-SIMC/dballe/issues/62
     Dbadb dbadb(*f.db);
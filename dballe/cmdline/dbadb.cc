@@ -1,10 +1,25 @@
 #include "dbadb.h"
 #include "dballe/message.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/json_codec.h"
+#include "dballe/core/file.h"
 #include "dballe/values.h"
 #include "dballe/db/db.h"
+#include "dballe/db/v7/db.h"
+#include "dballe/db/v7/driver.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/qbuilder.h"
+#include "dballe/sql/sql.h"
+#include "dballe/core/query.h"
 
 #include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 using namespace wreport;
 using namespace std;
@@ -50,6 +65,142 @@ bool Importer::operator()(const Item& item)
     return true;
 }
 
+/**
+ * Encode messages using a pool of threads, writing them out in the same order
+ * as they were added.
+ *
+ * Exporters load wreport tables holding impl::msg::ExclusiveTablesLock, so
+ * workers can encode messages using different tables at the same time.
+ */
+class ParallelEncoder
+{
+protected:
+    struct Job
+    {
+        std::vector<std::shared_ptr<Message>> msgs;
+        std::string encoded;
+        std::exception_ptr error;
+        bool done = false;
+    };
+
+    File& file;
+    /// Maximum number of messages added and not yet written
+    size_t max_queued;
+    std::vector<std::unique_ptr<Exporter>> exporters;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    /// Jobs in output order, waiting to be encoded or written
+    std::deque<std::unique_ptr<Job>> queue;
+    /// Jobs waiting to be encoded
+    std::deque<Job*> to_encode;
+    bool stopped = false;
+
+    void encode_main(const Exporter& exporter)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            cond.wait(lock, [&] { return stopped || !to_encode.empty(); });
+            if (stopped) return;
+            Job* job = to_encode.front();
+            to_encode.pop_front();
+
+            lock.unlock();
+            try {
+                job->encoded = exporter.to_binary(job->msgs);
+            } catch (...) {
+                job->error = std::current_exception();
+            }
+            job->msgs.clear();
+            lock.lock();
+
+            job->done = true;
+            cond.notify_all();
+        }
+    }
+
+    /// Wait for the first job in the queue to be encoded, and write it out
+    void write_next(std::unique_lock<std::mutex>& lock)
+    {
+        cond.wait(lock, [&] { return queue.front()->done; });
+        std::unique_ptr<Job> job(move(queue.front()));
+        queue.pop_front();
+        cond.notify_all();
+
+        lock.unlock();
+        if (job->error)
+            std::rethrow_exception(job->error);
+        file.write(job->encoded);
+        lock.lock();
+    }
+
+    void stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+            cond.notify_all();
+        }
+        for (auto& t: threads)
+            t.join();
+        threads.clear();
+    }
+
+public:
+    ParallelEncoder(File& file, const impl::ExporterOptions& opts, unsigned jobs)
+        : file(file), max_queued(jobs * 16)
+    {
+        for (unsigned i = 0; i < jobs; ++i)
+            exporters.emplace_back(Exporter::create(file.encoding(), opts));
+
+        try {
+            for (auto& exp: exporters)
+            {
+                const Exporter* e = exp.get();
+                threads.emplace_back([this, e] { encode_main(*e); });
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+    ParallelEncoder(const ParallelEncoder&) = delete;
+    ParallelEncoder& operator=(const ParallelEncoder&) = delete;
+    ~ParallelEncoder()
+    {
+        stop();
+    }
+
+    /**
+     * Queue a message for encoding.
+     *
+     * If too many messages are queued, wait and write out the oldest ones
+     * first.
+     */
+    void add(std::shared_ptr<Message> msg)
+    {
+        std::unique_ptr<Job> job(new Job);
+        job->msgs.emplace_back(move(msg));
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (queue.size() >= max_queued)
+            write_next(lock);
+        to_encode.push_back(job.get());
+        queue.emplace_back(move(job));
+        cond.notify_all();
+    }
+
+    /// Write out all the queued messages
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!queue.empty())
+            write_next(lock);
+    }
+};
+
 }
 
 /// Query data in the database and output results as arbitrary human readable text
@@ -91,6 +242,149 @@ int Dbadb::do_stations(const Query& query, FILE* out)
     return 0;
 }
 
+namespace {
+
+/// Run EXPLAIN on a query, returning the query plan as a string
+std::string explain_to_string(sql::Connection& conn, const std::string& query)
+{
+    char* buf = nullptr;
+    size_t size = 0;
+    FILE* plan = open_memstream(&buf, &size);
+    if (!plan)
+        throw error_system("cannot create a memory stream for the query plan");
+    try {
+        conn.explain(query, plan);
+    } catch (...) {
+        fclose(plan);
+        free(buf);
+        throw;
+    }
+    fclose(plan);
+    std::string res(buf, size);
+    free(buf);
+    return res;
+}
+
+/// Check if a query plan contains a sort of the results in a temporary structure
+bool plan_has_temp_sort(sql::ServerType server_type, const std::string& plan)
+{
+    switch (server_type)
+    {
+        case sql::ServerType::SQLITE: return plan.find("USE TEMP B-TREE") != std::string::npos;
+        case sql::ServerType::POSTGRES: return plan.find("Sort  (") != std::string::npos;
+        case sql::ServerType::MYSQL: return plan.find("Using filesort") != std::string::npos;
+        default: return false;
+    }
+}
+
+}
+
+int Dbadb::do_explain(const Query& query, FILE* out)
+{
+    db::v7::DB* v7db = dynamic_cast<db::v7::DB*>(&db);
+    if (!v7db)
+        throw error_unimplemented("explain is only supported on V7 databases");
+
+    auto tr = dynamic_pointer_cast<db::v7::Transaction>(v7db->transaction());
+    const core::Query& q = core::Query::downcast(query);
+    unsigned modifiers = q.get_modifiers();
+
+    // Build the SQL of the queries used by the various cursors
+    std::vector<std::pair<const char*, std::string>> queries;
+    {
+        db::v7::StationQueryBuilder qb(tr, q, modifiers);
+        qb.build();
+        queries.emplace_back("query_stations", qb.sql_query);
+    }
+    {
+        db::v7::DataQueryBuilder qb(tr, q, modifiers & ~DBA_DB_MODIFIER_BEST, true);
+        qb.build();
+        queries.emplace_back("query_station_data", qb.sql_query);
+    }
+    {
+        db::v7::DataQueryBuilder qb(tr, q, modifiers & ~DBA_DB_MODIFIER_BEST, false);
+        qb.build();
+        queries.emplace_back("query_data", qb.sql_query);
+    }
+    {
+        db::v7::DataQueryBuilder qb(tr, q, modifiers | DBA_DB_MODIFIER_BEST, false);
+        qb.build();
+        queries.emplace_back("query_data best", qb.sql_query);
+    }
+    {
+        db::v7::SummaryQueryBuilder qb(tr, q, modifiers & ~DBA_DB_MODIFIER_BEST, false);
+        qb.build();
+        queries.emplace_back("query_summary", qb.sql_query);
+    }
+
+    std::vector<const char*> sorted;
+    for (const auto& i: queries)
+    {
+        std::string plan = explain_to_string(*v7db->conn, i.second);
+        bool has_sort = plan_has_temp_sort(v7db->conn->server_type, plan);
+        if (has_sort)
+            sorted.push_back(i.first);
+        fprintf(out, "# %s\n", i.first);
+        fputs(plan.c_str(), out);
+        fprintf(out, "Temporary sort: %s\n\n", has_sort ? "yes" : "no");
+    }
+
+    fprintf(out, "%zu of %zu queries need a temporary sort", sorted.size(), queries.size());
+    for (auto i = sorted.begin(); i != sorted.end(); ++i)
+        fprintf(out, "%s%s", i == sorted.begin() ? ": " : ", ", *i);
+    fputc('\n', out);
+
+    tr->rollback();
+    return 0;
+}
+
+int Dbadb::do_covering_index(FILE* out)
+{
+    db::v7::DB* v7db = dynamic_cast<db::v7::DB*>(&db);
+    if (!v7db)
+        throw error_unimplemented("covering indices are only supported on V7 databases");
+
+    auto t = v7db->conn->transaction();
+    v7db->driver().create_data_covering_index_v7();
+    t->commit();
+    fprintf(out, "Covering index present on the data table\n");
+    return 0;
+}
+
+int Dbadb::do_typed_values(FILE* out)
+{
+    db::v7::DB* v7db = dynamic_cast<db::v7::DB*>(&db);
+    if (!v7db)
+        throw error_unimplemented("typed values are only supported on V7 databases");
+
+    if (v7db->driver().has_typed_values())
+    {
+        fprintf(out, "The database already has typed values\n");
+        return 0;
+    }
+
+    auto t = v7db->conn->transaction();
+    v7db->driver().create_typed_values_v7();
+    t->commit();
+    // Pooled drivers cached has_typed_values before the change
+    v7db->invalidate_pool();
+    fprintf(out, "Typed values added\n");
+    return 0;
+}
+
+int Dbadb::do_drop_partitions(const Datetime& before, FILE* out)
+{
+    db::v7::DB* v7db = dynamic_cast<db::v7::DB*>(&db);
+    if (!v7db)
+        throw error_unimplemented("partitioned data tables are only supported on V7 databases");
+
+    auto t = v7db->conn->transaction();
+    unsigned dropped = v7db->driver().drop_data_partitions_v7(before);
+    t->commit();
+    fprintf(out, "%u partition%s dropped\n", dropped, dropped == 1 ? "" : "s");
+    return 0;
+}
+
 int Dbadb::do_export_dump(const Query& query, FILE* out)
 {
     auto cursor = db.query_messages(query);
@@ -126,7 +420,7 @@ int Dbadb::do_import(const std::string& fname, Reader& reader, const DBImportOpt
     return do_import(fnames, reader, opts);
 }
 
-int Dbadb::do_export(const Query& query, File& file, const char* output_template, const char* forced_repmemo)
+int Dbadb::do_export(const Query& query, File& file, const char* output_template, const char* forced_repmemo, unsigned jobs)
 {
     impl::ExporterOptions opts;
     if (output_template && output_template[0] != 0)
@@ -134,9 +428,30 @@ int Dbadb::do_export(const Query& query, File& file, const char* output_template
 
     if (forced_repmemo)
         forced_repmemo = forced_repmemo;
-    auto exporter = Exporter::create(file.encoding(), opts);
 
-    auto cursor = db.query_messages(query);
+    // Read results incrementally, so that memory use does not depend on the
+    // size of the export
+    core::Query stream_query(core::Query::downcast(query));
+    if (stream_query.query.empty())
+        stream_query.query = "stream";
+    else
+        stream_query.query += ",stream";
+
+    std::unique_ptr<Exporter> exporter;
+    std::unique_ptr<ParallelEncoder> encoder;
+    // JSON output is streamed to the file as it is encoded
+    const impl::msg::JsonExporter* jexporter = nullptr;
+    core::JsonFile* jfile = nullptr;
+    if (jobs > 1)
+        encoder.reset(new ParallelEncoder(file, opts, jobs));
+    else
+    {
+        exporter = Exporter::create(file.encoding(), opts);
+        jexporter = dynamic_cast<const impl::msg::JsonExporter*>(exporter.get());
+        jfile = dynamic_cast<core::JsonFile*>(&file);
+    }
+
+    auto cursor = db.query_messages(stream_query);
     while (cursor->next())
     {
         auto msg = cursor->detach_message();
@@ -147,10 +462,20 @@ int Dbadb::do_export(const Query& query, File& file, const char* output_template
             m.type = impl::Message::type_from_repmemo(forced_repmemo);
             m.set_rep_memo(forced_repmemo);
         }
+        if (encoder)
+        {
+            encoder->add(move(msg));
+            continue;
+        }
         std::vector<std::shared_ptr<Message>> msgs;
         msgs.emplace_back(move(msg));
-        file.write(exporter->to_binary(msgs));
+        if (jexporter && jfile)
+            jfile->write_stream([&](std::ostream& out) { jexporter->write(msgs, out); });
+        else
+            file.write(exporter->to_binary(msgs));
     }
+    if (encoder)
+        encoder->flush();
     return 0;
 }
 
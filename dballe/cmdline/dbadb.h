@@ -34,8 +34,36 @@ public:
     /// Import one file
     int do_import(const std::string& fname, Reader& reader, const DBImportOptions& opts);
 
-    /// Export messages writing them to the givne file
-    int do_export(const Query& query, File& file, const char* output_template=NULL, const char* forced_repmemo=NULL);
+    /**
+     * Print the query plans of the database queries used to answer the given
+     * query, reporting which of them need a temporary sort of their results.
+     */
+    int do_explain(const Query& query, FILE* out);
+
+    /**
+     * Add to the database, if missing, the optional index on the data table
+     * that covers the columns read by data queries.
+     */
+    int do_covering_index(FILE* out);
+
+    /**
+     * Add to the database, if missing, the typed copy of numeric values used
+     * to look up data_filter and ana_filter constraints with an index.
+     */
+    int do_typed_values(FILE* out);
+
+    /**
+     * Remove all the data before the given datetime from a database with a
+     * partitioned data table, by dropping whole monthly partitions.
+     */
+    int do_drop_partitions(const Datetime& before, FILE* out);
+
+    /**
+     * Export messages writing them to the givne file.
+     *
+     * If jobs is more than 1, messages are encoded using that many threads.
+     */
+    int do_export(const Query& query, File& file, const char* output_template=NULL, const char* forced_repmemo=NULL, unsigned jobs=1);
 };
 
 
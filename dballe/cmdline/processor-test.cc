@@ -1,6 +1,12 @@
 #include "dballe/core/tests.h"
 #include "processor.h"
+#include "conversion.h"
+#include "dballe/file.h"
 #include <limits>
+#include <fstream>
+#include <list>
+#include <sstream>
+#include <unistd.h>
 
 using namespace dballe;
 using namespace dballe::cmdline;
@@ -133,6 +139,189 @@ add_method("issue77", [] {
     reader.read({dballe::tests::datafile("/json/issue77.json")}, action);
 });
 
+add_method("read_parallel", [] {
+    // Decoding with multiple threads gives the same results, in the same
+    // order, as decoding serially
+    struct TestAction : public Action {
+        std::vector<unsigned> indices;
+        std::vector<size_t> sizes;
+        virtual bool operator()(const Item& item)
+        {
+            indices.push_back(item.idx);
+            sizes.push_back(item.msgs ? item.msgs->size() : 0);
+            // Reject some items, to also test counting failures
+            return item.idx % 7 != 0;
+        }
+    };
+
+    ReaderOptions opts;
+    Reader serial(opts);
+    TestAction serial_action;
+    serial.read({dballe::tests::datafile("bufr/gen-generic.bufr")}, serial_action);
+
+    opts.jobs = 4;
+    Reader parallel(opts);
+    wassert(actual(parallel.jobs) == 4u);
+    TestAction parallel_action;
+    parallel.read({dballe::tests::datafile("bufr/gen-generic.bufr")}, parallel_action);
+
+    wassert(actual(serial_action.indices.size()) > 10u);
+    wassert(actual(parallel_action.indices.size()) == serial_action.indices.size());
+    for (unsigned i = 0; i < serial_action.indices.size(); ++i)
+    {
+        wassert(actual(parallel_action.indices[i]) == serial_action.indices[i]);
+        wassert(actual(parallel_action.sizes[i]) == serial_action.sizes[i]);
+    }
+    wassert(actual(parallel.count_successes) == serial.count_successes);
+    wassert(actual(parallel.count_failures) == serial.count_failures);
+});
+
+add_method("prepare_parallel", [] {
+    // Action::prepare runs in worker threads, and operator() sees its
+    // results in input order
+    struct TestAction : public Action {
+        unsigned workers = 0;
+        std::vector<std::string> prepared;
+        void start_workers(unsigned count) override { workers = count; }
+        void prepare(Item& item, unsigned worker) override
+        {
+            if (worker >= workers)
+                throw error_consistency("worker index out of range");
+            item.encoded = std::to_string(item.idx) + ":" + std::to_string(item.msgs ? item.msgs->size() : 0);
+        }
+        bool operator()(const Item& item) override
+        {
+            prepared.push_back(item.encoded);
+            return true;
+        }
+    };
+
+    ReaderOptions opts;
+    Reader serial(opts);
+    TestAction serial_action;
+    serial.read({dballe::tests::datafile("bufr/gen-generic.bufr")}, serial_action);
+    wassert(actual(serial_action.workers) == 1u);
+
+    opts.jobs = 4;
+    Reader parallel(opts);
+    TestAction parallel_action;
+    parallel.read({dballe::tests::datafile("bufr/gen-generic.bufr")}, parallel_action);
+    wassert(actual(parallel_action.workers) == 4u);
+
+    wassert(actual(serial_action.prepared.size()) > 10u);
+    wassert(actual(parallel_action.prepared.size()) == serial_action.prepared.size());
+    for (unsigned i = 0; i < serial_action.prepared.size(); ++i)
+        wassert(actual(parallel_action.prepared[i]) == serial_action.prepared[i]);
+    wassert(actual(parallel.count_failures) == 0u);
+});
+
+
+add_method("convert_parallel", [] {
+    // dbamsg convert -j 4 writes exactly the same bytes as -j 1
+    std::list<std::string> inputs {
+        dballe::tests::datafile("bufr/gen-generic.bufr"),
+        dballe::tests::datafile("bufr/gen-synop.bufr"),
+        dballe::tests::datafile("bufr/obs3-3.1.bufr"),
+        dballe::tests::datafile("bufr/temp-gts2.bufr"),
+        dballe::tests::datafile("bufr/db-messages1.bufr"),
+    };
+    auto convert = [&](Encoding encoding, int jobs, unsigned& failures) {
+        std::string fname = "convert_parallel.out";
+        ReaderOptions opts;
+        opts.jobs = jobs;
+        Reader reader(opts);
+        {
+            Converter conv;
+            conv.file = File::create(encoding, fname, "w").release();
+            conv.set_exporter(encoding, impl::ExporterOptions());
+            reader.read(inputs, conv);
+        }
+        failures = reader.count_failures;
+        std::ifstream in(fname, std::ios::binary);
+        std::stringstream res;
+        res << in.rdbuf();
+        unlink(fname.c_str());
+        return res.str();
+    };
+
+    for (auto encoding: { Encoding::BUFR, Encoding::CREX })
+    {
+        // Run the parallel conversion first, so that in a new process it is
+        // the one that loads tables and templates
+        unsigned parallel_failures, serial_failures;
+        std::string parallel = convert(encoding, 4, parallel_failures);
+        std::string serial = convert(encoding, 1, serial_failures);
+        wassert(actual(serial.size()) > 0u);
+        wassert(actual(parallel_failures) == serial_failures);
+        wassert(actual(parallel.size()) == serial.size());
+        wassert_true(parallel == serial);
+    }
+});
+
+add_method("convert_parallel_new_process", [this] {
+    // Encoding tables and templates are loaded on first use: check that
+    // their loading is safe when the first conversions run in parallel
+    wassert_true(run_test_in_new_process(this->name + ".convert_parallel"));
+});
+
+add_method("convert_parallel_mixed_tables", [] {
+    // A single file whose messages use different table versions converts
+    // the same with -j 4 as with -j 1
+    std::string fname = "convert_parallel_mixed_tables.bufr";
+    {
+        std::ofstream out(fname, std::ios::binary);
+        for (const char* name: {
+                "bufr/obs3-3.1.bufr",           // centre 254, tables 11
+                "bufr/gen-generic.bufr",        // centre 200, tables 12
+                "bufr/synop-evapo.bufr",        // centre 91, tables 13
+                "bufr/db-messages1.bufr",       // centre 98, tables 6, local 1
+                "bufr/arpa-station.bufr",       // edition 4, tables 14, local 1
+                "bufr/synop-rad1.bufr",         // edition 4, centre 78, tables 18
+                "bufr/gts-synop-linate.bufr",   // edition 4, centre 255, tables 17
+                "bufr/ed4.bufr",                // edition 4, tables 13, local 102
+            })
+        {
+            std::ifstream in(dballe::tests::datafile(name), std::ios::binary);
+            out << in.rdbuf();
+        }
+    }
+
+    auto convert = [&](Encoding encoding, int jobs, unsigned& failures) {
+        std::string outname = "convert_parallel_mixed_tables.out";
+        ReaderOptions opts;
+        opts.jobs = jobs;
+        Reader reader(opts);
+        {
+            Converter conv;
+            conv.file = File::create(encoding, outname, "w").release();
+            conv.set_exporter(encoding, impl::ExporterOptions());
+            reader.read({fname}, conv);
+        }
+        failures = reader.count_failures;
+        std::ifstream in(outname, std::ios::binary);
+        std::stringstream res;
+        res << in.rdbuf();
+        unlink(outname.c_str());
+        return res.str();
+    };
+
+    for (auto encoding: { Encoding::BUFR, Encoding::CREX })
+    {
+        unsigned parallel_failures, serial_failures;
+        std::string parallel = convert(encoding, 4, parallel_failures);
+        std::string serial = convert(encoding, 1, serial_failures);
+        wassert(actual(serial.size()) > 0u);
+        wassert(actual(parallel_failures) == serial_failures);
+        wassert(actual(parallel.size()) == serial.size());
+        wassert_true(parallel == serial);
+    }
+    unlink(fname.c_str());
+});
+
+add_method("convert_parallel_mixed_tables_new_process", [this] {
+    // No table has been loaded yet when the workers start decoding
+    wassert_true(run_test_in_new_process(this->name + ".convert_parallel_mixed_tables"));
+});
 
 }
 
@@ -3,9 +3,12 @@
 #include <wreport/utils/string.h>
 #include "dballe/file.h"
 #include "dballe/message.h"
+#include "dballe/var.h"
 #include "dballe/msg/context.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/wr_codec.h"
 #include "dballe/core/csv.h"
+#include "dballe/core/file.h"
 #include "dballe/core/match-wreport.h"
 #include "dballe/cmdline/cmdline.h"
 #include <cstring>
@@ -15,6 +18,11 @@
 #include <sstream>
 #include <stack>
 #include <limits>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 using namespace wreport;
 using namespace std;
@@ -311,8 +319,210 @@ bool Filter::match_item(const Item& item) const
         return false;
 }
 
+namespace {
+
+/// Item read from a file, decoded and matched against the filter
+struct DecodedItem
+{
+    Item item;
+    /// True if the item matches the filter
+    bool matched = false;
+    /// Exception raised while decoding or matching
+    std::exception_ptr error;
+    /// True when decoding has finished
+    bool done = false;
+    /// True if the tables needed to decode the item have been preloaded
+    bool preloaded = false;
+
+    DecodedItem(const BinaryMessage& bm)
+    {
+        item.rmsg = new BinaryMessage(bm);
+        item.idx = bm.index;
+    }
+
+    void decode(Importer& imp, const Filter& filter, bool print_errors)
+    {
+        try {
+            try {
+                if (preloaded)
+                {
+                    impl::msg::SharedTablesLock lock;
+                    item.decode(imp, print_errors);
+                } else {
+                    impl::msg::ExclusiveTablesLock lock;
+                    item.decode(imp, print_errors);
+                }
+            } catch (std::exception& e) {
+                // Convert decode errors into ProcessingException, to skip
+                // this item if it fails to decode. We can safely skip,
+                // because if file->read() returned successfully the next
+                // read should properly start at the next item
+                item.processing_failed(e);
+            }
+            matched = filter.match_item(item);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    void prepare(Action& action, unsigned worker)
+    {
+        if (error || !matched) return;
+        try {
+            action.prepare(item, worker);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+};
+
+/**
+ * Decode the messages of a file using multiple threads.
+ *
+ * One thread reads messages from the file, and a pool of threads decodes
+ * them and runs Action::prepare on them. Decoded items are returned by next()
+ * in the order they have in the file.
+ *
+ * wreport loads tables lazily and without locking: the reading thread loads
+ * the tables of each message with impl::msg::preload_tables() before queueing
+ * it, so that workers can decode it holding only a shared lock on the tables.
+ */
+class ParallelDecoder
+{
+protected:
+    File& file;
+    const Filter& filter;
+    Action& action;
+    bool print_errors;
+    /// Maximum number of items read from the file and not yet returned
+    size_t max_queued;
+    std::vector<std::unique_ptr<Importer>> importers;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    /// Items in file order, waiting to be decoded or returned
+    std::deque<std::unique_ptr<DecodedItem>> queue;
+    /// Items waiting to be decoded
+    std::deque<DecodedItem*> to_decode;
+    bool end_of_input = false;
+    bool stopped = false;
+    std::exception_ptr read_error;
+
+    void read_main()
+    {
+        try {
+            while (BinaryMessage bm = file.read())
+            {
+                if (!filter.match_index(bm.index))
+                    continue;
+                std::unique_ptr<DecodedItem> decoded(new DecodedItem(bm));
+                decoded->preloaded = impl::msg::preload_tables(bm);
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&] { return stopped || queue.size() < max_queued; });
+                if (stopped) return;
+                to_decode.push_back(decoded.get());
+                queue.emplace_back(move(decoded));
+                cond.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            read_error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        end_of_input = true;
+        cond.notify_all();
+    }
+
+    void decode_main(Importer& imp, unsigned worker)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            cond.wait(lock, [&] { return stopped || end_of_input || !to_decode.empty(); });
+            if (stopped) return;
+            if (to_decode.empty())
+                return;
+            DecodedItem* decoded = to_decode.front();
+            to_decode.pop_front();
+
+            lock.unlock();
+            decoded->decode(imp, filter, print_errors);
+            decoded->prepare(action, worker);
+            lock.lock();
+
+            decoded->done = true;
+            cond.notify_all();
+        }
+    }
+
+    void stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped = true;
+            cond.notify_all();
+        }
+        for (auto& t: threads)
+            t.join();
+        threads.clear();
+    }
+
+public:
+    ParallelDecoder(File& file, const Filter& filter, Action& action, const impl::ImporterOptions& import_opts, bool print_errors, unsigned jobs)
+        : file(file), filter(filter), action(action), print_errors(print_errors), max_queued(jobs * 16)
+    {
+        for (unsigned i = 0; i < jobs; ++i)
+            importers.emplace_back(Importer::create(file.encoding(), import_opts));
+        action.start_workers(jobs);
+
+        try {
+            threads.emplace_back([this] { read_main(); });
+            for (unsigned worker = 0; worker < importers.size(); ++worker)
+            {
+                Importer* i = importers[worker].get();
+                threads.emplace_back([this, i, worker] { decode_main(*i, worker); });
+            }
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+    ParallelDecoder(const ParallelDecoder&) = delete;
+    ParallelDecoder& operator=(const ParallelDecoder&) = delete;
+    ~ParallelDecoder()
+    {
+        stop();
+    }
+
+    /**
+     * Return the next decoded item, or nullptr at the end of the file.
+     *
+     * If reading the file failed, the exception is rethrown here after all
+     * the items read before the failure have been returned.
+     */
+    std::unique_ptr<DecodedItem> next()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return queue.empty() ? end_of_input : queue.front()->done; });
+        if (queue.empty())
+        {
+            if (read_error)
+                std::rethrow_exception(read_error);
+            return std::unique_ptr<DecodedItem>();
+        }
+        std::unique_ptr<DecodedItem> res(move(queue.front()));
+        queue.pop_front();
+        cond.notify_all();
+        return res;
+    }
+};
+
+}
+
 Reader::Reader(const ReaderOptions& opts)
-    : input_type(opts.input_type), fail_file_name(opts.fail_file_name), filter(opts)
+    : input_type(opts.input_type), fail_file_name(opts.fail_file_name), filter(opts),
+      jobs(opts.jobs > 1 ? opts.jobs : 1), mmap(opts.mmap || opts.mmap_index), mmap_index(opts.mmap_index)
 {
 }
 
@@ -330,6 +540,7 @@ void Reader::read_csv(const std::list<std::string>& fnames, Action& action)
     // and once to parse the BinaryMessage strings.
     Item item;
     unique_ptr<CSVReader> csvin;
+    action.start_workers(1);
 
     list<string>::const_iterator name = fnames.begin();
     do
@@ -363,6 +574,8 @@ void Reader::read_csv(const std::list<std::string>& fnames, Action& action)
             if (!filter.match_item(item))
                 continue;
 
+            item.encoded.clear();
+            action.prepare(item, 0);
             action(item);
         }
     } while (name != fnames.end());
@@ -398,36 +611,26 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
             }
         }
 
-
-        std::unique_ptr<Importer> imp = Importer::create(file->encoding(), import_opts);
-        while (BinaryMessage bm = file->read())
+        // Switch regular BUFR files to memory mapped access
+        if (mmap && file->encoding() == Encoding::BUFR && core::MmapBufrFile::can_map(file->pathname()))
         {
-            Item item;
-            item.rmsg = new BinaryMessage(bm);
-            item.idx = bm.index;
-            bool processed = false;
+            std::string pathname = file->pathname();
+            file.reset();
+            file.reset(new core::MmapBufrFile(pathname, mmap_index));
+        }
+        core::MmapBufrFile* mapped = dynamic_cast<core::MmapBufrFile*>(file.get());
 
-            try {
-    //          if (op_verbose)
-    //              fprintf(stderr, "Reading message #%d...\n", item.index);
 
-                if (!filter.match_index(item.idx))
-                    continue;
-
-                try {
-                    item.decode(*imp, print_errors);
-                } catch (std::exception& e) {
-                    // Convert decode errors into ProcessingException, to skip
-                    // this item if it fails to decode. We can safely skip,
-                    // because if file->read() returned successfully the next
-                    // read should properly start at the next item
-                    item.processing_failed(e);
-                }
+        auto process = [&](DecodedItem& decoded) {
+            Item& item = decoded.item;
+            bool processed = false;
 
-                //process_input(*file, rmsg, grepdata, action);
+            try {
+                if (decoded.error)
+                    std::rethrow_exception(decoded.error);
 
-                if (!filter.match_item(item))
-                    continue;
+                if (!decoded.matched)
+                    return;
 
                 processed = action(item);
             } catch (ProcessingException& pe) {
@@ -453,6 +656,40 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
                 ++count_successes;
             else
                 ++count_failures;
+        };
+
+        if (jobs > 1)
+        {
+            ParallelDecoder decoder(*file, filter, action, import_opts, print_errors, jobs);
+            while (std::unique_ptr<DecodedItem> decoded = decoder.next())
+                process(*decoded);
+        } else {
+            std::unique_ptr<Importer> imp = Importer::create(file->encoding(), import_opts);
+            action.start_workers(1);
+            if (mapped)
+            {
+                // Skip messages excluded by the index filter without
+                // copying them out of the memory map
+                for (unsigned idx = 0; idx < mapped->size(); ++idx)
+                {
+                    if (!filter.match_index(idx))
+                        continue;
+                    DecodedItem decoded(mapped->read_at(idx));
+                    decoded.decode(*imp, filter, print_errors);
+                    decoded.prepare(action, 0);
+                    process(decoded);
+                }
+            } else {
+                while (BinaryMessage bm = file->read())
+                {
+                    if (!filter.match_index(bm.index))
+                        continue;
+                    DecodedItem decoded(bm);
+                    decoded.decode(*imp, filter, print_errors);
+                    decoded.prepare(action, 0);
+                    process(decoded);
+                }
+            }
         }
     } while (name != fnames.end());
 }
@@ -101,6 +101,8 @@ struct Item
     BinaryMessage* rmsg;
     wreport::Bulletin* bulletin;
     std::vector<std::shared_ptr<Message>>* msgs;
+    /// Output data prepared by Action::prepare
+    std::string encoded;
 
     Item();
     ~Item();
@@ -118,6 +120,24 @@ struct Item
 struct Action
 {
     virtual ~Action() {}
+
+    /**
+     * Called before reading, with the number of threads that will call
+     * prepare(), to allocate the state that they need
+     */
+    virtual void start_workers(unsigned count) {}
+
+    /**
+     * Do the part of the processing of a decoded item that does not depend
+     * on the other items, like encoding it, storing results in the item.
+     *
+     * With more than one job, this is called in parallel by worker threads on
+     * different items. worker is the index of the calling thread, from 0 to
+     * the count passed to start_workers().
+     */
+    virtual void prepare(Item& item, unsigned worker) {}
+
+    /// Process an item. Items are processed one at a time, in input order
     virtual bool operator()(const Item& item) = 0;
 };
 
@@ -140,6 +160,12 @@ struct ReaderOptions
     const char* index_filter = nullptr;
     const char* input_type = "auto";
     const char* fail_file_name = nullptr;
+    /// Number of threads used to decode input messages
+    int jobs = 1;
+    /// Read BUFR files through a memory map
+    int mmap = 0;
+    /// Save and reuse the message offsets of memory mapped BUFR files in a sidecar index file
+    int mmap_index = 0;
 };
 
 struct Filter
@@ -189,6 +215,17 @@ public:
     impl::ImporterOptions import_opts;
     Filter filter;
     bool verbose = false;
+    /**
+     * Number of threads used to decode input messages.
+     *
+     * If more than 1, messages are read by a separate thread and decoded in
+     * parallel, and are still passed to the action in their original order.
+     */
+    unsigned jobs = 1;
+    /// Read BUFR files through a memory map
+    bool mmap = false;
+    /// Save and reuse the message offsets of memory mapped BUFR files
+    bool mmap_index = false;
     unsigned count_successes = 0;
     unsigned count_failures = 0;
 
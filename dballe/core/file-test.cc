@@ -1,5 +1,9 @@
 #include "core/tests.h"
 #include "core/file.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using namespace dballe;
 using namespace dballe::tests;
@@ -15,6 +19,146 @@ class Tests : public TestCase
     {
         add_method("empty", []() {
         });
+
+        add_method("mmap_bufr", []() {
+            std::string fname = tests::datafile("bufr/db-messages1.bufr");
+
+            // Read the file sequentially for reference
+            std::vector<BinaryMessage> expected;
+            auto file = File::create(Encoding::BUFR, fname, "r");
+            while (BinaryMessage bm = file->read())
+                expected.push_back(bm);
+            wassert(actual(expected.size()) > 1u);
+
+            // The memory mapped file finds the same messages
+            core::MmapBufrFile mapped(fname);
+            wassert(actual(mapped.size()) == expected.size());
+            for (const auto& e: expected)
+            {
+                BinaryMessage bm = wcallchecked(mapped.read());
+                wassert(actual(bm).istrue());
+                wassert(actual(bm.data) == e.data);
+                wassert(actual(bm.offset) == e.offset);
+                wassert(actual(bm.index) == e.index);
+                wassert(actual(bm.pathname) == fname);
+            }
+            wassert(actual(mapped.read()).isfalse());
+
+            // Random access
+            unsigned last = expected.size() - 1;
+            wassert(actual(mapped.read_at(last).data) == expected[last].data);
+            wassert(actual(memcmp(mapped.data(1), expected[1].data.data(), expected[1].data.size())) == 0);
+            wassert_throws(std::out_of_range, mapped.read_at(expected.size()));
+
+            mapped.seek(1);
+            BinaryMessage bm = wcallchecked(mapped.read());
+            wassert(actual(bm.index) == 1);
+            wassert(actual(bm.data) == expected[1].data);
+
+            wassert(mapped.close());
+            wassert_throws(wreport::error_consistency, mapped.read());
+        });
+
+        add_method("mmap_bufr_corrupted", []() {
+            // Invalid messages are skipped, and the following ones are read
+            std::vector<std::string> msgs;
+            auto file = File::create(Encoding::BUFR, tests::datafile("bufr/db-messages1.bufr"), "r");
+            while (BinaryMessage bm = file->read())
+                msgs.push_back(bm.data);
+            wassert(actual(msgs.size()) > 2u);
+
+            std::string truncated = msgs[1].substr(0, msgs[1].size() / 2);
+            std::string no_end = msgs[1];
+            no_end[no_end.size() - 1] = '8';
+            std::string edition1 = msgs[1];
+            edition1[7] = 1;
+
+            std::string fname = "mmap_bufr_corrupted.bufr";
+            FILE* out = fopen(fname.c_str(), "wb");
+            for (const auto& data: { msgs[0], truncated, msgs[2], no_end, edition1, msgs[0] })
+                fwrite(data.data(), data.size(), 1, out);
+            fclose(out);
+
+            core::MmapBufrFile mapped(fname);
+            wassert(actual(mapped.size()) == 3u);
+            wassert(actual(mapped.read_at(0).data) == msgs[0]);
+            wassert(actual(mapped.read_at(1).data) == msgs[2]);
+            wassert(actual(mapped.read_at(2).data) == msgs[0]);
+            unlink(fname.c_str());
+        });
+
+        add_method("mmap_bufr_index", []() {
+            std::string fname = tests::datafile("bufr/db-messages1.bufr");
+            std::string idxname = "mmap_bufr_index.idx";
+            unlink(idxname.c_str());
+
+            core::MmapBufrFile mapped(fname);
+            wassert_false(mapped.load_index(idxname));
+            wassert(mapped.save_index(idxname));
+
+            // A new file loads the same offsets from the index
+            core::MmapBufrFile mapped1(fname);
+            wassert_true(mapped1.load_index(idxname));
+            wassert(actual(mapped1.size()) == mapped.size());
+            for (unsigned i = 0; i < mapped.size(); ++i)
+            {
+                wassert(actual(mapped1.span(i).offset) == mapped.span(i).offset);
+                wassert(actual(mapped1.span(i).size) == mapped.span(i).size);
+            }
+
+            // The index of a different file is not used
+            core::MmapBufrFile other(tests::datafile("bufr/bufr1"));
+            wassert_false(other.load_index(idxname));
+            wassert(actual(other.size()) == 1u);
+
+            unlink(idxname.c_str());
+        });
+
+        add_method("mmap_bufr_index_errors", []() {
+            std::string fname = "mmap_bufr_index_errors.bufr";
+            std::string idxname = core::MmapBufrFile::index_pathname(fname);
+            std::string data = File::create(Encoding::BUFR, tests::datafile("bufr/bufr1"), "r")->read().data;
+            FILE* out = fopen(fname.c_str(), "wb");
+            fwrite(data.data(), data.size(), 1, out);
+            fclose(out);
+            unlink(idxname.c_str());
+
+            // An index claiming more messages than can fit in the file is
+            // rejected
+            {
+                core::MmapBufrFile mapped(fname);
+                wassert(mapped.save_index(idxname));
+                FILE* idx = fopen(idxname.c_str(), "r+b");
+                uint64_t count = 0xffffffffffffull;
+                fseek(idx, 32, SEEK_SET);
+                fwrite(&count, sizeof(count), 1, idx);
+                fclose(idx);
+                wassert_false(mapped.load_index(idxname));
+                wassert(actual(mapped.size()) == 1u);
+            }
+            unlink(idxname.c_str());
+
+            // If the index cannot be written, the scanned file is used
+            wassert(actual(mkdir(idxname.c_str(), 0755)) == 0);
+            {
+                core::MmapBufrFile mapped(fname, true);
+                wassert(actual(mapped.size()) == 1u);
+            }
+            rmdir(idxname.c_str());
+            unlink((idxname + ".tmp").c_str());
+            unlink(fname.c_str());
+        });
+
+        add_method("mmap_bufr_truncated", []() {
+            std::string fname = "mmap_bufr_truncated.bufr";
+            std::string data = File::create(Encoding::BUFR, tests::datafile("bufr/bufr1"), "r")->read().data;
+            FILE* out = fopen(fname.c_str(), "wb");
+            fwrite(data.data(), data.size() - 10, 1, out);
+            fclose(out);
+
+            wassert_throws(wreport::error_consistency, std::unique_ptr<core::MmapBufrFile>(new core::MmapBufrFile(fname)));
+            unlink(fname.c_str());
+        });
     }
 } test("core_file");
 
@@ -4,6 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
 
 using namespace wreport;
 using namespace std;
@@ -79,6 +87,262 @@ void BufrFile::write(const std::string& msg)
     BufrBulletin::write(msg, fd, m_name.c_str());
 }
 
+namespace {
+
+/// Header of the index file of a MmapBufrFile
+struct IndexHeader
+{
+    char magic[8];
+    uint64_t file_size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t count;
+};
+
+const char index_magic[8] = { 'D', 'B', 'A', 'I', 'D', 'X', '1', '\n' };
+
+}
+
+MmapBufrFile::MmapBufrFile(const std::string& name, bool use_index)
+    : File(name, nullptr, false)
+{
+    mfd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (mfd == -1)
+        error_system::throwf("cannot open %s", name.c_str());
+
+    struct stat st;
+    if (fstat(mfd, &st) == -1)
+    {
+        int e = errno;
+        ::close(mfd);
+        throw error_system("cannot stat " + name, e);
+    }
+    mapped_size = st.st_size;
+    mtime = st.st_mtim;
+
+    if (mapped_size > 0)
+    {
+        void* res = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, mfd, 0);
+        if (res == MAP_FAILED)
+        {
+            int e = errno;
+            ::close(mfd);
+            throw error_system("cannot memory map " + name, e);
+        }
+        mapped = (const char*)res;
+        madvise(res, mapped_size, MADV_SEQUENTIAL);
+    }
+
+    if (use_index)
+    {
+        std::string idxname = index_pathname(name);
+        if (!load_index(idxname))
+        {
+            scan();
+            // The index is only an optimization: keep the scanned spans if
+            // it cannot be written, for example in a read-only directory
+            try {
+                save_index(idxname);
+            } catch (std::exception& e) {
+                fprintf(stderr, "warning: %s\n", e.what());
+            }
+        }
+    } else
+        scan();
+}
+
+MmapBufrFile::~MmapBufrFile()
+{
+    close();
+}
+
+void MmapBufrFile::close()
+{
+    if (mapped)
+    {
+        munmap((void*)mapped, mapped_size);
+        mapped = nullptr;
+    }
+    if (mfd != -1)
+    {
+        ::close(mfd);
+        mfd = -1;
+    }
+}
+
+void MmapBufrFile::scan()
+{
+    spans.clear();
+    size_t pos = 0;
+    while (pos < mapped_size)
+    {
+        const char* start = (const char*)memmem(mapped + pos, mapped_size - pos, "BUFR", 4);
+        if (!start) break;
+        size_t ofs = start - mapped;
+        if (mapped_size - ofs < 8)
+        {
+            fprintf(stderr, "warning: %s: skipping BUFR message at offset %zu: it is truncated\n", m_name.c_str(), ofs);
+            break;
+        }
+
+        // Skip invalid messages with a warning, and look for the next one
+        // right after their header, since their length cannot be trusted
+        const unsigned char* sec0 = (const unsigned char*)start;
+        size_t len = (sec0[4] << 16) | (sec0[5] << 8) | sec0[6];
+        if (sec0[7] < 2)
+            fprintf(stderr, "warning: %s: skipping BUFR message at offset %zu: edition %d has no total length in section 0\n", m_name.c_str(), ofs, (int)sec0[7]);
+        else if (len < 12 || len > mapped_size - ofs)
+            fprintf(stderr, "warning: %s: skipping BUFR message at offset %zu: length is %zu but only %zu bytes are left\n", m_name.c_str(), ofs, len, mapped_size - ofs);
+        else if (memcmp(start + len - 4, "7777", 4) != 0)
+            fprintf(stderr, "warning: %s: skipping BUFR message at offset %zu: it does not end with 7777\n", m_name.c_str(), ofs);
+        else
+        {
+            spans.push_back(Span{(off_t)ofs, len});
+            pos = ofs + len;
+            continue;
+        }
+        pos = ofs + 4;
+    }
+}
+
+BinaryMessage MmapBufrFile::read()
+{
+    if (mfd == -1)
+        throw error_consistency("cannot read from a closed file");
+    if ((unsigned)idx >= spans.size())
+        return BinaryMessage(Encoding::BUFR);
+    return read_at(idx++);
+}
+
+void MmapBufrFile::write(const std::string& msg)
+{
+    throw error_consistency("cannot write to a memory mapped file");
+}
+
+const char* MmapBufrFile::data(unsigned idx) const
+{
+    if (mfd == -1)
+        throw error_consistency("cannot read from a closed file");
+    return mapped + spans.at(idx).offset;
+}
+
+BinaryMessage MmapBufrFile::read_at(unsigned idx) const
+{
+    BinaryMessage res(Encoding::BUFR);
+    const Span& span = spans.at(idx);
+    res.data.assign(data(idx), span.size);
+    res.pathname = m_name;
+    res.offset = span.offset;
+    res.index = idx;
+    return res;
+}
+
+void MmapBufrFile::seek(unsigned idx)
+{
+    if (idx > spans.size())
+        error_consistency::throwf("cannot seek to message %u of %s, which has %zu messages", idx, m_name.c_str(), spans.size());
+    this->idx = idx;
+}
+
+bool MmapBufrFile::load_index(const std::string& pathname)
+{
+    FILE* in = fopen(pathname.c_str(), "rb");
+    if (!in)
+    {
+        if (errno == ENOENT) return false;
+        error_system::throwf("cannot open %s", pathname.c_str());
+    }
+
+    IndexHeader header;
+    bool valid = fread(&header, sizeof(header), 1, in) == 1
+        && memcmp(header.magic, index_magic, sizeof(index_magic)) == 0
+        && header.file_size == mapped_size
+        && header.mtime_sec == mtime.tv_sec
+        && header.mtime_nsec == mtime.tv_nsec
+        // Each message is at least 12 bytes long: do not trust counts that
+        // could not fit in the file, before allocating memory for them
+        && header.count <= mapped_size / 12;
+    std::vector<Span> res;
+    if (valid)
+    {
+        res.reserve(header.count);
+        std::vector<uint64_t> buf(header.count * 2);
+        valid = fread(buf.data(), sizeof(uint64_t), buf.size(), in) == buf.size();
+        for (size_t i = 0; valid && i < header.count; ++i)
+        {
+            Span span{(off_t)buf[i * 2], (size_t)buf[i * 2 + 1]};
+            // Do not trust offsets that fall outside the file
+            if (span.size > mapped_size || (size_t)span.offset > mapped_size - span.size)
+                valid = false;
+            res.push_back(span);
+        }
+    }
+    fclose(in);
+
+    if (valid)
+        spans = std::move(res);
+    return valid;
+}
+
+void MmapBufrFile::save_index(const std::string& pathname) const
+{
+    IndexHeader header;
+    memcpy(header.magic, index_magic, sizeof(index_magic));
+    header.file_size = mapped_size;
+    header.mtime_sec = mtime.tv_sec;
+    header.mtime_nsec = mtime.tv_nsec;
+    header.count = spans.size();
+
+    std::vector<uint64_t> buf;
+    buf.reserve(spans.size() * 2);
+    for (const auto& span: spans)
+    {
+        buf.push_back(span.offset);
+        buf.push_back(span.size);
+    }
+
+    // Write to a temporary file and rename, so that concurrent readers never
+    // see a partial index
+    std::string tmpname = pathname + ".tmp";
+    FILE* out = fopen(tmpname.c_str(), "wb");
+    if (!out)
+        error_system::throwf("cannot create %s", tmpname.c_str());
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(buf.data(), sizeof(uint64_t), buf.size(), out);
+    if (ferror(out))
+    {
+        int e = errno;
+        fclose(out);
+        unlink(tmpname.c_str());
+        throw error_system("cannot write " + tmpname, e);
+    }
+    if (fclose(out) != 0)
+    {
+        int e = errno;
+        unlink(tmpname.c_str());
+        throw error_system("cannot write " + tmpname, e);
+    }
+    if (rename(tmpname.c_str(), pathname.c_str()) != 0)
+    {
+        int e = errno;
+        unlink(tmpname.c_str());
+        throw error_system("cannot rename " + tmpname + " to " + pathname, e);
+    }
+}
+
+std::string MmapBufrFile::index_pathname(const std::string& name)
+{
+    return name + ".idx";
+}
+
+bool MmapBufrFile::can_map(const std::string& name)
+{
+    struct stat st;
+    if (stat(name.c_str(), &st) == -1)
+        return false;
+    return S_ISREG(st.st_mode);
+}
+
 BinaryMessage CrexFile::read()
 {
     if (fd == nullptr)
@@ -107,13 +371,20 @@ BinaryMessage JsonFile::read()
 
     BinaryMessage res(Encoding::JSON);
     long offset = ftell(fd);
-    int c;
-    while ((c = getc(fd)) != EOF)
+    // Read the line in chunks, appending them to the message
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), fd))
     {
-        if (c == '\n')
+        size_t len = strlen(buf);
+        if (len > 0 && buf[len - 1] == '\n')
+        {
+            res.data.append(buf, len - 1);
             break;
-        res.data += c;
+        }
+        res.data.append(buf, len);
     }
+    if (ferror(fd))
+        error_system::throwf("cannot read JSON line from %s", m_name.c_str());
     if (res.data.empty())
         return res;
 
@@ -135,5 +406,42 @@ void JsonFile::write(const std::string& msg)
     //     error_system::throwf("cannot write JSON line terminator to %s", m_name.c_str());
 }
 
+namespace {
+
+/// Unbuffered stream buffer writing to a FILE*, which does its own buffering
+struct StdioStreambuf : public std::streambuf
+{
+    FILE* fd;
+
+    StdioStreambuf(FILE* fd) : fd(fd) {}
+
+    int_type overflow(int_type c) override
+    {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        if (putc(c, fd) == EOF)
+            return traits_type::eof();
+        return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        return fwrite(s, 1, n, fd);
+    }
+};
+
+}
+
+void JsonFile::write_stream(std::function<void(std::ostream&)> writer)
+{
+    if (fd == nullptr)
+        throw error_consistency("cannot write to a closed file");
+    StdioStreambuf buf(fd);
+    std::ostream out(&buf);
+    writer(out);
+    if (!out || ferror(fd))
+        error_system::throwf("cannot write JSON line to %s", m_name.c_str());
+}
+
 }
 }
@@ -7,6 +7,10 @@
 #include <string>
 #include <cstdio>
 #include <functional>
+#include <iosfwd>
+#include <vector>
+#include <sys/types.h>
+#include <time.h>
 
 namespace dballe {
 namespace core {
@@ -58,6 +62,97 @@ public:
     void write(const std::string& msg) override;
 };
 
+/**
+ * Read-only BUFR file accessed through a memory map.
+ *
+ * The file is scanned once to locate the start and end of each message,
+ * after which messages can be read in sequence or by index, and their encoded
+ * data can be accessed directly in the memory map without copying.
+ *
+ * The message offsets can be saved to a sidecar index file, to avoid
+ * scanning the file again the next time it is opened. The index is
+ * invalidated if the size or modification time of the file change.
+ */
+class MmapBufrFile : public dballe::core::File
+{
+public:
+    /// Location of a message in the file
+    struct Span
+    {
+        off_t offset;
+        size_t size;
+    };
+
+protected:
+    /// File descriptor of the mapped file
+    int mfd = -1;
+    /// Mapped file contents
+    const char* mapped = nullptr;
+    /// Size of the mapped file
+    size_t mapped_size = 0;
+    /// Modification time of the mapped file
+    struct timespec mtime;
+    /// Location of all messages in the file
+    std::vector<Span> spans;
+
+    /**
+     * Scan the file to locate all messages.
+     *
+     * Truncated or invalid messages are skipped with a warning on stderr,
+     * and scanning continues with the following messages.
+     */
+    void scan();
+
+public:
+    /**
+     * Map the file.
+     *
+     * If use_index is true, message locations are read from the index file,
+     * if it exists and it is up to date. Otherwise, the file is scanned, and
+     * the index file is written afterwards: if that fails, a warning is
+     * printed to stderr and the scanned message locations are used.
+     */
+    MmapBufrFile(const std::string& name, bool use_index=false);
+    ~MmapBufrFile();
+
+    Encoding encoding() const override { return Encoding::BUFR; }
+    void close() override;
+    BinaryMessage read() override;
+    void write(const std::string& msg) override;
+
+    /// Number of messages in the file
+    unsigned size() const { return spans.size(); }
+
+    /// Location of the message with the given index
+    const Span& span(unsigned idx) const { return spans.at(idx); }
+
+    /// Encoded data of the message with the given index, pointing into the memory map
+    const char* data(unsigned idx) const;
+
+    /// Read the message with the given index, without changing the position of read()
+    BinaryMessage read_at(unsigned idx) const;
+
+    /// Set the index of the next message returned by read()
+    void seek(unsigned idx);
+
+    /**
+     * Load message locations from an index file.
+     *
+     * Returns false if the index file does not exist or does not match the
+     * file.
+     */
+    bool load_index(const std::string& pathname);
+
+    /// Save message locations to an index file
+    void save_index(const std::string& pathname) const;
+
+    /// Pathname of the index file used for the given file
+    static std::string index_pathname(const std::string& name);
+
+    /// Check if a file can be memory mapped, that is, if it is a regular file
+    static bool can_map(const std::string& name);
+};
+
 class CrexFile : public dballe::core::File
 {
 public:
@@ -78,6 +173,12 @@ public:
     Encoding encoding() const override { return Encoding::JSON; }
     BinaryMessage read() override;
     void write(const std::string& msg) override;
+
+    /**
+     * Write to the file through a std::ostream, without building the output
+     * in memory first
+     */
+    void write_stream(std::function<void(std::ostream&)> writer);
 };
 
 }
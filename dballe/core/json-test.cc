@@ -100,6 +100,65 @@ class Tests : public TestCase
             writer.end_mapping();
             wassert(actual(out.str()) == "{\"\":1,\"antani\":1.0}");
         });
+        add_method("write_error", []() {
+            // A stream buffer that fails all writes
+            struct FailingBuf : public std::streambuf {};
+            FailingBuf buf;
+            std::ostream out(&buf);
+            core::JSONWriter writer(out);
+            wassert_true(out.good());
+            writer.add_int(1);
+            wassert_true(out.bad());
+
+            std::ostream out1(&buf);
+            core::JSONWriter writer1(out1);
+            writer1.add_null();
+            wassert_true(out1.bad());
+        });
+        add_method("parse_buffer", []() {
+            // Parsing from a buffer gives the same events as parsing a stream
+            struct Recorder : public core::JSONReader
+            {
+                std::string events;
+                void on_start_list() override { events += "["; }
+                void on_end_list() override { events += "]"; }
+                void on_start_mapping() override { events += "{"; }
+                void on_end_mapping() override { events += "}"; }
+                void on_add_null() override { events += "null,"; }
+                void on_add_bool(bool val) override { events += val ? "true," : "false,"; }
+                void on_add_int(int val) override { events += "i" + std::to_string(val) + ","; }
+                void on_add_double(double val) override { events += "d" + std::to_string(val) + ","; }
+                void on_add_string(const std::string& val) override { events += "s" + val + ","; }
+            };
+
+            std::string json = R"( {"a": [1, -2, 3.5, -1e2, true, false, null], "b\"\n\\c": "x\ty",)"
+                               R"( "": {}, "l": [[], [""]]} 12 "end" )";
+
+            Recorder from_stream;
+            std::stringstream in(json);
+            while (!in.eof())
+                from_stream.parse(in);
+
+            Recorder from_buffer;
+            const char* cur = json.data();
+            const char* end = json.data() + json.size();
+            while (cur != end)
+                cur = from_buffer.parse(cur, end);
+
+            wassert(actual(from_buffer.events) == "{sa,[i1,i-2,d3.500000,d-100.000000,true,false,null,]sb\"\n\\c,sx\ty,s,{}sl,[[][s,]]}i12,send,");
+            wassert(actual(from_buffer.events) == from_stream.events);
+
+            // Errors are detected
+            Recorder errors;
+            std::string bad = "[1, 2";
+            wassert_throws(core::JSONParseException, errors.parse(bad.data(), bad.data() + bad.size()));
+            bad = "\"unterminated";
+            wassert_throws(core::JSONParseException, errors.parse(bad.data(), bad.data() + bad.size()));
+            bad = "99999999999";
+            wassert_throws(core::JSONParseException, errors.parse(bad.data(), bad.data() + bad.size()));
+            bad = "nul";
+            wassert_throws(core::JSONParseException, errors.parse(bad.data(), bad.data() + bad.size()));
+        });
     };
 } test("core_json");
 
@@ -2,6 +2,10 @@
 #include "dballe/values.h"
 #include <cctype>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <climits>
 
 using namespace std;
 
@@ -11,6 +15,23 @@ namespace core {
 JSONWriter::JSONWriter(std::ostream& out) : out(out) {}
 JSONWriter::~JSONWriter() {}
 
+void JSONWriter::jputc(char c)
+{
+    if (out.rdbuf()->sputc(c) == std::char_traits<char>::eof())
+        out.setstate(std::ios::badbit);
+}
+
+void JSONWriter::jputs(const char* s)
+{
+    jputs(s, strlen(s));
+}
+
+void JSONWriter::jputs(const char* s, size_t len)
+{
+    if (out.rdbuf()->sputn(s, len) != (std::streamsize)len)
+        out.setstate(std::ios::badbit);
+}
+
 void JSONWriter::reset()
 {
     stack.clear();
@@ -23,10 +44,10 @@ void JSONWriter::val_head()
         switch (stack.back())
         {
             case LIST_FIRST: stack.back() = LIST; break;
-            case LIST: out << ','; break;
+            case LIST: jputc(','); break;
             case MAPPING_KEY_FIRST: stack.back() = MAPPING_VAL; break;
-            case MAPPING_KEY: out << ','; stack.back() = MAPPING_VAL; break;
-            case MAPPING_VAL: out << ':'; stack.back() = MAPPING_KEY; break;
+            case MAPPING_KEY: jputc(','); stack.back() = MAPPING_VAL; break;
+            case MAPPING_VAL: jputc(':'); stack.back() = MAPPING_KEY; break;
         }
     }
 }
@@ -34,19 +55,21 @@ void JSONWriter::val_head()
 void JSONWriter::add_null()
 {
     val_head();
-    out << "null";
+    jputs("null");
 }
 
 void JSONWriter::add_bool(bool val)
 {
     val_head();
-    out << (val ? "true" : "false" );
+    jputs(val ? "true" : "false");
 }
 
 void JSONWriter::add_int(int val)
 {
     val_head();
-    out << to_string(val);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", val);
+    jputs(buf);
 }
 
 void JSONWriter::add_double(double val)
@@ -55,32 +78,32 @@ void JSONWriter::add_double(double val)
 
     double vint, vfrac;
     vfrac = modf(val, &vint);
+    // Large enough for "%f" of any double
+    char buf[400];
     if (vfrac == 0.0)
-    {
-        out << to_string((int)vint);
-        out << ".0";
-    }
+        snprintf(buf, sizeof(buf), "%d.0", (int)vint);
     else
-        out << to_string(val);
+        snprintf(buf, sizeof(buf), "%f", val);
+    jputs(buf);
 }
 
 void JSONWriter::add_cstring(const char* val)
 {
     val_head();
-    out << '"';
+    jputc('"');
     for ( ; *val; ++val)
         switch (*val)
         {
-            case '"': out << "\\\""; break;
-            case '\\': out << "\\\\"; break;
-            case '\b': out << "\\b"; break;
-            case '\f': out << "\\f"; break;
-            case '\n': out << "\\n"; break;
-            case '\r': out << "\\r"; break;
-            case '\t': out << "\\t"; break;
-            default: out << *val; break;
+            case '"': jputs("\\\""); break;
+            case '\\': jputs("\\\\"); break;
+            case '\b': jputs("\\b"); break;
+            case '\f': jputs("\\f"); break;
+            case '\n': jputs("\\n"); break;
+            case '\r': jputs("\\r"); break;
+            case '\t': jputs("\\t"); break;
+            default: jputc(*val); break;
         }
-    out << '"';
+    jputc('"');
 }
 
 void JSONWriter::add_string(const std::string& val)
@@ -187,7 +210,7 @@ void JSONWriter::add_datetimerange(const DatetimeRange& val)
 
 void JSONWriter::add_number(const std::string& val) {
     val_head();
-    out << val;
+    jputs(val.data(), val.size());
 }
 
 void JSONWriter::add_var(const wreport::Var& val) {
@@ -212,32 +235,32 @@ void JSONWriter::add_ident(const Ident& val)
 }
 
 void JSONWriter::add_break() {
-    out << "\n";
+    jputc('\n');
 }
 
 void JSONWriter::start_list()
 {
     val_head();
-    out << '[';
+    jputc('[');
     stack.push_back(LIST_FIRST);
 }
 
 void JSONWriter::end_list()
 {
-    out << ']';
+    jputc(']');
     stack.pop_back();
 }
 
 void JSONWriter::start_mapping()
 {
     val_head();
-    out << '{';
+    jputc('{');
     stack.push_back(MAPPING_KEY_FIRST);
 }
 
 void JSONWriter::end_mapping()
 {
-    out << '}';
+    jputc('}');
     stack.pop_back();
 }
 
@@ -662,5 +685,201 @@ void JSONReader::parse(std::istream& in) {
     parse_value(jstream, *this);
 }
 
+namespace {
+
+/// Parse JSON values in place from a memory buffer
+struct BufferParser
+{
+    const char* cur;
+    const char* end;
+    std::string& strbuf;
+    JSONReader& e;
+
+    BufferParser(const char* begin, const char* end, std::string& strbuf, JSONReader& e)
+        : cur(begin), end(end), strbuf(strbuf), e(e) {}
+
+    void skip_spaces()
+    {
+        while (cur < end && isspace((unsigned char)*cur))
+            ++cur;
+    }
+
+    void expect_token(const char* token)
+    {
+        for (const char* s = token; *s; ++s, ++cur)
+        {
+            if (cur == end)
+                throw JSONParseException("unexpected end of file reached");
+            if (*cur != *s)
+                throw JSONParseException("unexpected character");
+        }
+        skip_spaces();
+    }
+
+    /// Parse a string into strbuf
+    void parse_string()
+    {
+        ++cur; // Eat the leading '"'
+        strbuf.clear();
+        while (true)
+        {
+            // Copy all the characters up to the next quote or escape at once
+            const char* start = cur;
+            while (cur < end && *cur != '"' && *cur != '\\')
+                ++cur;
+            strbuf.append(start, cur - start);
+            if (cur == end)
+                throw JSONParseException("unterminated string");
+            if (*cur++ == '"')
+                break;
+            if (cur == end)
+                throw JSONParseException("unterminated string");
+            switch (*cur++)
+            {
+                case 'b': strbuf += '\b'; break;
+                case 'f': strbuf += '\f'; break;
+                case 'n': strbuf += '\n'; break;
+                case 'r': strbuf += '\r'; break;
+                case 't': strbuf += '\t'; break;
+                default: strbuf += cur[-1]; break;
+            }
+        }
+        skip_spaces();
+    }
+
+    void parse_number()
+    {
+        const char* start = cur;
+        bool is_double = false;
+        for ( ; cur < end; ++cur)
+        {
+            if ((*cur >= '0' && *cur <= '9') || *cur == '-')
+                continue;
+            if (*cur == '.' || *cur == 'e' || *cur == 'E' || *cur == '+')
+                is_double = true;
+            else
+                break;
+        }
+
+        // Copy the number to a terminated buffer for strtol/strtod
+        char buf[64];
+        size_t len = cur - start;
+        if (len >= sizeof(buf))
+            throw JSONParseException("number is too long");
+        memcpy(buf, start, len);
+        buf[len] = 0;
+
+        char* num_end;
+        errno = 0;
+        if (is_double)
+        {
+            double val = strtod(buf, &num_end);
+            if (num_end != buf + len)
+                throw JSONParseException("invalid number");
+            e.on_add_double(val);
+        } else {
+            long val = strtol(buf, &num_end, 10);
+            if (num_end != buf + len)
+                throw JSONParseException("invalid number");
+            if (errno == ERANGE || val < INT_MIN || val > INT_MAX)
+                throw JSONParseException("number out of range");
+            e.on_add_int(val);
+        }
+        skip_spaces();
+    }
+
+    void parse_value()
+    {
+        if (cur == end)
+            throw JSONParseException("JSON string is truncated");
+        switch (*cur)
+        {
+            case '{':
+                ++cur;
+                e.on_start_mapping();
+                skip_spaces();
+                while (cur < end && *cur != '}')
+                {
+                    if (*cur != '"')
+                        throw JSONParseException("expected a string as object key");
+                    parse_string();
+                    e.on_add_string(strbuf);
+                    if (cur < end && *cur == ':')
+                        ++cur;
+                    else
+                        throw JSONParseException("':' expected after object key");
+                    skip_spaces();
+                    parse_value();
+                    if (cur < end && *cur == ',')
+                        ++cur;
+                    skip_spaces();
+                }
+                if (cur == end)
+                    throw JSONParseException("expected object does not end with '}'");
+                ++cur;
+                e.on_end_mapping();
+                break;
+            case '[':
+                ++cur;
+                e.on_start_list();
+                skip_spaces();
+                while (cur < end && *cur != ']')
+                {
+                    parse_value();
+                    if (cur < end && *cur == ',')
+                        ++cur;
+                    skip_spaces();
+                }
+                if (cur == end)
+                    throw JSONParseException("array does not end with ']'");
+                ++cur;
+                e.on_end_list();
+                break;
+            case '"':
+                parse_string();
+                e.on_add_string(strbuf);
+                break;
+            case '-':
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+                parse_number();
+                break;
+            case 't':
+                expect_token("true");
+                e.on_add_bool(true);
+                break;
+            case 'f':
+                expect_token("false");
+                e.on_add_bool(false);
+                break;
+            case 'n':
+                expect_token("null");
+                e.on_add_null();
+                break;
+            default:
+                throw JSONParseException("unexpected character");
+        }
+        skip_spaces();
+    }
+};
+
+}
+
+const char* JSONReader::parse(const char* begin, const char* end)
+{
+    BufferParser parser(begin, end, strbuf, *this);
+    parser.skip_spaces();
+    parser.parse_value();
+    return parser.cur;
+}
+
 }
 }
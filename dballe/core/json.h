@@ -5,6 +5,7 @@
 #include <wreport/var.h>
 #include <dballe/types.h>
 #include <dballe/core/fwd.h>
+#include <string>
 #include <vector>
 #include <ostream>
 #include <istream>
@@ -42,8 +43,10 @@ protected:
     /// Append whatever separator is needed (if any) before a new value
     void val_head();
 
+    /// Write to the output stream buffer, setting badbit on failure
     void jputc(char c);
     void jputs(const char* s);
+    void jputs(const char* s, size_t len);
 
 public:
     JSONWriter(std::ostream& out);
@@ -146,6 +149,22 @@ public:
 
     // Parse a stream
     void parse(std::istream& in);
+
+    /**
+     * Parse one JSON value from a memory buffer, skipping spaces before and
+     * after it.
+     *
+     * The buffer is read in place, and all strings are decoded into the same
+     * reusable buffer, so that parsing does not allocate memory for each
+     * token.
+     *
+     * Returns the position after the value and its trailing spaces.
+     */
+    const char* parse(const char* begin, const char* end);
+
+protected:
+    /// Buffer reused to decode strings when parsing memory buffers
+    std::string strbuf;
 };
 
 
@@ -216,6 +216,8 @@ add_method("modifiers", []() {
     wassert(actual(core::Query::parse_modifiers("details")) == DBA_DB_MODIFIER_SUMMARY_DETAILS);
     wassert(actual(core::Query::parse_modifiers("attrs")) == DBA_DB_MODIFIER_WITH_ATTRIBUTES);
     wassert(actual(core::Query::parse_modifiers("best,attrs")) == (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_WITH_ATTRIBUTES));
+    wassert(actual(core::Query::parse_modifiers("stream")) == DBA_DB_MODIFIER_STREAM);
+    wassert(actual(core::Query::parse_modifiers("stvars")) == DBA_DB_MODIFIER_STATION_VARS);
 });
 
 add_method("issue107", []() {
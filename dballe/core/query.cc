@@ -462,7 +462,9 @@ unsigned Query::parse_modifiers(const char* s)
                 else if (strncmp(s, "nosort", 6) == 0)
                     modifiers |= DBA_DB_MODIFIER_UNSORTED;
                 else if (strncmp(s, "stream", 6) == 0)
-                    ; // Not used anymore
+                    modifiers |= DBA_DB_MODIFIER_STREAM;
+                else if (strncmp(s, "stvars", 6) == 0)
+                    modifiers |= DBA_DB_MODIFIER_STATION_VARS;
                 else
                     got = 0;
                 break;
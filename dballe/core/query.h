@@ -15,12 +15,18 @@
 #define DBA_DB_MODIFIER_BEST        (1 << 0)
 /** Do not bother sorting the results */
 #define DBA_DB_MODIFIER_UNSORTED    (1 << 5)
+/** Read results from the database incrementally, instead of loading them all
+ * when the query starts. Cursors will return -1 for remaining() */
+#define DBA_DB_MODIFIER_STREAM      (1 << 6)
 /** Sort by report after ana_id, to ease reconstructing messages on export */
 #define DBA_DB_MODIFIER_SORT_FOR_EXPORT (1 << 7)
 /// Add minimum date, maximum date and data count details to summary query results
 #define DBA_DB_MODIFIER_SUMMARY_DETAILS (1 << 8)
 /// Also get attributes alongside data
 #define DBA_DB_MODIFIER_WITH_ATTRIBUTES (1 << 9)
+/** Load the station variables of all the stations in a station query with a
+ * single query, instead of one query per station */
+#define DBA_DB_MODIFIER_STATION_VARS (1 << 10)
 
 namespace dballe {
 namespace core {
@@ -3,6 +3,7 @@
 #include <wreport/utils/string.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <pwd.h>
 #include <fnmatch.h>
 
@@ -189,6 +190,26 @@ BinaryMessage read_rawmsg(const char* filename, Encoding type)
     return res;
 }
 
+bool run_test_in_new_process(const std::string& name)
+{
+    pid_t pid = fork();
+    if (pid == -1)
+        throw error_system("cannot fork a test process");
+    if (pid == 0)
+    {
+        setenv("TEST_ONLY", name.c_str(), 1);
+        unsetenv("TEST_EXCEPT");
+        unsetenv("TEST_BLACKLIST");
+        execl("/proc/self/exe", "/proc/self/exe", (const char*)nullptr);
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) == -1)
+        throw error_system("cannot wait for the test process");
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
 #if 0
     void vars_equal(const Record& expected) { return TestRecordVarsEqual(this->actual, expected); }
 void TestRecordValEqual::check() const
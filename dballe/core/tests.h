@@ -54,6 +54,17 @@ std::unique_ptr<File> open_test_data(const char* filename, Encoding type);
 
 BinaryMessage read_rawmsg(const char* filename, Encoding type);
 
+/**
+ * Run a test method of the current test executable in a new process, and
+ * return true if it succeeded.
+ *
+ * This tests code whose behaviour depends on global state, like tables that
+ * are loaded the first time they are used.
+ *
+ * name is the full name of the test method, as in "testcase.method".
+ */
+bool run_test_in_new_process(const std::string& name);
+
 class MemoryCSVWriter : public CSVWriter
 {
 public:
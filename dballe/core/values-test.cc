@@ -1,8 +1,11 @@
 #include "tests.h"
 #include "values.h"
+#include "var.h"
+#include "varmatch.h"
 #include <cstring>
 
 using namespace std;
+using namespace wreport;
 using namespace dballe::tests;
 using namespace dballe;
 
@@ -21,6 +24,25 @@ void Tests::register_tests()
 add_method("empty", []() {
 });
 
+add_method("match_attrs", []() {
+    Var var(varinfo(WR_VAR(0, 12, 101)), 273.15);
+    var.seta(newvar(WR_VAR(0, 33, 7), 50));
+    var.seta(newvar(WR_VAR(0, 1, 19), "test"));
+
+    core::value::Encoder enc;
+    enc.append_attributes(var);
+
+    using core::value::Decoder;
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33007>40"))).istrue());
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33007<40"))).isfalse());
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("40<=B33007<=60"))).istrue());
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("B01019=test"))).istrue());
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("B01019=other"))).isfalse());
+    // Missing attributes never match
+    wassert(actual(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33036>0"))).isfalse());
+    wassert(actual(Decoder::match_attrs(std::vector<uint8_t>(), *Varmatch::parse("B33007>40"))).isfalse());
+});
+
 }
 
 }
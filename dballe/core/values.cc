@@ -1,5 +1,6 @@
 #include "values.h"
 #include "dballe/core/var.h"
+#include "dballe/core/varmatch.h"
 #include <arpa/inet.h>
 #include <ostream>
 
@@ -60,6 +61,7 @@ void Encoder::append_attributes(const wreport::Var& var)
 }
 
 Decoder::Decoder(const std::vector<uint8_t>& buf) : buf(buf.data()), size(buf.size()) {}
+Decoder::Decoder(const uint8_t* buf, unsigned size) : buf(buf), size(size) {}
 
 uint16_t Decoder::decode_uint16()
 {
@@ -118,6 +120,42 @@ void Decoder::decode_attrs(const std::vector<uint8_t>& buf, wreport::Var& var)
         var.seta(move(dec.decode_var()));
 }
 
+bool Decoder::match_attrs(const uint8_t* buf, unsigned size, const Varmatch& match)
+{
+    Decoder dec(buf, size);
+    while (dec.size)
+    {
+        Varcode code = dec.decode_uint16();
+        // The type is needed also to skip values that do not match
+        Vartype type = varinfo(code)->type;
+        switch (type)
+        {
+            case Vartype::Binary:
+            case Vartype::String:
+            {
+                const char* val = dec.decode_cstring();
+                if (code == match.code) return match.match_string(val);
+                break;
+            }
+            case Vartype::Integer:
+            case Vartype::Decimal:
+            {
+                int val = (int)dec.decode_uint32();
+                if (code == match.code) return match.match_int(val);
+                break;
+            }
+            default:
+                error_consistency::throwf("unsupported variable type %d", (int)type);
+        }
+    }
+    return false;
+}
+
+bool Decoder::match_attrs(const std::vector<uint8_t>& buf, const Varmatch& match)
+{
+    return match_attrs(buf.data(), buf.size(), match);
+}
+
 }
 }
 }
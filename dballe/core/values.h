@@ -6,6 +6,8 @@
 #include <vector>
 
 namespace dballe {
+struct Varmatch;
+
 namespace core {
 namespace value {
 
@@ -27,6 +29,7 @@ struct Decoder
     unsigned size;
 
     Decoder(const std::vector<uint8_t>& buf);
+    Decoder(const uint8_t* buf, unsigned size);
     uint16_t decode_uint16();
     uint32_t decode_uint32();
     const char* decode_cstring();
@@ -36,6 +39,14 @@ struct Decoder
      * Decode the attributes of var from a buffer
      */
     static void decode_attrs(const std::vector<uint8_t>& buf, wreport::Var& var);
+
+    /**
+     * Check if any of the attributes encoded in a buffer matches match.
+     *
+     * Values are compared as they are encoded, without creating Var objects.
+     */
+    static bool match_attrs(const uint8_t* buf, unsigned size, const Varmatch& match);
+    static bool match_attrs(const std::vector<uint8_t>& buf, const Varmatch& match);
 };
 
 }
@@ -37,8 +37,29 @@ bool Varmatch::operator()(const wreport::Var& var) const
     return var.code() == code;
 }
 
+bool Varmatch::match_int(int val) const
+{
+    return true;
+}
+
+bool Varmatch::match_string(const char* val) const
+{
+    return true;
+}
+
 namespace varmatch {
 
+// Compare a value with a matcher operand, which is false if one is numeric
+// and the other is a string
+template<typename OP, typename A, typename B>
+static bool compare(const OP& op, const A& a, const B& b) { return false; }
+template<typename OP>
+static bool compare(const OP& op, int a, int b) { return op(a, b); }
+template<typename OP>
+static bool compare(const OP& op, const char* a, const std::string& b) { return op(a, b); }
+template<typename OP>
+static bool compare(const OP& op, const std::string& a, const char* b) { return op(a, b); }
+
 template<typename T, typename OP>
 struct Op : public Varmatch
 {
@@ -51,6 +72,8 @@ struct Op : public Varmatch
         if (!var.isset()) return false;
         return op(var.enq<T>(), val);
     }
+    bool match_int(int v) const override { return compare(op, v, val); }
+    bool match_string(const char* v) const override { return compare(op, v, val); }
 };
 
 template<typename T>
@@ -87,6 +110,8 @@ struct Between : public Varmatch
         const auto& val = var.enq<T>();
         return op1(min, val) && op2(val, max);
     }
+    bool match_int(int v) const override { return compare(op1, min, v) && compare(op2, v, max); }
+    bool match_string(const char* v) const override { return compare(op1, min, v) && compare(op2, v, max); }
 };
 
 template<typename T>
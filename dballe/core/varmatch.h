@@ -18,6 +18,18 @@ struct Varmatch
 
     virtual bool operator()(const wreport::Var&) const;
 
+    /**
+     * Match the value of a numeric variable with this code, as returned by
+     * Var::enqi(), without building a Var
+     */
+    virtual bool match_int(int val) const;
+
+    /**
+     * Match the value of a string variable with this code, without building
+     * a Var
+     */
+    virtual bool match_string(const char* val) const;
+
     /**
      * Parse variable matcher from a string in the form
      * Bxxyyy{<|<=|=|>=|>}value or value<=Bxxyyy<=value
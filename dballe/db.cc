@@ -1,5 +1,6 @@
 #include "db.h"
 #include "db/db.h"
+#include "db/v7/db.h"
 #include "sql/sql.h"
 #include "core/string.h"
 #include "wreport/utils/string.h"
@@ -39,6 +40,15 @@ std::unique_ptr<DBConnectOptions> DBConnectOptions::create(const std::string& ur
     else
         res->wipe = false;
 
+    std::string pool;
+    if (url_pop_query_string(res->url, "pool", pool))
+    {
+        int size = atoi(pool.c_str());
+        if (size < 1)
+            wreport::error_consistency::throwf("unsupported value for pool: %s (it should be a positive number)", pool.c_str());
+        res->pool_size = size;
+    }
+
     if (strncmp(url.c_str(), "test:", 5) == 0)
     {
         const char* envurl = getenv("DBA_DB");
@@ -60,7 +70,13 @@ std::unique_ptr<DBConnectOptions> DBConnectOptions::test_create(const char* back
     }
     const char* envurl = getenv(envname.c_str());
     if (!envurl)
-        envurl = "test:";
+    {
+        // In-memory databases need no configuration
+        if (backend && strcmp(backend, "MEM") == 0)
+            envurl = "mem:";
+        else
+            envurl = "test:";
+    }
     return create(envurl);
 }
 
@@ -121,6 +137,8 @@ std::shared_ptr<DB> DB::connect(const DBConnectOptions& opts)
         auto res = db::DB::create(conn);
         if (opts.wipe)
             res->reset();
+        if (opts.pool_size > 1)
+            std::dynamic_pointer_cast<db::v7::DB>(res)->enable_pool(opts.pool_size);
         return res;
     }
 }
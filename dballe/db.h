@@ -27,6 +27,13 @@ public:
     /// Wipe database on connection
     bool wipe = false;
 
+    /**
+     * Maximum number of connections used to run transactions concurrently.
+     *
+     * Values greater than 1 are only supported on PostgreSQL and MySQL.
+     */
+    unsigned pool_size = 1;
+
     /**
      * Disable all the one-off actions set to perform on connection.
      *
@@ -5,8 +5,10 @@
 #include "v7/repinfo.h"
 #include "v7/db.h"
 #include "v7/transaction.h"
+#include "dballe/sql/sql.h"
 #include "config.h"
 #include <cstring>
+#include <thread>
 #include <unistd.h>
 #include <wreport/utils/subprocess.h>
 
@@ -43,6 +45,7 @@ Tests<V7DB> tg4("db_basic_tr_v7_postgresql", "POSTGRESQL");
 #ifdef HAVE_MYSQL
 Tests<V7DB> tg6("db_basic_tr_v7_mysql", "MYSQL");
 #endif
+Tests<V7DB> tg7("db_basic_tr_v7_mem", "MEM");
 
 CommitTests<V7DB> ct2("db_basic_db_v7_sqlite", "SQLITE");
 #ifdef HAVE_LIBPQ
@@ -579,6 +582,159 @@ this->add_method("wipe", [](Fixture& f) {
     wassert(actual(db->query_station_data(core::Query())->remaining()) == 1u);
 });
 
+this->add_method("pool", [](Fixture& f) {
+    f.destroys_db = true;
+    switch (f.db->conn->server_type)
+    {
+        case sql::ServerType::POSTGRES:
+        case sql::ServerType::MYSQL:
+            break;
+        default:
+            wassert_throws(error_unimplemented, f.db->enable_pool(2));
+            return;
+    }
+
+    TestDataSet data;
+    data.stations["s1"].station.report = "synop";
+    data.stations["s1"].station.coords = Coords(12.34560, 76.54320);
+    data.stations["s1"].values.set("B01019", "Station 1");
+    data.data["s1"].station = data.stations["s1"].station;
+    data.data["s1"].level = Level(10, 11, 15, 22);
+    data.data["s1"].trange = Trange(20, 111, 122);
+    data.data["s1"].datetime = Datetime(1945, 4, 25, 8);
+    data.data["s1"].values.set("B01011", "Data 1");
+    wassert(f.populate_database(data));
+
+    wassert(f.db->enable_pool(2));
+
+    // Run more read-only transactions than connections, from multiple threads
+    std::vector<unsigned> counts(6, 0);
+    std::vector<std::string> errors(6);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < counts.size(); ++i)
+        workers.emplace_back([&, i] {
+            try {
+                auto tr = f.db->transaction(true);
+                auto cur = tr->query_data(core::Query());
+                while (cur->next())
+                    ++counts[i];
+                tr->rollback();
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    for (auto& w: workers)
+        w.join();
+
+    for (unsigned i = 0; i < counts.size(); ++i)
+    {
+        wassert(actual(errors[i]) == "");
+        wassert(actual(counts[i]) == 1u);
+    }
+
+    // Writes go through the pool, and are seen by later transactions
+    core::Data vals;
+    vals.station = data.stations["s1"].station;
+    vals.level = Level(10, 11, 15, 22);
+    vals.trange = Trange(20, 111, 122);
+    vals.datetime = Datetime(1945, 4, 25, 8);
+    vals.values.set("B01012", 300);
+    {
+        auto tr = f.db->transaction();
+        wassert(tr->insert_data(vals));
+        tr->commit();
+    }
+    wassert(actual(f.db->query_data(core::Query())->remaining()) == 2u);
+});
+
+this->add_method("pool_concurrent_filters", [](Fixture& f) {
+    f.destroys_db = true;
+    switch (f.db->conn->server_type)
+    {
+        case sql::ServerType::POSTGRES:
+        case sql::ServerType::MYSQL:
+            break;
+        default:
+            return;
+    }
+
+    // B12101 values from 270 to 279
+    TestDataSet data;
+    data.stations["s1"].station.report = "synop";
+    data.stations["s1"].station.coords = Coords(12.34560, 76.54320);
+    data.stations["s1"].values.set("B01019", "Station 1");
+    for (int i = 0; i < 10; ++i)
+    {
+        core::Data& d = data.data["d" + std::to_string(i)];
+        d.station = data.stations["s1"].station;
+        d.level = Level(10, 11, 15, 22);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 25, i);
+        d.values.set("B12101", 270.0 + i);
+    }
+    wassert(f.populate_database(data));
+
+    wassert(f.db->enable_pool(3));
+
+    // Build queries with data filters from multiple threads at the same time
+    static const char* queries[] = {
+        "data_filter=B12101>275.00",
+        "data_filter=B12101<=275.00",
+        "data_filter=272.00<=B12101<=274.00",
+        "ana_filter=B01019=Station 1, data_filter=B12101!=270.00",
+    };
+    static const unsigned expected[] = { 4, 6, 3, 9 };
+    std::vector<std::string> errors(8);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < errors.size(); ++i)
+        workers.emplace_back([&, i] {
+            try {
+                for (unsigned round = 0; round < 20; ++round)
+                {
+                    unsigned q = (i + round) % 4;
+                    auto tr = f.db->transaction(true);
+                    unsigned count = tr->query_data(core_query_from_string(queries[q]))->remaining();
+                    tr->rollback();
+                    if (count != expected[q])
+                    {
+                        errors[i] = std::string(queries[q]) + " returned " + std::to_string(count) + " values";
+                        return;
+                    }
+                }
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    for (auto& w: workers)
+        w.join();
+    for (const auto& e: errors)
+        wassert(actual(e) == "");
+
+    // A report added outside of the pool is found by read-only transactions
+    // that start from an older repinfo snapshot
+    {
+        auto tr = std::make_shared<v7::Transaction>(f.db, f.db->conn->transaction());
+        core::Data vals = data.data["d0"];
+        vals.station.report = "newnet";
+        wassert(tr->insert_data(vals));
+        tr->commit();
+    }
+    {
+        auto tr = f.db->transaction(true);
+        wassert(actual(tr->query_data(core_query_from_string("rep_memo=newnet"))->remaining()) == 1);
+        tr->rollback();
+    }
+
+    // Nesting transactions on a thread fails instead of waiting forever once
+    // the thread holds all the connections
+    {
+        auto tr1 = f.db->transaction(true);
+        auto tr2 = f.db->transaction(true);
+        auto tr3 = f.db->transaction(true);
+        wassert_throws(error_consistency, f.db->transaction(true));
+    }
+});
+
 this->add_method("transaction_create_error", [](Fixture& f) {
     f.destroys_db = true;
     f.db->disappear();
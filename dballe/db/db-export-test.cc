@@ -58,6 +58,7 @@ Tests<V7DB> tg4("db_export_v7_postgresql", "POSTGRESQL");
 #ifdef HAVE_MYSQL
 Tests<V7DB> tg6("db_export_v7_mysql", "MYSQL");
 #endif
+Tests<V7DB> tg7("db_export_v7_mem", "MEM");
 
 template<typename DB>
 void Tests<DB>::register_tests()
@@ -142,6 +143,30 @@ this->add_method("export", [](Fixture& f) {
     wassert(actual_var(*msgs[0], sc::temp_2m) == 290.0);
 });
 
+this->add_method("export_stream", [](Fixture& f) {
+    // Streaming export gives the same messages as buffered export
+    DBData test_data;
+    wassert(f.populate(test_data));
+
+    core::Data st;
+    st.station = test_data.data["ds0"].station;
+    st.values.set("B01001", 10);
+    f.tr->insert_station_data(st);
+
+    impl::Messages expected = dballe::tests::messages_from_db(f.tr, core::Query());
+    wassert(actual(expected.size()) == 4u);
+
+    core::Query query;
+    query.query = "stream";
+    auto cur = f.tr->query_messages(query);
+    wassert(actual(cur->remaining()) == -1);
+    impl::Messages msgs;
+    while (cur->next())
+        msgs.emplace_back(cur->detach_message());
+    wassert(actual(impl::msg::messages_diff(expected, msgs)) == 0u);
+    wassert(actual_var(*msgs[0], sc::block) == 10);
+});
+
 this->add_method("missing_repmemo", [](Fixture& f) {
     // Text exporting of extra station information
     core::Query query;
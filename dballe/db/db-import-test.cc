@@ -325,5 +325,6 @@ Tests<V7DB> tg4("db_import_v7_postgresql", "POSTGRESQL");
 #ifdef HAVE_MYSQL
 Tests<V7DB> tg6("db_import_v7_mysql", "MYSQL");
 #endif
+Tests<V7DB> tg7("db_import_v7_mem", "MEM");
 
 }
@@ -1,6 +1,8 @@
 #include "dballe/db/tests.h"
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/cursor.h"
+#include "dballe/sql/sql.h"
 #include "config.h"
 
 using namespace dballe;
@@ -103,6 +105,8 @@ EmptyFixtureTests<V7DB> tg8("db_query_data2_v7_postgresql", "POSTGRESQL");
 OldFixtureTests<V7DB> tga("db_query_data1_v7_mysql", "MYSQL");
 EmptyFixtureTests<V7DB> tgc("db_query_data2_v7_mysql", "MYSQL");
 #endif
+OldFixtureTests<V7DB> tgd("db_query_data1_v7_mem", "MEM");
+EmptyFixtureTests<V7DB> tge("db_query_data2_v7_mem", "MEM");
 
 template<typename DB>
 void OldFixtureTests<DB>::register_tests()
@@ -376,6 +380,80 @@ this->add_method("query_ordering", [](Fixture& f) {
     }
 });
 
+this->add_method("query_stream", [](Fixture& f) {
+    auto insert = [&](const char* str) {
+        core::Data data;
+        data.set_from_test_string(str);
+        wassert(f.tr->insert_data(data));
+        return data;
+    };
+    auto vals01 = insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=synop, B12101=280.15");
+    auto vals02 = insert("lat=2, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=synop, B12101=280.15");
+    auto vals03 = insert("lat=1, lon=1, year=2001, leveltype1=1, pindicator=1, rep_memo=synop, B12101=280.15");
+    auto vals04 = insert("lat=1, lon=1, year=2000, leveltype1=2, pindicator=1, rep_memo=synop, B12101=280.15");
+    auto vals05 = insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=2, rep_memo=synop, B12101=280.15");
+    auto vals06 = insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=metar, B12101=280.15");
+    auto vals07 = insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=synop, B12103=280.15");
+    f.tr->clear_cached_state();
+
+    core::Query query;
+    query.query = "stream";
+    auto cur = f.tr->query_data(query);
+    // Use a small batch size to test iterating across batches
+    dynamic_cast<db::v7::cursor::Data&>(*cur).rows.batch_size = 2;
+    if (f.db->conn->server_type == sql::ServerType::MYSQL)
+        // MySQL cannot stream results, and runs a regular query instead
+        wassert(actual(cur->remaining()) == 7);
+    else
+        wassert(actual(cur->remaining()) == -1);
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals01));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals07));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals05));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals04));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals03));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals02));
+    wassert(actual(cur->next())); wassert(actual(cur).data_matches(vals06));
+    wassert_false(cur->next());
+    wassert_false(cur->next());
+
+    // Discarding in the middle of the results releases the stream
+    cur = f.tr->query_data(query);
+    dynamic_cast<db::v7::cursor::Data&>(*cur).rows.batch_size = 2;
+    wassert(actual(cur->next()));
+    cur->discard();
+    wassert_false(cur->next());
+});
+
+this->add_method("query_stream_best", [](Fixture& f) {
+    // Same value on different networks: only the highest priority one is
+    // returned, even if they end up in different batches
+    auto insert = [&](const char* str) {
+        core::Data data;
+        data.set_from_test_string(str);
+        wassert(f.tr->insert_data(data));
+    };
+    insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=synop, B12101=280.15");
+    insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=metar, B12101=281.15");
+    insert("lat=1, lon=1, year=2000, leveltype1=1, pindicator=1, rep_memo=temp, B12101=282.15");
+
+    core::Query query;
+    query.query = "best";
+    auto cur = f.tr->query_data(query);
+    wassert(actual(cur->remaining()) == 1);
+    wassert_true(cur->next());
+    double expected = cur->get_var().enqd();
+
+    for (unsigned batch_size = 1; batch_size < 4; ++batch_size)
+    {
+        query.query = "stream,best";
+        auto scur = f.tr->query_data(query);
+        dynamic_cast<db::v7::cursor::Data&>(*scur).rows.batch_size = batch_size;
+        wassert_true(scur->next());
+        wassert(actual(scur->get_var().enqd()) == expected);
+        wassert_false(scur->next());
+    }
+});
+
 this->add_method("issue224", [](Fixture& f) {
     auto insert = [&](const char* str, int attr) {
         core::Data data;
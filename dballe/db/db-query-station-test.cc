@@ -3,6 +3,8 @@
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/db/v7/station.h"
+#include "dballe/db/v7/driver.h"
+#include "dballe/sql/sql.h"
 
 using namespace dballe;
 using namespace dballe::db;
@@ -88,6 +90,31 @@ class Tests : public FixtureTestCase<TransactionFixture<DB, DBData>>
             wassert(actual(f.tr).try_station_query("lonmin=77., lonmax=76.54320", 4));
             wassert(actual(f.tr).try_station_query("lonmin=77., lonmax=-10", 0));
         });
+        this->add_method("query_bbox", [](Fixture& f) {
+            // The spatial index is set up where the backend supports it
+            switch (f.db->conn->server_type)
+            {
+                case sql::ServerType::POSTGRES:
+                    wassert_true(f.db->driver().has_station_spatial_index());
+                    break;
+                case sql::ServerType::SQLITE:
+                    wassert(actual(f.db->driver().has_station_spatial_index()) == f.db->conn->has_table("station_rtree"));
+                    break;
+                default:
+                    wassert_false(f.db->driver().has_station_spatial_index());
+                    break;
+            }
+
+            // Bounding box queries give the same results with or without it
+            wassert(actual(f.tr).try_station_query("latmin=10., latmax=20., lonmin=70., lonmax=80.", 2));
+            wassert(actual(f.tr).try_station_query("latmin=10., latmax=30., lonmin=60., lonmax=80.", 4));
+            wassert(actual(f.tr).try_station_query("latmin=12.34560, latmax=12.34560, lonmin=60., lonmax=80.", 2));
+            wassert(actual(f.tr).try_station_query("latmin=12.34570, latmax=23.45660, lonmin=60., lonmax=80.", 0));
+            wassert(actual(f.tr).try_station_query("latmin=20., latmax=30., lonmin=70., lonmax=80.", 0));
+            wassert(actual(f.tr).try_station_query("latmin=20., latmax=30., lonmin=170., lonmax=70.", 2));
+            wassert(actual(f.tr).try_station_query("latmin=10., latmax=30., lonmin=170., lonmax=80.", 4));
+            wassert(actual(f.tr).try_station_query("latmin=10., latmax=30., lonmin=-170., lonmax=-100.", 0));
+        });
         this->add_method("query_mobile", [](Fixture& f) {
             wassert(actual(f.tr).try_station_query("mobile=0", 4));
             wassert(actual(f.tr).try_station_query("mobile=1", 0));
@@ -167,6 +194,7 @@ class Tests : public FixtureTestCase<TransactionFixture<DB, DBData>>
             switch (f.db->format())
             {
                 case Format::V7:
+                case Format::MEM:
                     wassert(actual(cur->remaining()) == 4);
                     break;
                 default: error_unimplemented::throwf("cannot run this test on a database of format %d", (int)DB::format);
@@ -177,6 +205,29 @@ class Tests : public FixtureTestCase<TransactionFixture<DB, DBData>>
             wassert(actual(f.tr).try_station_query("rep_memo=synop", 1));
             wassert(actual(f.tr).try_station_query("rep_memo=metar", 2));
         });
+        this->add_method("query_station_vars", [](Fixture& f) {
+            // Station variables loaded in bulk are the same as those loaded
+            // one station at a time
+            auto values_by_station = [&](const std::string& query) {
+                std::map<int, DBValues> res;
+                auto cur = f.tr->query_stations(core_query_from_string(query));
+                while (cur->next())
+                    res[cur->get_station().id] = cur->get_values();
+                return res;
+            };
+            for (const char* q: { "", "rep_memo=metar", "block=3", "limit=1" })
+            {
+                auto expected = values_by_station(q);
+                auto actual_values = values_by_station(std::string(q) + (q[0] ? ", " : "") + "query=stvars");
+                wassert(actual(actual_values.size()) == expected.size());
+                for (const auto& i: expected)
+                {
+                    wassert(actual(actual_values.count(i.first)) == 1u);
+                    wassert_true(actual_values[i.first].vars_equal(i.second));
+                    wassert(actual(actual_values[i.first].size()) == 3u);
+                }
+            }
+        });
     }
 };
 
@@ -187,5 +238,6 @@ Tests<V7DB> tg4("db_query_station_v7_postgresql", "POSTGRESQL");
 #ifdef HAVE_MYSQL
 Tests<V7DB> tg6("db_query_station_v7_mysql", "MYSQL");
 #endif
+Tests<V7DB> tg7("db_query_station_v7_mem", "MEM");
 
 }
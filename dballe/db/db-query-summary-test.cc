@@ -269,6 +269,39 @@ class Tests : public FixtureTestCase<DBDataFixture<DB>>
             wassert(actual(f.tr).try_summary_query("priomax=81", 4));
             wassert(actual(f.tr).try_summary_query("priomax=100", 4));
         });
+        this->add_method("details_after_changes", [](Fixture& f) {
+            // Counts and datetime ranges follow inserts and removals, and do
+            // not depend on whether they are grouped from the data table (as
+            // with datetime constraints) or read from data_summary
+            auto check = [&](unsigned rows, unsigned count, const Datetime& dtmax) {
+                auto check_details = [&](const db::DBSummary& res) {
+                    wassert(actual(res.data_count()) == count);
+                    wassert(actual(res.datetime_min()) == Datetime(1945, 4, 25, 8));
+                    wassert(actual(res.datetime_max()) == dtmax);
+                };
+                wassert(actual(f.tr).try_summary_query("query=details", rows, check_details));
+                wassert(actual(f.tr).try_summary_query("yearmin=1945, query=details", rows, check_details));
+            };
+
+            wassert(check(4, 8, Datetime(1945, 4, 26, 8)));
+
+            core::Data vals;
+            vals.station = f.test_data.stations["st1_metar"].station;
+            vals.datetime = Datetime(1945, 4, 27, 8);
+            vals.level = Level(10, 11, 15, 22);
+            vals.trange = Trange(20, 111, 122);
+            vals.values.set("B12101", 292.0);
+            wassert(f.tr->insert_data(vals));
+            wassert(check(4, 9, Datetime(1945, 4, 27, 8)));
+
+            wassert(f.tr->remove_data(core_query_from_string(parm("ana_id", f.st1_id) + ", var=B12103")));
+            wassert(check(3, 7, Datetime(1945, 4, 27, 8)));
+
+            auto cur = f.tr->query_data(core_query_from_string("yearmin=1945, monthmin=4, daymin=27"));
+            while (cur->next())
+                dynamic_cast<db::CursorData&>(*cur).remove();
+            wassert(check(3, 6, Datetime(1945, 4, 26, 8)));
+        });
     }
 };
 
@@ -279,5 +312,6 @@ Tests<V7DB> tg4("db_query_summary_v7_postgresql", "POSTGRESQL");
 #ifdef HAVE_MYSQL
 Tests<V7DB> tg6("db_query_summary_v7_mysql", "MYSQL");
 #endif
+Tests<V7DB> tg7("db_query_summary_v7_mem", "MEM");
 
 }
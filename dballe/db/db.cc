@@ -1,6 +1,7 @@
 #include "config.h"
 #include "db.h"
 #include "v7/db.h"
+#include "v7/mem/storage.h"
 #include "dballe/sql/sql.h"
 #include "dballe/sql/sqlite.h"
 #include "dballe/message.h"
@@ -126,8 +127,7 @@ shared_ptr<DB> DB::connect_from_file(const char* pathname)
 
 shared_ptr<DB> DB::connect_memory()
 {
-    auto conn = sql::SQLiteConnection::create();
-    conn->open_memory();
+    auto conn = v7::mem::MemConnection::create();
     auto res = static_pointer_cast<DB>(make_shared<v7::DB>(conn));
     res->reset();
     return res;
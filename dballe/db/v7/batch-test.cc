@@ -2,6 +2,7 @@
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/db/v7/levtr.h"
+#include "dballe/db/v7/station.h"
 #include "dballe/var.h"
 #include "batch.h"
 #include "config.h"
@@ -166,6 +167,66 @@ add_method("import", [](Fixture& f) {
     wassert(actual(batch.count_select_data) == 0u);
 });
 
+add_method("station_cache", [](Fixture& f) {
+    using namespace db::v7;
+    db::v7::Tracer<> trc;
+    Batch& batch = f.tr->batch;
+    batch.set_write_attrs(false);
+
+    // New stations are cached when inserted
+    auto st = batch.get_station(trc, "synop", Coords(45.0, 11.0), Ident());
+    Var sv(var(WR_VAR(0, 7, 30), 1000.0));
+    st->get_station_data(trc).add(&sv, batch::ERROR);
+    batch.write_pending(trc);
+    int id = st->id;
+    wassert(actual(batch.count_select_stations) == 1u);
+    wassert(actual(batch.count_station_cache_misses) == 1u);
+    wassert(actual(batch.count_station_cache_hits) == 0u);
+
+    st = batch.get_station(trc, "synop", Coords(46.0, 11.0), Ident());
+    batch.write_pending(trc);
+    wassert(actual(batch.count_select_stations) == 2u);
+
+    // Going back to a station does not query the database
+    st = batch.get_station(trc, "synop", Coords(45.0, 11.0), Ident());
+    wassert(actual(st->id) == id);
+    wassert(actual(batch.count_select_stations) == 2u);
+    wassert(actual(batch.count_station_cache_hits) == 1u);
+
+    // Neither does looking up a known station by ID
+    DBStation by_id;
+    by_id.id = id;
+    batch.get_station(trc, "synop", Coords(46.0, 11.0), Ident());
+    st = batch.get_station(trc, by_id, false);
+    wassert(actual(st->coords) == Coords(45.0, 11.0));
+    wassert(actual(batch.count_select_stations) == 2u);
+
+    // Prefetching an area with too many stations does not mark it complete
+    f.tr->clear_cached_state();
+    wassert_false(f.tr->station().prefetch_area(trc, "synop", LatRange(44.0, 47.5), LonRange(10.0, 12.0), 1));
+    wassert_false(f.tr->station().cache_complete("synop", LatRange(44.0, 47.5), LonRange(10.0, 12.0)));
+
+    // After a prefetch, unknown stations in the area are known not to exist
+    f.tr->clear_cached_state();
+    wassert_true(f.tr->station().prefetch_area(trc, "synop", LatRange(44.0, 47.5), LonRange(10.0, 12.0), 2));
+    wassert_true(f.tr->station().cache_complete("synop", LatRange(45.0, 47.0), LonRange(10.5, 11.5)));
+    wassert_false(f.tr->station().cache_complete("synop", LatRange(45.0, 48.0), LonRange(10.5, 11.5)));
+    wassert_false(f.tr->station().cache_complete("metar", LatRange(45.0, 47.0), LonRange(10.5, 11.5)));
+    unsigned selects = batch.count_select_stations;
+    st = batch.get_station(trc, "synop", Coords(46.0, 11.0), Ident());
+    wassert_false(st->is_new);
+    st = batch.get_station(trc, "synop", Coords(47.0, 11.0), Ident());
+    wassert_true(st->is_new);
+    wassert(actual(st->id) == MISSING_INT);
+    wassert(actual(batch.count_select_stations) == selects);
+
+    // Stations outside the area, or of other reports, are looked up
+    st = batch.get_station(trc, "synop", Coords(48.0, 11.0), Ident());
+    wassert(actual(batch.count_select_stations) == selects + 1);
+    st = batch.get_station(trc, "metar", Coords(45.5, 11.0), Ident());
+    wassert(actual(batch.count_select_stations) == selects + 2);
+});
+
 add_method("insert", [](Fixture& f) {
     using namespace db::v7;
     db::v7::Tracer<> trc;
@@ -1,7 +1,10 @@
 #include "batch.h"
 #include "transaction.h"
 #include "station.h"
+#include "db.h"
+#include "driver.h"
 #include <algorithm>
+#include <unordered_set>
 
 namespace dballe {
 namespace db {
@@ -46,6 +49,29 @@ void Batch::new_station(Tracer<>& trc, const std::string& report, const Coords&
     last_station->ident = ident;
 }
 
+int Batch::lookup_station_id(Tracer<>& trc, const dballe::DBStation& station)
+{
+    v7::Station& st = transaction.station();
+
+    int id;
+    if (st.find_cached_id(station, id))
+    {
+        ++count_station_cache_hits;
+        return id;
+    }
+
+    ++count_station_cache_misses;
+    ++count_select_stations;
+    id = st.maybe_get_id(trc, station);
+    if (id != MISSING_INT)
+    {
+        DBStation cached(station);
+        cached.id = id;
+        st.add_cache(cached);
+    }
+    return id;
+}
+
 batch::Station* Batch::get_station(Tracer<>& trc, const dballe::DBStation& station, bool station_can_add)
 {
     v7::Station& st = transaction.station();
@@ -56,16 +82,23 @@ batch::Station* Batch::get_station(Tracer<>& trc, const dballe::DBStation& stati
             throw std::runtime_error("cannot use station information without both coordinates and ana_id");
         if (last_station && last_station->id == station.id)
             return last_station;
-        DBStation from_db = st.lookup(trc, station.id);
-        new_station(trc, from_db.report, from_db.coords, from_db.ident);
-        ++count_select_stations;
+        if (const DBStation* cached = st.find_cached(station.id))
+        {
+            ++count_station_cache_hits;
+            new_station(trc, cached->report, cached->coords, cached->ident);
+        } else {
+            ++count_station_cache_misses;
+            DBStation from_db = st.lookup(trc, station.id);
+            new_station(trc, from_db.report, from_db.coords, from_db.ident);
+            ++count_select_stations;
+            st.add_cache(from_db);
+        }
         last_station->id = station.id;
     } else {
         if (have_station(station.report, station.coords, station.ident))
             return last_station;
         new_station(trc, station.report, station.coords, station.ident);
-        ++count_select_stations;
-        last_station->id = st.maybe_get_id(trc, *last_station);
+        last_station->id = lookup_station_id(trc, *last_station);
     }
 
     if (last_station->id == MISSING_INT)
@@ -88,12 +121,9 @@ batch::Station* Batch::get_station(Tracer<>& trc, const std::string& report, con
     if (have_station(report, coords, ident))
         return last_station;
 
-    v7::Station& st = transaction.station();
-
     new_station(trc, report, coords, ident);
 
-    last_station->id = st.maybe_get_id(trc, *last_station);
-    ++count_select_stations;
+    last_station->id = lookup_station_id(trc, *last_station);
     if (last_station->id == MISSING_INT)
     {
         last_station->is_new = true;
@@ -122,8 +152,9 @@ void Batch::clear()
 
 void Batch::dump(FILE* out) const
 {
-    fprintf(out, " * Batch wa:%d csst:%u cssd: %u, csd: %u\n",
-            (int)write_attrs, count_select_stations, count_select_station_data, count_select_data);
+    fprintf(out, " * Batch wa:%d csst:%u (cache hit:%u miss:%u) cssd: %u, csd: %u\n",
+            (int)write_attrs, count_select_stations, count_station_cache_hits, count_station_cache_misses,
+            count_select_station_data, count_select_data);
     if (last_station)
     {
         fprintf(out, "Cached station:\n");
@@ -227,6 +258,14 @@ void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
             else
                 cur->id = v.id;
         }
+        if (tr.driver().has_data_summary())
+        {
+            // to_insert can contain duplicates, which are inserted only once
+            std::unordered_set<IdVarcode> added;
+            for (const auto& v: to_insert)
+                if (added.insert(IdVarcode(v.id_levtr, v.var->code())).second)
+                    st.summary_changes.add(station_id, v.id_levtr, v.var->code(), datetime);
+        }
     }
     if (!to_update.empty())
     {
@@ -23,10 +23,13 @@ protected:
 
     bool have_station(const std::string& report, const Coords& coords, const Ident& ident);
     void new_station(Tracer<>& trc, const std::string& report, const Coords& coords, const Ident& ident);
+    int lookup_station_id(Tracer<>& trc, const dballe::DBStation& station);
 
 public:
     Transaction& transaction;
     unsigned count_select_stations = 0;
+    unsigned count_station_cache_hits = 0;
+    unsigned count_station_cache_misses = 0;
     unsigned count_select_station_data = 0;
     unsigned count_select_data = 0;
 
@@ -44,6 +44,61 @@ add_method("levtr", [] {
     wassert(actual(cache.reverse[lt.level].size()) == 1u);
 });
 
+add_method("station", [] {
+    db::v7::StationCache cache;
+
+    wassert_false(cache.find_entry(1));
+    wassert_false(cache.find_entry(MISSING_INT));
+    wassert(actual(cache.find_id(DBStation())) == MISSING_INT);
+
+    DBStation st;
+    st.id = 1;
+    st.report = "synop";
+    st.coords = Coords(45.0, 11.0);
+
+    cache.insert(st);
+
+    wassert_true(cache.find_entry(1));
+    wassert(actual(*cache.find_entry(1)) == st);
+    wassert(actual(cache.find_id(st)) == 1);
+
+    cache.insert(st);
+    wassert(actual(cache.reverse[st.coords].size()) == 1u);
+
+    // Same coordinates, different report or ident
+    DBStation st1(st);
+    st1.id = MISSING_INT;
+    st1.report = "metar";
+    wassert(actual(cache.find_id(st1)) == MISSING_INT);
+    st1.report = "synop";
+    st1.ident = "test";
+    wassert(actual(cache.find_id(st1)) == MISSING_INT);
+    cache.insert(st1, 2);
+    wassert(actual(cache.find_id(st1)) == 2);
+    wassert(actual(cache.find_id(st)) == 1);
+    wassert(actual(cache.reverse[st.coords].size()) == 2u);
+
+    // The same ID cannot be reused for a different station
+    wassert_throws(std::runtime_error, cache.insert(st1, 1));
+
+    cache.complete.emplace_back("synop", LatRange(44.0, 46.0), LonRange(10.0, 12.0));
+    wassert_true(cache.is_complete(st));
+    // Completeness is by report and area, for fixed and mobile stations
+    wassert_true(cache.is_complete(st1));
+    DBStation st2(st);
+    st2.coords = Coords(47.0, 11.0);
+    wassert_false(cache.is_complete(st2));
+    st2.coords = st.coords;
+    st2.report = "metar";
+    wassert_false(cache.is_complete(st2));
+    wassert_true(cache.is_complete("synop", LatRange(44.5, 45.5), LonRange(10.5, 11.5)));
+    wassert_false(cache.is_complete("synop", LatRange(44.5, 46.5), LonRange(10.5, 11.5)));
+    cache.clear();
+    wassert_true(cache.complete.empty());
+    wassert_false(cache.find_entry(1));
+    wassert(actual(cache.find_id(st)) == MISSING_INT);
+});
+
 }
 
 }
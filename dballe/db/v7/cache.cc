@@ -116,6 +116,110 @@ int LevTrCache::find_id(const LevTrEntry& e) const
     return reverse.find_id(e);
 }
 
+
+int StationReverseIndex::find_id(const dballe::Station& st) const
+{
+    auto li = find(st.coords);
+    if (li == end())
+        return MISSING_INT;
+    for (auto i: li->second)
+        if (i->report == st.report && i->ident == st.ident)
+            return i->id;
+    return MISSING_INT;
+}
+
+void StationReverseIndex::add(const DBStation* st)
+{
+    auto li = find(st->coords);
+    if (li == end())
+        insert(make_pair(st->coords, std::vector<const DBStation*>{st}));
+    else
+        li->second.push_back(st);
+}
+
+
+StationCache::~StationCache()
+{
+    for (auto& i: by_id)
+        delete i.second;
+}
+
+void StationCache::clear()
+{
+    for (auto& i: by_id)
+        delete i.second;
+    by_id.clear();
+    reverse.clear();
+    complete.clear();
+}
+
+const DBStation* StationCache::find_entry(int id) const
+{
+    auto i = by_id.find(id);
+    if (i == by_id.end())
+        return nullptr;
+    return i->second;
+}
+
+const DBStation* StationCache::insert(const DBStation& e)
+{
+    return insert(std::unique_ptr<DBStation>(new DBStation(e)));
+}
+
+const DBStation* StationCache::insert(const DBStation& e, int id)
+{
+    std::unique_ptr<DBStation> ne(new DBStation(e));
+    ne->id = id;
+    return insert(move(ne));
+}
+
+const DBStation* StationCache::insert(std::unique_ptr<DBStation> e)
+{
+    if (e->id == MISSING_INT)
+        throw std::runtime_error("station to cache in transaction state must have a database ID");
+
+    auto i = this->by_id.find(e->id);
+    if (i != this->by_id.end())
+    {
+        // Stations do not move: if we have a match on the ID, we just need to
+        // enforce that there is no mismatch on the station data
+        if (*i->second != *e)
+            throw std::runtime_error("cannot replace a cached DB entry with one with the same ID and different data");
+        return i->second;
+    }
+
+    const DBStation* res = e.get();
+    this->by_id.insert(make_pair(res->id, e.release()));
+    reverse.add(res);
+    return res;
+}
+
+int StationCache::find_id(const dballe::Station& e) const
+{
+    return reverse.find_id(e);
+}
+
+bool StationCache::is_complete(const dballe::Station& e) const
+{
+    for (const auto& area: complete)
+        if (area.contains(e))
+            return true;
+    return false;
+}
+
+bool StationCache::is_complete(const std::string& report, const LatRange& latrange, const LonRange& lonrange) const
+{
+    for (const auto& area: complete)
+        if (area.report == report && area.latrange.contains(latrange) && area.lonrange.contains(lonrange))
+            return true;
+    return false;
+}
+
+bool StationCacheArea::contains(const dballe::Station& e) const
+{
+    return e.report == report && latrange.contains(e.coords.lat) && lonrange.contains(e.coords.lon);
+}
+
 }
 }
 }
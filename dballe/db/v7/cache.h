@@ -4,6 +4,7 @@
 #include <dballe/types.h>
 #include <unordered_map>
 #include <memory>
+#include <string>
 #include <vector>
 #include <iosfwd>
 
@@ -66,6 +67,75 @@ struct LevTrCache
     void clear();
 };
 
+
+struct StationReverseIndex : public std::unordered_map<Coords, std::vector<const DBStation*>>
+{
+    int find_id(const dballe::Station& st) const;
+    void add(const DBStation* st);
+};
+
+
+/**
+ * Cache of station IDs, indexed by ID and by (report, coords, ident).
+ *
+ * If complete is true, the cache holds all the stations in the database, and
+ * a station not found in the cache does not exist in the database.
+ */
+/// Area for which a StationCache holds all the stations in the database
+struct StationCacheArea
+{
+    std::string report;
+    LatRange latrange;
+    LonRange lonrange;
+
+    StationCacheArea(const std::string& report, const LatRange& latrange, const LonRange& lonrange)
+        : report(report), latrange(latrange), lonrange(lonrange) {}
+
+    bool contains(const dballe::Station& e) const;
+};
+
+struct StationCache
+{
+    std::unordered_map<int, DBStation*> by_id;
+    StationReverseIndex reverse;
+    /// Areas for which the cache holds all the stations in the database
+    std::vector<StationCacheArea> complete;
+
+    StationCache() = default;
+    StationCache(const StationCache&) = delete;
+    StationCache(StationCache&&) = delete;
+    StationCache& operator=(const StationCache&) = delete;
+    StationCache& operator=(StationCache&&) = delete;
+    ~StationCache();
+
+    const DBStation* find_entry(int id) const;
+
+    const DBStation* insert(const DBStation& e);
+    const DBStation* insert(const DBStation& e, int id);
+    const DBStation* insert(std::unique_ptr<DBStation> e);
+
+    /**
+     * Find the ID of a station given its report, coordinates and identifier.
+     *
+     * Returns MISSING_INT if the station is not in the cache.
+     */
+    int find_id(const dballe::Station& e) const;
+
+    /**
+     * Check if the cache holds all the stations in the database with the
+     * report and coordinates of \a e
+     */
+    bool is_complete(const dballe::Station& e) const;
+
+    /**
+     * Check if the cache holds all the stations in the database with the
+     * given report inside the given area
+     */
+    bool is_complete(const std::string& report, const LatRange& latrange, const LonRange& lonrange) const;
+
+    void clear();
+};
+
 }
 }
 }
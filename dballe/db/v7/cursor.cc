@@ -8,6 +8,7 @@
 #include "dballe/db/v7/station.h"
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/data.h"
+#include "dballe/db/v7/trace.h"
 #include "dballe/types.h"
 #include "dballe/var.h"
 #include "dballe/core/var.h"
@@ -42,6 +43,25 @@ void StationRows::load(Tracer<>& trc, const StationQueryBuilder& qb)
     tr->station().run_station_query(trc, qb, [&](const dballe::DBStation& desc) {
         results.emplace_back(desc);
     });
+
+    if (qb.modifiers & DBA_DB_MODIFIER_STATION_VARS)
+    {
+        // Load all station variables with a single query, and merge them
+        // into their stations
+        std::unordered_map<int, DBValues*> by_id;
+        for (auto& row: results)
+        {
+            row.values.reset(new DBValues);
+            by_id[row.station.id] = row.values.get();
+        }
+        tr->station().run_station_vars_query(trc, qb, [&](int id_station, std::unique_ptr<wreport::Var> var) {
+            auto i = by_id.find(id_station);
+            if (i == by_id.end())
+                return;
+            i->second->set(std::move(var));
+        });
+    }
+
     at_start = true;
     cur = results.begin();
 }
@@ -52,9 +72,7 @@ const DBValues& StationRows::values() const
     {
         cur->values.reset(new DBValues);
         Tracer<> trc(tr->trc ? tr->trc->trace_add_station_vars() : nullptr);
-        // FIXME: this could be made more efficient by querying all matching
-        // station values, and merging rows during load, so it would only do
-        // one query to the database
+        // With DBA_DB_MODIFIER_STATION_VARS, values are all loaded by load()
         tr->station().add_station_vars(trc, cur->station.id, *cur->values);
     }
     return *cur->values;
@@ -71,23 +89,82 @@ void StationDataRows::load(Tracer<>& trc, const DataQueryBuilder& qb)
     cur = results.begin();
 }
 
+void StationDataRows::load_stream(std::unique_ptr<StreamQuery> query, std::unique_ptr<StationDataStream> stream)
+{
+    results.clear();
+    stream_query = std::move(query);
+    this->stream = std::move(stream);
+    streaming = true;
+    at_start = true;
+    cur = results.begin();
+}
+
+void StationDataRows::fetch_batch()
+{
+    results.clear();
+    bool more = stream->fetch(batch_size, [&](const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var) {
+        results.emplace_back(station, id_data, std::move(var));
+    });
+    if (!more)
+        stream.reset();
+    cur = results.begin();
+}
+
+bool StationDataRows::next()
+{
+    if (Rows::next())
+        return true;
+    while (stream)
+    {
+        fetch_batch();
+        if (cur != results.end())
+            return true;
+    }
+    return false;
+}
+
+void StationDataRows::discard()
+{
+    stream.reset();
+    results.clear();
+    Rows::discard();
+}
+
 void DataRows::load(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
     std::set<int> ids;
     tr->data().run_data_query(trc, qb, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+        trace::PhaseTimer timer(trc, "materialize");
         results.emplace_back(station, id_levtr, datetime, id_data, std::move(var));
         ids.insert(id_levtr);
     });
     at_start = true;
     cur = results.begin();
 
+    trace::PhaseTimer timer(trc, "levtr_prefetch");
     tr->levtr().prefetch_ids(trc, ids);
 }
 
+int DataRows::station_priority(const dballe::DBStation& station)
+{
+    // Values of the same station tend to come together
+    if (station.id == prio_station)
+        return prio_station_prio;
+
+    // Look up the report name only the first time a station is seen
+    auto i = station_reps.find(station.id);
+    if (i == station_reps.end())
+        i = station_reps.emplace(station.id, tr->repinfo().get_id(station.report.c_str())).first;
+
+    prio_station = station.id;
+    prio_station_prio = tr->repinfo().get_priority_by_id(i->second);
+    return prio_station_prio;
+}
+
 bool DataRows::add_to_best_results(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)
 {
-    int prio = tr->repinfo().get_priority(station.report);
+    int prio = station_priority(station);
 
     if (results.empty()) goto append;
     if (station.coords != results.back().station.coords) goto append;
@@ -115,26 +192,95 @@ void DataRows::load_best(Tracer<>& trc, const DataQueryBuilder& qb)
     results.clear();
     set<int> ids;
     tr->data().run_data_query(trc, qb, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+        trace::PhaseTimer timer(trc, "priority");
         if (add_to_best_results(station, id_levtr, datetime, id_data, move(var)))
             ids.insert(id_levtr);
     });
     at_start = true;
     cur = results.begin();
 
+    trace::PhaseTimer timer(trc, "levtr_prefetch");
     tr->levtr().prefetch_ids(trc, ids);
 }
 
+void DataRows::load_stream(std::unique_ptr<StreamQuery> query, std::unique_ptr<DataStream> stream, bool best)
+{
+    results.clear();
+    stream_query = std::move(query);
+    this->stream = std::move(stream);
+    stream_best = best;
+    streaming = true;
+    at_start = true;
+    cur = results.begin();
+}
+
+void DataRows::fetch_batch()
+{
+    results.clear();
+    bool more;
+    if (stream_best)
+    {
+        if (stream_pending)
+        {
+            results.emplace_back(std::move(*stream_pending));
+            stream_pending.reset();
+        }
+        more = stream->fetch(batch_size, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+            add_to_best_results(station, id_levtr, datetime, id_data, move(var));
+        });
+        // Hold back the last row until we know that the next batch does not
+        // contain a value with a higher priority for it
+        if (more && !results.empty())
+        {
+            stream_pending.reset(new DataRow(std::move(results.back())));
+            results.pop_back();
+        }
+    } else {
+        more = stream->fetch(batch_size, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+            results.emplace_back(station, id_levtr, datetime, id_data, std::move(var));
+        });
+    }
+    if (!more)
+        stream.reset();
+    cur = results.begin();
+}
+
+bool DataRows::next()
+{
+    if (BaseDataRows::next())
+        return true;
+    while (stream)
+    {
+        fetch_batch();
+        if (cur != results.end())
+            return true;
+    }
+    return false;
+}
+
+void DataRows::discard()
+{
+    stream.reset();
+    stream_pending.reset();
+    station_reps.clear();
+    prio_station = MISSING_INT;
+    results.clear();
+    BaseDataRows::discard();
+}
+
 void SummaryRows::load(Tracer<>& trc, const SummaryQueryBuilder& qb)
 {
     results.clear();
     set<int> ids;
     tr->data().run_summary_query(trc, qb, [&](const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t count) {
+        trace::PhaseTimer timer(trc, "materialize");
         results.emplace_back(station, id_levtr, code, datetime, count);
         ids.insert(id_levtr);
     });
     at_start = true;
     cur = results.begin();
 
+    trace::PhaseTimer timer(trc, "levtr_prefetch");
     tr->levtr().prefetch_ids(trc, ids);
 }
 
@@ -142,6 +288,8 @@ void SummaryRows::load(Tracer<>& trc, const SummaryQueryBuilder& qb)
 template<typename Impl>
 int Base<Impl>::remaining() const
 {
+    if (rows.streaming)
+        return -1;
     if (rows.at_start)
         return rows.results.size();
     else
@@ -271,7 +419,7 @@ std::unique_ptr<dballe::CursorStation> run_station_query(Tracer<>& trc, std::sha
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     auto resptr = new Stations(tr);
@@ -281,16 +429,54 @@ std::unique_ptr<dballe::CursorStation> run_station_query(Tracer<>& trc, std::sha
     return std::move(res);
 }
 
+/**
+ * Run a streaming station data query, returning nullptr if the backend cannot
+ * stream query results
+ */
+static std::unique_ptr<dballe::CursorStationData> run_station_data_stream_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const core::Query& q, unsigned int modifiers, bool explain)
+{
+    if (modifiers & DBA_DB_MODIFIER_BEST)
+        throw error_unimplemented("best queries of station vars");
+
+    // The cursor reads results after we return, so it needs its own copy of
+    // the query
+    std::unique_ptr<StreamQuery> sq(new StreamQuery(tr, q, modifiers, true));
+    sq->qb.build();
+
+    auto stream = tr->station_data().stream_station_data_query(trc, sq->qb);
+    if (!stream)
+        return std::unique_ptr<dballe::CursorStationData>();
+
+    if (explain)
+    {
+        fprintf(stderr, "EXPLAIN "); q.print(stderr);
+        tr->conn->explain(sq->qb.sql_query, stderr);
+    }
+
+    auto resptr = new StationData(sq->qb, modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES);
+    std::unique_ptr<db::CursorStationData> res(resptr);
+    resptr->rows.load_stream(std::move(sq), std::move(stream));
+    // std::move is redundant, but needed by centos7's obsolete compiler
+    return std::move(res);
+}
+
 std::unique_ptr<dballe::CursorStationData> run_station_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const core::Query& q, bool explain)
 {
     unsigned int modifiers = q.get_modifiers();
+    if (modifiers & DBA_DB_MODIFIER_STREAM)
+    {
+        // Fall back to a regular query if the backend cannot stream
+        if (auto res = run_station_data_stream_query(trc, tr, q, modifiers, explain))
+            return res;
+    }
+
     DataQueryBuilder qb(tr, q, modifiers, true);
     qb.build();
 
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     std::unique_ptr<db::CursorStationData> res;
@@ -309,16 +495,51 @@ std::unique_ptr<dballe::CursorStationData> run_station_data_query(Tracer<>& trc,
     return std::move(res);
 }
 
+/**
+ * Run a streaming data query, returning nullptr if the backend cannot stream
+ * query results
+ */
+static std::unique_ptr<dballe::CursorData> run_data_stream_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const core::Query& q, unsigned int modifiers, bool explain)
+{
+    // The cursor reads results after we return, so it needs its own copy of
+    // the query
+    std::unique_ptr<StreamQuery> sq(new StreamQuery(tr, q, modifiers, false));
+    sq->qb.build();
+
+    auto stream = tr->data().stream_data_query(trc, sq->qb);
+    if (!stream)
+        return std::unique_ptr<dballe::CursorData>();
+
+    if (explain)
+    {
+        fprintf(stderr, "EXPLAIN "); q.print(stderr);
+        tr->conn->explain(sq->qb.sql_query, stderr);
+    }
+
+    auto resptr = new Data(sq->qb, modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES);
+    std::unique_ptr<CursorData> res(resptr);
+    resptr->rows.load_stream(std::move(sq), std::move(stream), modifiers & DBA_DB_MODIFIER_BEST);
+    // std::move is redundant, but needed by centos7's obsolete compiler
+    return std::move(res);
+}
+
 std::unique_ptr<dballe::CursorData> run_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const core::Query& q, bool explain)
 {
     unsigned int modifiers = q.get_modifiers();
+    if (modifiers & DBA_DB_MODIFIER_STREAM)
+    {
+        // Fall back to a regular query if the backend cannot stream
+        if (auto res = run_data_stream_query(trc, tr, q, modifiers, explain))
+            return res;
+    }
+
     DataQueryBuilder qb(tr, q, modifiers, false);
     qb.build();
 
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     std::unique_ptr<CursorData> res;
@@ -345,7 +566,7 @@ std::unique_ptr<dballe::CursorSummary> run_summary_query(Tracer<>& trc, std::sha
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     auto resptr = new Summary(tr);
@@ -367,13 +588,32 @@ void run_delete_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->conn->explain(qb.sql_query, stderr);
     }
 
     if (station_vars)
+    {
         tr->station_data().remove(trc, qb);
-    else
-        tr->data().remove(trc, qb);
+        return;
+    }
+
+    if (tr->driver().has_data_summary())
+    {
+        // Mark for recomputation the summary rows of the values being
+        // deleted. Without the attribute filter and the limit, this can
+        // select more rows than needed, which is harmless
+        tr->data().flush_summary(trc);
+        core::Query sq(q);
+        sq.attr_filter.clear();
+        sq.limit = MISSING_INT;
+        SummaryQueryBuilder sqb(tr, sq, DBA_DB_MODIFIER_UNSORTED, false);
+        sqb.build();
+        tr->data().run_summary_query(trc, sqb, [&](const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t count) {
+            tr->data().summary_changes.remove(station.id, id_levtr, code);
+        });
+    }
+
+    tr->data().remove(trc, qb);
 }
 
 
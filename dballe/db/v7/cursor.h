@@ -6,8 +6,11 @@
 #include <dballe/db/v7/transaction.h>
 #include <dballe/db/v7/repinfo.h>
 #include <dballe/db/v7/levtr.h>
+#include <dballe/db/v7/data.h>
+#include <dballe/db/v7/qbuilder.h>
 #include <dballe/values.h>
 #include <memory>
+#include <unordered_map>
 
 namespace dballe {
 namespace db {
@@ -90,6 +93,15 @@ struct Rows
     /// True if we are at the start of the iteration
     bool at_start = true;
 
+    /**
+     * True if results only holds the current batch of rows of a query that is
+     * read incrementally from the database
+     */
+    bool streaming = false;
+
+    /// Number of rows to read from the database at a time, when streaming
+    unsigned batch_size = 1000;
+
     Rows(std::shared_ptr<v7::Transaction> tr) : tr(tr) {}
 
     const Row* operator->() const { return &*cur; }
@@ -120,11 +132,39 @@ struct StationRows : public Rows<StationRow>
     void enq(impl::Enq& enq) const;
 };
 
+/**
+ * Query and query builder of a streaming cursor, which need to remain valid
+ * until the cursor has finished reading results
+ */
+struct StreamQuery
+{
+    core::Query query;
+    DataQueryBuilder qb;
+
+    StreamQuery(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
+        : query(query), qb(tr, this->query, modifiers, query_station_vars) {}
+};
+
 struct StationDataRows : public Rows<StationDataRow>
 {
     using Rows::Rows;
+
+    /// Query whose results are being streamed
+    std::unique_ptr<StreamQuery> stream_query;
+
+    /// Source of further rows, while streaming
+    std::unique_ptr<StationDataStream> stream;
+
     void load(Tracer<>& trc, const DataQueryBuilder& qb);
+    /// Start reading the results of the query incrementally from stream
+    void load_stream(std::unique_ptr<StreamQuery> query, std::unique_ptr<StationDataStream> stream);
+    bool next();
+    void discard();
     void enq(impl::Enq& enq) const;
+
+protected:
+    /// Replace results with the next batch of rows from stream
+    void fetch_batch();
 };
 
 template<typename Row>
@@ -150,8 +190,19 @@ struct LevTrRows : public Rows<Row>
     const LevTrEntry& get_levtr() const
     {
         if (levtr == nullptr)
-            // We prefetch levtr info for all IDs, so we do not need to hit the database here
-            levtr = &(this->tr->levtr().lookup_cache(this->cur->id_levtr));
+        {
+            if (this->streaming)
+            {
+                // Streamed rows are not prefetched: look them up as needed,
+                // letting the LevTr cache absorb repeated IDs
+                Tracer<> trc;
+                levtr = this->tr->levtr().lookup_id(trc, this->cur->id_levtr);
+                if (!levtr)
+                    wreport::error_notfound::throwf("LevTr with ID %d not found", this->cur->id_levtr);
+            } else
+                // We prefetch levtr info for all IDs, so we do not need to hit the database here
+                levtr = &(this->tr->levtr().lookup_cache(this->cur->id_levtr));
+        }
         return *levtr;
     }
 };
@@ -168,11 +219,44 @@ struct DataRows : public BaseDataRows
 
     int insert_cur_prio;
 
+    /// Query whose results are being streamed
+    std::unique_ptr<StreamQuery> stream_query;
+
+    /// Source of further rows, while streaming
+    std::unique_ptr<DataStream> stream;
+
+    /// True if the rows being streamed need to be filtered by priority
+    bool stream_best = false;
+
+    /**
+     * When streaming a best query, the last row of a batch, which can still be
+     * replaced by a higher priority value at the start of the next batch
+     */
+    std::unique_ptr<DataRow> stream_pending;
+
+    /// Report ID of each station seen by add_to_best_results
+    std::unordered_map<int, int> station_reps;
+
+    /// Station ID and priority of the last value seen by add_to_best_results
+    int prio_station = MISSING_INT;
+    int prio_station_prio = INT_MAX;
+
+    /// Get the priority of the report of a station, looking it up by report ID
+    int station_priority(const dballe::DBStation& station);
+
     /// Append or replace the last result according to priority. Returns false if the value has been ignored.
     bool add_to_best_results(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var);
 
     void load(Tracer<>& trc, const DataQueryBuilder& qb);
     void load_best(Tracer<>& trc, const DataQueryBuilder& qb);
+    /// Start reading the results of the query incrementally from stream
+    void load_stream(std::unique_ptr<StreamQuery> query, std::unique_ptr<DataStream> stream, bool best);
+    bool next();
+    void discard();
+
+protected:
+    /// Replace results with the next batch of rows from stream
+    void fetch_batch();
 };
 
 struct SummaryRows : public LevTrRows<SummaryRow>
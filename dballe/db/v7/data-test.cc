@@ -1,5 +1,8 @@
 #include "dballe/db/tests.h"
 #include "dballe/sql/sql.h"
+#include "dballe/sql/sqlite.h"
+#include "dballe/core/data.h"
+#include "dballe/core/query.h"
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/db/v7/batch.h"
@@ -9,6 +12,8 @@
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/data.h"
 #include "config.h"
+#include <cstdlib>
+#include <map>
 
 using namespace dballe;
 using namespace dballe::tests;
@@ -152,6 +157,211 @@ add_method("attrs", [](Fixture& f) {
     wassert(actual(attrs[0]) == 50);
 });
 
+add_method("packed", [](Fixture& f) {
+    // The packed layout is only available on SQLite
+    if (f.db->conn->server_type != sql::ServerType::SQLITE) return;
+
+    auto conn = sql::SQLiteConnection::create();
+    conn->open_memory();
+    setenv("DBA_SQLITE_PACKED", "1", 1);
+    auto db = dynamic_pointer_cast<dballe::db::v7::DB>(dballe::db::DB::create(conn));
+    db->reset();
+    unsetenv("DBA_SQLITE_PACKED");
+    wassert(actual(conn->get_setting("data_layout")) == "packed");
+
+    auto tr = dynamic_pointer_cast<dballe::db::v7::Transaction>(db->transaction());
+    core::Data vals;
+    vals.station.report = "synop";
+    vals.station.coords = Coords(45.0, 11.0);
+    vals.datetime = Datetime(2001, 2, 3, 4, 5, 6);
+    vals.level = Level(1);
+    vals.trange = Trange::instant();
+    vals.values.set("B12101", 273.15);
+    vals.values.set("B01019", "1234");
+    wassert(tr->insert_data(vals));
+
+    // Datetimes and numeric values are stored as integers, strings as text
+    auto stm = conn->sqlitestatement("SELECT datetime, typeof(value) FROM data ORDER BY code");
+    std::vector<std::string> types;
+    stm->execute([&]() {
+        wassert(actual(stm->column_int64(0)) == 20010203040506LL);
+        types.push_back(stm->column_string(1));
+    });
+    wassert(actual(types.size()) == 2u);
+    wassert(actual(types[0]) == "text");
+    wassert(actual(types[1]) == "integer");
+
+    // Values read back as they were written, and datetime and value filters
+    // work on the packed form
+    auto cur = tr->query_data(core_query_from_string("yearmin=2001, monthmin=2, daymin=3, hourmin=4, var=B12101, data_filter=B12101>273"));
+    wassert(actual(cur->remaining()) == 1);
+    wassert_true(cur->next());
+    wassert(actual(cur->get_datetime()) == Datetime(2001, 2, 3, 4, 5, 6));
+    wassert(actual(cur->get_var().enqd()) == 273.15);
+
+    cur = tr->query_data(core_query_from_string("var=B01019, data_filter=B01019=1234"));
+    wassert(actual(cur->remaining()) == 1);
+    wassert_true(cur->next());
+    wassert(actual(cur->get_var().enqc()) == "1234");
+
+    cur = tr->query_data(core_query_from_string("yearmax=2001, monthmax=2, daymax=3, hourmax=4, minumax=5, secmax=5"));
+    wassert(actual(cur->remaining()) == 0);
+    cur.reset();
+
+    tr->rollback();
+});
+
+add_method("insert_bulk", [](Fixture& f) {
+    // Insert enough values at once to use the bulk insert path, where the
+    // backend has one
+    using namespace dballe::db::v7;
+    Tracer<> trc;
+    auto& da = f.tr->data();
+
+    std::vector<std::unique_ptr<Var>> values;
+    std::vector<batch::MeasuredDatum> vars;
+    for (int i = 0; i < 200; ++i)
+    {
+        int id_levtr = f.tr->levtr().obtain_id(trc, LevTrEntry(Level(1, i), Trange(254)));
+        values.emplace_back(new Var(varinfo(WR_VAR(0, 12, 101)), 273.15 + i / 10.0));
+        if (i % 2)
+            values.back()->seta(newvar(WR_VAR(0, 33, 7), i % 100));
+        vars.emplace_back(id_levtr, values.back().get());
+    }
+    wassert(da.insert(trc, f.sde1.id, Datetime(2001, 2, 3, 4, 5, 6), vars, true));
+
+    std::set<int> ids;
+    for (const auto& v: vars)
+        ids.insert(v.id);
+    wassert(actual(ids.size()) == 200u);
+    wassert_false(ids.count(MISSING_INT));
+
+    unsigned count = 0;
+    da.query(trc, f.sde1.id, Datetime(2001, 2, 3, 4, 5, 6), [&](int id, int id_levtr, wreport::Varcode code) {
+        wassert_true(ids.count(id));
+        ++count;
+    });
+    wassert(actual(count) == 200u);
+
+    // Check that values have been stored correctly
+    auto cur = f.tr->query_data(core::Query());
+    count = 0;
+    while (cur->next())
+    {
+        wassert(actual(cur->get_var()) == Var(varinfo(WR_VAR(0, 12, 101)), 273.15 + cur->get_level().l1 / 10.0));
+        ++count;
+    }
+    wassert(actual(count) == 200u);
+
+    // Check that attributes have been stored correctly
+    for (const auto& v: vars)
+    {
+        std::vector<wreport::Var> attrs;
+        da.read_attrs(trc, v.id, [&](std::unique_ptr<wreport::Var> a) {
+            attrs.emplace_back(*a);
+        });
+        if (const Var* a = v.var->next_attr())
+        {
+            wassert(actual(attrs.size()) == 1u);
+            wassert(actual(attrs[0]) == *a);
+        } else
+            wassert(actual(attrs.size()) == 0u);
+    }
+});
+
+add_method("insert_bulk_ids", [](Fixture& f) {
+    // IDs assigned by multi-row INSERT statements are the rowids of the
+    // inserted rows
+    if (f.db->conn->server_type != sql::ServerType::SQLITE) return;
+    using namespace dballe::db::v7;
+    Tracer<> trc;
+    auto& conn = dynamic_cast<sql::SQLiteConnection&>(*f.db->conn);
+    unsigned orig_max_rows = conn.max_rows_per_insert;
+
+    // Batch sizes that are not a multiple of the statement sizes
+    struct Case { unsigned max_rows; int count; int day; };
+    for (const auto& c: { Case{128, 173, 1}, Case{32, 45, 2}, Case{1, 13, 3} })
+    {
+        conn.max_rows_per_insert = c.max_rows;
+        std::vector<std::unique_ptr<Var>> values;
+        std::vector<batch::MeasuredDatum> vars;
+        for (int i = 0; i < c.count; ++i)
+        {
+            int id_levtr = f.tr->levtr().obtain_id(trc, LevTrEntry(Level(1, c.day * 1000 + i), Trange(254)));
+            values.emplace_back(new Var(varinfo(WR_VAR(0, 12, 101)), 273.15 + i / 10.0));
+            vars.emplace_back(id_levtr, values.back().get());
+        }
+        wassert(f.tr->data().insert(trc, f.sde1.id, Datetime(2001, 2, c.day), vars, false));
+
+        // Each case uses its own levels, so id_levtr identifies its rows
+        std::map<int, int> rowids;
+        auto stm = conn.sqlitestatement("SELECT id_levtr, id FROM data");
+        stm->execute([&]() { rowids[stm->column_int(0)] = stm->column_int(1); });
+        for (const auto& v: vars)
+        {
+            wassert_true(rowids.count(v.id_levtr));
+            wassert(actual(v.id) == rowids[v.id_levtr]);
+        }
+    }
+
+    // Station data, with one statement per row and with multi-row statements
+    Varcode codes[] = {
+        WR_VAR(0, 1, 1), WR_VAR(0, 1, 2), WR_VAR(0, 2, 1), WR_VAR(0, 4, 1),
+        WR_VAR(0, 5, 1), WR_VAR(0, 6, 1), WR_VAR(0, 7, 30), WR_VAR(0, 7, 31),
+        WR_VAR(0, 10, 4), WR_VAR(0, 11, 1), WR_VAR(0, 11, 2), WR_VAR(0, 12, 101),
+        WR_VAR(0, 13, 3),
+    };
+    for (auto max_rows: { 128u, 1u })
+    {
+        conn.max_rows_per_insert = max_rows;
+        int id_station = max_rows == 1 ? f.sde2.id : f.sde1.id;
+        std::vector<std::unique_ptr<Var>> values;
+        std::vector<batch::StationDatum> vars;
+        for (auto code: codes)
+        {
+            values.emplace_back(new Var(varinfo(code)));
+            values.back()->set(1);
+            vars.emplace_back(values.back().get());
+        }
+        wassert(f.tr->station_data().insert(trc, id_station, vars, false));
+
+        std::map<Varcode, int> rowids;
+        auto stm = conn.sqlitestatement("SELECT code, id FROM station_data WHERE id_station=?");
+        stm->bind_val(1, id_station);
+        stm->execute([&]() { rowids[stm->column_int(0)] = stm->column_int(1); });
+        wassert(actual(rowids.size()) == 13u);
+        for (const auto& v: vars)
+            wassert(actual(v.id) == rowids[v.var->code()]);
+    }
+
+    conn.max_rows_per_insert = orig_max_rows;
+});
+
+add_method("remove_bulk", [](Fixture& f) {
+    // Values matching a delete query are removed with a single statement
+    using namespace dballe::db::v7;
+    Tracer<> trc;
+    auto& da = f.tr->data();
+
+    std::vector<std::unique_ptr<Var>> values;
+    std::vector<batch::MeasuredDatum> vars;
+    for (int i = 0; i < 50; ++i)
+    {
+        int id_levtr = f.tr->levtr().obtain_id(trc, LevTrEntry(Level(1, i), Trange(254)));
+        values.emplace_back(new Var(varinfo(WR_VAR(0, 12, 101)), 273.15 + i / 10.0));
+        vars.emplace_back(id_levtr, values.back().get());
+    }
+    wassert(da.insert(trc, f.sde1.id, Datetime(2001, 2, 3, 4, 5, 6), vars, false));
+
+    f.tr->trc->clear();
+    wassert(f.tr->remove_data(core_query_from_string("var=B12101")));
+    trace::Aggregate stats = f.tr->trc->aggregate("delete");
+    wassert(actual(stats.count) == 1u);
+    wassert(actual(stats.rows) == 50u);
+
+    wassert(actual(f.tr->query_data(core::Query())->remaining()) == 0);
+});
+
 }
 
 }
@@ -3,6 +3,7 @@
 #include "dballe/values.h"
 #include <algorithm>
 #include <cstring>
+#include <tuple>
 
 using namespace std;
 using namespace wreport;
@@ -136,6 +137,63 @@ void DataDumper::print_tail()
     fprintf(out, "%d element%s in table data\n", count, count != 1 ? "s" : "");
 }
 
+
+bool DataSummaryChanges::Key::operator<(const Key& o) const
+{
+    return std::tie(id_station, id_levtr, code) < std::tie(o.id_station, o.id_levtr, o.code);
+}
+
+void DataSummaryChanges::add(int id_station, int id_levtr, wreport::Varcode code, const Datetime& datetime)
+{
+    Added& a = added[Key(id_station, id_levtr, code)];
+    if (a.count == 0 || datetime < a.dtmin) a.dtmin = datetime;
+    if (a.count == 0 || a.dtmax < datetime) a.dtmax = datetime;
+    ++a.count;
+}
+
+void DataSummaryChanges::remove(int id_station, int id_levtr, wreport::Varcode code)
+{
+    removed.insert(Key(id_station, id_levtr, code));
+}
+
+void DataSummaryChanges::clear()
+{
+    added.clear();
+    removed.clear();
+}
+
+
+/// Maximum number of stations refreshed by a single summary_refresh call
+static const unsigned summary_refresh_stations = 256;
+
+void Data::flush_summary(Tracer<>& trc)
+{
+    // Recompute whole stations, to scan each of their data rows only once
+    // regardless of how many of their summary rows changed
+    std::set<int> refreshed;
+    for (const auto& key: summary_changes.removed)
+        refreshed.insert(key.id_station);
+
+    std::vector<int> id_stations;
+    for (int id_station: refreshed)
+    {
+        id_stations.push_back(id_station);
+        if (id_stations.size() == summary_refresh_stations)
+        {
+            summary_refresh(trc, id_stations);
+            id_stations.clear();
+        }
+    }
+    if (!id_stations.empty())
+        summary_refresh(trc, id_stations);
+
+    // Recomputing a station also accounts for the values added to it
+    for (const auto& i: summary_changes.added)
+        if (refreshed.find(i.first.id_station) == refreshed.end())
+            summary_add(trc, i.first, i.second);
+    summary_changes.clear();
+}
+
 }
 }
 }
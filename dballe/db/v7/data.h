@@ -2,6 +2,7 @@
 #define DBALLE_DB_V7_DATAV7_H
 
 #include <dballe/fwd.h>
+#include <dballe/types.h>
 #include <dballe/values.h>
 #include <dballe/core/fwd.h>
 #include <dballe/core/defs.h>
@@ -12,6 +13,8 @@
 #include <memory>
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
 #include <cstdio>
 #include <functional>
 
@@ -136,6 +139,44 @@ struct DataTraits
 extern template class DataCommon<StationDataTraits>;
 extern template class DataCommon<DataTraits>;
 
+/**
+ * Incremental reader for the results of a station data query.
+ *
+ * Rows are read from the database one batch at a time, so that iterating a
+ * large result set does not require holding all of it in memory.
+ */
+struct StationDataStream
+{
+    virtual ~StationDataStream() {}
+
+    /**
+     * Read at most max_rows rows from the database, sending the ones that
+     * match the query to dest. If max_rows is 0, read all remaining rows.
+     *
+     * @return false if the end of the results has been reached
+     */
+    virtual bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest) = 0;
+};
+
+/**
+ * Incremental reader for the results of a data query.
+ *
+ * Rows are read from the database one batch at a time, so that iterating a
+ * large result set does not require holding all of it in memory.
+ */
+struct DataStream
+{
+    virtual ~DataStream() {}
+
+    /**
+     * Read at most max_rows rows from the database, sending the ones that
+     * match the query to dest. If max_rows is 0, read all remaining rows.
+     *
+     * @return false if the end of the results has been reached
+     */
+    virtual bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest) = 0;
+};
+
 struct StationData : public DataCommon<StationDataTraits>
 {
     using DataCommon<StationDataTraits>::DataCommon;
@@ -150,12 +191,91 @@ struct StationData : public DataCommon<StationDataTraits>
      * Run a station data query, iterating on the resulting variables
      */
     virtual void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) = 0;
+
+    /**
+     * Start a station data query, returning a stream to read its results
+     * incrementally.
+     *
+     * qb must remain valid for the lifetime of the stream.
+     *
+     * Returns nullptr if the backend cannot stream query results: in that
+     * case, use the run_*_query functions instead.
+     */
+    virtual std::unique_ptr<StationDataStream> stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) = 0;
+};
+
+/**
+ * Changes to the data_summary table accumulated during a transaction, to be
+ * written by Data::flush_summary.
+ */
+struct DataSummaryChanges
+{
+    /// Row of the data_summary table
+    struct Key
+    {
+        int id_station;
+        int id_levtr;
+        wreport::Varcode code;
+
+        Key(int id_station, int id_levtr, wreport::Varcode code)
+            : id_station(id_station), id_levtr(id_levtr), code(code) {}
+
+        bool operator<(const Key& o) const;
+    };
+
+    /// Count and datetime range of inserted values
+    struct Added
+    {
+        unsigned count = 0;
+        Datetime dtmin;
+        Datetime dtmax;
+    };
+
+    /// Inserted values, by summary row
+    std::map<Key, Added> added;
+
+    /// Summary rows with removed values, which need to be recomputed
+    std::set<Key> removed;
+
+    void add(int id_station, int id_levtr, wreport::Varcode code, const Datetime& datetime);
+    void remove(int id_station, int id_levtr, wreport::Varcode code);
+    bool empty() const { return added.empty() && removed.empty(); }
+    void clear();
 };
 
 struct Data : public DataCommon<DataTraits>
 {
+protected:
+    /// Add the count and datetime range of inserted values to a summary row
+    virtual void summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added) = 0;
+
+    /**
+     * Recompute all the summary rows of the given stations from the contents
+     * of the data table, with a single grouped query
+     */
+    virtual void summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations) = 0;
+
+public:
+    /**
+     * Mark for recomputation the summary row of the value with the given id,
+     * which is about to be removed
+     */
+    virtual void summary_remove_by_id(Tracer<>& trc, int id_data) = 0;
+
+public:
     using DataCommon<DataTraits>::DataCommon;
 
+    /// Changes not yet written to the data_summary table
+    DataSummaryChanges summary_changes;
+
+    /**
+     * Write summary_changes to the data_summary table.
+     *
+     * The summary of stations with removed values is recomputed from the
+     * data table, the other rows are updated incrementally.
+     */
+    void flush_summary(Tracer<>& trc);
+
     /// Bulk variable insert
     virtual void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) = 0;
 
@@ -167,6 +287,17 @@ struct Data : public DataCommon<DataTraits>
      */
     virtual void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) = 0;
 
+    /**
+     * Start a data query, returning a stream to read its results
+     * incrementally.
+     *
+     * qb must remain valid for the lifetime of the stream.
+     *
+     * Returns nullptr if the backend cannot stream query results: in that
+     * case, use the run_*_query functions instead.
+     */
+    virtual std::unique_ptr<DataStream> stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) = 0;
+
     /**
      * Run a summary query, iterating on the resulting variables
      */
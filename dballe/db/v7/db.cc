@@ -7,6 +7,7 @@
 #include "dballe/db/v7/station.h"
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/data.h"
+#include "dballe/db/v7/pool.h"
 #include "cursor.h"
 #include "dballe/core/query.h"
 #include "dballe/types.h"
@@ -47,24 +48,54 @@ DB::DB(shared_ptr<Connection> conn)
 
 DB::~DB()
 {
+    pool.reset();
     trace->save();
     delete m_driver;
     delete trace;
 }
 
+db::Format DB::format() const
+{
+    if (conn->server_type == sql::ServerType::MEMORY)
+        return Format::MEM;
+    return Format::V7;
+}
+
 v7::Driver& DB::driver()
 {
     return *m_driver;
 }
 
+void DB::enable_pool(unsigned size)
+{
+    switch (conn->server_type)
+    {
+        case sql::ServerType::POSTGRES:
+        case sql::ServerType::MYSQL:
+            break;
+        default:
+            throw error_unimplemented("connection pools are only supported on PostgreSQL and MySQL");
+    }
+    pool.reset(new ConnectionPool(conn->get_url(), size));
+}
+
+void DB::invalidate_pool()
+{
+    if (pool) pool->invalidate();
+}
+
 std::shared_ptr<dballe::Transaction> DB::transaction(bool readonly)
 {
+    if (pool)
+        return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), pool->borrow(), readonly);
     auto res = conn->transaction(readonly);
     return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res));
 }
 
 std::shared_ptr<dballe::db::Transaction> DB::test_transaction(bool readonly)
 {
+    if (pool)
+        return make_shared<v7::TestTransaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), pool->borrow(), readonly);
     auto res = conn->transaction(readonly);
     return make_shared<v7::TestTransaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res));
 }
@@ -72,6 +103,7 @@ std::shared_ptr<dballe::db::Transaction> DB::test_transaction(bool readonly)
 void DB::delete_tables()
 {
     m_driver->delete_tables_v7();
+    if (pool) pool->invalidate();
 }
 
 void DB::disappear()
@@ -79,6 +111,7 @@ void DB::disappear()
     // TODO: track open trasnsactions with weak pointers and roll them all
     // back, or raise errors if some of them have not been fired yet?
     m_driver->delete_tables_v7();
+    if (pool) pool->invalidate();
 }
 
 void DB::reset(const char* repinfo_file)
@@ -86,6 +119,7 @@ void DB::reset(const char* repinfo_file)
     auto trc = trace->trace_reset(repinfo_file);
     disappear();
     m_driver->create_tables_v7();
+    if (pool) pool->invalidate();
 
     // Populate the tables with values
     auto tr = dynamic_pointer_cast<db::Transaction>(transaction());
@@ -100,6 +134,7 @@ void DB::vacuum()
     auto t = conn->transaction();
     driver().vacuum_v7();
     t->commit();
+    if (pool) pool->invalidate();
 }
 
 }
@@ -30,6 +30,8 @@ public:
 protected:
     /// SQL driver backend
     v7::Driver* m_driver;
+    /// Pool of connections used by transactions, if enabled
+    std::unique_ptr<ConnectionPool> pool;
 
     void init_after_connect();
 
@@ -37,11 +39,30 @@ public:
     DB(std::shared_ptr<dballe::sql::Connection> conn);
     virtual ~DB();
 
-    db::Format format() const { return Format::V7; }
+    db::Format format() const override;
 
     /// Access the backend DB driver
     v7::Driver& driver();
 
+    /**
+     * Run transactions on a pool of up to \a size connections, so that they
+     * can be used concurrently from multiple threads.
+     *
+     * The connection used to create the DB is still used for maintenance
+     * operations like reset() and vacuum().
+     *
+     * This is only supported on PostgreSQL and MySQL.
+     */
+    void enable_pool(unsigned size);
+
+    /**
+     * Close the pooled connections, if a pool is enabled.
+     *
+     * Call this after changing the database schema through conn, so that
+     * transactions do not use drivers with stale information about it.
+     */
+    void invalidate_pool();
+
     std::shared_ptr<dballe::Transaction> transaction(bool readonly=false) override;
     std::shared_ptr<dballe::db::Transaction> test_transaction(bool readonly=false) override;
 
@@ -1,6 +1,8 @@
 #include "driver.h"
 #include "config.h"
 #include "dballe/db/v7/sqlite/driver.h"
+#include "dballe/db/v7/mem/driver.h"
+#include "dballe/db/v7/mem/storage.h"
 #include "dballe/sql/sqlite.h"
 #ifdef HAVE_LIBPQ
 #include "dballe/db/v7/postgresql/driver.h"
@@ -47,6 +49,27 @@ void Driver::delete_tables(db::Format format)
     }
 }
 
+bool Driver::has_station_spatial_index()
+{
+    if (station_spatial_index == -1)
+        station_spatial_index = connection.get_setting("station_spatial_index").empty() ? 0 : 1;
+    return station_spatial_index == 1;
+}
+
+bool Driver::has_typed_values()
+{
+    if (typed_values == -1)
+        typed_values = connection.get_setting("typed_values").empty() ? 0 : 1;
+    return typed_values == 1;
+}
+
+bool Driver::has_data_summary()
+{
+    if (data_summary == -1)
+        data_summary = connection.get_setting("data_summary").empty() ? 0 : 1;
+    return data_summary == 1;
+}
+
 void Driver::remove_all(db::Format format)
 {
     switch (format)
@@ -58,18 +81,27 @@ void Driver::remove_all(db::Format format)
 
 void Driver::remove_all_v7()
 {
+    if (has_data_summary())
+        connection.execute("DELETE FROM data_summary");
     connection.execute("DELETE FROM station_data");
     connection.execute("DELETE FROM data");
     connection.execute("DELETE FROM levtr");
     connection.execute("DELETE FROM station");
 }
 
+unsigned Driver::drop_data_partitions_v7(const Datetime& before)
+{
+    throw error_unimplemented("partitioned data tables are only supported on PostgreSQL");
+}
+
 std::unique_ptr<Driver> Driver::create(dballe::sql::Connection& conn)
 {
     using namespace dballe::sql;
 
     if (SQLiteConnection* c = dynamic_cast<SQLiteConnection*>(&conn))
         return unique_ptr<Driver>(new sqlite::Driver(*c));
+    else if (mem::MemConnection* c = dynamic_cast<mem::MemConnection*>(&conn))
+        return unique_ptr<Driver>(new mem::Driver(*c));
 #ifdef HAVE_LIBPQ
     else if (PostgreSQLConnection* c = dynamic_cast<PostgreSQLConnection*>(&conn))
         return unique_ptr<Driver>(new postgresql::Driver(*c));
@@ -86,7 +118,7 @@ std::unique_ptr<Driver> Driver::create(dballe::sql::Connection& conn)
 #ifdef HAVE_MYSQL
                 "MySQL, "
 #endif
-                "SQLite connectors");
+                "SQLite and in-memory connectors");
 }
 
 }
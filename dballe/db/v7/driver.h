@@ -18,6 +18,14 @@ namespace v7 {
 
 struct Driver
 {
+protected:
+    /// Cached value for has_station_spatial_index: -1 if not yet checked
+    int station_spatial_index = -1;
+    /// Cached value for has_typed_values: -1 if not yet checked
+    int typed_values = -1;
+    /// Cached value for has_data_summary: -1 if not yet checked
+    int data_summary = -1;
+
 public:
     sql::Connection& connection;
 
@@ -60,6 +68,75 @@ public:
     /// Perform database cleanup/maintenance on v7 databases
     virtual void vacuum_v7() = 0;
 
+    /**
+     * Create, if missing, an index on the data table that covers the columns
+     * read by data queries, in the order used to sort their results.
+     *
+     * It is not created by default, since it makes the data table
+     * considerably larger and slower to insert into.
+     */
+    virtual void create_data_covering_index_v7() = 0;
+
+    /**
+     * Add, if missing, an ivalue column to the data and station_data tables,
+     * holding the scaled integer value of numeric variables.
+     *
+     * The column is filled for existing rows, kept up to date on insert and
+     * update, and indexed together with the varcode, so that numeric
+     * data_filter and ana_filter constraints can use an index.
+     *
+     * It is not created by default, since it makes inserts slower.
+     */
+    virtual void create_typed_values_v7() = 0;
+
+    /**
+     * Create, if missing, the data_summary table, holding count and datetime
+     * range of the values in data for each station, levtr and varcode.
+     *
+     * It is created with the other tables, and this is used to add it to
+     * databases created before it existed.
+     */
+    virtual void create_data_summary_v7() = 0;
+
+    /**
+     * Remove all the data before the given datetime, by dropping whole
+     * partitions of a data table partitioned by month.
+     *
+     * Only the partitions that end before \a before are dropped, so data in
+     * the month of \a before is kept. Stations and levtr entries left
+     * without data are not removed: use vacuum_v7() for that.
+     *
+     * @returns the number of partitions dropped
+     */
+    virtual unsigned drop_data_partitions_v7(const Datetime& before);
+
+    /**
+     * Check if the station table has a spatial index that can be used to
+     * look up stations by lat/lon bounding box.
+     *
+     * The result is read from the database settings the first time, and
+     * cached afterwards.
+     */
+    bool has_station_spatial_index();
+
+    /**
+     * Check if the data and station_data tables have the ivalue column
+     * created by create_typed_values_v7.
+     *
+     * The result is read from the database settings the first time, and
+     * cached afterwards.
+     */
+    bool has_typed_values();
+
+    /**
+     * Check if the database has the data_summary table created by
+     * create_data_summary_v7.
+     *
+     * The result is read from the database settings the first time, and
+     * cached afterwards.
+     */
+    bool has_data_summary();
+
     /// Create a Driver for this connection
     static std::unique_ptr<Driver> create(dballe::sql::Connection& conn);
 };
@@ -10,6 +10,7 @@
 #include "dballe/msg/context.h"
 #include "dballe/core/query.h"
 #include <map>
+#include <deque>
 #include <memory>
 #include <cstring>
 #include <iostream>
@@ -48,9 +49,57 @@ struct ProtoVar
 
 struct ProtoMessage
 {
+    int id_station = -1;
     std::unique_ptr<impl::Message> msg;
     std::vector<ProtoVar> vars;
     ProtoMessage() : msg(new impl::Message) {}
+
+    /// Fill in the message header
+    void init(const dballe::DBStation& station, const Datetime& datetime)
+    {
+        id_station = station.id;
+        msg->set_datetime(datetime);
+        msg->station_data.set(newvar(WR_VAR(0, 1, 194), station.report));
+        msg->type = impl::Message::type_from_repmemo(station.report.c_str());
+        msg->station_data.set(newvar(WR_VAR(0, 5, 1), station.coords.lat));
+        msg->station_data.set(newvar(WR_VAR(0, 6, 1), station.coords.lon));
+        if (!station.ident.is_missing())
+            msg->station_data.set(newvar(WR_VAR(0, 1, 11), (const char*)station.ident));
+    }
+
+    /**
+     * Merge station values and move variables to their contexts, returning
+     * the finished message.
+     *
+     * The levtr entries of all vars need to have been prefetched.
+     */
+    std::unique_ptr<impl::Message> finish(Tracer<>& trc, v7::LevTr& lt, const Values& station_values)
+    {
+        // Fill in station information
+        msg->station_data.merge(station_values);
+
+        // Move variables to contexts
+        {
+            impl::msg::Contexts::BulkInsert bulk(msg->data);
+            int last_id_levtr = -1;
+            impl::msg::Context* ctx = nullptr;
+            for (auto& pvar: vars)
+            {
+                if (pvar.id_levtr != last_id_levtr)
+                {
+                    ctx = lt.to_msg(trc, pvar.id_levtr, *msg);
+                    last_id_levtr = pvar.id_levtr;
+                }
+                ctx->values.set(std::move(pvar.var));
+            }
+        }
+        vars.clear();
+
+        if (msg->type == MessageType::PILOT || msg->type == MessageType::TEMP || msg->type == MessageType::TEMP_SHIP)
+            msg->sounding_pack_levels();
+
+        return std::move(msg);
+    }
 };
 
 struct Cursor : public impl::CursorMessage
@@ -107,15 +156,141 @@ struct Cursor : public impl::CursorMessage
     }
 };
 
+/**
+ * Cursor that reads export results from the database a batch at a time,
+ * building each message as soon as all its data has been read
+ */
+struct StreamCursor : public impl::CursorMessage
+{
+    std::shared_ptr<v7::Transaction> tr;
+    Tracer<> trc;
+    std::unique_ptr<cursor::StreamQuery> stream_query;
+    std::unique_ptr<DataStream> stream;
+    /// Number of rows to read from the database at a time
+    unsigned batch_size = 1000;
+    /// Messages being built, in output order. Only the last one can still be
+    /// incomplete while stream is active
+    std::deque<ProtoMessage> pending;
+    Datetime pending_datetime;
+    /// Station values of the station of the last message returned
+    StationValues station_values;
+    int station_values_id = -1;
+    std::unique_ptr<dballe::Message> cur;
+
+    StreamCursor(std::shared_ptr<v7::Transaction> tr, std::unique_ptr<cursor::StreamQuery> query, std::unique_ptr<DataStream> stream)
+        : tr(tr), stream_query(std::move(query)), stream(std::move(stream)), station_values(trc)
+    {
+    }
+
+    void fetch_batch()
+    {
+        std::set<int> id_levtrs;
+        bool more = stream->fetch(batch_size, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+            if (pending.empty() || station.id != pending.back().id_station || datetime != pending_datetime)
+            {
+                pending.emplace_back();
+                pending.back().init(station, datetime);
+                pending_datetime = datetime;
+            }
+            id_levtrs.insert(id_levtr);
+            pending.back().vars.emplace_back(id_levtr, std::move(var));
+        });
+        if (!more)
+            stream.reset();
+        tr->levtr().prefetch_ids(trc, id_levtrs);
+    }
+
+    bool has_value() const { return (bool)cur; }
+
+    const Message& get_message() const override
+    {
+        return *cur;
+    }
+
+    std::unique_ptr<Message> detach_message() override
+    {
+        return std::move(cur);
+    }
+
+    int remaining() const override
+    {
+        return -1;
+    }
+
+    bool next() override
+    {
+        cur.reset();
+
+        // Read until the first pending message is known to be complete
+        while (stream && pending.size() < 2)
+            fetch_batch();
+        if (pending.empty())
+            return false;
+
+        // Messages are sorted by station, so station values only need to be
+        // read when the station changes
+        int id_station = pending.front().id_station;
+        if (id_station != station_values_id)
+        {
+            station_values.read(*tr, id_station);
+            station_values_id = id_station;
+        }
+
+        cur = pending.front().finish(trc, tr->levtr(), station_values);
+        pending.pop_front();
+        return true;
+    }
+
+    void discard() override
+    {
+        stream.reset();
+        pending.clear();
+        cur.reset();
+    }
+
+    DBStation get_station() const override
+    {
+        DBStation res;
+        res.coords = cur->get_coords();
+        res.ident  = cur->get_ident();
+        res.report = cur->get_report();
+        return res;
+    }
+};
+
 }
 
 std::unique_ptr<dballe::CursorMessage> Transaction::query_messages(const Query& query)
 {
     Tracer<> trc(this->trc ? this->trc->trace_export_msgs(query) : nullptr);
     v7::LevTr& lt = levtr();
+    const core::Query& q = core::Query::downcast(query);
+    unsigned modifiers = DBA_DB_MODIFIER_SORT_FOR_EXPORT | DBA_DB_MODIFIER_WITH_ATTRIBUTES;
+
+    if (q.get_modifiers() & DBA_DB_MODIFIER_STREAM)
+    {
+        // The cursor reads results after we return, so it needs its own copy
+        // of the query
+        std::unique_ptr<cursor::StreamQuery> sq(new cursor::StreamQuery(dynamic_pointer_cast<v7::Transaction>(shared_from_this()), q, modifiers, false));
+        sq->qb.build();
+
+        // Backends that cannot stream use the regular export query below
+        Tracer<> trc_stream;
+        auto stream = data().stream_data_query(trc_stream, sq->qb);
+        if (stream)
+        {
+            if (db->explain_queries)
+            {
+                fprintf(stderr, "EXPLAIN "); query.print(stderr);
+                conn->explain(sq->qb.sql_query, stderr);
+            }
+
+            return std::unique_ptr<dballe::CursorMessage>(new StreamCursor(dynamic_pointer_cast<v7::Transaction>(shared_from_this()), std::move(sq), std::move(stream)));
+        }
+    }
 
     // The big export query
-    DataQueryBuilder qb(dynamic_pointer_cast<v7::Transaction>(shared_from_this()), core::Query::downcast(query), DBA_DB_MODIFIER_SORT_FOR_EXPORT | DBA_DB_MODIFIER_WITH_ATTRIBUTES, false);
+    DataQueryBuilder qb(dynamic_pointer_cast<v7::Transaction>(shared_from_this()), q, modifiers, false);
     qb.build();
 
     // Current context information used to detect context changes
@@ -127,7 +302,7 @@ std::unique_ptr<dballe::CursorMessage> Transaction::query_messages(const Query&
     if (db->explain_queries)
     {
         fprintf(stderr, "EXPLAIN "); query.print(stderr);
-        db->conn->explain(qb.sql_query, stderr);
+        conn->explain(qb.sql_query, stderr);
     }
 
     // Retrieve results, buffering them locally to avoid performing concurrent
@@ -141,13 +316,7 @@ std::unique_ptr<dballe::CursorMessage> Transaction::query_messages(const Query&
             auto& vec = results[station.id];
             vec.emplace_back();
             msg = &vec.back();
-            msg->msg->set_datetime(datetime);
-            msg->msg->station_data.set(newvar(WR_VAR(0, 1, 194), station.report));
-            msg->msg->type = impl::Message::type_from_repmemo(station.report.c_str());
-            msg->msg->station_data.set(newvar(WR_VAR(0, 5, 1), station.coords.lat));
-            msg->msg->station_data.set(newvar(WR_VAR(0, 6, 1), station.coords.lon));
-            if (!station.ident.is_missing())
-                msg->msg->station_data.set(newvar(WR_VAR(0, 1, 11), (const char*)station.ident));
+            msg->init(station, datetime);
             last_datetime = datetime;
             last_ana_id = station.id;
         }
@@ -162,30 +331,7 @@ std::unique_ptr<dballe::CursorMessage> Transaction::query_messages(const Query&
     {
         station_values.read(*this, r.first);
         for (auto& msg: r.second)
-        {
-            // Fill in station information
-            msg.msg->station_data.merge(station_values);
-
-            // Move variables to contexts
-            int last_id_levtr = -1;
-            impl::msg::Context* ctx = nullptr;
-            for (auto& pvar: msg.vars)
-            {
-                if (pvar.id_levtr != last_id_levtr)
-                {
-                    ctx = lt.to_msg(trc, pvar.id_levtr, *msg.msg);
-                    last_id_levtr = pvar.id_levtr;
-                }
-                ctx->values.set(std::move(pvar.var));
-            }
-            msg.vars.clear();
-
-            // Send message to consumer
-            if (msg.msg->type == MessageType::PILOT || msg.msg->type == MessageType::TEMP || msg.msg->type == MessageType::TEMP_SHIP)
-                msg.msg->sounding_pack_levels();
-
-            res->results.emplace_back(std::move(msg.msg));
-        }
+            res->results.emplace_back(msg.finish(trc, lt, station_values));
         r.second.clear();
     }
     results.clear();
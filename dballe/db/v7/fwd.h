@@ -18,6 +18,8 @@ struct LevTr;
 struct LevTrEntry;
 struct SQLTrace;
 struct Driver;
+struct PooledConnection;
+class ConnectionPool;
 
 namespace cursor {
 struct Stations;
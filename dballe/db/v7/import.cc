@@ -8,7 +8,9 @@
 #include "dballe/db/v7/data.h"
 #include "dballe/msg/msg.h"
 #include "dballe/msg/context.h"
+#include <algorithm>
 #include <cassert>
+#include <map>
 
 using namespace wreport;
 using dballe::sql::Connection;
@@ -17,6 +19,48 @@ namespace dballe {
 namespace db {
 namespace v7 {
 
+/**
+ * Number of messages of a report in a single import_messages call above which
+ * it is cheaper to load the stations of that report in the area of the
+ * messages into the cache than to look up stations one at a time.
+ */
+static const unsigned station_prefetch_threshold = 100;
+
+/**
+ * Maximum number of stations prefetched for each message imported, so that
+ * the cost of prefetching grows with the size of the import and not with the
+ * size of the station table
+ */
+static const unsigned station_prefetch_per_message = 4;
+
+namespace {
+
+/// Messages of a report in an import batch, and their bounding box
+struct ImportArea
+{
+    unsigned count = 0;
+    int latmin = MISSING_INT;
+    int latmax = MISSING_INT;
+    int lonmin = MISSING_INT;
+    int lonmax = MISSING_INT;
+
+    void add(const Coords& coords)
+    {
+        if (count++ == 0)
+        {
+            latmin = latmax = coords.lat;
+            lonmin = lonmax = coords.lon;
+            return;
+        }
+        latmin = std::min(latmin, coords.lat);
+        latmax = std::max(latmax, coords.lat);
+        lonmin = std::min(lonmin, coords.lon);
+        lonmax = std::max(lonmax, coords.lon);
+    }
+};
+
+}
+
 void Transaction::add_msg_to_batch(Tracer<>& trc, const Message& message, const dballe::DBImportOptions& opts)
 {
     const impl::Message& msg = impl::Message::downcast(message);
@@ -109,6 +153,29 @@ void Transaction::import_messages(const std::vector<std::shared_ptr<dballe::Mess
 
     batch.set_write_attrs(opts.import_attributes);
 
+    if (messages.size() >= station_prefetch_threshold)
+    {
+        // Prefetch stations only in the area covered by each report
+        std::map<std::string, ImportArea> areas;
+        for (const auto& i: messages)
+        {
+            const impl::Message& msg = impl::Message::downcast(*i);
+            Coords coords = msg.get_coords();
+            if (coords.is_missing()) continue;
+            areas[opts.report.empty() ? msg.get_report() : opts.report].add(coords);
+        }
+
+        for (const auto& a: areas)
+        {
+            if (a.second.count < station_prefetch_threshold) continue;
+            LatRange latrange(a.second.latmin, a.second.latmax);
+            LonRange lonrange(a.second.lonmin, a.second.lonmax);
+            if (station().cache_complete(a.first, latrange, lonrange))
+                continue;
+            station().prefetch_area(trc, a.first, latrange, lonrange, a.second.count * station_prefetch_per_message);
+        }
+    }
+
     for (const auto& i: messages)
         add_msg_to_batch(trc, *i, opts);
 
@@ -16,6 +16,30 @@ void LevTr::clear_cache()
     cache.clear();
 }
 
+void LevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+{
+    std::set<int> missing;
+    for (auto id: ids)
+        if (!cache.find_entry(id))
+            missing.insert(id);
+    if (missing.empty()) return;
+    _prefetch_ids(trc, missing);
+}
+
+void LevTr::load_cache(const LevTrCache& src)
+{
+    for (const auto& i: src.by_id)
+        if (!cache.find_entry(i.first))
+            cache.insert(*i.second);
+}
+
+void LevTr::save_cache(LevTrCache& dest) const
+{
+    for (const auto& i: cache.by_id)
+        if (!dest.find_entry(i.first))
+            dest.insert(*i.second);
+}
+
 const LevTrEntry& LevTr::lookup_cache(int id)
 {
     const LevTrEntry* res = cache.find_entry(id);
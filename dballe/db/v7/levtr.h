@@ -24,6 +24,9 @@ protected:
     LevTrCache cache;
     virtual void _dump(std::function<void(int, const Level&, const Trange&)> out) = 0;
 
+    /// Load LevTr information for the given IDs, none of which is in the cache
+    virtual void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) = 0;
+
 public:
     LevTr(v7::Transaction& tr);
     virtual ~LevTr();
@@ -38,8 +41,16 @@ public:
 
     /**
      * Given a set of IDs, load LevTr information for them and add it to the cache.
+     *
+     * IDs that are already in the cache are not looked up again.
      */
-    virtual void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) = 0;
+    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids);
+
+    /// Add all the entries of src to the cache
+    void load_cache(const LevTrCache& src);
+
+    /// Add all the cached entries to dest, skipping those already there
+    void save_cache(LevTrCache& dest) const;
 
     /**
      * Get/create a Context in the Msg for this level/timerange.
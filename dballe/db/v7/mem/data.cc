@@ -0,0 +1,724 @@
+#include "data.h"
+#include "query.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/batch.h"
+#include "dballe/db/v7/qbuilder.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/db/v7/trace.h"
+#include "dballe/values.h"
+#include "dballe/core/values.h"
+#include "dballe/var.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+template class MemDataCommon<StationData>;
+template class MemDataCommon<Data>;
+
+template<typename Parent>
+MemDataCommon<Parent>::MemDataCommon(v7::Transaction& tr, MemConnection& conn)
+    : Parent(tr), conn(conn)
+{
+}
+
+template<typename Parent>
+MemDataCommon<Parent>::~MemDataCommon()
+{
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::read_attrs(Tracer<>& trc, int id_data, std::function<void(std::unique_ptr<wreport::Var>)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT attrs FROM … WHERE id=?") : nullptr);
+    const std::vector<uint8_t>* attrs = value_attrs(id_data);
+    if (!attrs) return;
+    if (trc_sel) trc_sel->add_row();
+    Values::decode(*attrs, dest);
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data, const Values& values)
+{
+    Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … SET attrs=? WHERE id=?", 1) : nullptr);
+    set_attrs(id_data, values.encode());
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
+{
+    Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … SET attrs=NULL WHERE id=?", 1) : nullptr);
+    set_attrs(id_data, std::vector<uint8_t>());
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
+{
+    // Collect the IDs first, since removing values changes the indices that
+    // query_ids is iterating
+    std::vector<int> ids;
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+    query_ids(qb, [&](int id_data, const std::vector<uint8_t>& attrs) {
+        if (trc_sel) trc_sel->add_row();
+        if (qb.attr_filter && !qb.match_attrs(attrs)) return;
+        ids.push_back(id_data);
+    });
+
+    char query[64];
+    snprintf(query, 64, "DELETE FROM %s WHERE id=?", Parent::table_name);
+    Tracer<> trc_del(trc ? trc->trace_delete(query, ids.size()) : nullptr);
+    for (auto id: ids)
+        remove_value(id);
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::remove_by_id(Tracer<>& trc, int id)
+{
+    char query[64];
+    snprintf(query, 64, "DELETE FROM %s WHERE id=%d", Parent::table_name, id);
+
+    Tracer<> trc_del(trc ? trc->trace_delete(query, 1) : nullptr);
+    remove_value(id);
+}
+
+template<typename Parent>
+void MemDataCommon<Parent>::update(Tracer<>& trc, std::vector<typename Parent::BatchValue>& vars, bool with_attrs)
+{
+    for (auto& v: vars)
+    {
+        core::value::Encoder enc;
+        if (with_attrs && v.var->next_attr())
+            enc.append_attributes(*v.var);
+
+        Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … set value=?, attrs=? WHERE id=?", 1) : nullptr);
+        update_value(v.id, v.var->enqc(), enc.buf);
+    }
+}
+
+
+namespace {
+
+/// Copy of a station variable selected by a query
+struct StationDataRow
+{
+    int id_station;
+    wreport::Varcode code;
+    int id_data;
+    std::string value;
+    std::vector<uint8_t> attrs;
+};
+
+/// Copy of a measured value selected by a query, with its sorting keys
+struct DataRow
+{
+    int id_station;
+    int rep;
+    /// Position of the level and time range in the sorting order
+    unsigned levtr_rank;
+    int id_levtr;
+    wreport::Varcode code;
+    int id_data;
+    std::string value;
+    std::vector<uint8_t> attrs;
+
+    bool operator<(const DataRow& o) const
+    {
+        if (levtr_rank != o.levtr_rank) return levtr_rank < o.levtr_rank;
+        if (rep != o.rep) return rep < o.rep;
+        return code < o.code;
+    }
+};
+
+/// Check if a query limit has been reached
+inline bool limit_reached(const core::Query& query, size_t count)
+{
+    return query.limit != MISSING_INT && count >= (unsigned)query.limit;
+}
+
+/**
+ * Iterate the data blocks of a station whose datetime is in the query
+ * datetime range
+ */
+void for_each_block(const Storage& storage, int id_station, const core::Query& query, std::function<void(const Datetime& datetime, const DataBlock& block)> dest)
+{
+    auto st = storage.data.find(id_station);
+    if (st == storage.data.end()) return;
+
+    const DatetimeRange& dtrange = query.dtrange;
+    auto i = dtrange.min.is_missing() ? st->second.begin() : st->second.lower_bound(dtrange.min);
+    for ( ; i != st->second.end(); ++i)
+    {
+        if (!dtrange.max.is_missing() && dtrange.max < i->first) break;
+        dest(i->first, i->second);
+    }
+}
+
+/// Collect the station variables selected by a query, in station and varcode order
+void collect_station_data(v7::Transaction& tr, const Storage& storage, const v7::DataQueryBuilder& qb, std::function<void(int id_station, wreport::Varcode code, const StationValue& value)> dest)
+{
+    StationFilter station_filter(tr, storage, qb.query, true);
+    ValueFilter value_filter(storage, qb.query, true);
+    size_t count = 0;
+
+    station_filter.for_each([&](int id_station, const StationRow&) {
+        auto st = storage.station_data.find(id_station);
+        if (st == storage.station_data.end()) return;
+        for (const auto& i: st->second)
+        {
+            if (limit_reached(qb.query, count)) return;
+            if (!value_filter.match_value(i.first, i.second.value)) continue;
+            dest(id_station, i.first, i.second);
+            ++count;
+        }
+    });
+}
+
+/**
+ * Fill station with the details of the station with the given ID, if it is
+ * not already there.
+ *
+ * Returns false if the station does not exist anymore.
+ */
+bool load_station(v7::Transaction& tr, const Storage& storage, int id_station, dballe::DBStation& station)
+{
+    if (id_station == station.id) return true;
+    const StationRow* row = storage.station(id_station);
+    if (!row) return false;
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(row->rep);
+    station.coords = row->coords;
+    station.ident = row->ident;
+    return true;
+}
+
+/**
+ * Read the station variables selected by a query, in station and varcode
+ * order.
+ *
+ * Variables are copied one station at a time, as the stream is read.
+ */
+struct MemStationDataStream : public StationDataStream
+{
+    v7::Transaction& tr;
+    const Storage& storage;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    ValueFilter value_filter;
+    /// IDs of the selected stations, in output order
+    std::vector<int> stations;
+    /// Position in stations of the next station to read
+    size_t next_station = 0;
+    /// Variables of the current station
+    std::vector<StationDataRow> rows;
+    size_t pos = 0;
+    /// Number of variables selected so far
+    size_t count = 0;
+    dballe::DBStation station;
+
+    MemStationDataStream(v7::Transaction& tr, const Storage& storage, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), storage(storage), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr),
+          value_filter(storage, qb.query, true)
+    {
+        StationFilter station_filter(tr, storage, qb.query, true);
+        station_filter.for_each([&](int id_station, const StationRow&) {
+            stations.push_back(id_station);
+        });
+    }
+
+    /// Read the variables of the next station that has any. Returns false at the end of the results
+    bool fill()
+    {
+        rows.clear();
+        pos = 0;
+        while (rows.empty())
+        {
+            if (next_station == stations.size() || limit_reached(qb.query, count))
+                return false;
+            int id_station = stations[next_station++];
+            auto st = storage.station_data.find(id_station);
+            if (st == storage.station_data.end()) continue;
+            for (const auto& i: st->second)
+            {
+                if (limit_reached(qb.query, count)) break;
+                if (!value_filter.match_value(i.first, i.second.value)) continue;
+                rows.emplace_back(StationDataRow{id_station, i.first, i.second.id, i.second.value,
+                        qb.select_attrs ? i.second.attrs : std::vector<uint8_t>()});
+                ++count;
+            }
+        }
+        return true;
+    }
+
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        for (unsigned i = 0; max_rows == 0 || i < max_rows; ++i)
+        {
+            if (pos == rows.size() && !fill())
+                return false;
+            const StationDataRow& row = rows[pos++];
+            if (trc_sel) trc_sel->add_row();
+            // Postprocessing filter of attr_filter
+            if (qb.attr_filter && !qb.match_attrs(row.attrs))
+                continue;
+
+            auto var = newvar(row.code, row.value.c_str());
+            if (qb.select_attrs)
+                core::value::Decoder::decode_attrs(row.attrs, *var);
+
+            if (!load_station(tr, storage, row.id_station, station))
+                continue;
+
+            dest(station, row.id_data, move(var));
+        }
+        return true;
+    }
+};
+
+/**
+ * Read the measured values selected by a query, sorted as the SQL backends
+ * would sort them.
+ *
+ * Values are copied one station and datetime at a time, as the stream is
+ * read. Data blocks are looked up again at each step, so that the database
+ * can be modified while the stream is being read.
+ */
+struct MemDataStream : public DataStream
+{
+    v7::Transaction& tr;
+    const Storage& storage;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    ValueFilter value_filter;
+    bool sorted;
+    /// Position of level and time ranges in the sorting order
+    std::unordered_map<int, unsigned> levtr_rank;
+    /// ID and report of the selected stations, in output order
+    std::vector<std::pair<int, int>> stations;
+    /**
+     * Position of the stations in the sorting order. Stations with the same
+     * rank have their values merged by datetime.
+     */
+    std::vector<unsigned> station_rank;
+    /// Range in stations of the stations being read
+    size_t group_begin = 0;
+    size_t group_end = 0;
+    /// Datetime of the values being read, missing at the start of a group
+    Datetime cur_datetime;
+    /// Values of the current stations at cur_datetime
+    std::vector<DataRow> rows;
+    size_t pos = 0;
+    /// Number of values selected so far
+    size_t count = 0;
+    dballe::DBStation station;
+
+    MemDataStream(v7::Transaction& tr, const Storage& storage, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), storage(storage), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr),
+          value_filter(storage, qb.query, false), sorted(!(qb.modifiers & DBA_DB_MODIFIER_UNSORTED))
+    {
+        // Rank level and time ranges by their sort order, which is the order
+        // of levtr_index
+        if (sorted)
+        {
+            unsigned rank = 0;
+            for (const auto& i: storage.levtr_index)
+                levtr_rank[i.second] = rank++;
+        }
+
+        StationFilter station_filter(tr, storage, qb.query, true);
+        std::vector<std::pair<int, const StationRow*>> selected;
+        station_filter.for_each([&](int id_station, const StationRow& station) {
+            selected.emplace_back(id_station, &station);
+        });
+
+        // Rank stations: by ID, or for best queries by coordinates and
+        // identifier, so that values of different reports for the same
+        // station are next to each other
+        if (sorted && qb.modifiers & DBA_DB_MODIFIER_BEST)
+        {
+            std::sort(selected.begin(), selected.end(), [](const std::pair<int, const StationRow*>& a, const std::pair<int, const StationRow*>& b) {
+                if (int res = a.second->coords.compare(b.second->coords)) return res < 0;
+                if (int res = a.second->ident.compare(b.second->ident)) return res < 0;
+                return a.first < b.first;
+            });
+            unsigned rank = 0;
+            for (unsigned i = 0; i < selected.size(); ++i)
+            {
+                if (i > 0 && (selected[i].second->coords != selected[i - 1].second->coords || selected[i].second->ident != selected[i - 1].second->ident))
+                    ++rank;
+                station_rank.push_back(rank);
+            }
+        } else {
+            for (unsigned i = 0; i < selected.size(); ++i)
+                station_rank.push_back(i);
+        }
+
+        stations.reserve(selected.size());
+        for (const auto& i: selected)
+            stations.emplace_back(i.first, i.second->rep);
+    }
+
+    /**
+     * Find the first datetime after cur_datetime with values in the current
+     * stations, within the query datetime range.
+     *
+     * Returns false if there is none.
+     */
+    bool next_datetime(Datetime& res) const
+    {
+        const DatetimeRange& dtrange = qb.query.dtrange;
+        bool found = false;
+        for (size_t i = group_begin; i < group_end; ++i)
+        {
+            auto st = storage.data.find(stations[i].first);
+            if (st == storage.data.end()) continue;
+            auto block = cur_datetime.is_missing()
+                ? (dtrange.min.is_missing() ? st->second.begin() : st->second.lower_bound(dtrange.min))
+                : st->second.upper_bound(cur_datetime);
+            if (block == st->second.end()) continue;
+            if (!dtrange.max.is_missing() && dtrange.max < block->first) continue;
+            if (!found || block->first < res)
+            {
+                res = block->first;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /// Copy the values of the current stations at cur_datetime into rows
+    void read_rows()
+    {
+        for (size_t i = group_begin; i < group_end; ++i)
+        {
+            auto st = storage.data.find(stations[i].first);
+            if (st == storage.data.end()) continue;
+            auto b = st->second.find(cur_datetime);
+            if (b == st->second.end()) continue;
+            const DataBlock& block = b->second;
+            for (unsigned pos = 0; pos < block.size(); ++pos)
+            {
+                if (!value_filter.match_levtr(block.id_levtr[pos])) continue;
+                if (!value_filter.match_value(block.codes[pos], block.values[pos])) continue;
+                rows.emplace_back(DataRow{
+                    stations[i].first, stations[i].second,
+                    sorted ? levtr_rank[block.id_levtr[pos]] : 0, block.id_levtr[pos],
+                    block.codes[pos], block.ids[pos], block.values[pos],
+                    qb.select_attrs ? block.attrs[pos] : std::vector<uint8_t>()});
+            }
+        }
+
+        if (sorted)
+            std::sort(rows.begin(), rows.end());
+
+        if (qb.query.limit != MISSING_INT && count + rows.size() > (unsigned)qb.query.limit)
+            rows.resize(qb.query.limit - count);
+        count += rows.size();
+    }
+
+    /// Read the next datetime that has values. Returns false at the end of the results
+    bool fill()
+    {
+        rows.clear();
+        pos = 0;
+        while (rows.empty())
+        {
+            if (limit_reached(qb.query, count))
+                return false;
+
+            Datetime dt;
+            if (group_begin < group_end && next_datetime(dt))
+            {
+                cur_datetime = dt;
+                read_rows();
+                continue;
+            }
+
+            // Move to the next group of stations with the same rank
+            if (group_end == stations.size())
+                return false;
+            group_begin = group_end;
+            group_end = group_begin + 1;
+            while (group_end < stations.size() && station_rank[group_end] == station_rank[group_begin])
+                ++group_end;
+            cur_datetime = Datetime();
+        }
+        return true;
+    }
+
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        for (unsigned i = 0; max_rows == 0 || i < max_rows; ++i)
+        {
+            if (pos == rows.size() && !fill())
+                return false;
+            DataRow& row = rows[pos++];
+            if (trc_sel) trc_sel->add_row();
+            // Postprocessing filter of attr_filter
+            if (qb.attr_filter && !qb.match_attrs(row.attrs))
+                continue;
+
+            auto var = newvar(row.code, row.value.c_str());
+            if (qb.select_attrs)
+                core::value::Decoder::decode_attrs(row.attrs, *var);
+
+            if (!load_station(tr, storage, row.id_station, station))
+                continue;
+
+            dest(station, row.id_levtr, cur_datetime, row.id_data, move(var));
+        }
+        return true;
+    }
+};
+
+}
+
+const std::vector<uint8_t>* MemStationData::value_attrs(int id_data) const
+{
+    const StationValue* value = conn.storage.station_value(id_data);
+    if (!value) return nullptr;
+    return &value->attrs;
+}
+
+void MemStationData::update_value(int id_data, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    conn.storage.station_data_update(id_data, value, attrs);
+}
+
+void MemStationData::set_attrs(int id_data, const std::vector<uint8_t>& attrs)
+{
+    conn.storage.station_data_set_attrs(id_data, attrs);
+}
+
+void MemStationData::remove_value(int id_data)
+{
+    conn.storage.station_data_remove(id_data);
+}
+
+void MemStationData::query_ids(const v7::IdQueryBuilder& qb, std::function<void(int id_data, const std::vector<uint8_t>& attrs)> dest)
+{
+    collect_station_data(tr, conn.storage, qb, [&](int id_station, wreport::Varcode code, const StationValue& value) {
+        dest(value.id, value.attrs);
+    });
+}
+
+void MemStationData::query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT id, code FROM station_data WHERE id_station=?") : nullptr);
+    auto st = conn.storage.station_data.find(id_station);
+    if (st == conn.storage.station_data.end()) return;
+    for (const auto& i: st->second)
+    {
+        if (trc_sel) trc_sel->add_row();
+        dest(i.second.id, i.first);
+    }
+}
+
+void MemStationData::insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs)
+{
+    std::sort(vars.begin(), vars.end());
+
+    Tracer<> trc_ins(trc ? trc->trace_insert("INSERT INTO station_data (id_station, code, value, attrs) VALUES (?, ?, ?, ?)", vars.size()) : nullptr);
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates, keeping the last value
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+
+        core::value::Encoder enc;
+        if (with_attrs && v->var->next_attr())
+            enc.append_attributes(*v->var);
+        v->id = conn.storage.station_data_insert(id_station, v->var->code(), v->var->enqc(), enc.buf);
+    }
+}
+
+void MemStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    MemStationDataStream stream(tr, conn.storage, trc, qb);
+    stream.fetch(0, dest);
+}
+
+std::unique_ptr<StationDataStream> MemStationData::stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<StationDataStream>(new MemStationDataStream(tr, conn.storage, trc, qb));
+}
+
+void MemStationData::dump(FILE* out)
+{
+    StationDataDumper dumper(out);
+
+    dumper.print_head();
+    for (const auto& st: conn.storage.station_data)
+        for (const auto& i: st.second)
+            dumper.print_row(i.second.id, st.first, i.first, i.second.value.c_str(), i.second.attrs);
+    dumper.print_tail();
+}
+
+
+const std::vector<uint8_t>* MemData::value_attrs(int id_data) const
+{
+    unsigned pos;
+    const DataBlock* block = conn.storage.data_value(id_data, pos);
+    if (!block) return nullptr;
+    return &block->attrs[pos];
+}
+
+void MemData::update_value(int id_data, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    conn.storage.data_update(id_data, value, attrs);
+}
+
+void MemData::set_attrs(int id_data, const std::vector<uint8_t>& attrs)
+{
+    conn.storage.data_set_attrs(id_data, attrs);
+}
+
+void MemData::remove_value(int id_data)
+{
+    conn.storage.data_remove(id_data);
+}
+
+void MemData::query_ids(const v7::IdQueryBuilder& qb, std::function<void(int id_data, const std::vector<uint8_t>& attrs)> dest)
+{
+    const Storage& storage = conn.storage;
+    StationFilter station_filter(tr, storage, qb.query, true);
+    ValueFilter value_filter(storage, qb.query, false);
+    size_t count = 0;
+
+    station_filter.for_each([&](int id_station, const StationRow&) {
+        for_each_block(storage, id_station, qb.query, [&](const Datetime& datetime, const DataBlock& block) {
+            for (unsigned pos = 0; pos < block.size(); ++pos)
+            {
+                if (limit_reached(qb.query, count)) return;
+                if (!value_filter.match_levtr(block.id_levtr[pos])) continue;
+                if (!value_filter.match_value(block.codes[pos], block.values[pos])) continue;
+                dest(block.ids[pos], block.attrs[pos]);
+                ++count;
+            }
+        });
+    });
+}
+
+void MemData::query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT id, id_levtr, code FROM data WHERE id_station=? AND datetime=?") : nullptr);
+    auto st = conn.storage.data.find(id_station);
+    if (st == conn.storage.data.end()) return;
+    auto dt = st->second.find(datetime);
+    if (dt == st->second.end()) return;
+    const DataBlock& block = dt->second;
+    for (unsigned pos = 0; pos < block.size(); ++pos)
+    {
+        if (trc_sel) trc_sel->add_row();
+        dest(block.ids[pos], block.id_levtr[pos], block.codes[pos]);
+    }
+}
+
+void MemData::insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
+{
+    std::sort(vars.begin(), vars.end());
+
+    Tracer<> trc_ins(trc ? trc->trace_insert("INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) VALUES (?, ?, ?, ?, ?, ?)", vars.size()) : nullptr);
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates, keeping the last value
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+
+        core::value::Encoder enc;
+        if (with_attrs && v->var->next_attr())
+            enc.append_attributes(*v->var);
+        v->id = conn.storage.data_insert(id_station, datetime, v->id_levtr, v->var->code(), v->var->enqc(), enc.buf);
+    }
+}
+
+void MemData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    MemDataStream stream(tr, conn.storage, trc, qb);
+    stream.fetch(0, dest);
+}
+
+std::unique_ptr<DataStream> MemData::stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<DataStream>(new MemDataStream(tr, conn.storage, trc, qb));
+}
+
+void MemData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)> dest)
+{
+    struct Group
+    {
+        size_t count = 0;
+        Datetime min;
+        Datetime max;
+    };
+
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+    const Storage& storage = conn.storage;
+    StationFilter station_filter(tr, storage, qb.query, true);
+    ValueFilter value_filter(storage, qb.query, false);
+
+    // Aggregate values by station, levtr and varcode
+    std::map<std::tuple<int, int, wreport::Varcode>, Group> groups;
+    station_filter.for_each([&](int id_station, const StationRow&) {
+        for_each_block(storage, id_station, qb.query, [&](const Datetime& datetime, const DataBlock& block) {
+            for (unsigned pos = 0; pos < block.size(); ++pos)
+            {
+                if (!value_filter.match_levtr(block.id_levtr[pos])) continue;
+                if (!value_filter.match_value(block.codes[pos], block.values[pos])) continue;
+                Group& group = groups[std::make_tuple(id_station, block.id_levtr[pos], block.codes[pos])];
+                if (group.count == 0 || datetime < group.min) group.min = datetime;
+                if (group.count == 0 || group.max < datetime) group.max = datetime;
+                ++group.count;
+            }
+        });
+    });
+
+    dballe::DBStation station;
+    size_t count = 0;
+    for (const auto& i: groups)
+    {
+        if (limit_reached(qb.query, count)) break;
+        if (!load_station(tr, storage, std::get<0>(i.first), station)) continue;
+        if (trc_sel) trc_sel->add_row();
+
+        size_t size = 0;
+        DatetimeRange datetime;
+        if (qb.select_summary_details)
+        {
+            size = i.second.count;
+            datetime = DatetimeRange(i.second.min, i.second.max);
+        }
+
+        dest(station, std::get<1>(i.first), std::get<2>(i.first), datetime, size);
+        ++count;
+    }
+}
+
+void MemData::dump(FILE* out)
+{
+    DataDumper dumper(out);
+
+    dumper.print_head();
+    for (const auto& st: conn.storage.data)
+        for (const auto& dt: st.second)
+        {
+            const DataBlock& block = dt.second;
+            for (unsigned pos = 0; pos < block.size(); ++pos)
+                dumper.print_row(block.ids[pos], st.first, block.id_levtr[pos], dt.first, block.codes[pos], block.values[pos].c_str(), block.attrs[pos]);
+        }
+    dumper.print_tail();
+}
+
+}
+}
+}
+}
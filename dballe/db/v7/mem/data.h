@@ -0,0 +1,114 @@
+#ifndef DBALLE_DB_V7_MEM_DATA_H
+#define DBALLE_DB_V7_MEM_DATA_H
+
+#include <dballe/db/v7/data.h>
+#include <dballe/db/v7/mem/storage.h>
+#include <cstdint>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+// Partial implementation of the common parts of StationData and Data
+template<typename Parent>
+class MemDataCommon : public Parent
+{
+protected:
+    /// In-memory database connection
+    MemConnection& conn;
+
+    /// Return the encoded attributes of a value, or nullptr if not found
+    virtual const std::vector<uint8_t>* value_attrs(int id_data) const = 0;
+
+    /// Replace the value and attributes of a value
+    virtual void update_value(int id_data, const std::string& value, const std::vector<uint8_t>& attrs) = 0;
+
+    /// Replace the attributes of a value
+    virtual void set_attrs(int id_data, const std::vector<uint8_t>& attrs) = 0;
+
+    /// Remove a value
+    virtual void remove_value(int id_data) = 0;
+
+    /**
+     * Send to dest the IDs and encoded attributes of the values selected by
+     * qb, up to the query limit
+     */
+    virtual void query_ids(const v7::IdQueryBuilder& qb, std::function<void(int id_data, const std::vector<uint8_t>& attrs)> dest) = 0;
+
+public:
+    MemDataCommon(v7::Transaction& tr, MemConnection& conn);
+    MemDataCommon(const MemDataCommon&) = delete;
+    MemDataCommon(const MemDataCommon&&) = delete;
+    MemDataCommon& operator=(const MemDataCommon&) = delete;
+    ~MemDataCommon();
+
+    void update(Tracer<>& trc, std::vector<typename Parent::BatchValue>& vars, bool with_attrs) override;
+    void read_attrs(Tracer<>& trc, int id_data, std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void write_attrs(Tracer<>& trc, int id_data, const Values& values) override;
+    void remove_all_attrs(Tracer<>& trc, int id_data) override;
+    void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
+    void remove_by_id(Tracer<>& trc, int id) override;
+    void clear_cache() override {}
+};
+
+extern template class MemDataCommon<StationData>;
+extern template class MemDataCommon<Data>;
+
+/**
+ * Access the in-memory station data table
+ */
+class MemStationData : public MemDataCommon<StationData>
+{
+protected:
+    const std::vector<uint8_t>* value_attrs(int id_data) const override;
+    void update_value(int id_data, const std::string& value, const std::vector<uint8_t>& attrs) override;
+    void set_attrs(int id_data, const std::vector<uint8_t>& attrs) override;
+    void remove_value(int id_data) override;
+    void query_ids(const v7::IdQueryBuilder& qb, std::function<void(int id_data, const std::vector<uint8_t>& attrs)> dest) override;
+
+public:
+    using MemDataCommon::MemDataCommon;
+
+    void query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest) override;
+    void insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs) override;
+    void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<StationDataStream> stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
+    void dump(FILE* out) override;
+};
+
+/**
+ * Access the in-memory data table
+ */
+class MemData : public MemDataCommon<Data>
+{
+protected:
+    const std::vector<uint8_t>* value_attrs(int id_data) const override;
+    void update_value(int id_data, const std::string& value, const std::vector<uint8_t>& attrs) override;
+    void set_attrs(int id_data, const std::vector<uint8_t>& attrs) override;
+    void remove_value(int id_data) override;
+    void query_ids(const v7::IdQueryBuilder& qb, std::function<void(int id_data, const std::vector<uint8_t>& attrs)> dest) override;
+    // Summaries are computed from the stored values: there is no
+    // data_summary table to maintain
+    void summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added) override {}
+    void summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations) override {}
+
+public:
+    using MemDataCommon::MemDataCommon;
+
+    void summary_remove_by_id(Tracer<>& trc, int id_data) override {}
+
+    void query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest) override;
+    void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) override;
+    void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<DataStream> stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
+    void run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)>) override;
+    void dump(FILE* out) override;
+};
+
+}
+}
+}
+}
+#endif
@@ -0,0 +1,96 @@
+#include "driver.h"
+#include "storage.h"
+#include "repinfo.h"
+#include "station.h"
+#include "levtr.h"
+#include "data.h"
+#include "dballe/db/v7/transaction.h"
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+Driver::Driver(MemConnection& conn)
+    : v7::Driver(conn), conn(conn)
+{
+}
+
+Driver::~Driver()
+{
+}
+
+std::unique_ptr<v7::Repinfo> Driver::create_repinfo(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Repinfo>(new MemRepinfoV7(conn));
+}
+
+std::unique_ptr<v7::Station> Driver::create_station(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Station>(new MemStation(tr, conn));
+}
+
+std::unique_ptr<v7::LevTr> Driver::create_levtr(v7::Transaction& tr)
+{
+    return unique_ptr<v7::LevTr>(new MemLevTr(tr, conn));
+}
+
+std::unique_ptr<v7::StationData> Driver::create_station_data(v7::Transaction& tr)
+{
+    return unique_ptr<v7::StationData>(new MemStationData(tr, conn));
+}
+
+std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Data>(new MemData(tr, conn));
+}
+
+void Driver::create_tables_v7()
+{
+    conn.storage.create_tables();
+    conn.set_setting("version", "V7");
+}
+
+void Driver::delete_tables_v7()
+{
+    conn.storage.drop_tables();
+    station_spatial_index = -1;
+    typed_values = -1;
+    data_summary = -1;
+}
+
+void Driver::remove_all_v7()
+{
+    conn.storage.remove_all();
+}
+
+void Driver::vacuum_v7()
+{
+    conn.storage.vacuum();
+}
+
+void Driver::create_data_covering_index_v7()
+{
+    // Values are already stored by station and datetime, with level, time
+    // range, varcode and value next to each other: there is nothing to add
+}
+
+void Driver::create_typed_values_v7()
+{
+    // Filters are matched on decoded values, without going through SQL:
+    // there is nothing to add
+}
+
+void Driver::create_data_summary_v7()
+{
+    // Summary queries are computed from the values in memory, which are
+    // already stored by station: there is nothing to maintain
+}
+
+}
+}
+}
+}
@@ -0,0 +1,41 @@
+#ifndef DBALLE_DB_V7_MEM_DRIVER_H
+#define DBALLE_DB_V7_MEM_DRIVER_H
+
+#include <dballe/db/v7/driver.h>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+class MemConnection;
+
+/**
+ * Driver for databases kept in memory, which run queries natively instead of
+ * going through SQL
+ */
+struct Driver : public v7::Driver
+{
+    MemConnection& conn;
+
+    Driver(MemConnection& conn);
+    virtual ~Driver();
+
+    std::unique_ptr<v7::Repinfo> create_repinfo(v7::Transaction& tr) override;
+    std::unique_ptr<v7::Station> create_station(v7::Transaction& tr) override;
+    std::unique_ptr<v7::LevTr> create_levtr(v7::Transaction& tr) override;
+    std::unique_ptr<v7::StationData> create_station_data(v7::Transaction& tr) override;
+    std::unique_ptr<v7::Data> create_data(v7::Transaction& tr) override;
+    void create_tables_v7() override;
+    void delete_tables_v7() override;
+    void remove_all_v7() override;
+    void vacuum_v7() override;
+    void create_data_covering_index_v7() override;
+    void create_typed_values_v7() override;
+    void create_data_summary_v7() override;
+};
+
+}
+}
+}
+}
+#endif
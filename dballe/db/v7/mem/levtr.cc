@@ -0,0 +1,78 @@
+#include "levtr.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/trace.h"
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+MemLevTr::MemLevTr(v7::Transaction& tr, MemConnection& conn)
+    : v7::LevTr(tr), conn(conn)
+{
+}
+
+MemLevTr::~MemLevTr()
+{
+}
+
+void MemLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+{
+    if (ids.empty()) return;
+
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT id, ltype1, l1, ltype2, l2, pind, p1, p2 FROM levtr WHERE id IN (…)") : nullptr);
+    for (auto id: ids)
+    {
+        if (cache.find_entry(id)) continue;
+        const LevTrRow* row = conn.storage.levtr_row(id);
+        if (!row) continue;
+        if (trc_sel) trc_sel->add_row();
+        cache.insert(unique_ptr<LevTrEntry>(new LevTrEntry(id, row->level, row->trange)));
+    }
+}
+
+const LevTrEntry* MemLevTr::lookup_id(Tracer<>& trc, int id)
+{
+    // First look it up in the transaction cache
+    const LevTrEntry* res = cache.find_entry(id);
+    if (res) return res;
+
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT ltype1, l1, ltype2, l2, pind, p1, p2 FROM levtr WHERE id=?") : nullptr);
+    const LevTrRow* row = conn.storage.levtr_row(id);
+    if (!row)
+        error_notfound::throwf("levtr with id %d not found in the database", id);
+    if (trc_sel) trc_sel->add_row();
+    return cache.insert(unique_ptr<LevTrEntry>(new LevTrEntry(id, row->level, row->trange)));
+}
+
+int MemLevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+{
+    int id = cache.find_id(desc);
+    if (id != MISSING_INT) return id;
+
+    LevTrRow row(desc.level, desc.trange);
+    auto i = conn.storage.levtr_index.find(row);
+    if (i != conn.storage.levtr_index.end())
+        id = i->second;
+    else {
+        // Not found in the database, insert a new one
+        Tracer<> trc_ins(trc ? trc->trace_insert("INSERT INTO levtr (ltype1, l1, ltype2, l2, pind, p1, p2) VALUES (?, ?, ?, ?, ?, ?, ?)", 1) : nullptr);
+        id = conn.storage.levtr_insert(row);
+    }
+    cache.insert(desc, id);
+    return id;
+}
+
+void MemLevTr::_dump(std::function<void(int, const Level&, const Trange&)> out)
+{
+    for (const auto& i: conn.storage.levtr)
+        out(i.first, i.second.level, i.second.trange);
+}
+
+}
+}
+}
+}
@@ -0,0 +1,41 @@
+#ifndef DBALLE_DB_V7_MEM_LEVTR_H
+#define DBALLE_DB_V7_MEM_LEVTR_H
+
+#include <dballe/db/v7/levtr.h>
+#include <dballe/db/v7/mem/storage.h>
+#include <cstdio>
+#include <memory>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+/**
+ * Access the in-memory levtr table, which interns level and time range pairs
+ */
+struct MemLevTr : public v7::LevTr
+{
+protected:
+    /// In-memory database connection
+    MemConnection& conn;
+
+    void _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& id) override;
+
+public:
+    MemLevTr(v7::Transaction& tr, MemConnection& conn);
+    MemLevTr(const LevTr&) = delete;
+    MemLevTr(const LevTr&&) = delete;
+    MemLevTr& operator=(const MemLevTr&) = delete;
+    ~MemLevTr();
+
+    const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
+    int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
+};
+
+}
+}
+}
+}
+#endif
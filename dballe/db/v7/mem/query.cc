@@ -0,0 +1,164 @@
+#include "query.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/core/query.h"
+#include "dballe/core/varmatch.h"
+#include "dballe/var.h"
+#include <algorithm>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+StationFilter::StationFilter(v7::Transaction& tr, const Storage& storage, const core::Query& query, bool with_prio)
+    : storage(storage), query(query)
+{
+    if (!query.ana_filter.empty())
+        ana_filter = Varmatch::parse(query.ana_filter);
+
+    if (!query.report.empty())
+        report_id = tr.repinfo().get_id(query.report.c_str());
+
+    if (with_prio && (query.priomin != MISSING_INT || query.priomax != MISSING_INT))
+    {
+        filter_prio = true;
+        for (auto id: tr.repinfo().ids_by_prio(query))
+            prio_ids.insert(id);
+    }
+}
+
+StationFilter::~StationFilter()
+{
+}
+
+bool StationFilter::match_station_var(int id, wreport::Varcode code, std::function<bool(const std::string& value)> match) const
+{
+    auto st = storage.station_data.find(id);
+    if (st == storage.station_data.end()) return false;
+    auto v = st->second.find(code);
+    if (v == st->second.end()) return false;
+    return match(v->second.value);
+}
+
+bool StationFilter::operator()(int id, const StationRow& station) const
+{
+    if (query.ana_id != MISSING_INT && id != query.ana_id) return false;
+    if (!query.latrange.is_missing() && !query.latrange.contains(station.coords.lat)) return false;
+    if (!query.lonrange.is_missing() && !query.lonrange.contains(station.coords.lon)) return false;
+    if (query.mobile != MISSING_INT && (query.mobile == 0) != station.ident.is_missing()) return false;
+    if (!query.ident.is_missing() && station.ident != query.ident) return false;
+    if (report_id != MISSING_INT && station.rep != report_id) return false;
+    if (filter_prio && prio_ids.find(station.rep) == prio_ids.end()) return false;
+    if (query.block != MISSING_INT)
+    {
+        string block = to_string(query.block);
+        if (!match_station_var(id, WR_VAR(0, 1, 1), [&](const std::string& value) { return value == block; }))
+            return false;
+    }
+    if (query.station != MISSING_INT)
+    {
+        string station = to_string(query.station);
+        if (!match_station_var(id, WR_VAR(0, 1, 2), [&](const std::string& value) { return value == station; }))
+            return false;
+    }
+    if (ana_filter)
+    {
+        Varcode code = ana_filter->code;
+        if (!match_station_var(id, code, [&](const std::string& value) { return (*ana_filter)(*newvar(code, value.c_str())); }))
+            return false;
+    }
+    return true;
+}
+
+void StationFilter::for_each(std::function<void(int id, const StationRow& station)> dest) const
+{
+    if (report_id == -1) return;
+
+    if (query.ana_id != MISSING_INT)
+    {
+        const StationRow* station = storage.station(query.ana_id);
+        if (station && (*this)(query.ana_id, *station))
+            dest(query.ana_id, *station);
+        return;
+    }
+
+    if (!query.latrange.is_missing())
+    {
+        std::vector<int> ids;
+        auto begin = storage.station_lat_index.lower_bound(query.latrange.imin);
+        auto end = storage.station_lat_index.upper_bound(query.latrange.imax);
+        for (auto i = begin; i != end; ++i)
+            ids.push_back(i->second);
+        std::sort(ids.begin(), ids.end());
+        for (auto id: ids)
+        {
+            const StationRow& station = *storage.station(id);
+            if ((*this)(id, station))
+                dest(id, station);
+        }
+        return;
+    }
+
+    for (const auto& i: storage.stations)
+        if ((*this)(i.first, i.second))
+            dest(i.first, i.second);
+}
+
+
+ValueFilter::ValueFilter(const Storage& storage, const core::Query& query, bool station_vars)
+    : query(query)
+{
+    if (!query.data_filter.empty())
+        data_filter = Varmatch::parse(query.data_filter);
+
+    if (station_vars) return;
+
+    const Level& l = query.level;
+    const Trange& t = query.trange;
+    filter_levtr = l.ltype1 != MISSING_INT || l.l1 != MISSING_INT || l.ltype2 != MISSING_INT || l.l2 != MISSING_INT
+                || t.pind != MISSING_INT || t.p1 != MISSING_INT || t.p2 != MISSING_INT;
+    if (!filter_levtr) return;
+
+    for (const auto& i: storage.levtr)
+    {
+        const Level& il = i.second.level;
+        const Trange& it = i.second.trange;
+        if (l.ltype1 != MISSING_INT && il.ltype1 != l.ltype1) continue;
+        if (l.l1 != MISSING_INT && il.l1 != l.l1) continue;
+        if (l.ltype2 != MISSING_INT && il.ltype2 != l.ltype2) continue;
+        if (l.l2 != MISSING_INT && il.l2 != l.l2) continue;
+        if (t.pind != MISSING_INT && it.pind != t.pind) continue;
+        if (t.p1 != MISSING_INT && it.p1 != t.p1) continue;
+        if (t.p2 != MISSING_INT && it.p2 != t.p2) continue;
+        levtr_ids.insert(i.first);
+    }
+}
+
+ValueFilter::~ValueFilter()
+{
+}
+
+bool ValueFilter::match_levtr(int id_levtr) const
+{
+    return !filter_levtr || levtr_ids.find(id_levtr) != levtr_ids.end();
+}
+
+bool ValueFilter::match_value(wreport::Varcode code, const std::string& value) const
+{
+    if (!query.varcodes.empty() && query.varcodes.find(code) == query.varcodes.end()) return false;
+    if (data_filter)
+    {
+        if (code != data_filter->code) return false;
+        if (!(*data_filter)(*newvar(code, value.c_str()))) return false;
+    }
+    return true;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,91 @@
+#ifndef DBALLE_DB_V7_MEM_QUERY_H
+#define DBALLE_DB_V7_MEM_QUERY_H
+
+#include <dballe/core/fwd.h>
+#include <dballe/db/v7/fwd.h>
+#include <dballe/db/v7/mem/storage.h>
+#include <wreport/varinfo.h>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace dballe {
+struct Varmatch;
+
+namespace db {
+namespace v7 {
+namespace mem {
+
+/**
+ * Match stations against the station constraints of a query.
+ *
+ * This implements the same selection as the WHERE clauses built by
+ * QueryBuilder::add_pa_where, and optionally by
+ * QueryBuilder::add_repinfo_where.
+ */
+class StationFilter
+{
+protected:
+    const Storage& storage;
+    const core::Query& query;
+    std::unique_ptr<Varmatch> ana_filter;
+    /// ID of the requested report, MISSING_INT for any, -1 for none
+    int report_id = MISSING_INT;
+    /// True if stations are filtered by report priority
+    bool filter_prio = false;
+    /// IDs of the reports with the requested priority
+    std::set<int> prio_ids;
+
+    bool match_station_var(int id, wreport::Varcode code, std::function<bool(const std::string& value)> match) const;
+
+public:
+    /**
+     * @param with_prio
+     *   true if the priomin and priomax constraints are to be used, as in
+     *   data queries
+     */
+    StationFilter(v7::Transaction& tr, const Storage& storage, const core::Query& query, bool with_prio);
+    ~StationFilter();
+
+    bool operator()(int id, const StationRow& station) const;
+
+    /**
+     * Send all the matching stations to dest, in ID order.
+     *
+     * Latitude ranges are looked up in the station latitude index.
+     */
+    void for_each(std::function<void(int id, const StationRow& station)> dest) const;
+};
+
+/**
+ * Match values against the value constraints of a query.
+ *
+ * This implements the same selection as the WHERE clauses built by
+ * QueryBuilder::add_ltr_where, add_varcode_where and add_datafilter_where.
+ */
+class ValueFilter
+{
+protected:
+    const core::Query& query;
+    std::unique_ptr<Varmatch> data_filter;
+    /// True if values are filtered by level and time range
+    bool filter_levtr = false;
+    /// IDs of the levtr with the requested level and time range
+    std::unordered_set<int> levtr_ids;
+
+public:
+    ValueFilter(const Storage& storage, const core::Query& query, bool station_vars);
+    ~ValueFilter();
+
+    bool match_levtr(int id_levtr) const;
+    bool match_value(wreport::Varcode code, const std::string& value) const;
+};
+
+}
+}
+}
+}
+#endif
@@ -0,0 +1,117 @@
+#include "repinfo.h"
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+MemRepinfoV7::MemRepinfoV7(MemConnection& conn)
+    : Repinfo(conn), conn(conn)
+{
+}
+
+MemRepinfoV7::~MemRepinfoV7()
+{
+}
+
+void MemRepinfoV7::read_cache()
+{
+    cache.clear();
+    memo_idx.clear();
+
+    for (const auto& i: conn.storage.repinfo)
+        cache_append(
+            i.first,
+            i.second.memo.c_str(),
+            i.second.desc.c_str(),
+            i.second.prio,
+            i.second.descriptor.c_str(),
+            i.second.tablea);
+
+    // Rebuild the memo index as well
+    rebuild_memo_idx();
+}
+
+void MemRepinfoV7::insert_auto_entry(const char* memo)
+{
+    const auto& repinfo = conn.storage.repinfo;
+    unsigned id = 0;
+    int prio = 0;
+    if (!repinfo.empty())
+        id = repinfo.rbegin()->first;
+    for (auto i = repinfo.begin(); i != repinfo.end(); ++i)
+        if (i == repinfo.begin() || i->second.prio > prio)
+            prio = i->second.prio;
+
+    RepinfoRow row;
+    row.memo = memo;
+    row.desc = memo;
+    row.prio = prio + 1;
+    row.descriptor = "-";
+    row.tablea = 255;
+    conn.storage.repinfo_insert(id + 1, row);
+}
+
+int MemRepinfoV7::id_use_count(unsigned id, const char* name)
+{
+    unsigned count = 0;
+    for (const auto& i: conn.storage.stations)
+        if (i.second.rep == (int)id)
+            ++count;
+    return count;
+}
+
+void MemRepinfoV7::delete_entry(unsigned id)
+{
+    conn.storage.repinfo_delete(id);
+}
+
+void MemRepinfoV7::update_entry(const v7::repinfo::Cache& entry)
+{
+    RepinfoRow row;
+    row.memo = entry.new_memo;
+    row.desc = entry.new_desc;
+    row.prio = entry.new_prio;
+    row.descriptor = entry.new_descriptor;
+    row.tablea = entry.new_tablea;
+    conn.storage.repinfo_update(entry.id, row);
+}
+
+void MemRepinfoV7::insert_entry(const v7::repinfo::Cache& entry)
+{
+    RepinfoRow row;
+    row.memo = entry.new_memo;
+    row.desc = entry.new_desc;
+    row.prio = entry.new_prio;
+    row.descriptor = entry.new_descriptor;
+    row.tablea = entry.new_tablea;
+    conn.storage.repinfo_insert(entry.id, row);
+}
+
+void MemRepinfoV7::dump(FILE* out)
+{
+    fprintf(out, "dump of table repinfo:\n");
+    fprintf(out, "   id   memo   description  prio   desc  tablea\n");
+
+    int count = 0;
+    for (const auto& i: conn.storage.repinfo)
+    {
+        fprintf(out, " %4d   %s  %s  %d  %s %d\n",
+                (int)i.first,
+                i.second.memo.c_str(),
+                i.second.desc.c_str(),
+                i.second.prio,
+                i.second.descriptor.c_str(),
+                i.second.tablea);
+        ++count;
+    }
+    fprintf(out, "%d element%s in table repinfo\n", count, count != 1 ? "s" : "");
+}
+
+}
+}
+}
+}
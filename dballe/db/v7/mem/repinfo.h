@@ -0,0 +1,42 @@
+#ifndef DBALLE_DB_V7_MEM_REPINFO_H
+#define DBALLE_DB_V7_MEM_REPINFO_H
+
+#include <dballe/db/v7/repinfo.h>
+#include <dballe/db/v7/mem/storage.h>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+/**
+ * Fast cached access to the in-memory repinfo table
+ */
+struct MemRepinfoV7 : public v7::Repinfo
+{
+    /// In-memory database connection
+    MemConnection& conn;
+
+    MemRepinfoV7(MemConnection& conn);
+    MemRepinfoV7(const MemRepinfoV7&) = delete;
+    MemRepinfoV7(const MemRepinfoV7&&) = delete;
+    virtual ~MemRepinfoV7();
+    MemRepinfoV7& operator=(const MemRepinfoV7&) = delete;
+
+    void dump(FILE* out) override;
+
+protected:
+    /// Return how many time this ID is used in the database
+    int id_use_count(unsigned id, const char* name) override;
+    void delete_entry(unsigned id) override;
+    void update_entry(const v7::repinfo::Cache& entry) override;
+    void insert_entry(const v7::repinfo::Cache& entry) override;
+    void read_cache() override;
+    void insert_auto_entry(const char* memo) override;
+};
+
+}
+}
+}
+}
+#endif
@@ -0,0 +1,179 @@
+#include "station.h"
+#include "query.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/db/v7/trace.h"
+#include "dballe/db/v7/qbuilder.h"
+#include "dballe/core/var.h"
+#include "dballe/values.h"
+#include <wreport/var.h>
+#include <sstream>
+
+using namespace wreport;
+using namespace dballe::db;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+MemStation::MemStation(v7::Transaction& tr, MemConnection& conn)
+    : v7::Station(tr), conn(conn)
+{
+}
+
+MemStation::~MemStation()
+{
+}
+
+DBStation MemStation::lookup(Tracer<>& trc, int id_station)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT rep, lat, lon, ident FROM station WHERE id=?") : nullptr);
+    const StationRow* row = conn.storage.station(id_station);
+    if (!row)
+    {
+        stringstream msg;
+        msg << "Station with id " << id_station << " not found";
+        throw std::runtime_error(msg.str());
+    }
+    if (trc_sel) trc_sel->add_row();
+
+    DBStation station;
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(row->rep);
+    station.coords = row->coords;
+    station.ident = row->ident;
+    return station;
+}
+
+int MemStation::maybe_get_id(Tracer<>& trc, const dballe::DBStation& st)
+{
+    int rep = tr.repinfo().obtain_id(st.report.c_str());
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT id FROM station WHERE rep=? AND lat=? AND lon=? AND ident=?") : nullptr);
+    auto i = conn.storage.station_index.find(StationRow(rep, st.coords, st.ident));
+    if (i == conn.storage.station_index.end())
+        return MISSING_INT;
+    if (trc_sel) trc_sel->add_row();
+    return i->second;
+}
+
+int MemStation::insert_new(Tracer<>& trc, const dballe::DBStation& desc)
+{
+    int rep = tr.repinfo().get_id(desc.report.c_str());
+    int id = conn.storage.station_insert(StationRow(rep, desc.coords, desc.ident));
+    if (trc) trc->trace_insert("INSERT INTO station (rep, lat, lon, ident) VALUES (?, ?, ?, ?)", 1);
+    cache.insert(desc, id);
+    return id;
+}
+
+void MemStation::get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT code, value, attrs FROM station_data WHERE id_station=? ORDER BY code") : nullptr);
+    auto st = conn.storage.station_data.find(id_station);
+    if (st == conn.storage.station_data.end())
+        return;
+
+    for (const auto& i: st->second)
+    {
+        if (trc_sel) trc_sel->add_row();
+        unique_ptr<Var> var = newvar(i.first, i.second.value.c_str());
+        DBValues::decode(i.second.attrs, [&](unique_ptr<wreport::Var> a) { var->seta(move(a)); });
+        dest(move(var));
+    }
+}
+
+void MemStation::add_station_vars(Tracer<>& trc, int id_station, DBValues& values)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT code, value FROM station_data WHERE id_station=?") : nullptr);
+    auto st = conn.storage.station_data.find(id_station);
+    if (st == conn.storage.station_data.end())
+        return;
+
+    for (const auto& i: st->second)
+    {
+        if (trc_sel) trc_sel->add_row();
+        values.set(newvar(i.first, i.second.value.c_str()));
+    }
+}
+
+namespace {
+
+/// Check if the station has measured values for any of the given varcodes
+bool has_varcodes(const Storage& storage, int id_station, const std::set<wreport::Varcode>& varcodes)
+{
+    auto st = storage.data.find(id_station);
+    if (st == storage.data.end())
+        return false;
+    for (const auto& block: st->second)
+        for (auto code: block.second.codes)
+            if (varcodes.find(code) != varcodes.end())
+                return true;
+    return false;
+}
+
+/// Send to dest the stations matched by a station query, ignoring its limit
+void for_each_station(v7::Transaction& tr, const Storage& storage, const v7::StationQueryBuilder& qb, std::function<void(int id, const StationRow& station)> dest)
+{
+    StationFilter filter(tr, storage, qb.query, false);
+    filter.for_each([&](int id, const StationRow& station) {
+        if (!qb.query.varcodes.empty() && !has_varcodes(storage, id, qb.query.varcodes))
+            return;
+        dest(id, station);
+    });
+}
+
+}
+
+void MemStation::run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_station_vars_query) : nullptr);
+    const Storage& storage = conn.storage;
+    for_each_station(tr, storage, qb, [&](int id, const StationRow& station) {
+        auto st = storage.station_data.find(id);
+        if (st == storage.station_data.end())
+            return;
+        for (const auto& i: st->second)
+        {
+            if (trc_sel) trc_sel->add_row();
+            dest(id, newvar(i.first, i.second.value.c_str()));
+        }
+    });
+}
+
+void MemStation::run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+
+    // Collect the results first, so that dest can safely change the database
+    std::vector<int> ids;
+    for_each_station(tr, conn.storage, qb, [&](int id, const StationRow& station) {
+        if (qb.query.limit != MISSING_INT && ids.size() >= (unsigned)qb.query.limit)
+            return;
+        ids.push_back(id);
+    });
+
+    dballe::DBStation station;
+    for (auto id: ids)
+    {
+        if (trc_sel) trc_sel->add_row();
+        const StationRow* row = conn.storage.station(id);
+        if (!row) continue;
+        station.id = id;
+        station.report = tr.repinfo().get_rep_memo(row->rep);
+        station.coords = row->coords;
+        station.ident = row->ident;
+        dest(station);
+    }
+}
+
+void MemStation::_dump(std::function<void(int, int, const Coords& coords, const char* ident)> out)
+{
+    for (const auto& i: conn.storage.stations)
+        out(i.first, i.second.rep, i.second.coords, i.second.ident.get());
+}
+
+}
+}
+}
+}
@@ -0,0 +1,49 @@
+#ifndef DBALLE_DB_V7_MEM_STATION_H
+#define DBALLE_DB_V7_MEM_STATION_H
+
+#include <dballe/db/v7/station.h>
+#include <dballe/db/v7/mem/storage.h>
+#include <functional>
+#include <memory>
+
+namespace wreport {
+struct Var;
+}
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+/**
+ * Access the in-memory station table
+ */
+class MemStation : public v7::Station
+{
+protected:
+    /// In-memory database connection
+    MemConnection& conn;
+
+    void _dump(std::function<void(int, int, const Coords& coords, const char* ident)> out) override;
+
+public:
+    MemStation(v7::Transaction& tr, MemConnection& conn);
+    ~MemStation();
+    MemStation(const MemStation&) = delete;
+    MemStation(const MemStation&&) = delete;
+    MemStation& operator=(const MemStation&) = delete;
+
+    DBStation lookup(Tracer<>& trc, int id_station) override;
+    int maybe_get_id(Tracer<>& trc, const dballe::DBStation& st) override;
+    int insert_new(Tracer<>& trc, const dballe::DBStation& desc) override;
+    void get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void add_station_vars(Tracer<>& trc, int id_station, DBValues& values) override;
+    void run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest) override;
+    void run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)>) override;
+};
+
+}
+}
+}
+}
+#endif
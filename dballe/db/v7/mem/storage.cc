@@ -0,0 +1,546 @@
+#include "storage.h"
+#include <wreport/error.h>
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+bool StationRow::operator<(const StationRow& o) const
+{
+    if (rep != o.rep) return rep < o.rep;
+    if (int res = coords.compare(o.coords)) return res < 0;
+    return ident.compare(o.ident) < 0;
+}
+
+bool LevTrRow::operator<(const LevTrRow& o) const
+{
+    if (int res = level.compare(o.level)) return res < 0;
+    return trange.compare(o.trange) < 0;
+}
+
+
+int DataBlock::find(int id) const
+{
+    for (unsigned i = 0; i < ids.size(); ++i)
+        if (ids[i] == id)
+            return i;
+    return -1;
+}
+
+void DataBlock::append(int id, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    ids.push_back(id);
+    this->id_levtr.push_back(id_levtr);
+    codes.push_back(code);
+    values.push_back(value);
+    this->attrs.push_back(attrs);
+}
+
+void DataBlock::erase(unsigned pos)
+{
+    ids.erase(ids.begin() + pos);
+    id_levtr.erase(id_levtr.begin() + pos);
+    codes.erase(codes.begin() + pos);
+    values.erase(values.begin() + pos);
+    attrs.erase(attrs.begin() + pos);
+}
+
+
+void Storage::log(std::function<void()> undo)
+{
+    if (in_transaction)
+        journal.emplace_back(move(undo));
+}
+
+std::shared_ptr<const Tables> Storage::take_tables()
+{
+    // Moving the tables is cheap, and does not need copying their contents
+    auto saved = make_shared<Tables>(std::move(static_cast<Tables&>(*this)));
+    static_cast<Tables&>(*this) = Tables();
+    log([this, saved] { static_cast<Tables&>(*this) = std::move(*saved); });
+    return saved;
+}
+
+void Storage::begin()
+{
+    if (in_transaction)
+        throw error_consistency("cannot start a transaction within a transaction");
+    in_transaction = true;
+}
+
+void Storage::commit()
+{
+    journal.clear();
+    in_transaction = false;
+}
+
+void Storage::rollback()
+{
+    // Undo actions reuse the methods that change the tables, which must not
+    // log them again
+    in_transaction = false;
+    std::vector<std::function<void()>> undo;
+    undo.swap(journal);
+    for (auto i = undo.rbegin(); i != undo.rend(); ++i)
+        (*i)();
+}
+
+void Storage::set_setting(const std::string& key, const std::string& value)
+{
+    auto i = settings.find(key);
+    if (i == settings.end())
+    {
+        log([this, key] { settings.erase(key); });
+        settings.insert(make_pair(key, value));
+    } else {
+        string old = i->second;
+        log([this, key, old] { settings[key] = old; });
+        i->second = value;
+    }
+}
+
+void Storage::drop_settings()
+{
+    auto saved = make_shared<std::map<std::string, std::string>>();
+    saved->swap(settings);
+    log([this, saved] { settings.swap(*saved); });
+}
+
+void Storage::create_tables()
+{
+    if (created) return;
+    created = true;
+    log([this] { created = false; });
+}
+
+void Storage::drop_tables()
+{
+    take_tables();
+}
+
+void Storage::remove_all()
+{
+    auto saved = take_tables();
+    created = saved->created;
+    settings = saved->settings;
+    repinfo = saved->repinfo;
+}
+
+void Storage::vacuum()
+{
+    // Collect the levtr and stations that still have measured values
+    std::set<int> used_levtr;
+    for (const auto& st: data)
+        for (const auto& block: st.second)
+            used_levtr.insert(block.second.id_levtr.begin(), block.second.id_levtr.end());
+
+    for (auto i = levtr.begin(); i != levtr.end(); )
+    {
+        if (used_levtr.find(i->first) != used_levtr.end())
+        {
+            ++i;
+            continue;
+        }
+        int id = i->first;
+        LevTrRow row = i->second;
+        levtr_index.erase(row);
+        i = levtr.erase(i);
+        log([this, id, row] {
+            levtr.insert(make_pair(id, row));
+            levtr_index.insert(make_pair(row, id));
+        });
+    }
+
+    for (auto i = station_data.begin(); i != station_data.end(); )
+    {
+        if (data.find(i->first) != data.end())
+        {
+            ++i;
+            continue;
+        }
+        int id_station = i->first;
+        auto vars = make_shared<std::map<wreport::Varcode, StationValue>>();
+        vars->swap(i->second);
+        for (const auto& v: *vars)
+            station_data_by_id.erase(v.second.id);
+        i = station_data.erase(i);
+        log([this, id_station, vars] {
+            for (const auto& v: *vars)
+                station_data_by_id[v.second.id] = make_pair(id_station, v.first);
+            station_data[id_station].swap(*vars);
+        });
+    }
+
+    for (auto i = stations.begin(); i != stations.end(); )
+    {
+        if (data.find(i->first) != data.end())
+        {
+            ++i;
+            continue;
+        }
+        int id = i->first;
+        StationRow row = i->second;
+        station_index.erase(row);
+        auto range = station_lat_index.equal_range(row.coords.lat);
+        for (auto l = range.first; l != range.second; ++l)
+            if (l->second == id)
+            {
+                station_lat_index.erase(l);
+                break;
+            }
+        i = stations.erase(i);
+        log([this, id, row] {
+            stations.insert(make_pair(id, row));
+            station_index.insert(make_pair(row, id));
+            station_lat_index.insert(make_pair(row.coords.lat, id));
+        });
+    }
+}
+
+void Storage::repinfo_insert(unsigned id, const RepinfoRow& row)
+{
+    if (repinfo.find(id) != repinfo.end())
+        error_consistency::throwf("repinfo entry %u already exists", id);
+    for (const auto& i: repinfo)
+    {
+        if (i.second.memo == row.memo)
+            error_consistency::throwf("repinfo entry %s already exists", row.memo.c_str());
+        if (i.second.prio == row.prio)
+            error_consistency::throwf("repinfo priority %d is already used by %s", row.prio, i.second.memo.c_str());
+    }
+    repinfo.insert(make_pair(id, row));
+    log([this, id] { repinfo.erase(id); });
+}
+
+void Storage::repinfo_update(unsigned id, const RepinfoRow& row)
+{
+    auto i = repinfo.find(id);
+    if (i == repinfo.end())
+        error_notfound::throwf("repinfo entry %u not found", id);
+    RepinfoRow old = i->second;
+    i->second = row;
+    log([this, id, old] { repinfo.find(id)->second = old; });
+}
+
+void Storage::repinfo_delete(unsigned id)
+{
+    auto i = repinfo.find(id);
+    if (i == repinfo.end()) return;
+    RepinfoRow old = i->second;
+    repinfo.erase(i);
+    log([this, id, old] { repinfo.insert(make_pair(id, old)); });
+}
+
+const StationRow* Storage::station(int id) const
+{
+    auto i = stations.find(id);
+    if (i == stations.end()) return nullptr;
+    return &i->second;
+}
+
+int Storage::station_insert(const StationRow& row)
+{
+    if (station_index.find(row) != station_index.end())
+        throw error_consistency("station already exists");
+    int id = stations.empty() ? 1 : stations.rbegin()->first + 1;
+    stations.insert(make_pair(id, row));
+    station_index.insert(make_pair(row, id));
+    station_lat_index.insert(make_pair(row.coords.lat, id));
+    log([this, id, row] {
+        auto range = station_lat_index.equal_range(row.coords.lat);
+        for (auto i = range.first; i != range.second; ++i)
+            if (i->second == id)
+            {
+                station_lat_index.erase(i);
+                break;
+            }
+        station_index.erase(row);
+        stations.erase(id);
+    });
+    return id;
+}
+
+const LevTrRow* Storage::levtr_row(int id) const
+{
+    auto i = levtr.find(id);
+    if (i == levtr.end()) return nullptr;
+    return &i->second;
+}
+
+int Storage::levtr_insert(const LevTrRow& row)
+{
+    if (levtr_index.find(row) != levtr_index.end())
+        throw error_consistency("levtr already exists");
+    int id = levtr.empty() ? 1 : levtr.rbegin()->first + 1;
+    levtr.insert(make_pair(id, row));
+    levtr_index.insert(make_pair(row, id));
+    log([this, id, row] {
+        levtr_index.erase(row);
+        levtr.erase(id);
+    });
+    return id;
+}
+
+void Storage::station_data_put(int id_station, wreport::Varcode code, const StationValue& val)
+{
+    station_data[id_station][code] = val;
+    station_data_by_id[val.id] = make_pair(id_station, code);
+}
+
+const StationValue* Storage::station_value(int id) const
+{
+    auto i = station_data_by_id.find(id);
+    if (i == station_data_by_id.end()) return nullptr;
+    return &station_data.find(i->second.first)->second.find(i->second.second)->second;
+}
+
+int Storage::station_data_insert(int id_station, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    if (stations.find(id_station) == stations.end())
+        error_notfound::throwf("station %d not found", id_station);
+    auto& vars = station_data[id_station];
+    if (vars.find(code) != vars.end())
+        error_consistency::throwf("station variable %01d%02d%03d already exists in station %d", WR_VAR_FXY(code), id_station);
+    StationValue val;
+    val.id = ++last_station_data_id;
+    val.value = value;
+    val.attrs = attrs;
+    station_data_put(id_station, code, val);
+    int id = val.id;
+    log([this, id] { station_data_remove(id); });
+    return id;
+}
+
+void Storage::station_data_update(int id, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    StationValue* val = const_cast<StationValue*>(station_value(id));
+    if (!val)
+        error_notfound::throwf("station variable %d not found", id);
+    string old_value = val->value;
+    vector<uint8_t> old_attrs = val->attrs;
+    val->value = value;
+    val->attrs = attrs;
+    log([this, id, old_value, old_attrs] { station_data_update(id, old_value, old_attrs); });
+}
+
+void Storage::station_data_set_attrs(int id, const std::vector<uint8_t>& attrs)
+{
+    StationValue* val = const_cast<StationValue*>(station_value(id));
+    if (!val)
+        error_notfound::throwf("station variable %d not found", id);
+    vector<uint8_t> old_attrs = val->attrs;
+    val->attrs = attrs;
+    log([this, id, old_attrs] { station_data_set_attrs(id, old_attrs); });
+}
+
+void Storage::station_data_remove(int id)
+{
+    auto i = station_data_by_id.find(id);
+    if (i == station_data_by_id.end()) return;
+    int id_station = i->second.first;
+    Varcode code = i->second.second;
+    station_data_by_id.erase(i);
+
+    auto st = station_data.find(id_station);
+    auto v = st->second.find(code);
+    StationValue old = v->second;
+    st->second.erase(v);
+    if (st->second.empty())
+        station_data.erase(st);
+
+    log([this, id_station, code, old] { station_data_put(id_station, code, old); });
+}
+
+void Storage::data_put(int id_station, const Datetime& datetime, int id, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    data[id_station][datetime].append(id, id_levtr, code, value, attrs);
+    data_by_id[id] = make_pair(id_station, datetime);
+}
+
+const DataBlock* Storage::data_value(int id, unsigned& pos) const
+{
+    auto i = data_by_id.find(id);
+    if (i == data_by_id.end()) return nullptr;
+    const DataBlock& block = data.find(i->second.first)->second.find(i->second.second)->second;
+    pos = block.find(id);
+    return &block;
+}
+
+int Storage::data_insert(int id_station, const Datetime& datetime, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    if (stations.find(id_station) == stations.end())
+        error_notfound::throwf("station %d not found", id_station);
+    if (levtr.find(id_levtr) == levtr.end())
+        error_notfound::throwf("levtr %d not found", id_levtr);
+
+    auto st = data.find(id_station);
+    if (st != data.end())
+    {
+        auto block = st->second.find(datetime);
+        if (block != st->second.end())
+            for (unsigned i = 0; i < block->second.size(); ++i)
+                if (block->second.id_levtr[i] == id_levtr && block->second.codes[i] == code)
+                    error_consistency::throwf("value %01d%02d%03d already exists", WR_VAR_FXY(code));
+    }
+
+    int id = ++last_data_id;
+    data_put(id_station, datetime, id, id_levtr, code, value, attrs);
+    log([this, id] { data_remove(id); });
+    return id;
+}
+
+void Storage::data_update(int id, const std::string& value, const std::vector<uint8_t>& attrs)
+{
+    unsigned pos;
+    DataBlock* block = const_cast<DataBlock*>(data_value(id, pos));
+    if (!block)
+        error_notfound::throwf("value %d not found", id);
+    string old_value = block->values[pos];
+    vector<uint8_t> old_attrs = block->attrs[pos];
+    block->values[pos] = value;
+    block->attrs[pos] = attrs;
+    log([this, id, old_value, old_attrs] { data_update(id, old_value, old_attrs); });
+}
+
+void Storage::data_set_attrs(int id, const std::vector<uint8_t>& attrs)
+{
+    unsigned pos;
+    DataBlock* block = const_cast<DataBlock*>(data_value(id, pos));
+    if (!block)
+        error_notfound::throwf("value %d not found", id);
+    vector<uint8_t> old_attrs = block->attrs[pos];
+    block->attrs[pos] = attrs;
+    log([this, id, old_attrs] { data_set_attrs(id, old_attrs); });
+}
+
+void Storage::data_remove(int id)
+{
+    auto i = data_by_id.find(id);
+    if (i == data_by_id.end()) return;
+    int id_station = i->second.first;
+    Datetime datetime = i->second.second;
+    data_by_id.erase(i);
+
+    auto st = data.find(id_station);
+    auto b = st->second.find(datetime);
+    DataBlock& block = b->second;
+    unsigned pos = block.find(id);
+    int id_levtr = block.id_levtr[pos];
+    Varcode code = block.codes[pos];
+    string value = move(block.values[pos]);
+    vector<uint8_t> attrs = move(block.attrs[pos]);
+    block.erase(pos);
+    if (block.empty())
+    {
+        st->second.erase(b);
+        if (st->second.empty())
+            data.erase(st);
+    }
+
+    log([this, id_station, datetime, id, id_levtr, code, value, attrs] {
+        data_put(id_station, datetime, id, id_levtr, code, value, attrs);
+    });
+}
+
+
+namespace {
+
+struct MemTransaction : public dballe::sql::Transaction
+{
+    Storage& storage;
+    bool fired = false;
+
+    MemTransaction(Storage& storage) : storage(storage)
+    {
+        storage.begin();
+    }
+    ~MemTransaction() { if (!fired) rollback_nothrow(); }
+
+    void commit() override
+    {
+        storage.commit();
+        fired = true;
+    }
+    void rollback() override
+    {
+        storage.rollback();
+        fired = true;
+    }
+    void rollback_nothrow() noexcept override
+    {
+        try {
+            storage.rollback();
+        } catch (...) {
+        }
+        fired = true;
+    }
+    void lock_table(const char* name) override
+    {
+        // Nothing to do: there is only one transaction at a time
+    }
+};
+
+}
+
+MemConnection::MemConnection()
+{
+    url = "mem:";
+    server_type = dballe::sql::ServerType::MEMORY;
+}
+
+std::shared_ptr<MemConnection> MemConnection::create()
+{
+    return shared_ptr<MemConnection>(new MemConnection);
+}
+
+std::unique_ptr<dballe::sql::Transaction> MemConnection::transaction(bool readonly)
+{
+    return unique_ptr<dballe::sql::Transaction>(new MemTransaction(storage));
+}
+
+bool MemConnection::has_table(const std::string& name)
+{
+    if (!storage.created) return false;
+    return name == "repinfo" || name == "station" || name == "levtr"
+        || name == "station_data" || name == "data";
+}
+
+std::string MemConnection::get_setting(const std::string& key)
+{
+    auto i = storage.settings.find(key);
+    if (i == storage.settings.end())
+        return std::string();
+    return i->second;
+}
+
+void MemConnection::set_setting(const std::string& key, const std::string& value)
+{
+    storage.set_setting(key, value);
+}
+
+void MemConnection::drop_settings()
+{
+    storage.drop_settings();
+}
+
+void MemConnection::execute(const std::string& query)
+{
+    error_unimplemented::throwf("cannot run SQL on a mem: database: %s", query.c_str());
+}
+
+void MemConnection::explain(const std::string& query, FILE* out)
+{
+    fprintf(out, "mem: databases run queries natively, without SQL. Equivalent SQL query: %s\n", query.c_str());
+}
+
+}
+}
+}
+}
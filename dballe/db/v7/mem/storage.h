@@ -0,0 +1,240 @@
+#ifndef DBALLE_DB_V7_MEM_STORAGE_H
+#define DBALLE_DB_V7_MEM_STORAGE_H
+
+#include <dballe/sql/sql.h>
+#include <dballe/types.h>
+#include <wreport/varinfo.h>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace mem {
+
+/// Row of the in-memory repinfo table
+struct RepinfoRow
+{
+    std::string memo;
+    std::string desc;
+    int prio;
+    std::string descriptor;
+    int tablea;
+};
+
+/**
+ * Row of the in-memory station table.
+ *
+ * It is also used as key in the index of stations by (rep, coords, ident).
+ */
+struct StationRow
+{
+    int rep;
+    Coords coords;
+    Ident ident;
+
+    StationRow(int rep, const Coords& coords, const Ident& ident)
+        : rep(rep), coords(coords), ident(ident) {}
+
+    bool operator<(const StationRow& o) const;
+};
+
+/// Row of the in-memory levtr table
+struct LevTrRow
+{
+    Level level;
+    Trange trange;
+
+    LevTrRow(const Level& level, const Trange& trange)
+        : level(level), trange(trange) {}
+
+    bool operator<(const LevTrRow& o) const;
+};
+
+/// Station variable
+struct StationValue
+{
+    int id;
+    std::string value;
+    std::vector<uint8_t> attrs;
+};
+
+/**
+ * Measured values of a station at a given datetime, stored by column.
+ *
+ * Values are kept in insertion order, and sorted when they are queried.
+ */
+struct DataBlock
+{
+    std::vector<int> ids;
+    std::vector<int> id_levtr;
+    std::vector<wreport::Varcode> codes;
+    std::vector<std::string> values;
+    std::vector<std::vector<uint8_t>> attrs;
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+
+    /// Return the position of the value with the given ID, or -1 if not found
+    int find(int id) const;
+
+    void append(int id, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs);
+
+    void erase(unsigned pos);
+};
+
+/// Contents of an in-memory database
+struct Tables
+{
+    /// True if the tables have been created
+    bool created = false;
+
+    std::map<std::string, std::string> settings;
+
+    std::map<unsigned, RepinfoRow> repinfo;
+
+    std::map<int, StationRow> stations;
+    /// Index of station IDs by (rep, coords, ident)
+    std::map<StationRow, int> station_index;
+    /// Index of station IDs by latitude, used by lat/lon range queries
+    std::multimap<int, int> station_lat_index;
+
+    std::map<int, LevTrRow> levtr;
+    /// Index of levtr IDs by level and time range
+    std::map<LevTrRow, int> levtr_index;
+
+    /// Station variables, by station and varcode
+    std::map<int, std::map<wreport::Varcode, StationValue>> station_data;
+    /// Station and varcode of station variables, by ID
+    std::unordered_map<int, std::pair<int, wreport::Varcode>> station_data_by_id;
+    int last_station_data_id = 0;
+
+    /// Measured values, by station and datetime
+    std::map<int, std::map<Datetime, DataBlock>> data;
+    /// Station and datetime of measured values, by ID
+    std::unordered_map<int, std::pair<int, Datetime>> data_by_id;
+    int last_data_id = 0;
+};
+
+/**
+ * In-memory contents of a database, with support for rolling back changes.
+ *
+ * All changes are done via methods, which during a transaction record how to
+ * undo them.
+ */
+class Storage : public Tables
+{
+protected:
+    /// True if a transaction is in progress
+    bool in_transaction = false;
+
+    /// Actions that undo the changes made during the current transaction
+    std::vector<std::function<void()>> journal;
+
+    /// Record an undo action, if a transaction is in progress
+    void log(std::function<void()> undo);
+
+    /**
+     * Move all the tables out of the storage, leaving it empty, and record
+     * moving them back on rollback.
+     *
+     * Returns the previous contents of the tables.
+     */
+    std::shared_ptr<const Tables> take_tables();
+
+    void station_data_put(int id_station, wreport::Varcode code, const StationValue& val);
+    void data_put(int id_station, const Datetime& datetime, int id, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs);
+
+public:
+    Storage() = default;
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    void begin();
+    void commit();
+    void rollback();
+
+    void set_setting(const std::string& key, const std::string& value);
+    void drop_settings();
+
+    void create_tables();
+    void drop_tables();
+    /// Empty all tables except repinfo
+    void remove_all();
+    /// Remove orphan levtr, station_data and stations
+    void vacuum();
+
+    void repinfo_insert(unsigned id, const RepinfoRow& row);
+    void repinfo_update(unsigned id, const RepinfoRow& row);
+    void repinfo_delete(unsigned id);
+
+    /// Lookup a station by ID, returning nullptr if not found
+    const StationRow* station(int id) const;
+    int station_insert(const StationRow& row);
+
+    /// Lookup a levtr by ID, returning nullptr if not found
+    const LevTrRow* levtr_row(int id) const;
+    int levtr_insert(const LevTrRow& row);
+
+    /// Lookup a station variable by ID, returning nullptr if not found
+    const StationValue* station_value(int id) const;
+    int station_data_insert(int id_station, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs);
+    void station_data_update(int id, const std::string& value, const std::vector<uint8_t>& attrs);
+    void station_data_set_attrs(int id, const std::vector<uint8_t>& attrs);
+    void station_data_remove(int id);
+
+    /**
+     * Lookup a measured value by ID, returning the block that contains it
+     * and setting pos to its position inside the block.
+     *
+     * Returns nullptr if not found.
+     */
+    const DataBlock* data_value(int id, unsigned& pos) const;
+    int data_insert(int id_station, const Datetime& datetime, int id_levtr, wreport::Varcode code, const std::string& value, const std::vector<uint8_t>& attrs);
+    void data_update(int id, const std::string& value, const std::vector<uint8_t>& attrs);
+    void data_set_attrs(int id, const std::vector<uint8_t>& attrs);
+    void data_remove(int id);
+};
+
+/**
+ * Connection to an in-memory database.
+ *
+ * It does not understand SQL, and is only meant to be used by the mem v7
+ * driver, which accesses storage directly.
+ */
+class MemConnection : public dballe::sql::Connection
+{
+protected:
+    MemConnection();
+
+public:
+    /// Database contents
+    Storage storage;
+
+    MemConnection(const MemConnection&) = delete;
+    MemConnection(const MemConnection&&) = delete;
+    MemConnection& operator=(const MemConnection&) = delete;
+
+    static std::shared_ptr<MemConnection> create();
+
+    std::unique_ptr<dballe::sql::Transaction> transaction(bool readonly=false) override;
+    bool has_table(const std::string& name) override;
+    std::string get_setting(const std::string& key) override;
+    void set_setting(const std::string& key, const std::string& value) override;
+    void drop_settings() override;
+    void execute(const std::string& query) override;
+    void explain(const std::string& query, FILE* out) override;
+};
+
+}
+}
+}
+}
+#endif
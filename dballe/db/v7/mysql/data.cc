@@ -8,7 +8,6 @@
 #include "dballe/sql/querybuf.h"
 #include "dballe/values.h"
 #include "dballe/core/values.h"
-#include "dballe/core/varmatch.h"
 #include <algorithm>
 #include <cstring>
 
@@ -69,29 +68,26 @@ void MySQLDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
     conn.exec_no_data(query);
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void MySQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
     if (qb.bind_in_ident)
         throw error_unimplemented("binding in MySQL driver is not implemented");
 
-    std::unique_ptr<Varmatch> attr_filter;
-    if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
+    if (!qb.attr_filter)
+    {
+        // Delete all the matching values with a single statement. MySQL does
+        // not allow to select from the table being deleted in a subquery, but
+        // allows it in a join
+        Querybuf dq(512);
+        dq.appendf("DELETE t FROM %s t JOIN (", Parent::table_name);
+        dq.append(qb.sql_query);
+        dq.append(") del ON t.id = del.id");
+        Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        conn.exec_no_data(dq);
+        if (trc_del) trc_del->add_row(conn.changes());
+        return;
+    }
 
     Querybuf dq(512);
     dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
@@ -102,7 +98,7 @@ void MySQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb
     while (auto row = res.fetch())
     {
         if (trc_sel) trc_sel->add_row();
-        if (attr_filter.get() && !match_attrs(*attr_filter, row.as_blob(1))) return;
+        if (!qb.match_attrs(row.as_blob(1))) continue;
 
         // Note: if the query gets too long, we can split this in more DELETE
         // runs
@@ -204,6 +200,84 @@ void MySQLStationData::insert(Tracer<>& trc, int id_station, std::vector<batch::
     }
 }
 
+namespace {
+
+void read_station(v7::Transaction& tr, const sql::mysql::Row& row, dballe::DBStation& station)
+{
+    int id_station = row.as_int(0);
+    if (id_station == station.id)
+        return;
+
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(row.as_int(1));
+    station.coords.lat = row.as_int(2);
+    station.coords.lon = row.as_int(3);
+    if (row.isnull(4))
+        station.ident.clear();
+    else
+        station.ident = row.as_string(4);
+}
+
+void read_station_data_row(v7::Transaction& tr, Tracer<>& trc, const v7::DataQueryBuilder& qb, const sql::mysql::Row& row, dballe::DBStation& station, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>& dest)
+{
+    std::vector<uint8_t> attrs;
+    if (qb.select_attrs)
+        attrs = row.as_blob(8);
+
+    // Postprocessing filter of attr_filter
+    if (qb.attr_filter && !qb.match_attrs(attrs))
+        return;
+
+    wreport::Varcode code = row.as_int(5);
+    const char* value = row.as_cstring(7);
+    std::unique_ptr<wreport::Var> var;
+    {
+        trace::PhaseTimer timer(trc, "decode");
+        var = newvar(code, value);
+        if (qb.select_attrs)
+            core::value::Decoder::decode_attrs(attrs, *var);
+        timer.add_allocs();
+    }
+
+    read_station(tr, row, station);
+
+    int id_data = row.as_int(6);
+
+    dest(station, id_data, move(var));
+}
+
+void read_data_row(v7::Transaction& tr, Tracer<>& trc, const v7::DataQueryBuilder& qb, const sql::mysql::Row& row, dballe::DBStation& station, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>& dest)
+{
+    std::vector<uint8_t> attrs;
+    if (qb.select_attrs)
+        attrs = row.as_blob(10);
+
+    // Postprocessing filter of attr_filter
+    if (qb.attr_filter && !qb.match_attrs(attrs))
+        return;
+
+    wreport::Varcode code = row.as_int(6);
+    const char* value = row.as_cstring(9);
+    std::unique_ptr<wreport::Var> var;
+    {
+        trace::PhaseTimer timer(trc, "decode");
+        var = newvar(code, value);
+        if (qb.select_attrs)
+            core::value::Decoder::decode_attrs(attrs, *var);
+        timer.add_allocs();
+    }
+
+    read_station(tr, row, station);
+
+    int id_levtr = row.as_int(5);
+    int id_data = row.as_int(7);
+    Datetime datetime = row.as_datetime(8);
+
+    dest(station, id_levtr, datetime, id_data, move(var));
+}
+
+}
+
 void MySQLStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
 {
     if (qb.bind_in_ident)
@@ -213,35 +287,18 @@ void MySQLStationData::run_station_data_query(Tracer<>& trc, const v7::DataQuery
     dballe::DBStation station;
     conn.exec_use(qb.sql_query, [&](const sql::mysql::Row& row) {
         if (trc_sel) trc_sel->add_row();
-        wreport::Varcode code = row.as_int(5);
-        const char* value = row.as_cstring(7);
-        auto var = newvar(code, value);
-        if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(row.as_blob(8), *var);
-
-        // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
-            return;
-
-        int id_station = row.as_int(0);
-        if (id_station != station.id)
-        {
-            station.id = id_station;
-            station.report = tr.repinfo().get_rep_memo(row.as_int(1));
-            station.coords.lat = row.as_int(2);
-            station.coords.lon = row.as_int(3);
-            if (row.isnull(4))
-                station.ident.clear();
-            else
-                station.ident = row.as_string(4);
-        }
-
-        int id_data = row.as_int(6);
-
-        dest(station, id_data, move(var));
+        read_station_data_row(tr, trc_sel, qb, row, station, dest);
     });
 }
 
+std::unique_ptr<StationDataStream> MySQLStationData::stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    // mysql_use_result would keep the connection busy until all rows have
+    // been read, preventing the other queries that cursors run while being
+    // iterated: query results are read all at once instead
+    return std::unique_ptr<StationDataStream>();
+}
+
 void MySQLStationData::dump(FILE* out)
 {
     StationDataDumper dumper(out);
@@ -325,37 +382,16 @@ void MySQLData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, st
     dballe::DBStation station;
     conn.exec_use(qb.sql_query, [&](const sql::mysql::Row& row) {
         if (trc_sel) trc_sel->add_row();
-        wreport::Varcode code = row.as_int(6);
-        const char* value = row.as_cstring(9);
-        auto var = newvar(code, value);
-        if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(row.as_blob(10), *var);
-
-        // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
-            return;
-
-        int id_station = row.as_int(0);
-        if (id_station != station.id)
-        {
-            station.id = id_station;
-            station.report = tr.repinfo().get_rep_memo(row.as_int(1));
-            station.coords.lat = row.as_int(2);
-            station.coords.lon = row.as_int(3);
-            if (row.isnull(4))
-                station.ident.clear();
-            else
-                station.ident = row.as_string(4);
-        }
-
-        int id_levtr = row.as_int(5);
-        int id_data = row.as_int(7);
-        Datetime datetime = row.as_datetime(8);
-
-        dest(station, id_levtr, datetime, id_data, move(var));
+        read_data_row(tr, trc_sel, qb, row, station, dest);
     });
 }
 
+std::unique_ptr<DataStream> MySQLData::stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    // See MySQLStationData::stream_station_data_query
+    return std::unique_ptr<DataStream>();
+}
+
 void MySQLData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)> dest)
 {
     if (qb.bind_in_ident)
@@ -393,6 +429,61 @@ void MySQLData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder&
     });
 }
 
+void MySQLData::summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added)
+{
+    const Datetime& mi = added.dtmin;
+    const Datetime& ma = added.dtmax;
+    Querybuf qb;
+    qb.appendf(R"(
+        INSERT INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count)
+             VALUES (%d, %d, %d, '%04d-%02d-%02d %02d:%02d:%02d', '%04d-%02d-%02d %02d:%02d:%02d', %u)
+        ON DUPLICATE KEY UPDATE
+             dtmin=LEAST(dtmin, VALUES(dtmin)), dtmax=GREATEST(dtmax, VALUES(dtmax)), count=count+VALUES(count)
+    )", key.id_station, key.id_levtr, (int)key.code,
+        mi.year, mi.month, mi.day, mi.hour, mi.minute, mi.second,
+        ma.year, ma.month, ma.day, ma.hour, ma.minute, ma.second,
+        added.count);
+    Tracer<> trc_ins(trc ? trc->trace_insert(qb, 1) : nullptr);
+    conn.exec_no_data(qb);
+}
+
+void MySQLData::summary_remove_by_id(Tracer<>& trc, int id_data)
+{
+    char query[128];
+    snprintf(query, 128, "SELECT id_station, id_levtr, code FROM data WHERE id=%d", id_data);
+    Tracer<> trc_sel(trc ? trc->trace_select(query) : nullptr);
+    auto res = conn.exec_store(query);
+    while (auto row = res.fetch())
+    {
+        if (trc_sel) trc_sel->add_row();
+        summary_changes.remove(row.as_int(0), row.as_int(1), row.as_int(2));
+    }
+}
+
+void MySQLData::summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations)
+{
+    Querybuf ids;
+    ids.start_list(",");
+    for (int id: id_stations)
+        ids.append_listf("%d", id);
+
+    Querybuf dq;
+    dq.appendf("DELETE FROM data_summary WHERE id_station IN (%s)", ids.c_str());
+    Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+    conn.exec_no_data(dq);
+
+    Querybuf iq;
+    iq.appendf(R"(
+        INSERT INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count)
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+              WHERE id_station IN (%s)
+           GROUP BY id_station, id_levtr, code
+    )", ids.c_str());
+    Tracer<> trc_ins(trc ? trc->trace_insert(iq) : nullptr);
+    conn.exec_no_data(iq);
+}
+
 
 void MySQLData::dump(FILE* out)
 {
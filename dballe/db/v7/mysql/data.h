@@ -64,6 +64,7 @@ public:
     void query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs) override;
     void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<StationDataStream> stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
@@ -73,14 +74,21 @@ public:
  */
 class MySQLData : public MySQLDataCommon<Data>
 {
+protected:
+    void summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added) override;
+    void summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations) override;
+
 public:
     using MySQLDataCommon::MySQLDataCommon;
 
     MySQLData(v7::Transaction& tr, dballe::sql::MySQLConnection& conn);
 
+    void summary_remove_by_id(Tracer<>& trc, int id_data) override;
+
     void query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) override;
     void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<DataStream> stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)>) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
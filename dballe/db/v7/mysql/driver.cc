@@ -124,16 +124,22 @@ void Driver::create_tables_v7()
         )
     )" DBA_MYSQL_DEFAULT_TABLE_OPTIONS);
 
+    data_summary = 0;
+    create_data_summary_v7();
+
     conn.set_setting("version", "V7");
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("data_summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
     conn.drop_table_if_exists("repinfo");
     conn.drop_table_if_exists("station");
     conn.drop_settings();
+    typed_values = -1;
+    data_summary = -1;
 }
 void Driver::vacuum_v7()
 {
@@ -145,6 +151,63 @@ void Driver::vacuum_v7()
          WHERE dd.id IS NULL
     )");
     conn.exec_no_data("DELETE s FROM station s LEFT JOIN data d ON d.id_station = s.id WHERE d.id IS NULL");
+    create_data_summary_v7();
+}
+
+void Driver::create_data_covering_index_v7()
+{
+    // id is the primary key, which InnoDB appends to all secondary indices
+    if (conn.exec_store("SHOW INDEX FROM data WHERE Key_name='data_cover'").rowcount() > 0)
+        return;
+    conn.exec_no_data("CREATE INDEX data_cover ON data(id_station, datetime, id_levtr, code, value)");
+}
+
+void Driver::create_typed_values_v7()
+{
+    if (has_typed_values()) return;
+
+    // value holds the scaled integer of numeric variables, which has at most
+    // 18 digits and fits in a 64 bit BIGINT: longer strings of digits are
+    // string variables
+    static const char* ivalue_expr = "IF(NEW.value REGEXP '^-?[0-9]{1,18}$', CAST(NEW.value AS SIGNED), NULL)";
+    for (const char* table: { "data", "station_data" })
+    {
+        conn.exec_no_data(string("ALTER TABLE ") + table + " ADD COLUMN ivalue BIGINT, ADD INDEX " + table + "_ivalue (code, ivalue)");
+        conn.exec_no_data(string("UPDATE ") + table + " SET ivalue=CAST(value AS SIGNED) WHERE value REGEXP '^-?[0-9]{1,18}$'");
+        conn.exec_no_data(string("CREATE TRIGGER ") + table + "_ivalue_insert BEFORE INSERT ON " + table
+                + " FOR EACH ROW SET NEW.ivalue=" + ivalue_expr);
+        conn.exec_no_data(string("CREATE TRIGGER ") + table + "_ivalue_update BEFORE UPDATE ON " + table
+                + " FOR EACH ROW SET NEW.ivalue=" + ivalue_expr);
+    }
+
+    conn.set_setting("typed_values", "ivalue");
+    typed_values = 1;
+}
+
+void Driver::create_data_summary_v7()
+{
+    if (has_data_summary()) return;
+
+    conn.exec_no_data(R"(
+        CREATE TABLE data_summary (
+           id_station  INTEGER NOT NULL,
+           id_levtr    INTEGER NOT NULL,
+           code        SMALLINT NOT NULL,
+           dtmin       DATETIME NOT NULL,
+           dtmax       DATETIME NOT NULL,
+           count       INTEGER NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        )
+    )" DBA_MYSQL_DEFAULT_TABLE_OPTIONS);
+    conn.exec_no_data(R"(
+        INSERT INTO data_summary
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+           GROUP BY id_station, id_levtr, code
+    )");
+
+    conn.set_setting("data_summary", "table");
+    data_summary = 1;
 }
 
 }
@@ -24,6 +24,9 @@ struct Driver : public v7::Driver
     void create_tables_v7() override;
     void delete_tables_v7() override;
     void vacuum_v7() override;
+    void create_data_covering_index_v7() override;
+    void create_typed_values_v7() override;
+    void create_data_summary_v7() override;
 };
 
 }
@@ -50,7 +50,7 @@ MySQLLevTr::~MySQLLevTr()
 {
 }
 
-void MySQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void MySQLLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty()) return;
 
@@ -26,6 +26,7 @@ protected:
     dballe::sql::MySQLConnection& conn;
 
     void _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
 
 public:
     MySQLLevTr(v7::Transaction& tr, dballe::sql::MySQLConnection& conn);
@@ -34,7 +35,6 @@ public:
     MySQLLevTr& operator=(const MySQLLevTr&) = delete;
     ~MySQLLevTr();
 
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
     const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
     int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
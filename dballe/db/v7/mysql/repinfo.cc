@@ -16,7 +16,6 @@ namespace mysql {
 MySQLRepinfoV7::MySQLRepinfoV7(MySQLConnection& conn)
     : Repinfo(conn), conn(conn)
 {
-    read_cache();
 }
 
 MySQLRepinfoV7::~MySQLRepinfoV7()
@@ -110,7 +110,9 @@ int MySQLStation::insert_new(Tracer<>& trc, const dballe::DBStation& desc)
     }
     Tracer<> trc_ins(trc ? trc->trace_insert(qb, 1) : nullptr);
     conn.exec_no_data(qb);
-    return conn.get_last_insert_id();
+    int id = conn.get_last_insert_id();
+    cache.insert(desc, id);
+    return id;
 }
 
 #if 0
@@ -196,6 +198,18 @@ void MySQLStation::add_station_vars(Tracer<>& trc, int id_station, DBValues& val
     }
 }
 
+void MySQLStation::run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest)
+{
+    if (qb.bind_in_ident)
+        throw error_unimplemented("binding in MySQL driver is not implemented");
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_station_vars_query) : nullptr);
+
+    conn.exec_use(qb.sql_station_vars_query, [&](const sql::mysql::Row& row) {
+        if (trc_sel) trc_sel->add_row();
+        dest(row.as_int(0), newvar((wreport::Varcode)row.as_int(1), row.as_cstring(2)));
+    });
+}
+
 void MySQLStation::run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)> dest)
 {
     if (qb.bind_in_ident)
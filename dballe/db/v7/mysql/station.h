@@ -39,6 +39,7 @@ public:
     int insert_new(Tracer<>& trc, const dballe::DBStation& desc) override;
     void get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
     void add_station_vars(Tracer<>& trc, int id_station, DBValues& values) override;
+    void run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest) override;
     void run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)>) override;
 };
 
@@ -0,0 +1,137 @@
+#include "pool.h"
+#include "driver.h"
+#include "levtr.h"
+#include "transaction.h"
+#include "dballe/db.h"
+#include "dballe/sql/sql.h"
+#include <wreport/error.h>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+PooledConnection::PooledConnection(std::shared_ptr<dballe::sql::Connection> conn, unsigned generation)
+    : conn(conn), driver(v7::Driver::create(*this->conn)), generation(generation)
+{
+}
+
+PooledConnection::~PooledConnection()
+{
+}
+
+
+ConnectionPool::ConnectionPool(const std::string& url, unsigned max_size)
+    : url(url), max_size(max_size)
+{
+    if (max_size == 0)
+        throw error_consistency("connection pool size must be at least 1");
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    for (auto pc: idle)
+        delete pc;
+}
+
+std::shared_ptr<PooledConnection> ConnectionPool::borrow()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::thread::id self = std::this_thread::get_id();
+    if (idle.empty() && open >= max_size)
+    {
+        auto i = borrowed.find(self);
+        if (i != borrowed.end() && i->second >= open)
+            error_consistency::throwf("all %u pooled connections are used by transactions of the current thread: nested transactions would wait forever", max_size);
+    }
+    returned.wait(lock, [this] { return !idle.empty() || open < max_size; });
+
+    PooledConnection* pc;
+    if (!idle.empty())
+    {
+        pc = idle.back();
+        idle.pop_back();
+    } else {
+        // Reserve the slot, and connect without holding the lock
+        ++open;
+        unsigned gen = generation;
+        lock.unlock();
+        try {
+            auto opts = DBConnectOptions::create(url);
+            pc = new PooledConnection(dballe::sql::Connection::create(*opts), gen);
+        } catch (...) {
+            lock.lock();
+            --open;
+            returned.notify_one();
+            throw;
+        }
+        lock.lock();
+    }
+    pc->borrower = self;
+    ++borrowed[self];
+    lock.unlock();
+
+    return std::shared_ptr<PooledConnection>(pc, [this](PooledConnection* pc) { give_back(pc); });
+}
+
+void ConnectionPool::give_back(PooledConnection* pc)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto b = borrowed.find(pc->borrower);
+    if (b != borrowed.end() && --b->second == 0)
+        borrowed.erase(b);
+    if (pc->generation != generation)
+    {
+        // Opened before invalidate(): close it
+        --open;
+        lock.unlock();
+        delete pc;
+    } else {
+        idle.push_back(pc);
+        lock.unlock();
+    }
+    returned.notify_one();
+}
+
+void ConnectionPool::invalidate()
+{
+    std::vector<PooledConnection*> closed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++generation;
+        closed.swap(idle);
+        open -= closed.size();
+        repinfo.clear();
+        levtr.clear();
+    }
+    for (auto pc: closed)
+        delete pc;
+    returned.notify_all();
+}
+
+bool ConnectionPool::load_snapshot(v7::Transaction& tr)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (repinfo.empty()) return false;
+    tr.repinfo().load_cache(repinfo);
+    tr.levtr().load_cache(levtr);
+    return true;
+}
+
+void ConnectionPool::save_snapshot(v7::Transaction& tr)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tr.pooled && tr.pooled->generation != generation)
+        return;
+    // Read-only transactions only update the snapshot if they read repinfo
+    // from the database
+    if (!tr.readonly || repinfo.empty() || !tr.repinfo().is_snapshot())
+        repinfo = tr.repinfo().get_cache();
+    tr.levtr().save_cache(levtr);
+}
+
+}
+}
+}
@@ -0,0 +1,118 @@
+#ifndef DBALLE_DB_V7_POOL_H
+#define DBALLE_DB_V7_POOL_H
+
+#include <dballe/sql/fwd.h>
+#include <dballe/db/v7/fwd.h>
+#include <dballe/db/v7/cache.h>
+#include <dballe/db/v7/repinfo.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+/// Connection borrowed from a ConnectionPool, with its own driver
+struct PooledConnection
+{
+    std::shared_ptr<dballe::sql::Connection> conn;
+    std::unique_ptr<v7::Driver> driver;
+    /// Generation of the pool when the connection was opened
+    unsigned generation;
+    /// Thread that borrowed the connection
+    std::thread::id borrower;
+
+    PooledConnection(std::shared_ptr<dballe::sql::Connection> conn, unsigned generation);
+    ~PooledConnection();
+};
+
+/**
+ * Pool of connections to a database, used to run transactions concurrently
+ * from multiple threads.
+ *
+ * Connections are opened when needed, up to a maximum number: when they are
+ * all in use, borrow() waits until one is given back.
+ *
+ * The pool also keeps a snapshot of the repinfo table and of the levtr
+ * entries seen so far, which read-only transactions use to fill their caches
+ * instead of querying the database. The snapshot is updated by transactions
+ * as they end, and a transaction rereads repinfo from the database if it
+ * does not find a report in it.
+ *
+ * A thread that starts a transaction while it still holds another one needs
+ * a second connection: this can deadlock when several threads do it at the
+ * same time on an exhausted pool, so nested transactions should be avoided.
+ */
+class ConnectionPool
+{
+protected:
+    /// URL used to open new connections
+    std::string url;
+    /// Maximum number of open connections
+    unsigned max_size;
+
+    std::mutex mutex;
+    /// Notified when a connection is given back
+    std::condition_variable returned;
+    /// Number of open connections, idle or in use
+    unsigned open = 0;
+    /// Connections not in use
+    std::vector<PooledConnection*> idle;
+    /// Number of connections in use, by borrowing thread
+    std::map<std::thread::id, unsigned> borrowed;
+    /// Incremented by invalidate(), to close connections opened before it
+    unsigned generation = 0;
+
+    /// Snapshot of the repinfo table, empty if not loaded yet
+    std::vector<repinfo::Cache> repinfo;
+    /// Snapshot of the levtr entries seen so far
+    LevTrCache levtr;
+
+    void give_back(PooledConnection* pc);
+
+public:
+    ConnectionPool(const std::string& url, unsigned max_size);
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    ~ConnectionPool();
+
+    /**
+     * Borrow a connection, opening it or waiting for one if needed.
+     *
+     * The connection is given back to the pool when the last copy of the
+     * returned pointer is destroyed.
+     *
+     * Throws error_consistency instead of waiting if all the connections are
+     * in use by the calling thread, since none would ever be given back.
+     */
+    std::shared_ptr<PooledConnection> borrow();
+
+    /**
+     * Close the idle connections and discard the snapshot.
+     *
+     * This is needed after the database tables have been recreated or
+     * vacuumed through a different connection. Connections currently in use
+     * are closed when they are given back.
+     */
+    void invalidate();
+
+    /**
+     * Fill the repinfo and levtr caches of tr from the snapshot.
+     *
+     * Returns false, without touching tr, if there is no snapshot yet.
+     */
+    bool load_snapshot(v7::Transaction& tr);
+
+    /// Update the snapshot with the repinfo and levtr caches of tr
+    void save_snapshot(v7::Transaction& tr);
+};
+
+}
+}
+}
+#endif
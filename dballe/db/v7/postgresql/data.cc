@@ -1,5 +1,6 @@
 #include "data.h"
 #include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/driver.h"
 #include "dballe/db/v7/trace.h"
 #include "dballe/db/v7/batch.h"
 #include "dballe/db/v7/qbuilder.h"
@@ -8,8 +9,8 @@
 #include "dballe/sql/querybuf.h"
 #include "dballe/values.h"
 #include "dballe/core/values.h"
-#include "dballe/core/varmatch.h"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 
 using namespace wreport;
@@ -33,6 +34,22 @@ PostgreSQLDataCommon<Parent>::PostgreSQLDataCommon(v7::Transaction& tr, dballe::
 {
 }
 
+template<typename Parent>
+std::vector<int> PostgreSQLDataCommon<Parent>::reserve_ids(Tracer<>& trc, unsigned count)
+{
+    char query[128];
+    snprintf(query, 128, "SELECT nextval(pg_get_serial_sequence('%s', 'id'))::int4 FROM generate_series(1, $1::int4)", Parent::table_name);
+    Tracer<> trc_sel(trc ? trc->trace_select(query, count) : nullptr);
+    Result res(conn.exec(query, (int32_t)count));
+    if (res.rowcount() != count)
+        error_consistency::throwf("reserving %u IDs from %s returned %u values", count, Parent::table_name, res.rowcount());
+    std::vector<int> ids;
+    ids.reserve(count);
+    for (unsigned row = 0; row < count; ++row)
+        ids.push_back(res.get_int4(row, 0));
+    return ids;
+}
+
 template<typename Parent>
 void PostgreSQLDataCommon<Parent>::read_attrs(Tracer<>& trc, int id_data, std::function<void(std::unique_ptr<wreport::Var>)> dest)
 {
@@ -82,37 +99,14 @@ void PostgreSQLDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
     conn.exec_prepared_no_data(remove_attrs_query_name, id_data);
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
-    if (!qb.query.attr_filter.empty())
+    if (qb.attr_filter)
     {
         // We need to apply attr_filter to all results of the query, so we
-        // iterate the results and delete the matching ones one by one.
-        std::unique_ptr<Varmatch> attr_filter = Varmatch::parse(qb.query.attr_filter);
-        if (remove_data_query_name.empty())
-        {
-            remove_data_query_name = Parent::table_name;
-            remove_data_query_name += "v7_remove_data";
-            char query[64];
-            snprintf(query, 64, "DELETE FROM %s WHERE id=$1::int4", Parent::table_name);
-            conn.prepare(remove_data_query_name, query);
-        }
-
+        // iterate the results and delete the matching ones with a single
+        // statement
         Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
         Result to_remove;
         if (qb.bind_in_ident)
@@ -121,12 +115,21 @@ void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilde
             to_remove = conn.exec(qb.sql_query);
         if (trc_sel) trc_sel->add_row(to_remove.rowcount());
         trc_sel.done();
+
+        Querybuf dq(512);
+        dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
+        dq.start_list(",");
+        unsigned count = 0;
         for (unsigned row = 0; row < to_remove.rowcount(); ++row)
         {
-            if (!match_attrs(*attr_filter, to_remove.get_bytea(row, 1))) return;
-            Tracer<> trc_del(trc ? trc->trace_delete(remove_data_query_name, 1) : nullptr);
-            conn.exec_prepared(remove_data_query_name, (int)to_remove.get_int4(row, 0));
+            if (!qb.match_attrs(to_remove.get_bytea(row, 1))) continue;
+            dq.append_listf("%d", (int)to_remove.get_int4(row, 0));
+            ++count;
         }
+        dq.append(")");
+        if (!count) return;
+        Tracer<> trc_del(trc ? trc->trace_delete(dq, count) : nullptr);
+        conn.exec_no_data(dq);
     } else {
         Querybuf dq(512);
         dq.append("DELETE FROM ");
@@ -135,12 +138,13 @@ void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilde
         dq.append(qb.sql_query);
         dq.append(")");
         Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        Result res;
         if (qb.bind_in_ident)
-        {
-            conn.exec_no_data(dq.c_str(), qb.bind_in_ident);
-        } else {
-            conn.exec_no_data(dq.c_str());
-        }
+            res = conn.exec_unchecked(dq.c_str(), qb.bind_in_ident);
+        else
+            res = conn.exec_unchecked(dq.c_str());
+        res.expect_no_data(dq);
+        if (trc_del) trc_del->add_row(res.affected_rows());
     }
 }
 
@@ -232,13 +236,56 @@ void PostgreSQLStationData::insert(Tracer<>& trc, int id_station, std::vector<ba
 {
     std::sort(vars.begin(), vars.end());
 
+    // Count the values to insert, skipping duplicates
+    unsigned count = 0;
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        ++count;
+    }
+
+    if (conn.copy_min_rows && count >= conn.copy_min_rows)
+    {
+        // Bulk insert with COPY, assigning IDs ourselves
+        static const char* copy_query = "COPY station_data (id, id_station, code, value, attrs) FROM STDIN (FORMAT binary)";
+        std::vector<int> ids = reserve_ids(trc, count);
+        CopyBuffer buf;
+        unsigned row = 0;
+        for (auto v = vars.begin(); v != vars.end(); ++v)
+        {
+            // Skip duplicates
+            auto next = v + 1;
+            if (next != vars.end() && *v == *next)
+                continue;
+            v->id = ids[row++];
+            buf.start_row(5);
+            buf.add_int4(v->id);
+            buf.add_int4(id_station);
+            buf.add_int4(v->var->code());
+            buf.add_string(v->var->enqc());
+            if (with_attrs && v->var->next_attr())
+            {
+                core::value::Encoder enc;
+                enc.append_attributes(*v->var);
+                buf.add_bytea(enc.buf);
+            } else
+                buf.add_null();
+        }
+        buf.finish();
+
+        Tracer<> trc_ins(trc ? trc->trace_insert(copy_query, count) : nullptr);
+        conn.copy_from_stdin(copy_query, buf);
+        return;
+    }
+
     char lead[64];
     snprintf(lead, 64, "(DEFAULT,%d,", id_station);
 
     Querybuf dq(512);
     dq.append("INSERT INTO station_data (id, id_station, code, value, attrs) VALUES ");
     dq.start_list(",");
-    unsigned count = 0;
     for (auto v = vars.begin(); v != vars.end(); ++v)
     {
         // Skip duplicates
@@ -259,7 +306,6 @@ void PostgreSQLStationData::insert(Tracer<>& trc, int id_station, std::vector<ba
         } else
             dq.append("NULL::bytea");
         dq.append(")");
-        ++count;
     }
     dq.append(" RETURNING id");
 
@@ -281,10 +327,197 @@ void PostgreSQLStationData::insert(Tracer<>& trc, int id_station, std::vector<ba
     }
 }
 
+namespace {
+
+/**
+ * Server-side cursor, used to read the results of a query a batch at a time
+ */
+class ServerCursor
+{
+protected:
+    PostgreSQLConnection& conn;
+    std::string name;
+
+public:
+    ServerCursor(PostgreSQLConnection& conn, const v7::DataQueryBuilder& qb)
+        : conn(conn)
+    {
+        // Cursors of pooled transactions can be declared concurrently
+        static std::atomic<unsigned> serial(0);
+        name = "dballe_stream_" + std::to_string(++serial);
+
+        std::string query = "DECLARE " + name + " BINARY NO SCROLL CURSOR FOR " + qb.sql_query;
+        if (qb.bind_in_ident)
+            conn.exec_no_data(query, qb.bind_in_ident);
+        else
+            conn.exec_no_data(query);
+    }
+    ServerCursor(const ServerCursor&) = delete;
+    ServerCursor& operator=(const ServerCursor&) = delete;
+    ~ServerCursor()
+    {
+        // The cursor is closed automatically when the transaction ends
+        if (PQtransactionStatus(conn) == PQTRANS_INTRANS)
+            conn.pqexec_nothrow("CLOSE " + name);
+    }
+
+    /**
+     * Fetch at most max_rows rows, or all the remaining rows if max_rows is 0
+     */
+    Result fetch(unsigned max_rows)
+    {
+        if (max_rows == 0)
+            return conn.exec("FETCH ALL FROM " + name);
+        else
+            return conn.exec("FETCH FORWARD " + std::to_string(max_rows) + " FROM " + name);
+    }
+};
+
+void read_station(v7::Transaction& tr, const Result& res, unsigned row, dballe::DBStation& station)
+{
+    int id_station = res.get_int4(row, 0);
+    if (id_station == station.id)
+        return;
+
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(res.get_int4(row, 1));
+    station.coords.lat = res.get_int4(row, 2);
+    station.coords.lon = res.get_int4(row, 3);
+    if (res.is_null(row, 4))
+        station.ident.clear();
+    else
+        station.ident = res.get_string(row, 4);
+}
+
+void read_station_data_rows(v7::Transaction& tr, Tracer<>& trc, const v7::DataQueryBuilder& qb, const Result& res, dballe::DBStation& station, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>& dest)
+{
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+    {
+        std::vector<uint8_t> attrs;
+        if (qb.select_attrs)
+            attrs = res.get_bytea(row, 8);
+
+        // Postprocessing filter of attr_filter
+        if (qb.attr_filter && !qb.match_attrs(attrs))
+            continue;
+
+        wreport::Varcode code = res.get_int4(row, 5);
+        const char* value = res.get_string(row, 7);
+        std::unique_ptr<wreport::Var> var;
+        {
+            trace::PhaseTimer timer(trc, "decode");
+            var = newvar(code, value);
+            if (qb.select_attrs)
+                core::value::Decoder::decode_attrs(attrs, *var);
+            timer.add_allocs();
+        }
+
+        read_station(tr, res, row, station);
+
+        int id_data = res.get_int4(row, 6);
+
+        dest(station, id_data, move(var));
+    }
+}
+
+void read_data_rows(v7::Transaction& tr, Tracer<>& trc, const v7::DataQueryBuilder& qb, const Result& res, dballe::DBStation& station, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>& dest)
+{
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+    {
+        std::vector<uint8_t> attrs;
+        if (qb.select_attrs)
+            attrs = res.get_bytea(row, 10);
+
+        // Postprocessing filter of attr_filter
+        if (qb.attr_filter && !qb.match_attrs(attrs))
+            continue;
+
+        wreport::Varcode code = res.get_int4(row, 6);
+        const char* value = res.get_string(row, 9);
+        std::unique_ptr<wreport::Var> var;
+        {
+            trace::PhaseTimer timer(trc, "decode");
+            var = newvar(code, value);
+            if (qb.select_attrs)
+                core::value::Decoder::decode_attrs(attrs, *var);
+            timer.add_allocs();
+        }
+
+        read_station(tr, res, row, station);
+
+        int id_levtr = res.get_int4(row, 5);
+        int id_data = res.get_int4(row, 7);
+        Datetime datetime = res.get_timestamp(row, 8);
+
+        dest(station, id_levtr, datetime, id_data, move(var));
+    }
+}
+
+struct PostgreSQLStationDataStream : public StationDataStream
+{
+    v7::Transaction& tr;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    ServerCursor cursor;
+    dballe::DBStation station;
+    bool done = false;
+
+    PostgreSQLStationDataStream(v7::Transaction& tr, PostgreSQLConnection& conn, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr), cursor(conn, qb)
+    {
+    }
+
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        if (done) return false;
+        Result res;
+        {
+            trace::PhaseTimer timer(trc_sel, "sql");
+            res = cursor.fetch(max_rows);
+        }
+        if (trc_sel) trc_sel->add_row(res.rowcount());
+        if (max_rows == 0 || res.rowcount() < max_rows)
+            done = true;
+        read_station_data_rows(tr, trc_sel, qb, res, station, dest);
+        return !done;
+    }
+};
+
+struct PostgreSQLDataStream : public DataStream
+{
+    v7::Transaction& tr;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    ServerCursor cursor;
+    dballe::DBStation station;
+    bool done = false;
+
+    PostgreSQLDataStream(v7::Transaction& tr, PostgreSQLConnection& conn, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr), cursor(conn, qb)
+    {
+    }
+
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        if (done) return false;
+        Result res;
+        {
+            trace::PhaseTimer timer(trc_sel, "sql");
+            res = cursor.fetch(max_rows);
+        }
+        if (trc_sel) trc_sel->add_row(res.rowcount());
+        if (max_rows == 0 || res.rowcount() < max_rows)
+            done = true;
+        read_data_rows(tr, trc_sel, qb, res, station, dest);
+        return !done;
+    }
+};
+
+}
+
 void PostgreSQLStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-    using namespace dballe::sql::postgresql;
 
     // Start the query asynchronously
     int res;
@@ -301,38 +534,15 @@ void PostgreSQLStationData::run_station_data_query(Tracer<>& trc, const v7::Data
     dballe::DBStation station;
     conn.run_single_row_mode(qb.sql_query, [&](const Result& res) {
         if (trc_sel) trc_sel->add_row(res.rowcount());
-        for (unsigned row = 0; row < res.rowcount(); ++row)
-        {
-            wreport::Varcode code = res.get_int4(row, 5);
-            const char* value = res.get_string(row, 7);
-            auto var = newvar(code, value);
-            if (qb.select_attrs)
-                core::value::Decoder::decode_attrs(res.get_bytea(row, 8), *var);
-
-            // Postprocessing filter of attr_filter
-            if (qb.attr_filter && !qb.match_attrs(*var))
-                return;
-
-            int id_station = res.get_int4(row, 0);
-            if (id_station != station.id)
-            {
-                station.id = id_station;
-                station.report = tr.repinfo().get_rep_memo(res.get_int4(row, 1));
-                station.coords.lat = res.get_int4(row, 2);
-                station.coords.lon = res.get_int4(row, 3);
-                if (res.is_null(row, 4))
-                    station.ident.clear();
-                else
-                    station.ident = res.get_string(row, 4);
-            }
-
-            int id_data = res.get_int4(row, 6);
-
-            dest(station, id_data, move(var));
-        }
+        read_station_data_rows(tr, trc_sel, qb, res, station, dest);
     });
 }
 
+std::unique_ptr<StationDataStream> PostgreSQLStationData::stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<StationDataStream>(new PostgreSQLStationDataStream(tr, conn, trc, qb));
+}
+
 void PostgreSQLStationData::dump(FILE* out)
 {
     StationDataDumper dumper(out);
@@ -348,12 +558,59 @@ void PostgreSQLStationData::dump(FILE* out)
 }
 
 
-PostgreSQLData::PostgreSQLData(v7::Transaction& tr, PostgreSQLConnection& conn)
-    : PostgreSQLDataCommon(tr, conn)
+PostgreSQLData::PostgreSQLData(v7::Transaction& tr, PostgreSQLConnection& conn, bool partitioned)
+    : PostgreSQLDataCommon(tr, conn), partitioned(partitioned)
 {
     conn.prepare("datav7_select", "SELECT id, id_levtr, code FROM data WHERE id_station=$1::int4 AND datetime=$2::timestamp");
 }
 
+std::string PostgreSQLData::partition_name(int year, int month)
+{
+    char name[16];
+    snprintf(name, 16, "data_%04d%02d", year, month);
+    return name;
+}
+
+void PostgreSQLData::ensure_partition(Tracer<>& trc, const Datetime& dt)
+{
+    int key = dt.year * 100 + dt.month;
+    if (partitions.find(key) != partitions.end()) return;
+
+    string name = partition_name(dt.year, dt.month);
+
+    // Serialize the creation of the partition with concurrent imports of the
+    // same month: the lock is held until the end of the transaction, so a
+    // concurrent import sees the partition once it has been committed
+    conn.exec_one_row("SELECT pg_advisory_xact_lock(hashtext($1::text))", name);
+
+    Tracer<> trc_sel(trc ? trc->trace_select("SELECT to_regclass($1::text)") : nullptr);
+    Result res(conn.exec_one_row("SELECT to_regclass($1::text)", name));
+    if (trc_sel) trc_sel->add_row();
+    trc_sel.done();
+    if (res.is_null(0, 0))
+    {
+        // Create the partition as a standalone table and attach it, since
+        // CREATE TABLE ... PARTITION OF would lock the whole data table in
+        // ACCESS EXCLUSIVE mode until the import commits. ATTACH PARTITION
+        // only takes a SHARE UPDATE EXCLUSIVE lock, which does not block
+        // concurrent queries and inserts
+        int next_year = dt.month == 12 ? dt.year + 1 : dt.year;
+        int next_month = dt.month == 12 ? 1 : dt.month + 1;
+        char query[160];
+        snprintf(query, 160, "CREATE TABLE %s (LIKE data INCLUDING DEFAULTS INCLUDING CONSTRAINTS)", name.c_str());
+        conn.exec_no_data(query);
+        // The typed values trigger is created on each partition, since
+        // PostgreSQL before 13 cannot have it on the partitioned table
+        if (tr.driver().has_typed_values())
+            conn.exec_no_data("CREATE TRIGGER " + name + "_ivalue BEFORE INSERT OR UPDATE OF value ON " + name
+                    + " FOR EACH ROW EXECUTE PROCEDURE dballe_set_ivalue()");
+        snprintf(query, 160, "ALTER TABLE data ATTACH PARTITION %s FOR VALUES FROM ('%04d-%02d-01') TO ('%04d-%02d-01')",
+                name.c_str(), (int)dt.year, (int)dt.month, next_year, next_month);
+        conn.exec_no_data(query);
+    }
+    partitions.insert(key);
+}
+
 void PostgreSQLData::query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select("datav7_select") : nullptr);
@@ -370,8 +627,57 @@ void PostgreSQLData::query(Tracer<>& trc, int id_station, const Datetime& dateti
 
 void PostgreSQLData::insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
 {
+    if (partitioned)
+        ensure_partition(trc, datetime);
+
     std::sort(vars.begin(), vars.end());
 
+    // Count the values to insert, skipping duplicates
+    unsigned count = 0;
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        ++count;
+    }
+
+    if (conn.copy_min_rows && count >= conn.copy_min_rows)
+    {
+        // Bulk insert with COPY, assigning IDs ourselves
+        static const char* copy_query = "COPY data (id, id_station, datetime, id_levtr, code, value, attrs) FROM STDIN (FORMAT binary)";
+        std::vector<int> ids = reserve_ids(trc, count);
+        CopyBuffer buf;
+        unsigned row = 0;
+        for (auto v = vars.begin(); v != vars.end(); ++v)
+        {
+            // Skip duplicates
+            auto next = v + 1;
+            if (next != vars.end() && *v == *next)
+                continue;
+            v->id = ids[row++];
+            buf.start_row(7);
+            buf.add_int4(v->id);
+            buf.add_int4(id_station);
+            buf.add_timestamp(datetime);
+            buf.add_int4(v->id_levtr);
+            buf.add_int4(v->var->code());
+            buf.add_string(v->var->enqc());
+            if (with_attrs && v->var->next_attr())
+            {
+                core::value::Encoder enc;
+                enc.append_attributes(*v->var);
+                buf.add_bytea(enc.buf);
+            } else
+                buf.add_null();
+        }
+        buf.finish();
+
+        Tracer<> trc_ins(trc ? trc->trace_insert(copy_query, count) : nullptr);
+        conn.copy_from_stdin(copy_query, buf);
+        return;
+    }
+
     const Datetime& dt = datetime;
     char val_lead[64];
     snprintf(val_lead, 64, "(DEFAULT,%d,'%04d-%02d-%02d %02d:%02d:%02d',",
@@ -381,7 +687,6 @@ void PostgreSQLData::insert(Tracer<>& trc, int id_station, const Datetime& datet
     Querybuf dq(512);
     dq.append("INSERT INTO data (id, id_station, datetime, id_levtr, code, value, attrs) VALUES ");
     dq.start_list(",");
-    unsigned count = 0;
     for (auto v = vars.begin(); v != vars.end(); ++v)
     {
         // Skip duplicates
@@ -404,7 +709,6 @@ void PostgreSQLData::insert(Tracer<>& trc, int id_station, const Datetime& datet
         } else
             dq.append("NULL::bytea");
         dq.append(")");
-        ++count;
     }
     dq.append(" RETURNING id");
 
@@ -429,7 +733,6 @@ void PostgreSQLData::insert(Tracer<>& trc, int id_station, const Datetime& datet
 void PostgreSQLData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-    using namespace dballe::sql::postgresql;
 
     // Start the query asynchronously
     int res;
@@ -446,40 +749,15 @@ void PostgreSQLData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& q
     dballe::DBStation station;
     conn.run_single_row_mode(qb.sql_query, [&](const Result& res) {
         if (trc_sel) trc_sel->add_row(res.rowcount());
-        for (unsigned row = 0; row < res.rowcount(); ++row)
-        {
-            wreport::Varcode code = res.get_int4(row, 6);
-            const char* value = res.get_string(row, 9);
-            auto var = newvar(code, value);
-            if (qb.select_attrs)
-                core::value::Decoder::decode_attrs(res.get_bytea(row, 10), *var);
-
-            // Postprocessing filter of attr_filter
-            if (qb.attr_filter && !qb.match_attrs(*var))
-                return;
-
-            int id_station = res.get_int4(row, 0);
-            if (id_station != station.id)
-            {
-                station.id = id_station;
-                station.report = tr.repinfo().get_rep_memo(res.get_int4(row, 1));
-                station.coords.lat = res.get_int4(row, 2);
-                station.coords.lon = res.get_int4(row, 3);
-                if (res.is_null(row, 4))
-                    station.ident.clear();
-                else
-                    station.ident = res.get_string(row, 4);
-            }
-
-            int id_levtr = res.get_int4(row, 5);
-            int id_data = res.get_int4(row, 7);
-            Datetime datetime = res.get_timestamp(row, 8);
-
-            dest(station, id_levtr, datetime, id_data, move(var));
-        }
+        read_data_rows(tr, trc_sel, qb, res, station, dest);
     });
 }
 
+std::unique_ptr<DataStream> PostgreSQLData::stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<DataStream>(new PostgreSQLDataStream(tr, conn, trc, qb));
+}
+
 void PostgreSQLData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)> dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -532,6 +810,56 @@ void PostgreSQLData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuil
     });
 }
 
+void PostgreSQLData::summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added)
+{
+    // Prepared on first use, since the table may not exist yet when the
+    // transaction starts
+    conn.prepare("data_summaryv7_add", R"(
+        INSERT INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count)
+             VALUES ($1::int4, $2::int4, $3::int4, $4::timestamp, $5::timestamp, $6::int4)
+        ON CONFLICT (id_station, id_levtr, code) DO UPDATE
+                SET dtmin=LEAST(data_summary.dtmin, EXCLUDED.dtmin),
+                    dtmax=GREATEST(data_summary.dtmax, EXCLUDED.dtmax),
+                    count=data_summary.count + EXCLUDED.count
+    )");
+    Tracer<> trc_ins(trc ? trc->trace_insert("data_summaryv7_add", 1) : nullptr);
+    conn.exec_prepared_no_data("data_summaryv7_add", (int32_t)key.id_station, (int32_t)key.id_levtr, (int32_t)key.code, added.dtmin, added.dtmax, (int32_t)added.count);
+}
+
+void PostgreSQLData::summary_remove_by_id(Tracer<>& trc, int id_data)
+{
+    conn.prepare("data_summaryv7_key", "SELECT id_station, id_levtr, code FROM data WHERE id=$1::int4");
+    Tracer<> trc_sel(trc ? trc->trace_select("data_summaryv7_key") : nullptr);
+    auto res = conn.exec_prepared("data_summaryv7_key", (int32_t)id_data);
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+        summary_changes.remove(res.get_int4(row, 0), res.get_int4(row, 1), res.get_int4(row, 2));
+    if (trc_sel) trc_sel->add_row(res.rowcount());
+}
+
+void PostgreSQLData::summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations)
+{
+    Querybuf ids;
+    ids.start_list(",");
+    for (int id: id_stations)
+        ids.append_listf("%d", id);
+
+    Querybuf dq;
+    dq.appendf("DELETE FROM data_summary WHERE id_station IN (%s)", ids.c_str());
+    Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+    conn.exec_no_data(dq);
+
+    Querybuf iq;
+    iq.appendf(R"(
+        INSERT INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count)
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+              WHERE id_station IN (%s)
+           GROUP BY id_station, id_levtr, code
+    )", ids.c_str());
+    Tracer<> trc_ins(trc ? trc->trace_insert(iq) : nullptr);
+    conn.exec_no_data(iq);
+}
+
 
 void PostgreSQLData::dump(FILE* out)
 {
@@ -4,6 +4,8 @@
 #include <dballe/db/v7/data.h>
 #include <dballe/db/v7/cache.h>
 #include <dballe/sql/fwd.h>
+#include <set>
+#include <string>
 
 namespace dballe {
 namespace db {
@@ -20,7 +22,12 @@ protected:
     std::string select_attrs_query_name;
     std::string write_attrs_query_name;
     std::string remove_attrs_query_name;
-    std::string remove_data_query_name;
+
+    /**
+     * Allocate count new IDs from the sequence of the id column, to be used
+     * for rows inserted with COPY
+     */
+    std::vector<int> reserve_ids(Tracer<>& trc, unsigned count);
 
 public:
     PostgreSQLDataCommon(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn);
@@ -50,23 +57,42 @@ public:
     void query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs) override;
     void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<StationDataStream> stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
 
 class PostgreSQLData : public PostgreSQLDataCommon<Data>
 {
+protected:
+    /// True if the data table is partitioned by month
+    bool partitioned = false;
+    /// Months (as year * 100 + month) whose partition is known to exist
+    std::set<int> partitions;
+
+    /// Create, if missing, the partition of the data table for dt
+    void ensure_partition(Tracer<>& trc, const Datetime& dt);
+
+    void summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added) override;
+    void summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations) override;
+
 public:
     using PostgreSQLDataCommon::PostgreSQLDataCommon;
 
-    PostgreSQLData(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn);
+    PostgreSQLData(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn, bool partitioned=false);
+
+    void summary_remove_by_id(Tracer<>& trc, int id_data) override;
 
     void query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) override;
     void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<DataStream> stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)>) override;
     void dump(FILE* out) override;
-    void clear_cache() override {}
+    void clear_cache() override { partitions.clear(); }
+
+    /// Name of the partition of the data table for the given month
+    static std::string partition_name(int year, int month);
 };
 
 }
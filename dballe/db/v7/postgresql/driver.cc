@@ -7,14 +7,18 @@
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/qbuilder.h"
 #include "dballe/sql/postgresql.h"
+#include "dballe/sql/querybuf.h"
 #include "dballe/var.h"
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 using namespace std;
 using namespace wreport;
 using dballe::sql::PostgreSQLConnection;
 using dballe::sql::error_postgresql;
+using dballe::sql::Querybuf;
 
 namespace dballe {
 namespace db {
@@ -24,6 +28,7 @@ namespace postgresql {
 Driver::Driver(PostgreSQLConnection& conn)
     : v7::Driver(conn), conn(conn)
 {
+    partitioned_data = conn.get_setting("data_partitioning") == "month";
 }
 
 Driver::~Driver()
@@ -52,7 +57,7 @@ std::unique_ptr<v7::StationData> Driver::create_station_data(v7::Transaction& tr
 
 std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
 {
-    return unique_ptr<v7::Data>(new PostgreSQLData(tr, conn));
+    return unique_ptr<v7::Data>(new PostgreSQLData(tr, conn, partitioned_data));
 }
 
 void Driver::create_tables_v7()
@@ -81,6 +86,7 @@ void Driver::create_tables_v7()
     )");
     conn.exec_no_data("CREATE UNIQUE INDEX pa_uniq ON station(rep, lat, lon, ident);");
     conn.exec_no_data("CREATE INDEX pa_lon ON station(lon);");
+    conn.exec_no_data("CREATE INDEX pa_latlon ON station USING GIST ((point(lon, lat)));");
 
     conn.exec_no_data(R"(
         CREATE TABLE levtr (
@@ -107,31 +113,50 @@ void Driver::create_tables_v7()
     )");
     conn.exec_no_data("CREATE UNIQUE INDEX station_data_uniq on station_data(id_station, code);");
 
-    conn.exec_no_data(R"(
-        CREATE TABLE data (
-           id          SERIAL PRIMARY KEY,
+    // A partitioned data table has a partition for each month, created when
+    // data is first inserted in it. Its primary key needs to include the
+    // partition key
+    partitioned_data = getenv("DBA_POSTGRESQL_PARTITIONED") != nullptr;
+    const char* data_columns = R"(
            id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
            id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
            datetime    TIMESTAMP NOT NULL,
            code        INTEGER NOT NULL,
            value       VARCHAR(255) NOT NULL,
            attrs       BYTEA
-        );
-    )");
+    )";
+    if (partitioned_data)
+        conn.exec_no_data(string("CREATE TABLE data (id SERIAL NOT NULL,") + data_columns
+                + ", PRIMARY KEY (id, datetime)) PARTITION BY RANGE (datetime)");
+    else
+        conn.exec_no_data(string("CREATE TABLE data (id SERIAL PRIMARY KEY,") + data_columns + ")");
     conn.exec_no_data("CREATE UNIQUE INDEX data_uniq on data(id_station, datetime, id_levtr, code);");
     // When possible, replace with a postgresql 9.5 BRIN index
     conn.exec_no_data("CREATE INDEX data_dt ON data(datetime);");
+    if (partitioned_data)
+        conn.set_setting("data_partitioning", "month");
+
+    data_summary = 0;
+    create_data_summary_v7();
 
+    conn.set_setting("station_spatial_index", "gist");
+    station_spatial_index = 1;
     conn.set_setting("version", "V7");
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("data_summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
     conn.drop_table_if_exists("station");
     conn.drop_table_if_exists("repinfo");
+    conn.exec_no_data("DROP FUNCTION IF EXISTS dballe_set_ivalue()");
     conn.drop_settings();
+    partitioned_data = false;
+    station_spatial_index = -1;
+    typed_values = -1;
+    data_summary = -1;
 }
 void Driver::vacuum_v7()
 {
@@ -156,8 +181,139 @@ void Driver::vacuum_v7()
          LEFT JOIN data d ON d.id_station = p.id
              WHERE d.id is NULL)
     )");
+    create_data_summary_v7();
 }
 
+void Driver::create_data_covering_index_v7()
+{
+    conn.exec_no_data("CREATE INDEX IF NOT EXISTS data_cover ON data(id_station, datetime, id_levtr, code, id, value)");
+}
+
+void Driver::create_typed_values_v7()
+{
+    if (has_typed_values()) return;
+
+    // value holds the scaled integer of numeric variables, which has at most
+    // 18 digits and fits in a 64 bit BIGINT: longer strings of digits are
+    // string variables
+    conn.exec_no_data(R"(
+        CREATE OR REPLACE FUNCTION dballe_set_ivalue() RETURNS trigger AS $$
+        BEGIN
+            NEW.ivalue := CASE WHEN NEW.value ~ '^-?[0-9]{1,18}$' THEN NEW.value::bigint END;
+            RETURN NEW;
+        END;
+        $$ LANGUAGE plpgsql
+    )");
+    for (const char* table: { "data", "station_data" })
+    {
+        conn.exec_no_data(string("ALTER TABLE ") + table + " ADD COLUMN ivalue BIGINT");
+        conn.exec_no_data(string("UPDATE ") + table + " SET ivalue=value::bigint WHERE value ~ '^-?[0-9]{1,18}$'");
+        // PostgreSQL before 13 cannot have BEFORE row triggers on a
+        // partitioned table: create the trigger on each partition instead.
+        // PostgreSQLData::ensure_partition adds it to new partitions
+        std::vector<std::string> trigger_tables;
+        if (partitioned_data && strcmp(table, "data") == 0)
+        {
+            sql::postgresql::Result res = conn.exec("SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid WHERE i.inhparent = 'data'::regclass");
+            for (unsigned row = 0; row < res.rowcount(); ++row)
+                trigger_tables.emplace_back(res.get_string(row, 0));
+        } else
+            trigger_tables.emplace_back(table);
+        for (const auto& name: trigger_tables)
+            conn.exec_no_data("CREATE TRIGGER " + name + "_ivalue BEFORE INSERT OR UPDATE OF value ON " + name
+                    + " FOR EACH ROW EXECUTE PROCEDURE dballe_set_ivalue()");
+        conn.exec_no_data(string("CREATE INDEX ") + table + "_ivalue ON " + table + "(code, ivalue)");
+    }
+
+    conn.set_setting("typed_values", "ivalue");
+    typed_values = 1;
+}
+
+void Driver::create_data_summary_v7()
+{
+    if (has_data_summary()) return;
+
+    conn.exec_no_data(R"(
+        CREATE TABLE data_summary (
+           id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
+           id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
+           code        INTEGER NOT NULL,
+           dtmin       TIMESTAMP NOT NULL,
+           dtmax       TIMESTAMP NOT NULL,
+           count       INTEGER NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        )
+    )");
+    conn.exec_no_data(R"(
+        INSERT INTO data_summary
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+           GROUP BY id_station, id_levtr, code
+    )");
+
+    conn.set_setting("data_summary", "table");
+    data_summary = 1;
+}
+
+
+unsigned Driver::drop_data_partitions_v7(const Datetime& before)
+{
+    using namespace dballe::sql::postgresql;
+
+    if (!partitioned_data)
+        throw error_consistency("the data table is not partitioned");
+
+    Result res = conn.exec(R"(
+        SELECT c.relname
+          FROM pg_inherits i
+          JOIN pg_class c ON c.oid = i.inhrelid
+         WHERE i.inhparent = 'data'::regclass
+      ORDER BY c.relname
+    )");
+
+    unsigned dropped = 0;
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+    {
+        const char* name = res.get_string(row, 0);
+        int year, month;
+        if (strlen(name) != 11 || sscanf(name, "data_%4d%2d", &year, &month) != 2)
+            continue;
+        // Keep the partition if it ends after before
+        Datetime end = month == 12 ? Datetime(year + 1, 1, 1) : Datetime(year, month + 1, 1);
+        if (end > before)
+            continue;
+
+        // Take the values in the partition out of the summary
+        if (has_data_summary())
+            conn.exec_no_data(string(R"(
+                UPDATE data_summary s
+                   SET count = s.count - p.count
+                  FROM (SELECT id_station, id_levtr, code, COUNT(*) AS count
+                          FROM )") + name + R"(
+                      GROUP BY id_station, id_levtr, code) p
+                 WHERE s.id_station = p.id_station AND s.id_levtr = p.id_levtr AND s.code = p.code
+            )");
+        conn.exec_no_data(string("DROP TABLE ") + name);
+        ++dropped;
+    }
+
+    if (dropped && has_data_summary())
+    {
+        conn.exec_no_data("DELETE FROM data_summary WHERE count <= 0");
+        // The values left are all after the dropped partitions: only the
+        // minimum datetimes may need updating
+        Querybuf qb;
+        qb.append(R"(
+            UPDATE data_summary s
+               SET dtmin = (SELECT MIN(d.datetime) FROM data d
+                             WHERE d.id_station = s.id_station AND d.id_levtr = s.id_levtr AND d.code = s.code)
+             WHERE s.dtmin < )");
+        conn.add_datetime(qb, before);
+        conn.exec_no_data(qb);
+    }
+
+    return dropped;
+}
 }
 }
 }
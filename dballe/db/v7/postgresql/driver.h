@@ -12,6 +12,8 @@ namespace postgresql {
 struct Driver : public v7::Driver
 {
     dballe::sql::PostgreSQLConnection& conn;
+    /// True if the data table is partitioned by month
+    bool partitioned_data = false;
 
     Driver(dballe::sql::PostgreSQLConnection& conn);
     virtual ~Driver();
@@ -24,6 +26,10 @@ struct Driver : public v7::Driver
     void create_tables_v7() override;
     void delete_tables_v7() override;
     void vacuum_v7() override;
+    void create_data_covering_index_v7() override;
+    void create_typed_values_v7() override;
+    void create_data_summary_v7() override;
+    unsigned drop_data_partitions_v7(const Datetime& before) override;
 };
 
 }
@@ -58,7 +58,7 @@ PostgreSQLLevTr::~PostgreSQLLevTr()
 {
 }
 
-void PostgreSQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void PostgreSQLLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty()) return;
 
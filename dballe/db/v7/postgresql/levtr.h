@@ -23,6 +23,7 @@ protected:
     dballe::sql::PostgreSQLConnection& conn;
 
     void _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
 
 public:
     PostgreSQLLevTr(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn);
@@ -31,7 +32,6 @@ public:
     PostgreSQLLevTr& operator=(const PostgreSQLLevTr&) = delete;
     ~PostgreSQLLevTr();
 
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& ids) override;
     const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
     int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
@@ -16,7 +16,6 @@ namespace postgresql {
 PostgreSQLRepinfo::PostgreSQLRepinfo(PostgreSQLConnection& conn)
     : Repinfo(conn), conn(conn)
 {
-    read_cache();
 }
 
 PostgreSQLRepinfo::~PostgreSQLRepinfo()
@@ -111,7 +111,9 @@ int PostgreSQLStation::insert_new(Tracer<>& trc, const dballe::DBStation& desc)
     // If no station was found, insert a new one
     int rep = tr.repinfo().get_id(desc.report.c_str());
     Tracer<> trc_ins(trc ? trc->trace_insert("v7_station_insert", 1) : nullptr);
-    return conn.exec_prepared_one_row("v7_station_insert", rep, desc.coords.lat, desc.coords.lon, desc.ident.get()).get_int4(0, 0);
+    int id = conn.exec_prepared_one_row("v7_station_insert", rep, desc.coords.lat, desc.coords.lon, desc.ident.get()).get_int4(0, 0);
+    cache.insert(desc, id);
+    return id;
 }
 
 void PostgreSQLStation::get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest)
@@ -150,6 +152,30 @@ void PostgreSQLStation::add_station_vars(Tracer<>& trc, int id_station, DBValues
         values.set(newvar((Varcode)res.get_int4(row, 0), res.get_string(row, 1)));
 }
 
+void PostgreSQLStation::run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest)
+{
+    using namespace dballe::sql::postgresql;
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_station_vars_query) : nullptr);
+
+    // Start the query asynchronously
+    int res;
+    if (qb.bind_in_ident)
+    {
+        const char* args[1] = { qb.bind_in_ident };
+        res = PQsendQueryParams(conn, qb.sql_station_vars_query.c_str(), 1, nullptr, args, nullptr, nullptr, 1);
+    } else {
+        res = PQsendQueryParams(conn, qb.sql_station_vars_query.c_str(), 0, nullptr, nullptr, nullptr, nullptr, 1);
+    }
+    if (!res)
+        throw sql::error_postgresql(conn, "executing " + qb.sql_station_vars_query);
+
+    conn.run_single_row_mode(qb.sql_station_vars_query, [&](const Result& res) {
+        if (trc_sel) trc_sel->add_row(res.rowcount());
+        for (unsigned row = 0; row < res.rowcount(); ++row)
+            dest(res.get_int4(row, 0), newvar((Varcode)res.get_int4(row, 1), res.get_string(row, 2)));
+    });
+}
+
 void PostgreSQLStation::run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)> dest)
 {
     using namespace dballe::sql::postgresql;
@@ -3,9 +3,12 @@
 #include "dballe/core/defs.h"
 #include "dballe/core/aliases.h"
 #include "dballe/core/query.h"
+#include "dballe/core/values.h"
 #include "dballe/core/varmatch.h"
 #include "dballe/var.h"
 #include "dballe/db/v7/repinfo.h"
+#include "dballe/db/v7/driver.h"
+#include "dballe/db/v7/db.h"
 #include "dballe/sql/sql.h"
 #include <wreport/var.h>
 #include <regex.h>
@@ -43,7 +46,7 @@ static Varcode parse_varcode(const char* str, regmatch_t pos)
     return res;
 }
 
-static void parse_value(const char* str, regmatch_t pos, Varinfo info, char* value)
+static std::string parse_value(const char* str, regmatch_t pos, Varinfo info)
 {
     /* Parse the value */
     const char* s = str + pos.rm_so;
@@ -53,18 +56,17 @@ static void parse_value(const char* str, regmatch_t pos, Varinfo info, char* val
         case Vartype::String:
         {
             // Copy the string, escaping quotes
-            int i = 0, j = 0;
-
-            value[j++] = '\'';
-            for (; i < len && j < 253; ++i, ++j)
+            std::string value;
+            value.reserve(len + 2);
+            value += '\'';
+            for (int i = 0; i < len; ++i)
             {
                 if (s[i] == '\'')
-                    value[j++] = '\\';
-                value[j] = s[i];
+                    value += '\\';
+                value += s[i];
             }
-            value[j++] = '\'';
-            value[j] = 0;
-            break;
+            value += '\'';
+            return value;
         }
         case Vartype::Binary:
             throw error_consistency("cannot use a *_filter on a binary variable");
@@ -74,41 +76,35 @@ static void parse_value(const char* str, regmatch_t pos, Varinfo info, char* val
             double dval;
             if (sscanf(s, "%lf", &dval) != 1)
                 error_consistency::throwf("value in \"%.*s\" must be a number", len, s);
-            sprintf(value, "%d", info->encode_decimal(dval));
-            break;
+            return std::to_string(info->encode_decimal(dval));
         }
     }
+    error_consistency::throwf("cannot use a *_filter on a variable of unknown type");
 }
 
-static Varinfo decode_data_filter(const std::string& filter, const char** op, const char** val, const char** val1)
+static regex_t* compile_filter_regex(const char* re, const char* what)
 {
-    static regex_t* re_normal = NULL;
-    static regex_t* re_between = NULL;
-    regmatch_t matches[4];
+    std::unique_ptr<regex_t> res(new regex_t);
+    if (int err = regcomp(res.get(), re, REG_EXTENDED))
+        error_regexp::throwf(err, res.get(), "compiling regular expression to match %s filters", what);
+    return res.release();
+}
 
-    static char oper[5];
-    static char value[255];
-    static char value1[255];
-#if 0
-    size_t len = strcspn(filter, "<=>");
-    const char* s = filter + len;
-#endif
+/**
+ * Parse a data filter.
+ *
+ * op is set to the SQL comparison operator, and val to the SQL value to
+ * compare with. For 'between' filters, op is empty and val and val1 are the
+ * two extremes; otherwise val1 is empty.
+ */
+static Varinfo decode_data_filter(const std::string& filter, std::string& op, std::string& val, std::string& val1)
+{
+    // Compiled once, with thread safe initialization
+    static regex_t* re_normal = compile_filter_regex("^([^<=>]+)([<=>]+)([^<=>]+)$", "normal");
+    static regex_t* re_between = compile_filter_regex("^([^<=>]+)<=([^<=>]+)<=([^<=>]+)$", "'between'");
+    regmatch_t matches[4];
     Varcode code;
 
-    /* Compile the regular expression if it has not yet been done */
-    if (re_normal == NULL)
-    {
-        re_normal = new regex_t;
-        if (int res = regcomp(re_normal, "^([^<=>]+)([<=>]+)([^<=>]+)$", REG_EXTENDED))
-            throw error_regexp(res, re_normal, "compiling regular expression to match normal filters");
-    }
-    if (re_between == NULL)
-    {
-        re_between = new regex_t;
-        if (int res = regcomp(re_between, "^([^<=>]+)<=([^<=>]+)<=([^<=>]+)$", REG_EXTENDED))
-            throw error_regexp(res, re_between, "compiling regular expression to match 'between' filters");
-    }
-
     int res = regexec(re_normal, filter.c_str(), 4, matches, 0);
     if (res != 0 && res != REG_NOMATCH)
         error_regexp::throwf(res, re_normal, "Trying to parse '%s' as a 'normal' filter", filter.c_str());
@@ -126,19 +122,15 @@ static Varinfo decode_data_filter(const std::string& filter, const char** op, co
         len = matches[2].rm_eo - matches[2].rm_so;
         if (len > 4)
             error_consistency::throwf("operator %.*s is not valid", len, filter.c_str() + matches[2].rm_so);
-        memcpy(oper, filter.c_str() + matches[2].rm_so, len);
-        oper[len] = 0;
-        if (strcmp(oper, "!=") == 0)
-            *op = "<>";
-        else if (strcmp(oper, "==") == 0)
-            *op = "=";
-        else
-            *op = oper;
+        op.assign(filter, matches[2].rm_so, len);
+        if (op == "!=")
+            op = "<>";
+        else if (op == "==")
+            op = "=";
 
         /* Parse the value */
-        parse_value(filter.c_str(), matches[3], info, value);
-        *val = value;
-        *val1 = NULL;
+        val = parse_value(filter.c_str(), matches[3], info);
+        val1.clear();
         return info;
     }
     else
@@ -147,7 +139,7 @@ static Varinfo decode_data_filter(const std::string& filter, const char** op, co
         if (res == REG_NOMATCH)
             error_consistency::throwf("%s is not a valid filter", filter.c_str());
         if (res != 0)
-            error_regexp::throwf(res, re_normal, "Trying to parse '%s' as a 'between' filter", filter.c_str());
+            error_regexp::throwf(res, re_between, "Trying to parse '%s' as a 'between' filter", filter.c_str());
 
         /* We have a between filter */
 
@@ -156,13 +148,10 @@ static Varinfo decode_data_filter(const std::string& filter, const char** op, co
         /* Query informations for the varcode */
         Varinfo info = varinfo(code);
         /* No need to parse the operator */
-        oper[0] = 0;
-        *op = oper;
+        op.clear();
         /* Parse the values */
-        parse_value(filter.c_str(), matches[1], info, value);
-        parse_value(filter.c_str(), matches[3], info, value1);
-        *val = value;
-        *val1 = value1;
+        val = parse_value(filter.c_str(), matches[1], info);
+        val1 = parse_value(filter.c_str(), matches[3], info);
         return info;
     }
 }
@@ -206,6 +195,56 @@ struct Constraints
         found = true;
     }
 
+    /**
+     * Narrow down a lat/lon range query using the station spatial index.
+     *
+     * This only preselects candidate stations: the exact comparisons are
+     * still added by add_lat and add_lon.
+     */
+    void add_bbox(ServerType server_type)
+    {
+        bool has_lat = !query.latrange.is_missing() && query.latrange.imin != query.latrange.imax;
+        bool has_lon = !query.lonrange.is_missing() && query.lonrange.imin != query.lonrange.imax;
+        if (!has_lat && !has_lon) return;
+
+        int latmin = has_lat ? query.latrange.imin : LatRange::IMIN;
+        int latmax = has_lat ? query.latrange.imax : LatRange::IMAX;
+        int lonmin = has_lon ? query.lonrange.imin : -18000000;
+        int lonmax = has_lon ? query.lonrange.imax : 18000000;
+
+        // Ranges across the antimeridian are looked up as two boxes
+        std::vector<std::pair<int, int>> lons;
+        if (lonmin <= lonmax)
+            lons.emplace_back(lonmin, lonmax);
+        else
+        {
+            lons.emplace_back(lonmin, 18000000);
+            lons.emplace_back(-18000000, lonmax);
+        }
+
+        if (server_type == ServerType::POSTGRES)
+        {
+            q.append_list("(");
+            for (auto i = lons.begin(); i != lons.end(); ++i)
+            {
+                if (i != lons.begin()) q.append(" OR ");
+                q.appendf("point(%s.lon, %s.lat) <@ box(point(%d, %d), point(%d, %d))",
+                        tbl, tbl, i->first, latmin, i->second, latmax);
+            }
+            q.append(")");
+        } else if (server_type == ServerType::SQLITE) {
+            q.append_listf("%s.id IN (SELECT id FROM station_rtree WHERE maxlat>=%d AND minlat<=%d AND (", tbl, latmin, latmax);
+            for (auto i = lons.begin(); i != lons.end(); ++i)
+            {
+                if (i != lons.begin()) q.append(" OR ");
+                q.appendf("(maxlon>=%d AND minlon<=%d)", i->first, i->second);
+            }
+            q.append("))");
+        } else
+            return;
+        found = true;
+    }
+
     void add_mobile()
     {
         if (query.mobile != MISSING_INT)
@@ -224,13 +263,15 @@ struct Constraints
 };
 
 QueryBuilder::QueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
-    : conn(*tr->db->conn), tr(tr), query(query), sql_query(2048), sql_from(1024), sql_where(1024),
+    : conn(*tr->conn), tr(tr), query(query), sql_query(2048), sql_from(1024), sql_where(1024),
       modifiers(modifiers), query_station_vars(query_station_vars)
 {
 }
 
 DataQueryBuilder::DataQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
-    : QueryBuilder(tr, query, modifiers, query_station_vars), query_attrs(modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES)
+    : QueryBuilder(tr, query, modifiers, query_station_vars),
+      sql_attr_filter(!query.attr_filter.empty() && conn.server_type == ServerType::SQLITE),
+      query_attrs(modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES)
 {
 }
 
@@ -273,6 +314,26 @@ void QueryBuilder::build()
         sql_query.appendf(" LIMIT %d", query.limit);
 }
 
+void StationQueryBuilder::build()
+{
+    QueryBuilder::build();
+
+    if (!(modifiers & DBA_DB_MODIFIER_STATION_VARS))
+        return;
+
+    // Select the station variables of the same stations: in case of LIMIT,
+    // this also selects variables of stations that are not in the results,
+    // which are then skipped when merging
+    sql_station_vars_query.append("SELECT s.id, d.code, d.value");
+    sql_station_vars_query.append(sql_from);
+    sql_station_vars_query.append(" JOIN station_data d ON d.id_station=s.id");
+    if (!sql_where.empty())
+    {
+        sql_station_vars_query.append(" WHERE ");
+        sql_station_vars_query.append(sql_where);
+    }
+}
+
 void StationQueryBuilder::build_select()
 {
     sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident");
@@ -344,11 +405,12 @@ void DataQueryBuilder::build_select()
         sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.code, d.id, d.value");
     else
         sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.id_levtr, d.code, d.id, d.datetime, d.value");
-    if (query_attrs || !query.attr_filter.empty())
+    bool filter_results = !query.attr_filter.empty() && !sql_attr_filter;
+    if (query_attrs || filter_results)
     {
         sql_query.append(", d.attrs");
         select_attrs = true;
-        if (!query.attr_filter.empty())
+        if (filter_results)
         {
             delete attr_filter;
             attr_filter = Varmatch::parse(query.attr_filter).release();
@@ -383,46 +445,34 @@ bool DataQueryBuilder::build_where()
     has_where = add_varcode_where("d") || has_where;
     has_where = add_repinfo_where("s") || has_where;
     has_where = add_datafilter_where("d") || has_where;
-    //has_where = add_attrfilter_where("d") || has_where;
+    has_where = add_attrfilter_where("d") || has_where;
 
     return has_where;
 }
 
-bool DataQueryBuilder::match_attrs(const Var& var) const
+bool DataQueryBuilder::match_attrs(const std::vector<uint8_t>& attrs) const
 {
-    for (const Var* a = var.next_attr(); a != NULL; a = a->next_attr())
-        if ((*attr_filter)(*a))
-            return true;
-    return false;
+    return core::value::Decoder::match_attrs(attrs, *attr_filter);
 }
 
-#if 0
 bool DataQueryBuilder::add_attrfilter_where(const char* tbl)
 {
-    if (query.attr_filter.empty()) return false;
-
-    const char *op, *value, *value1;
-    Varinfo info = decode_data_filter(query.attr_filter, &op, &value, &value1);
+    if (!sql_attr_filter) return false;
 
-    const char* atbl = query_station_vars ? "station_attr" : "attr";
-
-    sql_from.appendf(" JOIN %s %s_atf ON %s.id=%s_atf.id_data AND %s_atf.code=%d", atbl, tbl, tbl, tbl, tbl, info->code);
-    if (value[0] == '\'')
-        if (value1 == NULL)
-            sql_where.append_listf("%s_atf.value%s%s", tbl, op, value);
-        else
-            sql_where.append_listf("%s_atf.value BETWEEN %s AND %s", tbl, value, value1);
-    else
+    // Quote the filter as an SQL string literal
+    string quoted("'");
+    for (auto c: query.attr_filter)
     {
-        const char* type = (conn.server_type == ServerType::MYSQL) ? "SIGNED" : "INT";
-        if (value1 == NULL)
-            sql_where.append_listf("CAST(%s_atf.value AS %s)%s%s", tbl, type, op, value);
-        else
-            sql_where.append_listf("CAST(%s_atf.value AS %s) BETWEEN %s AND %s", tbl, type, value, value1);
+        if (c == '\'') quoted += '\'';
+        quoted += c;
     }
+    quoted += '\'';
+
+    // The filter is parsed once per query, and matched on the encoded
+    // attributes without decoding them
+    sql_where.append_listf("dballe_attr_match(%s.attrs, %s)", tbl, quoted.c_str());
     return true;
 }
-#endif
 
 void DataQueryBuilder::build_order_by()
 {
@@ -445,10 +495,12 @@ void DataQueryBuilder::build_order_by()
 void IdQueryBuilder::build_select()
 {
     sql_query.append("SELECT d.id");
-    if (!query.attr_filter.empty())
+    if (!query.attr_filter.empty() && !sql_attr_filter)
     {
         sql_query.append(", d.attrs");
         select_attrs = true;
+        delete attr_filter;
+        attr_filter = Varmatch::parse(query.attr_filter).release();
     }
     select_data_id = true;
     sql_from.append(" FROM station s");
@@ -472,8 +524,20 @@ void SummaryQueryBuilder::build_select()
     if (!query.attr_filter.empty())
         throw error_consistency("attr_filter is not supported on summary queries");
 
-    if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
+    use_data_summary = !query_station_vars && query.dtrange.is_missing() && query.data_filter.empty()
+                    && tr->driver().has_data_summary();
+
+    if (use_data_summary)
     {
+        // data_summary has one row per station, levtr and varcode, with
+        // count and datetime range already computed
+        if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
+        {
+            sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.id_levtr, d.code, d.count, d.dtmin, d.dtmax");
+            select_summary_details = true;
+        } else
+            sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.id_levtr, d.code");
+    } else if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS) {
         if (query_station_vars)
             sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.code, COUNT(1)");
         else
@@ -502,7 +566,7 @@ void SummaryQueryBuilder::build_select()
         sql_from.append(" JOIN station_data d ON s.id = d.id_station");
     else
     {
-        sql_from.append(" JOIN data d ON s.id = d.id_station");
+        sql_from.append(use_data_summary ? " JOIN data_summary d ON s.id = d.id_station" : " JOIN data d ON s.id = d.id_station");
         sql_from.append(" JOIN levtr ltr ON ltr.id=d.id_levtr");
     }
 }
@@ -510,6 +574,13 @@ void SummaryQueryBuilder::build_select()
 void SummaryQueryBuilder::build_order_by()
 {
     // No ordering required, but we may add a GROUP BY
+    if (use_data_summary)
+    {
+        // Rows are already grouped: sort them as GROUP BY would, which is
+        // the order of the data_summary primary key
+        sql_query.append(" ORDER BY s.id, d.id_levtr, d.code");
+        return;
+    }
     if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
     {
         if (query_station_vars)
@@ -530,6 +601,8 @@ bool QueryBuilder::add_pa_where(const char* tbl)
     }
     c.add_lat();
     c.add_lon();
+    if (tr->driver().has_station_spatial_index())
+        c.add_bbox(conn.server_type);
     c.add_mobile();
     if (!query.ident.is_missing())
     {
@@ -573,24 +646,31 @@ bool QueryBuilder::add_pa_where(const char* tbl)
     }
     if (!query.ana_filter.empty())
     {
-        const char *op, *value, *value1;
-        Varinfo info = decode_data_filter(query.ana_filter, &op, &value, &value1);
+        std::string op, value, value1;
+        Varinfo info = decode_data_filter(query.ana_filter, op, value, value1);
 
         sql_where.append_listf("EXISTS(SELECT id FROM station_data %s_af WHERE %s_af.id_station=%s.id"
                                " AND %s_af.code=%d", tbl, tbl, tbl, tbl, info->code);
 
         if (value[0] == '\'')
-            if (value1 == NULL)
-                sql_where.appendf(" AND %s_af.value%s%s)", tbl, op, value);
+            if (value1.empty())
+                sql_where.appendf(" AND %s_af.value%s%s)", tbl, op.c_str(), value.c_str());
+            else
+                sql_where.appendf(" AND %s_af.value BETWEEN %s AND %s)", tbl, value.c_str(), value1.c_str());
+        else if (tr->driver().has_typed_values())
+        {
+            if (value1.empty())
+                sql_where.appendf(" AND %s_af.ivalue%s%s)", tbl, op.c_str(), value.c_str());
             else
-                sql_where.appendf(" AND %s_af.value BETWEEN %s AND %s)", tbl, value, value1);
+                sql_where.appendf(" AND %s_af.ivalue BETWEEN %s AND %s)", tbl, value.c_str(), value1.c_str());
+        }
         else
         {
             const char* type = (conn.server_type == ServerType::MYSQL) ? "SIGNED" : "INT";
-            if (value1 == NULL)
-                sql_where.appendf(" AND CAST(%s_af.value AS %s)%s%s)", tbl, type, op, value);
+            if (value1.empty())
+                sql_where.appendf(" AND CAST(%s_af.value AS %s)%s%s)", tbl, type, op.c_str(), value.c_str());
             else
-                sql_where.appendf(" AND CAST(%s_af.value AS %s) BETWEEN %s AND %s)", tbl, type, value, value1);
+                sql_where.appendf(" AND CAST(%s_af.value AS %s) BETWEEN %s AND %s)", tbl, type, value.c_str(), value1.c_str());
         }
 
         c.found = true;
@@ -756,23 +836,32 @@ bool QueryBuilder::add_datafilter_where(const char* tbl)
 {
     if (query.data_filter.empty()) return false;
 
-    const char *op, *value, *value1;
-    Varinfo info = decode_data_filter(query.data_filter, &op, &value, &value1);
+    std::string op, value, value1;
+    Varinfo info = decode_data_filter(query.data_filter, op, value, value1);
 
     sql_where.append_listf("%s.code=%d", tbl, (int)info->code);
 
     if (value[0] == '\'')
-        if (value1 == NULL)
-            sql_where.append_listf("%s.value%s%s", tbl, op, value);
+        if (value1.empty())
+            sql_where.append_listf("%s.value%s%s", tbl, op.c_str(), value.c_str());
         else
-            sql_where.append_listf("%s.value BETWEEN %s AND %s", tbl, value, value1);
+            sql_where.append_listf("%s.value BETWEEN %s AND %s", tbl, value.c_str(), value1.c_str());
+    else if (tr->driver().has_typed_values())
+    {
+        // Compare with the typed copy of value, which can use the
+        // (code, ivalue) index
+        if (value1.empty())
+            sql_where.append_listf("%s.ivalue%s%s", tbl, op.c_str(), value.c_str());
+        else
+            sql_where.append_listf("%s.ivalue BETWEEN %s AND %s", tbl, value.c_str(), value1.c_str());
+    }
     else
     {
         const char* type = (conn.server_type == ServerType::MYSQL) ? "SIGNED" : "INT";
-        if (value1 == NULL)
-            sql_where.append_listf("CAST(%s.value AS %s)%s%s", tbl, type, op, value);
+        if (value1.empty())
+            sql_where.append_listf("CAST(%s.value AS %s)%s%s", tbl, type, op.c_str(), value.c_str());
         else
-            sql_where.append_listf("CAST(%s.value AS %s) BETWEEN %s AND %s", tbl, type, value, value1);
+            sql_where.append_listf("CAST(%s.value AS %s) BETWEEN %s AND %s", tbl, type, value.c_str(), value1.c_str());
     }
 
     return true;
@@ -62,7 +62,7 @@ struct QueryBuilder
     QueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars);
     virtual ~QueryBuilder() {}
 
-    void build();
+    virtual void build();
 
 protected:
     // Add WHERE conditions
@@ -80,9 +80,19 @@ protected:
 
 struct StationQueryBuilder : public QueryBuilder
 {
+    /**
+     * Query selecting id_station, code, value of the station variables of all
+     * the stations matched by sql_query.
+     *
+     * It is only built with DBA_DB_MODIFIER_STATION_VARS, and uses the same
+     * bound input parameters as sql_query.
+     */
+    dballe::sql::Querybuf sql_station_vars_query;
+
     StationQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers)
         : QueryBuilder(tr, query, modifiers, false) {}
 
+    void build() override;
     virtual void build_select();
     virtual bool build_where();
     virtual void build_order_by();
@@ -90,9 +100,18 @@ struct StationQueryBuilder : public QueryBuilder
 
 struct DataQueryBuilder : public QueryBuilder
 {
-    /// Attribute filter, if requested
+    /**
+     * Attribute filter, if requested and if it needs to be matched on the
+     * query results
+     */
     Varmatch* attr_filter = nullptr;
 
+    /**
+     * True if the attribute filter is matched by the SQL query, using the
+     * dballe_attr_match function registered by the SQLite driver
+     */
+    bool sql_attr_filter;
+
     /// True if we also query attributes of data
     bool query_attrs;
 
@@ -102,10 +121,10 @@ struct DataQueryBuilder : public QueryBuilder
     DataQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars);
     ~DataQueryBuilder();
 
-    // bool add_attrfilter_where(const char* tbl);
+    bool add_attrfilter_where(const char* tbl);
 
-    /// Match the attributes of var against attr_filter
-    bool match_attrs(const wreport::Var& var) const;
+    /// Match the encoded attributes of a value against attr_filter
+    bool match_attrs(const std::vector<uint8_t>& attrs) const;
 
     virtual void build_select();
     virtual bool build_where();
@@ -123,6 +142,15 @@ struct IdQueryBuilder : public DataQueryBuilder
 
 struct SummaryQueryBuilder : public DataQueryBuilder
 {
+    /**
+     * True if the query is answered from the data_summary table instead of
+     * grouping the data table.
+     *
+     * This is possible when the database has the table, and the query has no
+     * constraints on datetime or value, which the table does not store.
+     */
+    bool use_data_summary = false;
+
     SummaryQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
         : DataQueryBuilder(tr, query, modifiers, query_station_vars) {}
 
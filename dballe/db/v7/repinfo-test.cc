@@ -31,6 +31,11 @@ class Tests : public FixtureTestCase<EmptyTransactionFixture<DB>>
             wassert(actual(ri.get_rep_memo(1)) == "synop");
             wassert(actual(ri.get_priority("synop")) == 101);
             wassert(actual(ri.get_priority("wrong")) == INT_MAX);
+            wassert(actual(ri.get_priority_by_id(1)) == 101);
+            wassert(actual(ri.get_priority_by_id(255)) == 1000);
+            wassert(actual(ri.get_priority_by_id(-1)) == INT_MAX);
+            wassert(actual(ri.get_priority_by_id(254)) == INT_MAX);
+            wassert(actual(ri.get_priority_by_id(1000)) == INT_MAX);
         });
         // Test update
         this->add_method("update", [](Fixture& f) {
@@ -77,6 +82,7 @@ class Tests : public FixtureTestCase<EmptyTransactionFixture<DB>>
             wassert(actual(updated) == 2);
 
             wassert(actual(ri.get_priority("generic")) == -5);
+            wassert(actual(ri.get_priority_by_id(ri.get_id("generic"))) == -5);
         });
         // Test automatic repinfo creation
         this->add_method("fail2", [](Fixture& f) {
@@ -19,6 +19,11 @@ Repinfo::Repinfo(dballe::sql::Connection& conn)
 
 const char* Repinfo::get_rep_memo(int id)
 {
+    if (const repinfo::Cache* c = get_by_id(id))
+        return c->memo.c_str();
+    // The cache may come from a snapshot older than the database contents
+    read_cache();
+    snapshot = false;
     if (const repinfo::Cache* c = get_by_id(id))
         return c->memo.c_str();
     error_notfound::throwf("rep_memo not found for report code %d", id);
@@ -35,14 +40,21 @@ int Repinfo::get_id(const char* memo)
     if (memo_idx.empty()) rebuild_memo_idx();
 
     int pos = cache_find_by_memo(lc_memo);
+    if (pos == -1 && snapshot)
+    {
+        // The snapshot may be older than the database contents
+        read_cache();
+        snapshot = false;
+        if (memo_idx.empty()) rebuild_memo_idx();
+        pos = cache_find_by_memo(lc_memo);
+    }
     if (pos == -1) return -1;
     return memo_idx[pos].id;
 }
 
 int Repinfo::get_priority(const std::string& report)
 {
-    const repinfo::Cache* ri_entry = get_by_memo(report.c_str());
-    return ri_entry ? ri_entry->prio : INT_MAX;
+    return get_priority_by_id(get_id(report.c_str()));
 }
 
 std::map<std::string, int> Repinfo::get_priorities()
@@ -74,6 +86,14 @@ int Repinfo::obtain_id(const char* memo)
     return memo_idx[pos].id;
 }
 
+void Repinfo::load_cache(const std::vector<repinfo::Cache>& entries)
+{
+    cache = entries;
+    snapshot = true;
+    memo_idx.clear();
+    rebuild_memo_idx();
+}
+
 std::vector<int> Repinfo::ids_by_prio(const core::Query& q)
 {
     vector<int> res;
@@ -150,6 +170,7 @@ void Repinfo::cache_append(unsigned id, const char* memo, const char* desc, int
                 "is greather than the last value in che cache (%u)", id, (unsigned)cache.back().id);
 
     memo_idx.clear();
+    prio_idx.clear();
 
     /* Enlarge buffer if needed */
     cache.push_back(repinfo::Cache(id, memo, desc, prio, descriptor, tablea));
@@ -165,6 +186,13 @@ void Repinfo::rebuild_memo_idx() const
         memo_idx[i].id = cache[i].id;
     }
     std::sort(memo_idx.begin(), memo_idx.end());
+
+    // The cache is sorted by id, so the last entry has the highest one
+    prio_idx.clear();
+    if (cache.empty()) return;
+    prio_idx.resize(cache.back().id + 1, INT_MAX);
+    for (const auto& entry: cache)
+        prio_idx[entry.id] = entry.prio;
 }
 
 namespace {
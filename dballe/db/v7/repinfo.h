@@ -9,6 +9,7 @@
 
 #include <dballe/sql/fwd.h>
 #include <dballe/core/fwd.h>
+#include <climits>
 #include <memory>
 #include <map>
 #include <string>
@@ -84,9 +85,17 @@ struct Repinfo
     /// Get the ID for a given rep_memo; returns -1 if rep_memo is not valid
     int get_id(const char* rep_memo);
 
-    /// Get the priority for a given ID; returns INT_MAX if id is not valid
+    /// Get the priority for a given report name; returns INT_MAX if it is not valid
     int get_priority(const std::string& report);
 
+    /// Get the priority for a given report ID; returns INT_MAX if id is not valid
+    int get_priority_by_id(int id) const
+    {
+        if (prio_idx.empty()) rebuild_memo_idx();
+        if (id < 0 || (unsigned)id >= prio_idx.size()) return INT_MAX;
+        return prio_idx[id];
+    }
+
     /**
      * Update the report type information in the database using the data from the
      * given file.
@@ -134,13 +143,34 @@ struct Repinfo
      */
     virtual void read_cache() = 0;
 
+    /**
+     * Fill the cache with a copy of the given entries, without querying the
+     * database.
+     *
+     * The entries may be older than the database contents: lookups that do
+     * not find a report reread the cache from the database.
+     */
+    void load_cache(const std::vector<repinfo::Cache>& entries);
+
+    /// Check if the cache holds entries given to load_cache
+    bool is_snapshot() const { return snapshot; }
+
+    /// Access the cached table entries
+    const std::vector<repinfo::Cache>& get_cache() const { return cache; }
+
 protected:
     /** Cache of table entries */
     std::vector<repinfo::Cache> cache;
 
+    /// True if cache was filled by load_cache and not yet reread
+    bool snapshot = false;
+
     /** rep_memo -> rep_cod reverse index */
     mutable std::vector<repinfo::Memoidx> memo_idx;
 
+    /// Report priorities indexed by report ID, INT_MAX for unused IDs
+    mutable std::vector<int> prio_idx;
+
     /// Get a Cache entry by database ID
     const repinfo::Cache* get_by_id(unsigned id) const;
 
@@ -156,7 +186,7 @@ protected:
     /// Append an entry to the cache
     void cache_append(unsigned id, const char* memo, const char* desc, int prio, const char* descriptor, int tablea);
 
-    /// Rebuild the memo_idx cache
+    /// Rebuild the memo_idx and prio_idx caches
     void rebuild_memo_idx() const;
 
     /// Read cache entries from a repinfo file on disk
@@ -1,5 +1,6 @@
 #include "data.h"
 #include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/driver.h"
 #include "dballe/db/v7/batch.h"
 #include "dballe/db/v7/qbuilder.h"
 #include "dballe/db/v7/repinfo.h"
@@ -8,7 +9,6 @@
 #include "dballe/sql/querybuf.h"
 #include "dballe/values.h"
 #include "dballe/core/values.h"
-#include "dballe/core/varmatch.h"
 #include <algorithm>
 #include <cstring>
 
@@ -28,10 +28,13 @@ template class SQLiteDataCommon<Data>;
 
 template<typename Parent>
 SQLiteDataCommon<Parent>::SQLiteDataCommon(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn)
-    : Parent(tr), conn(conn)
+    : Parent(tr), conn(conn), typed_values(tr.driver().has_typed_values())
 {
     char query[64];
-    snprintf(query, 64, "UPDATE %s set value=?, attrs=? WHERE id=?", Parent::table_name);
+    if (typed_values)
+        snprintf(query, 64, "UPDATE %s set value=?1, attrs=?2, ivalue=?4 WHERE id=?3", Parent::table_name);
+    else
+        snprintf(query, 64, "UPDATE %s set value=?, attrs=? WHERE id=?", Parent::table_name);
     ustm = conn.sqlitestatement(query).release();
 }
 
@@ -44,6 +47,51 @@ SQLiteDataCommon<Parent>::~SQLiteDataCommon()
     delete sstm;
     delete istm;
     delete ustm;
+    for (auto& i: multi_istm)
+        delete i.second;
+}
+
+/// Numbers of rows inserted by the multi-row INSERT statements, in decreasing order
+static const unsigned multi_insert_sizes[] = { 128, 32, 8 };
+
+template<typename Parent>
+unsigned SQLiteDataCommon<Parent>::multi_insert_rows(unsigned count) const
+{
+    for (auto rows: multi_insert_sizes)
+        if (rows <= count && rows <= conn.max_rows_per_insert)
+            return rows;
+    return 1;
+}
+
+template<typename Parent>
+SQLiteStatement& SQLiteDataCommon<Parent>::multi_insert_statement(unsigned rows)
+{
+    auto i = multi_istm.find(rows);
+    if (i != multi_istm.end())
+        return *i->second;
+    SQLiteStatement* stm = conn.sqlitestatement(multi_insert_query(rows)).release();
+    multi_istm.insert(make_pair(rows, stm));
+    return *stm;
+}
+
+template<typename Parent>
+void SQLiteDataCommon<Parent>::bind_value(SQLiteStatement& stm, int idx, const wreport::Var& var)
+{
+    Vartype type = var.info()->type;
+    if (numeric_values && (type == Vartype::Integer || type == Vartype::Decimal))
+        stm.bind_val(idx, var.enqi());
+    else
+        stm.bind_val(idx, var.enqc());
+}
+
+template<typename Parent>
+void SQLiteDataCommon<Parent>::bind_ivalue(SQLiteStatement& stm, int idx, const wreport::Var& var)
+{
+    Vartype type = var.info()->type;
+    if (type == Vartype::Integer || type == Vartype::Decimal)
+        stm.bind_val(idx, var.enqi());
+    else
+        stm.bind_null_val(idx);
 }
 
 template<typename Parent>
@@ -93,43 +141,40 @@ void SQLiteDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
     remove_attrs_stm->execute();
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void SQLiteDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
+    if (!qb.attr_filter)
+    {
+        // Delete all the matching values with a single statement
+        Querybuf dq(512);
+        dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
+        dq.append(qb.sql_query);
+        dq.append(")");
+        auto stm = conn.sqlitestatement(dq);
+        if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+        Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        stm->execute();
+        if (trc_del) trc_del->add_row(conn.changes());
+        return;
+    }
+
+    // We need to apply attr_filter to all results of the query, so we
+    // iterate the results and delete the matching ones one by one.
     char query[64];
     snprintf(query, 64, "DELETE FROM %s WHERE id=?", Parent::table_name);
     auto stmd = conn.sqlitestatement(query);
     auto stm = conn.sqlitestatement(qb.sql_query);
     if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
 
-    std::unique_ptr<Varmatch> attr_filter;
-    if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
-
-    // Iterate all the data_id results, deleting the related data and attributes
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+    Tracer<> trc_del(trc ? trc->trace_delete(query) : nullptr);
     stm->execute([&]() {
         if (trc_sel) trc_sel->add_row();
-        if (attr_filter.get() && !match_attrs(*attr_filter, stm->column_blob(1))) return;
-
-        // Compile the DELETE query for the data
-        Tracer<> trc_del(trc ? trc->trace_delete(query, 1) : nullptr);
+        if (!qb.match_attrs(stm->column_blob(1))) return;
         stmd->bind_val(1, stm->column_int(0));
         stmd->execute();
+        if (trc_del) trc_del->add_row();
     });
 }
 
@@ -149,7 +194,7 @@ void SQLiteDataCommon<Parent>::update(Tracer<>& trc, std::vector<typename Parent
 {
     for (auto& v: vars)
     {
-        ustm->bind_val(1, v.var->enqc());
+        bind_value(*ustm, 1, *v.var);
         core::value::Encoder enc;
         if (with_attrs && v.var->next_attr())
         {
@@ -159,6 +204,8 @@ void SQLiteDataCommon<Parent>::update(Tracer<>& trc, std::vector<typename Parent
         else
             ustm->bind_null_val(2);
         ustm->bind_val(3, v.id);
+        if (typed_values)
+            bind_ivalue(*ustm, 4, *v.var);
 
         Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … set value=?, attrs=? WHERE id=?", 1) : nullptr);
         ustm->execute();
@@ -167,12 +214,13 @@ void SQLiteDataCommon<Parent>::update(Tracer<>& trc, std::vector<typename Parent
 
 static const char* select_station_data_query = "SELECT id, code FROM station_data WHERE id_station=?";
 static const char* insert_station_data_query = "INSERT INTO station_data (id_station, code, value, attrs) VALUES (?, ?, ?, ?)";
+static const char* insert_station_data_ivalue_query = "INSERT INTO station_data (id_station, code, value, attrs, ivalue) VALUES (?, ?, ?, ?, ?)";
 
 SQLiteStationData::SQLiteStationData(v7::Transaction& tr, SQLiteConnection& conn)
     : SQLiteDataCommon(tr, conn)
 {
     sstm = conn.sqlitestatement(select_station_data_query).release();
-    istm = conn.sqlitestatement(insert_station_data_query).release();
+    istm = conn.sqlitestatement(typed_values ? insert_station_data_ivalue_query : insert_station_data_query).release();
 }
 
 void SQLiteStationData::query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest)
@@ -187,69 +235,267 @@ void SQLiteStationData::query(Tracer<>& trc, int id_station, std::function<void(
     });
 }
 
+std::string SQLiteStationData::multi_insert_query(unsigned rows) const
+{
+    // ?1 is the station ID, shared by all rows
+    Querybuf q(64 + rows * 32);
+    if (typed_values)
+        q.append("INSERT INTO station_data (id_station, code, value, attrs, ivalue) VALUES ");
+    else
+        q.append("INSERT INTO station_data (id_station, code, value, attrs) VALUES ");
+    q.start_list(",");
+    unsigned per_row = typed_values ? 4 : 3;
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        unsigned base = 2 + i * per_row;
+        q.start_list_item();
+        if (typed_values)
+            q.appendf("(?1, ?%u, ?%u, ?%u, ?%u)", base, base + 1, base + 2, base + 3);
+        else
+            q.appendf("(?1, ?%u, ?%u, ?%u)", base, base + 1, base + 2);
+    }
+    return q;
+}
+
 void SQLiteStationData::insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs)
 {
     std::sort(vars.begin(), vars.end());
-    istm->bind_val(1, id_station);
+
+    // Collect the values to insert, skipping duplicates
+    std::vector<batch::StationDatum*> to_insert;
+    to_insert.reserve(vars.size());
     for (auto v = vars.begin(); v != vars.end(); ++v)
     {
-        // Skip duplicates
         auto next = v + 1;
         if (next != vars.end() && *v == *next)
             continue;
-        istm->bind_val(2, v->var->code());
-        istm->bind_val(3, v->var->enqc());
-        core::value::Encoder enc;
-        if (with_attrs && v->var->next_attr())
+        to_insert.push_back(&*v);
+    }
+
+    // Encode attributes in advance, since bound values need to stay valid
+    // until the statement is executed
+    std::vector<core::value::Encoder> attrs(with_attrs ? to_insert.size() : 0);
+    for (unsigned i = 0; i < attrs.size(); ++i)
+        if (to_insert[i]->var->next_attr())
+            attrs[i].append_attributes(*to_insert[i]->var);
+
+    unsigned pos = 0;
+    while (pos < to_insert.size())
+    {
+        unsigned rows = multi_insert_rows(to_insert.size() - pos);
+        if (rows == 1)
         {
-            enc.append_attributes(*v->var);
-            istm->bind_val(4, enc.buf);
+            batch::StationDatum& v = *to_insert[pos];
+            istm->bind_val(1, id_station);
+            istm->bind_val(2, v.var->code());
+            istm->bind_val(3, v.var->enqc());
+            if (with_attrs && !attrs[pos].buf.empty())
+                istm->bind_val(4, attrs[pos].buf);
+            else
+                istm->bind_null_val(4);
+            if (typed_values)
+                bind_ivalue(*istm, 5, *v.var);
+            Tracer<> trc_ins(trc ? trc->trace_insert(insert_station_data_query, 1) : nullptr);
+            istm->execute();
+            v.id = conn.get_last_insert_id();
+            ++pos;
+            continue;
         }
-        else
-            istm->bind_null_val(4);
-        Tracer<> trc_ins(trc ? trc->trace_insert(insert_station_data_query, 1) : nullptr);
-        istm->execute();
-        v->id = conn.get_last_insert_id();
+
+        SQLiteStatement& stm = multi_insert_statement(rows);
+        stm.bind_val(1, id_station);
+        unsigned per_row = typed_values ? 4 : 3;
+        for (unsigned i = 0; i < rows; ++i)
+        {
+            const batch::StationDatum& v = *to_insert[pos + i];
+            unsigned base = 2 + i * per_row;
+            stm.bind_val(base, v.var->code());
+            stm.bind_val(base + 1, v.var->enqc());
+            if (with_attrs && !attrs[pos + i].buf.empty())
+                stm.bind_val(base + 2, attrs[pos + i].buf);
+            else
+                stm.bind_null_val(base + 2);
+            if (typed_values)
+                bind_ivalue(stm, base + 3, *v.var);
+        }
+        Tracer<> trc_ins(trc ? trc->trace_insert(insert_station_data_query, rows) : nullptr);
+        stm.execute();
+
+        // Rows inserted by a single statement get consecutive rowids, in
+        // the order they appear in VALUES
+        int last_id = conn.get_last_insert_id();
+        for (unsigned i = 0; i < rows; ++i)
+            to_insert[pos + i]->id = last_id - rows + 1 + i;
+        pos += rows;
     }
 }
 
-void SQLiteStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+namespace {
+
+/**
+ * Create a variable from a value column, which holds text, or the scaled
+ * integer of numeric variables in the packed layout
+ */
+std::unique_ptr<wreport::Var> column_var(SQLiteStatement& stm, int col, wreport::Varcode code)
 {
-    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-    auto stm = conn.sqlitestatement(qb.sql_query);
+    if (sqlite3_column_type(stm, col) == SQLITE_INTEGER)
+        return std::unique_ptr<wreport::Var>(new wreport::Var(varinfo(code), stm.column_int(col)));
+    return newvar(code, stm.column_string(col));
+}
 
-    if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+struct SQLiteStationDataStream : public StationDataStream
+{
+    v7::Transaction& tr;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    std::unique_ptr<SQLiteStatement> stm;
+    dballe::DBStation station;
+    bool done = false;
 
+    SQLiteStationDataStream(v7::Transaction& tr, SQLiteConnection& conn, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr), stm(conn.sqlitestatement(qb.sql_query))
+    {
+        if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+    }
+
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        for (unsigned i = 0; !done && (max_rows == 0 || i < max_rows); ++i)
+        {
+            bool has_row;
+            {
+                trace::PhaseTimer timer(trc_sel, "sql");
+                has_row = stm->step();
+            }
+            if (!has_row)
+            {
+                done = true;
+                break;
+            }
+
+            if (trc_sel) trc_sel->add_row();
+            wreport::Varcode code = stm->column_int(5);
+            std::vector<uint8_t> attrs;
+            if (qb.select_attrs)
+                attrs = stm->column_blob(8);
+
+            // Postprocessing filter of attr_filter
+            if (qb.attr_filter && !qb.match_attrs(attrs))
+                continue;
+
+            std::unique_ptr<wreport::Var> var;
+            {
+                trace::PhaseTimer timer(trc_sel, "decode");
+                var = column_var(*stm, 7, code);
+                if (qb.select_attrs)
+                    core::value::Decoder::decode_attrs(attrs, *var);
+                timer.add_allocs();
+            }
+
+            int id_station = stm->column_int(0);
+            if (id_station != station.id)
+            {
+                station.id = id_station;
+                station.report = tr.repinfo().get_rep_memo(stm->column_int(1));
+                station.coords.lat = stm->column_int(2);
+                station.coords.lon = stm->column_int(3);
+                if (stm->column_isnull(4))
+                    station.ident.clear();
+                else
+                    station.ident = stm->column_string(4);
+            }
+
+            int id_data = stm->column_int(6);
+
+            dest(station, id_data, move(var));
+        }
+        return !done;
+    }
+};
+
+struct SQLiteDataStream : public DataStream
+{
+    v7::Transaction& tr;
+    const v7::DataQueryBuilder& qb;
+    Tracer<> trc_sel;
+    std::unique_ptr<SQLiteStatement> stm;
     dballe::DBStation station;
-    stm->execute([&]() {
-        if (trc_sel) trc_sel->add_row();
-        wreport::Varcode code = stm->column_int(5);
-        const char* value = stm->column_string(7);
-        auto var = newvar(code, value);
-        if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(stm->column_blob(8), *var);
+    bool done = false;
 
-        // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
-            return;
+    SQLiteDataStream(v7::Transaction& tr, SQLiteConnection& conn, Tracer<>& trc, const v7::DataQueryBuilder& qb)
+        : tr(tr), qb(qb), trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr), stm(conn.sqlitestatement(qb.sql_query))
+    {
+        if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+    }
 
-        int id_station = stm->column_int(0);
-        if (id_station != station.id)
+    bool fetch(unsigned max_rows, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest) override
+    {
+        for (unsigned i = 0; !done && (max_rows == 0 || i < max_rows); ++i)
         {
-            station.id = id_station;
-            station.report = qb.tr->repinfo().get_rep_memo(stm->column_int(1));
-            station.coords.lat = stm->column_int(2);
-            station.coords.lon = stm->column_int(3);
-            if (stm->column_isnull(4))
-                station.ident.clear();
-            else
-                station.ident = stm->column_string(4);
+            bool has_row;
+            {
+                trace::PhaseTimer timer(trc_sel, "sql");
+                has_row = stm->step();
+            }
+            if (!has_row)
+            {
+                done = true;
+                break;
+            }
+
+            if (trc_sel) trc_sel->add_row();
+            wreport::Varcode code = stm->column_int(6);
+            std::vector<uint8_t> attrs;
+            if (qb.select_attrs)
+                attrs = stm->column_blob(10);
+
+            // Postprocessing filter of attr_filter
+            if (qb.attr_filter && !qb.match_attrs(attrs))
+                continue;
+
+            std::unique_ptr<wreport::Var> var;
+            {
+                trace::PhaseTimer timer(trc_sel, "decode");
+                var = column_var(*stm, 9, code);
+                if (qb.select_attrs)
+                    core::value::Decoder::decode_attrs(attrs, *var);
+                timer.add_allocs();
+            }
+
+            int id_station = stm->column_int(0);
+            if (id_station != station.id)
+            {
+                station.id = id_station;
+                station.report = tr.repinfo().get_rep_memo(stm->column_int(1));
+                station.coords.lat = stm->column_int(2);
+                station.coords.lon = stm->column_int(3);
+                if (stm->column_isnull(4))
+                    station.ident.clear();
+                else
+                    station.ident = stm->column_string(4);
+            }
+
+            int id_levtr = stm->column_int(5);
+            int id_data = stm->column_int(7);
+            Datetime datetime = stm->column_datetime(8);
+
+            dest(station, id_levtr, datetime, id_data, move(var));
         }
+        return !done;
+    }
+};
 
-        int id_data = stm->column_int(6);
+}
 
-        dest(station, id_data, move(var));
-    });
+void SQLiteStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    SQLiteStationDataStream stream(tr, conn, trc, qb);
+    stream.fetch(0, dest);
+}
+
+std::unique_ptr<StationDataStream> SQLiteStationData::stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<StationDataStream>(new SQLiteStationDataStream(tr, conn, trc, qb));
 }
 
 void SQLiteStationData::dump(FILE* out)
@@ -268,12 +514,21 @@ void SQLiteStationData::dump(FILE* out)
 
 static const char* select_data_query = "SELECT id, id_levtr, code FROM data WHERE id_station=? AND datetime=?";
 static const char* insert_data_query = "INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) VALUES (?, ?, ?, ?, ?, ?)";
+static const char* insert_data_ivalue_query = "INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs, ivalue) VALUES (?, ?, ?, ?, ?, ?, ?)";
 
-SQLiteData::SQLiteData(v7::Transaction& tr, SQLiteConnection& conn)
+SQLiteData::SQLiteData(v7::Transaction& tr, SQLiteConnection& conn, bool packed)
     : SQLiteDataCommon(tr, conn)
 {
+    numeric_values = packed;
     sstm = conn.sqlitestatement(select_data_query).release();
-    istm = conn.sqlitestatement(insert_data_query).release();
+    istm = conn.sqlitestatement(typed_values ? insert_data_ivalue_query : insert_data_query).release();
+}
+
+SQLiteData::~SQLiteData()
+{
+    delete summary_insert_stm;
+    delete summary_update_stm;
+    delete summary_key_stm;
 }
 
 void SQLiteData::query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest)
@@ -290,74 +545,114 @@ void SQLiteData::query(Tracer<>& trc, int id_station, const Datetime& datetime,
     });
 }
 
+std::string SQLiteData::multi_insert_query(unsigned rows) const
+{
+    // ?1 and ?2 are the station ID and datetime, shared by all rows
+    Querybuf q(64 + rows * 40);
+    if (typed_values)
+        q.append("INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs, ivalue) VALUES ");
+    else
+        q.append("INSERT INTO data (id_station, id_levtr, datetime, code, value, attrs) VALUES ");
+    q.start_list(",");
+    unsigned per_row = typed_values ? 5 : 4;
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        unsigned base = 3 + i * per_row;
+        q.start_list_item();
+        if (typed_values)
+            q.appendf("(?1, ?%u, ?2, ?%u, ?%u, ?%u, ?%u)", base, base + 1, base + 2, base + 3, base + 4);
+        else
+            q.appendf("(?1, ?%u, ?2, ?%u, ?%u, ?%u)", base, base + 1, base + 2, base + 3);
+    }
+    return q;
+}
+
 void SQLiteData::insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
 {
     std::sort(vars.begin(), vars.end());
-    istm->bind_val(1, id_station);
-    istm->bind_val(3, datetime);
+
+    // Collect the values to insert, skipping duplicates
+    std::vector<batch::MeasuredDatum*> to_insert;
+    to_insert.reserve(vars.size());
     for (auto v = vars.begin(); v != vars.end(); ++v)
     {
-        // Skip duplicates
         auto next = v + 1;
         if (next != vars.end() && *v == *next)
             continue;
-        Tracer<> trc_ins(trc ? trc->trace_insert(insert_data_query, 1) : nullptr);
-        istm->bind_val(2, v->id_levtr);
-        istm->bind_val(4, v->var->code());
-        istm->bind_val(5, v->var->enqc());
-        core::value::Encoder enc;
-        if (with_attrs && v->var->next_attr())
-        {
-            enc.append_attributes(*v->var);
-            istm->bind_val(6, enc.buf);
-        }
-        else
-            istm->bind_null_val(6);
-        istm->execute();
-
-        v->id = conn.get_last_insert_id();
+        to_insert.push_back(&*v);
     }
-}
 
-void SQLiteData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest)
-{
-    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-    auto stm = conn.sqlitestatement(qb.sql_query);
-
-    if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+    // Encode attributes in advance, since bound values need to stay valid
+    // until the statement is executed
+    std::vector<core::value::Encoder> attrs(with_attrs ? to_insert.size() : 0);
+    for (unsigned i = 0; i < attrs.size(); ++i)
+        if (to_insert[i]->var->next_attr())
+            attrs[i].append_attributes(*to_insert[i]->var);
 
-    dballe::DBStation station;
-    stm->execute([&]() {
-        if (trc_sel) trc_sel->add_row();
-        wreport::Varcode code = stm->column_int(6);
-        const char* value = stm->column_string(9);
-        auto var = newvar(code, value);
-        if (qb.select_attrs)
-            core::value::Decoder::decode_attrs(stm->column_blob(10), *var);
-
-        // Postprocessing filter of attr_filter
-        if (qb.attr_filter && !qb.match_attrs(*var))
-            return;
+    unsigned pos = 0;
+    while (pos < to_insert.size())
+    {
+        unsigned rows = multi_insert_rows(to_insert.size() - pos);
+        if (rows == 1)
+        {
+            batch::MeasuredDatum& v = *to_insert[pos];
+            Tracer<> trc_ins(trc ? trc->trace_insert(insert_data_query, 1) : nullptr);
+            istm->bind_val(1, id_station);
+            istm->bind_val(2, v.id_levtr);
+            istm->bind_val(3, datetime);
+            istm->bind_val(4, v.var->code());
+            bind_value(*istm, 5, *v.var);
+            if (with_attrs && !attrs[pos].buf.empty())
+                istm->bind_val(6, attrs[pos].buf);
+            else
+                istm->bind_null_val(6);
+            if (typed_values)
+                bind_ivalue(*istm, 7, *v.var);
+            istm->execute();
+            v.id = conn.get_last_insert_id();
+            ++pos;
+            continue;
+        }
 
-        int id_station = stm->column_int(0);
-        if (id_station != station.id)
+        SQLiteStatement& stm = multi_insert_statement(rows);
+        stm.bind_val(1, id_station);
+        stm.bind_val(2, datetime);
+        unsigned per_row = typed_values ? 5 : 4;
+        for (unsigned i = 0; i < rows; ++i)
         {
-            station.id = id_station;
-            station.report = tr.repinfo().get_rep_memo(stm->column_int(1));
-            station.coords.lat = stm->column_int(2);
-            station.coords.lon = stm->column_int(3);
-            if (stm->column_isnull(4))
-                station.ident.clear();
+            const batch::MeasuredDatum& v = *to_insert[pos + i];
+            unsigned base = 3 + i * per_row;
+            stm.bind_val(base, v.id_levtr);
+            stm.bind_val(base + 1, v.var->code());
+            bind_value(stm, base + 2, *v.var);
+            if (with_attrs && !attrs[pos + i].buf.empty())
+                stm.bind_val(base + 3, attrs[pos + i].buf);
             else
-                station.ident = stm->column_string(4);
+                stm.bind_null_val(base + 3);
+            if (typed_values)
+                bind_ivalue(stm, base + 4, *v.var);
         }
+        Tracer<> trc_ins(trc ? trc->trace_insert(insert_data_query, rows) : nullptr);
+        stm.execute();
+
+        // Rows inserted by a single statement get consecutive rowids, in
+        // the order they appear in VALUES
+        int last_id = conn.get_last_insert_id();
+        for (unsigned i = 0; i < rows; ++i)
+            to_insert[pos + i]->id = last_id - rows + 1 + i;
+        pos += rows;
+    }
+}
 
-        int id_levtr = stm->column_int(5);
-        int id_data = stm->column_int(7);
-        Datetime datetime = stm->column_datetime(8);
+void SQLiteData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    SQLiteDataStream stream(tr, conn, trc, qb);
+    stream.fetch(0, dest);
+}
 
-        dest(station, id_levtr, datetime, id_data, move(var));
-    });
+std::unique_ptr<DataStream> SQLiteData::stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb)
+{
+    return std::unique_ptr<DataStream>(new SQLiteDataStream(tr, conn, trc, qb));
 }
 
 void SQLiteData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)> dest)
@@ -398,6 +693,76 @@ void SQLiteData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder&
     });
 }
 
+static const char* summary_insert_query = "INSERT OR IGNORE INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count) VALUES (?, ?, ?, ?, ?, 0)";
+static const char* summary_update_query = "UPDATE data_summary SET count=count+?, dtmin=min(dtmin, ?), dtmax=max(dtmax, ?) WHERE id_station=? AND id_levtr=? AND code=?";
+void SQLiteData::summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added)
+{
+    if (!summary_insert_stm)
+    {
+        summary_insert_stm = conn.sqlitestatement(summary_insert_query).release();
+        summary_update_stm = conn.sqlitestatement(summary_update_query).release();
+    }
+
+    // Make sure the row exists, then merge the new values into it
+    Tracer<> trc_ins(trc ? trc->trace_insert(summary_insert_query, 1) : nullptr);
+    summary_insert_stm->bind_val(1, key.id_station);
+    summary_insert_stm->bind_val(2, key.id_levtr);
+    summary_insert_stm->bind_val(3, key.code);
+    summary_insert_stm->bind_val(4, added.dtmin);
+    summary_insert_stm->bind_val(5, added.dtmax);
+    summary_insert_stm->execute();
+
+    Tracer<> trc_upd(trc ? trc->trace_update(summary_update_query, 1) : nullptr);
+    summary_update_stm->bind_val(1, (int)added.count);
+    summary_update_stm->bind_val(2, added.dtmin);
+    summary_update_stm->bind_val(3, added.dtmax);
+    summary_update_stm->bind_val(4, key.id_station);
+    summary_update_stm->bind_val(5, key.id_levtr);
+    summary_update_stm->bind_val(6, key.code);
+    summary_update_stm->execute();
+}
+
+static const char* summary_key_query = "SELECT id_station, id_levtr, code FROM data WHERE id=?";
+
+void SQLiteData::summary_remove_by_id(Tracer<>& trc, int id_data)
+{
+    if (!summary_key_stm)
+        summary_key_stm = conn.sqlitestatement(summary_key_query).release();
+
+    Tracer<> trc_sel(trc ? trc->trace_select(summary_key_query) : nullptr);
+    summary_key_stm->bind_val(1, id_data);
+    summary_key_stm->execute([&]() {
+        if (trc_sel) trc_sel->add_row();
+        summary_changes.remove(summary_key_stm->column_int(0), summary_key_stm->column_int(1), summary_key_stm->column_int(2));
+    });
+}
+
+void SQLiteData::summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations)
+{
+    Querybuf ids;
+    ids.start_list(",");
+    for (int id: id_stations)
+        ids.append_listf("%d", id);
+
+    Querybuf dq;
+    dq.appendf("DELETE FROM data_summary WHERE id_station IN (%s)", ids.c_str());
+    Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+    conn.execute(dq);
+    if (trc_del) trc_del->add_row(conn.changes());
+
+    Querybuf iq;
+    iq.appendf(R"(
+        INSERT INTO data_summary (id_station, id_levtr, code, dtmin, dtmax, count)
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+              WHERE id_station IN (%s)
+           GROUP BY id_station, id_levtr, code
+    )", ids.c_str());
+    Tracer<> trc_ins(trc ? trc->trace_insert(iq) : nullptr);
+    conn.execute(iq);
+    if (trc_ins) trc_ins->add_row(conn.changes());
+}
+
 
 void SQLiteData::dump(FILE* out)
 {
@@ -4,6 +4,8 @@
 #include <dballe/db/v7/data.h>
 #include <dballe/db/v7/cache.h>
 #include <dballe/sql/fwd.h>
+#include <map>
+#include <string>
 
 namespace dballe {
 namespace db {
@@ -31,6 +33,30 @@ protected:
     dballe::sql::SQLiteStatement* istm = nullptr;
     /// Precompiled update statement
     dballe::sql::SQLiteStatement* ustm = nullptr;
+    /// Precompiled insert statements for many rows, indexed by number of rows
+    std::map<unsigned, dballe::sql::SQLiteStatement*> multi_istm;
+    /// True if numeric values are stored as their scaled integer instead of text
+    bool numeric_values = false;
+    /// True if the table has an ivalue column, filled by insert and update
+    bool typed_values = false;
+
+    /// Bind the value of var, as text or as integer according to numeric_values
+    void bind_value(dballe::sql::SQLiteStatement& stm, int idx, const wreport::Var& var);
+
+    /// Bind the ivalue column for var: its scaled integer, or NULL for strings
+    void bind_ivalue(dballe::sql::SQLiteStatement& stm, int idx, const wreport::Var& var);
+
+    /// Build the query used to insert the given number of rows at once
+    virtual std::string multi_insert_query(unsigned rows) const = 0;
+
+    /**
+     * Return the number of rows to insert with the next INSERT statement,
+     * when count rows are left to insert
+     */
+    unsigned multi_insert_rows(unsigned count) const;
+
+    /// Return the precompiled statement inserting the given number of rows
+    dballe::sql::SQLiteStatement& multi_insert_statement(unsigned rows);
 
 public:
     SQLiteDataCommon(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn);
@@ -55,6 +81,9 @@ extern template class SQLiteDataCommon<Data>;
  */
 class SQLiteStationData : public SQLiteDataCommon<StationData>
 {
+protected:
+    std::string multi_insert_query(unsigned rows) const override;
+
 public:
     using SQLiteDataCommon::SQLiteDataCommon;
 
@@ -63,6 +92,7 @@ public:
     void query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs) override;
     void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<StationDataStream> stream_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
 };
@@ -72,14 +102,34 @@ public:
  */
 class SQLiteData : public SQLiteDataCommon<Data>
 {
+protected:
+    /// Precompiled data_summary statements, created on first use
+    dballe::sql::SQLiteStatement* summary_insert_stm = nullptr;
+    dballe::sql::SQLiteStatement* summary_update_stm = nullptr;
+    dballe::sql::SQLiteStatement* summary_key_stm = nullptr;
+
+    std::string multi_insert_query(unsigned rows) const override;
+    void summary_add(Tracer<>& trc, const DataSummaryChanges::Key& key, const DataSummaryChanges::Added& added) override;
+    void summary_refresh(Tracer<>& trc, const std::vector<int>& id_stations) override;
+
+public:
+    void summary_remove_by_id(Tracer<>& trc, int id_data) override;
+
 public:
     using SQLiteDataCommon::SQLiteDataCommon;
 
-    SQLiteData(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn);
+    /**
+     * @param packed
+     *   true if the data table uses the packed layout, with integer values
+     *   for numeric variables
+     */
+    SQLiteData(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn, bool packed=false);
+    ~SQLiteData();
 
     void query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest) override;
     void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) override;
     void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    std::unique_ptr<DataStream> stream_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb) override;
     void run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)>) override;
     void dump(FILE* out) override;
     void clear_cache() override {}
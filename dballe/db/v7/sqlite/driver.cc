@@ -7,9 +7,13 @@
 #include "dballe/db/v7/db.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/sql/sqlite.h"
+#include "dballe/core/values.h"
+#include "dballe/core/varmatch.h"
 #include "dballe/var.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <set>
 
 using namespace std;
 using namespace wreport;
@@ -23,9 +27,50 @@ namespace db {
 namespace v7 {
 namespace sqlite {
 
+namespace {
+
+void delete_varmatch(void* match)
+{
+    delete (Varmatch*)match;
+}
+
+/**
+ * SQL function dballe_attr_match(attrs, filter), returning true if any of the
+ * encoded attributes matches the attr_filter string
+ */
+void sql_attr_match(sqlite3_context* ctx, int argc, sqlite3_value** argv)
+{
+    try {
+        // SQLite keeps the parsed filter for as long as the argument does not
+        // change, which is usually the whole query
+        const Varmatch* match = (const Varmatch*)sqlite3_get_auxdata(ctx, 1);
+        std::unique_ptr<Varmatch> parsed;
+        if (!match)
+        {
+            parsed = Varmatch::parse((const char*)sqlite3_value_text(argv[1]));
+            match = parsed.get();
+        }
+
+        const uint8_t* attrs = (const uint8_t*)sqlite3_value_blob(argv[0]);
+        bool res = attrs && core::value::Decoder::match_attrs(attrs, sqlite3_value_bytes(argv[0]), *match);
+        sqlite3_result_int(ctx, res);
+
+        if (parsed)
+            sqlite3_set_auxdata(ctx, 1, parsed.release(), delete_varmatch);
+    } catch (std::exception& e) {
+        sqlite3_result_error(ctx, e.what(), -1);
+    }
+}
+
+}
+
 Driver::Driver(SQLiteConnection& conn)
     : v7::Driver(conn), conn(conn)
 {
+    if (sqlite3_create_function(conn, "dballe_attr_match", 2, SQLITE_UTF8, nullptr, sql_attr_match, nullptr, nullptr) != SQLITE_OK)
+        throw dballe::sql::error_sqlite(conn, "cannot register the dballe_attr_match function");
+    packed_data = conn.get_setting("data_layout") == "packed";
+    conn.packed_datetime = packed_data;
 }
 
 Driver::~Driver()
@@ -54,7 +99,7 @@ std::unique_ptr<v7::StationData> Driver::create_station_data(v7::Transaction& tr
 
 std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
 {
-    return unique_ptr<v7::Data>(new SQLiteData(tr, conn));
+    return unique_ptr<v7::Data>(new SQLiteData(tr, conn, packed_data));
 }
 
 void Driver::create_tables_v7()
@@ -106,30 +151,72 @@ void Driver::create_tables_v7()
            UNIQUE (id_station, code)
         );
     )");
-    conn.exec(R"(
+    // The packed layout has integer datetimes, and no type for value, so
+    // that numeric values are stored as integers and strings as text
+    packed_data = getenv("DBA_SQLITE_PACKED") != nullptr;
+    conn.packed_datetime = packed_data;
+    conn.exec(string(R"(
         CREATE TABLE data (
            id          INTEGER PRIMARY KEY,
            id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
            id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
-           datetime    TEXT NOT NULL,
+           datetime    )") + (packed_data ? "INTEGER" : "TEXT") + R"( NOT NULL,
            code        INTEGER NOT NULL,
-           value       VARCHAR(255) NOT NULL,
+           value       )" + (packed_data ? "" : "VARCHAR(255)") + R"( NOT NULL,
            attrs       BLOB,
            UNIQUE (id_station, datetime, id_levtr, code)
         );
         CREATE INDEX data_lt ON data(id_levtr);
     )");
+    if (packed_data)
+        conn.set_setting("data_layout", "packed");
+
+    // Index station coordinates for bounding box queries, if this SQLite
+    // has been built with the R*Tree module
+    station_spatial_index = 0;
+    try {
+        conn.exec("CREATE VIRTUAL TABLE station_rtree USING rtree(id, minlat, maxlat, minlon, maxlon)");
+        station_spatial_index = 1;
+    } catch (dballe::sql::error_sqlite&) {
+        // R*Tree is not available: bounding box queries will use pa_lon
+    }
+    if (station_spatial_index)
+    {
+        conn.exec(R"(
+            CREATE TRIGGER station_rtree_insert AFTER INSERT ON station BEGIN
+                INSERT INTO station_rtree VALUES (new.id, new.lat, new.lat, new.lon, new.lon);
+            END;
+            CREATE TRIGGER station_rtree_update AFTER UPDATE OF lat, lon ON station BEGIN
+                UPDATE station_rtree SET minlat=new.lat, maxlat=new.lat, minlon=new.lon, maxlon=new.lon
+                 WHERE id=new.id;
+            END;
+            CREATE TRIGGER station_rtree_delete AFTER DELETE ON station BEGIN
+                DELETE FROM station_rtree WHERE id=old.id;
+            END;
+        )");
+        conn.set_setting("station_spatial_index", "rtree");
+    }
+
+    data_summary = 0;
+    create_data_summary_v7();
 
     conn.set_setting("version", "V7");
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("data_summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
     conn.drop_table_if_exists("repinfo");
     conn.drop_table_if_exists("station");
+    conn.drop_table_if_exists("station_rtree");
     conn.drop_settings();
+    station_spatial_index = -1;
+    typed_values = -1;
+    data_summary = -1;
+    packed_data = false;
+    conn.packed_datetime = false;
 }
 void Driver::vacuum_v7()
 {
@@ -154,6 +241,80 @@ void Driver::vacuum_v7()
          LEFT JOIN data d ON d.id_station = p.id
              WHERE d.id is NULL)
     )");
+    create_data_summary_v7();
+}
+
+void Driver::create_data_covering_index_v7()
+{
+    // id is the rowid, which is always part of the index
+    conn.exec("CREATE INDEX IF NOT EXISTS data_cover ON data(id_station, datetime, id_levtr, code, value)");
+}
+
+void Driver::create_typed_values_v7()
+{
+    if (has_typed_values()) return;
+
+    // value holds the scaled integer of numeric variables. New rows get their
+    // ivalue from the INSERT and UPDATE statements of SQLiteData and
+    // SQLiteStationData, which avoids the cost of a trigger
+    for (const char* table: { "data", "station_data" })
+    {
+        conn.exec(string("ALTER TABLE ") + table + " ADD COLUMN ivalue INTEGER");
+
+        // Only fill ivalue for numeric variables: string variables can also
+        // hold values that look like integers
+        std::set<Varcode> numeric;
+        auto stm = conn.sqlitestatement(string("SELECT DISTINCT code FROM ") + table);
+        stm->execute([&]() {
+            Varcode code = stm->column_int(0);
+            try {
+                Vartype type = varinfo(code)->type;
+                if (type == Vartype::Integer || type == Vartype::Decimal)
+                    numeric.insert(code);
+            } catch (error_notfound&) {
+                // Leave ivalue unset for variables missing from the table
+            }
+        });
+        stm.reset();
+
+        if (!numeric.empty())
+        {
+            Querybuf q;
+            q.appendf("UPDATE %s SET ivalue=CAST(value AS INTEGER) WHERE code IN (", table);
+            q.append_varlist(numeric);
+            q.append(") AND CAST(CAST(value AS INTEGER) AS TEXT)=value");
+            conn.exec(q);
+        }
+        conn.exec(string("CREATE INDEX ") + table + "_ivalue ON " + table + "(code, ivalue)");
+    }
+
+    conn.set_setting("typed_values", "ivalue");
+    typed_values = 1;
+}
+
+void Driver::create_data_summary_v7()
+{
+    if (has_data_summary()) return;
+
+    const char* dttype = packed_data ? "INTEGER" : "TEXT";
+    conn.exec(string(R"(
+        CREATE TABLE data_summary (
+           id_station  INTEGER NOT NULL REFERENCES station (id) ON DELETE CASCADE,
+           id_levtr    INTEGER NOT NULL REFERENCES levtr(id) ON DELETE CASCADE,
+           code        INTEGER NOT NULL,
+           dtmin       )") + dttype + R"( NOT NULL,
+           dtmax       )" + dttype + R"( NOT NULL,
+           count       INTEGER NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        );
+        INSERT INTO data_summary
+             SELECT id_station, id_levtr, code, MIN(datetime), MAX(datetime), COUNT(*)
+               FROM data
+           GROUP BY id_station, id_levtr, code;
+    )");
+
+    conn.set_setting("data_summary", "table");
+    data_summary = 1;
 }
 
 }
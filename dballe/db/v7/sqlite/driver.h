@@ -13,6 +13,14 @@ struct Driver : public v7::Driver
 {
     dballe::sql::SQLiteConnection& conn;
 
+    /**
+     * True if the data table uses the packed layout, storing datetimes as
+     * YYYYMMDDhhmmss integers and numeric values as their scaled integer.
+     *
+     * New databases use it if DBA_SQLITE_PACKED is set in the environment.
+     */
+    bool packed_data = false;
+
     Driver(dballe::sql::SQLiteConnection& conn);
     virtual ~Driver();
 
@@ -24,6 +32,9 @@ struct Driver : public v7::Driver
     void create_tables_v7() override;
     void delete_tables_v7() override;
     void vacuum_v7() override;
+    void create_data_covering_index_v7() override;
+    void create_typed_values_v7() override;
+    void create_data_summary_v7() override;
 };
 
 }
@@ -69,7 +69,7 @@ SQLiteLevTr::~SQLiteLevTr()
     delete istm;
 }
 
-void SQLiteLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void SQLiteLevTr::_prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
 {
     if (ids.empty()) return;
 
@@ -34,6 +34,7 @@ protected:
     dballe::sql::SQLiteStatement* dstm = nullptr;
 
     void _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+    void _prefetch_ids(Tracer<>& trc, const std::set<int>& id) override;
 
 public:
     SQLiteLevTr(v7::Transaction& tr, dballe::sql::SQLiteConnection& conn);
@@ -42,7 +43,6 @@ public:
     SQLiteLevTr& operator=(const SQLiteLevTr&) = delete;
     ~SQLiteLevTr();
 
-    void prefetch_ids(Tracer<>& trc, const std::set<int>& id) override;
     const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
     int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
 };
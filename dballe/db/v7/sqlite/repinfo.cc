@@ -14,7 +14,6 @@ namespace sqlite {
 SQLiteRepinfoV7::SQLiteRepinfoV7(SQLiteConnection& conn)
     : Repinfo(conn), conn(conn)
 {
-    read_cache();
 }
 
 SQLiteRepinfoV7::~SQLiteRepinfoV7()
@@ -131,7 +131,9 @@ int SQLiteStation::insert_new(Tracer<>& trc, const dballe::DBStation& desc)
         istm->bind_null_val(4);
     istm->execute();
     if (trc) trc->trace_insert(insert_query, 1);
-    return conn.get_last_insert_id();
+    int id = conn.get_last_insert_id();
+    cache.insert(desc, id);
+    return id;
 }
 
 void SQLiteStation::get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest)
@@ -183,6 +185,19 @@ void SQLiteStation::add_station_vars(Tracer<>& trc, int id_station, DBValues& va
     });
 }
 
+void SQLiteStation::run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest)
+{
+    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_station_vars_query) : nullptr);
+    auto stm = conn.sqlitestatement(qb.sql_station_vars_query);
+
+    if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+
+    stm->execute([&]() {
+        if (trc_sel) trc_sel->add_row();
+        dest(stm->column_int(0), newvar((wreport::Varcode)stm->column_int(1), stm->column_string(2)));
+    });
+}
+
 void SQLiteStation::run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)> dest)
 {
     Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
@@ -1,6 +1,10 @@
 #include "station.h"
 #include "dballe/core/values.h"
 #include "transaction.h"
+#include "repinfo.h"
+#include "trace.h"
+#include "qbuilder.h"
+#include "dballe/core/query.h"
 
 using namespace wreport;
 using namespace dballe::db;
@@ -19,6 +23,52 @@ Station::~Station()
 {
 }
 
+void Station::clear_cache()
+{
+    cache.clear();
+}
+
+bool Station::prefetch_area(Tracer<>& trc, const std::string& report, const LatRange& latrange, const LonRange& lonrange, unsigned max_stations)
+{
+    core::Query query;
+    query.report = report;
+    query.latrange = latrange;
+    query.lonrange = lonrange;
+    // Fetch one more station to know if there are too many
+    query.limit = max_stations + 1;
+
+    StationQueryBuilder qb(dynamic_pointer_cast<v7::Transaction>(tr.shared_from_this()), query, DBA_DB_MODIFIER_UNSORTED);
+    qb.build();
+
+    unsigned count = 0;
+    run_station_query(trc, qb, [&](const dballe::DBStation& st) {
+        if (++count > max_stations)
+            return;
+        cache.insert(st);
+    });
+    if (count > max_stations)
+        return false;
+
+    cache.complete.emplace_back(report, latrange, lonrange);
+    return true;
+}
+
+bool Station::find_cached_id(const dballe::Station& st, int& id) const
+{
+    id = cache.find_id(st);
+    return id != MISSING_INT || cache.is_complete(st);
+}
+
+const DBStation* Station::find_cached(int id_station) const
+{
+    return cache.find_entry(id_station);
+}
+
+void Station::add_cache(const dballe::DBStation& st)
+{
+    cache.insert(st);
+}
+
 void Station::dump(FILE* out)
 {
     int count = 0;
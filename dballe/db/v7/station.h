@@ -25,12 +25,60 @@ struct Station
 {
 protected:
     v7::Transaction& tr;
+    StationCache cache;
     virtual void _dump(std::function<void(int, int, const Coords& coords, const char* ident)> out) = 0;
 
 public:
     Station(v7::Transaction& tr);
     virtual ~Station();
 
+    /**
+     * Invalidate the station cache.
+     *
+     * Further accesses will be done via the database, and slowly repopulate
+     * the cache from scratch.
+     */
+    void clear_cache();
+
+    /**
+     * Load into the cache the stations with the given report inside the given
+     * area.
+     *
+     * If the area has at most max_stations stations, after this and until the
+     * cache is cleared, stations of that report in that area that are not
+     * found in the cache are known not to exist in the database. Otherwise,
+     * only the first max_stations are loaded, and false is returned.
+     */
+    bool prefetch_area(Tracer<>& trc, const std::string& report, const LatRange& latrange, const LonRange& lonrange, unsigned max_stations);
+
+    /**
+     * Look up the ID of a station in the cache.
+     *
+     * Returns true if the cache can answer, setting id to the station ID, or
+     * to MISSING_INT if the station is known not to exist. Returns false if
+     * the database needs to be queried.
+     */
+    bool find_cached_id(const dballe::Station& st, int& id) const;
+
+    /**
+     * Check if the cache holds all the stations in the database with the
+     * given report inside the given area
+     */
+    bool cache_complete(const std::string& report, const LatRange& latrange, const LonRange& lonrange) const
+    {
+        return cache.is_complete(report, latrange, lonrange);
+    }
+
+    /**
+     * Look up a station in the cache by ID.
+     *
+     * Returns nullptr if the station is not in the cache.
+     */
+    const DBStation* find_cached(int id_station) const;
+
+    /// Add a station with a known database ID to the cache
+    void add_cache(const dballe::DBStation& st);
+
     /// Lookup station data by ID
     virtual DBStation lookup(Tracer<>& trc, int id_station) = 0;
 
@@ -66,6 +114,12 @@ public:
      */
     virtual void add_station_vars(Tracer<>& trc, int id_station, DBValues& values) = 0;
 
+    /**
+     * Run qb.sql_station_vars_query, sending the station variables (without
+     * attributes) of all the stations matched by the query to dest.
+     */
+    virtual void run_station_vars_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(int id_station, std::unique_ptr<wreport::Var> var)> dest) = 0;
+
     /**
      * Dump the entire contents of the table to an output stream
      */
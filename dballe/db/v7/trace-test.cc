@@ -1,7 +1,10 @@
 #include "dballe/db/tests.h"
+#include "dballe/db/v7/trace.h"
+#include <sstream>
 
 using namespace std;
 using namespace dballe;
+using namespace dballe::db::v7;
 using namespace dballe::tests;
 
 namespace {
@@ -15,6 +18,73 @@ class Tests : public TestCase
 
 void Tests::register_tests()
 {
+
+add_method("phases", []() {
+    trace::Step root("query_data");
+    Tracer<> trc(&root);
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        trace::PhaseTimer timer(trc, "decode");
+        timer.add_allocs(2);
+    }
+    {
+        Tracer<> trc_sel(trc->trace_select("SELECT 1", 3));
+        trace::PhaseTimer timer(trc_sel, "sql");
+    }
+    trc.done();
+
+    // Inactive tracers do nothing
+    Tracer<> null_trc;
+    {
+        trace::PhaseTimer timer(null_trc, "decode");
+        timer.add_allocs();
+    }
+
+    trace::Phase decode = root.aggregate_phase("decode");
+    wassert(actual(decode.count) == 3u);
+    wassert(actual(decode.allocs) == 6u);
+    wassert(actual(root.aggregate_phase("sql").count) == 1u);
+    wassert(actual(root.aggregate_phase("missing").count) == 0u);
+
+    std::stringstream json_buf;
+    core::JSONWriter writer(json_buf);
+    root.to_json(writer);
+    wassert(actual(json_buf.str()).contains(R"("phases":{"decode":{"count":3,"allocs":6,"nsecs":)"));
+    wassert(actual(json_buf.str()).contains(R"("phases":{"sql":{"count":1,"allocs":0,"nsecs":)"));
+});
+
+add_method("folded", []() {
+    trace::Step root("query_data");
+    Tracer<> trc(&root);
+    {
+        trace::PhaseTimer timer(trc, "materialize");
+    }
+    {
+        Tracer<> trc_sel(trc->trace_select("SELECT 1", 3));
+        trace::PhaseTimer timer(trc_sel, "sql");
+    }
+    trc.done();
+
+    std::stringstream out;
+    root.to_folded(out);
+
+    // One line per step and per phase, in the format used by flame graph
+    // tools
+    std::vector<std::string> stacks;
+    std::string line;
+    while (getline(out, line))
+    {
+        auto pos = line.rfind(' ');
+        wassert(actual(pos) != std::string::npos);
+        stacks.push_back(line.substr(0, pos));
+    }
+    wassert(actual(stacks.size()) == 4u);
+    wassert(actual(stacks[0]) == "query_data;materialize");
+    wassert(actual(stacks[1]) == "query_data;select;sql");
+    wassert(actual(stacks[2]) == "query_data;select");
+    wassert(actual(stacks[3]) == "query_data");
+});
+
 }
 
 }
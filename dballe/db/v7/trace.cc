@@ -69,12 +69,12 @@ std::string format_time_fname(time_t time)
 namespace trace {
 
 Step::Step(const std::string& name)
-    : name(name), start(clock())
+    : name(name), start(now_nsec())
 {
 }
 
 Step::Step(const std::string& name, const std::string& detail)
-    : name(name), detail(detail), start(clock())
+    : name(name), detail(detail), start(now_nsec())
 {
 }
 
@@ -86,12 +86,19 @@ Step::~Step()
 
 void Step::done()
 {
-    end = clock();
+    end = now_nsec();
 }
 
 unsigned Step::elapsed_usec() const
 {
-    return (end - start) * 1000000 / CLOCKS_PER_SEC;
+    return elapsed_nsec() / 1000;
+}
+
+uint64_t Step::elapsed_nsec() const
+{
+    // Steps that are still running have no end time
+    if (end < start) return 0;
+    return end - start;
 }
 
 void Step::to_json(core::JSONWriter& writer) const
@@ -101,6 +108,22 @@ void Step::to_json(core::JSONWriter& writer) const
     writer.add("detail", detail);
     writer.add("rows", (int)rows);
     writer.add("usecs", (int)elapsed_usec());
+    writer.add("nsecs", (size_t)elapsed_nsec());
+    if (!phases.empty())
+    {
+        writer.add("phases");
+        writer.start_mapping();
+        for (const auto& p: phases)
+        {
+            writer.add(p.first);
+            writer.start_mapping();
+            writer.add("count", (int)p.second.count);
+            writer.add("allocs", (int)p.second.allocs);
+            writer.add("nsecs", (size_t)p.second.nsecs);
+            writer.end_mapping();
+        }
+        writer.end_mapping();
+    }
     if (child)
     {
         writer.add("ops");
@@ -112,6 +135,34 @@ void Step::to_json(core::JSONWriter& writer) const
     writer.end_mapping();
 }
 
+void Step::to_folded(std::ostream& out) const
+{
+    to_folded(std::string(), out);
+}
+
+void Step::to_folded(const std::string& stack, std::ostream& out) const
+{
+    std::string path = stack;
+    if (!path.empty()) path += ";";
+    // Semicolons and spaces are separators in the folded format
+    for (auto c: name)
+        path += (c == ';' || c == ' ') ? '_' : c;
+
+    uint64_t self = elapsed_nsec();
+    for (const auto& p: phases)
+    {
+        out << path << ";" << p.first << " " << p.second.nsecs << "\n";
+        self = self > p.second.nsecs ? self - p.second.nsecs : 0;
+    }
+    for (Step* s = child; s; s = s->sibling)
+    {
+        uint64_t elapsed = s->elapsed_nsec();
+        self = self > elapsed ? self - elapsed : 0;
+        s->to_folded(path, out);
+    }
+    out << path << " " << self << "\n";
+}
+
 Tracer<> Transaction::trace_query_stations(const Query& query)
 {
     return Tracer<>(add_child(new trace::Step("query_stations", query_to_string(query))));
@@ -191,35 +242,38 @@ QuietCollectTrace::~QuietCollectTrace()
         delete i;
 }
 
+trace::Step* QuietCollectTrace::add_step(trace::Step* step)
+{
+    std::lock_guard<std::mutex> lock(steps_mutex);
+    steps.push_back(step);
+    return step;
+}
+
 Tracer<> QuietCollectTrace::trace_connect(const std::string& url)
 {
-    steps.push_back(new trace::Step("connect", url));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("connect", url)));
 }
 
 Tracer<> QuietCollectTrace::trace_reset(const char* repinfo_file)
 {
-    steps.push_back(new trace::Step("reset", repinfo_file ? repinfo_file : ""));
-    return steps.back();
+    return Tracer<>(add_step(new trace::Step("reset", repinfo_file ? repinfo_file : "")));
 }
 
 Tracer<trace::Transaction> QuietCollectTrace::trace_transaction()
 {
     trace::Transaction* res = new trace::Transaction;
-    steps.push_back(res);
+    add_step(res);
     return res;
 }
 
 Tracer<> QuietCollectTrace::trace_remove_all()
 {
-    steps.push_back(new trace::Step("remove_all"));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("remove_all")));
 }
 
 Tracer<> QuietCollectTrace::trace_vacuum()
 {
-    steps.push_back(new trace::Step("vacuum"));
-    return Tracer<>(steps.back());
+    return Tracer<>(add_step(new trace::Step("vacuum")));
 }
 
 
@@ -260,6 +314,16 @@ void CollectTrace::save()
     fwrite(json_buf.str().data(), json_buf.str().size(), 1, out);
     putc('\n', out);
     fclose(out);
+
+    // Also save the timings in a format that can be rendered as a flame graph
+    std::stringstream folded_buf;
+    for (const auto& s: steps)
+        s->to_folded(folded_buf);
+    fname.resize(fname.size() - 5);
+    fname += ".folded";
+    out = fopen(fname.c_str(), "wt");
+    fwrite(folded_buf.str().data(), folded_buf.str().size(), 1, out);
+    fclose(out);
 }
 
 
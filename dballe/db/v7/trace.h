@@ -4,6 +4,10 @@
 #include <dballe/fwd.h>
 #include <dballe/db/v7/fwd.h>
 #include <dballe/core/json.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -18,7 +22,28 @@ struct Aggregate
 {
     unsigned count = 0;
     unsigned rows = 0;
-    clock_t ticks = 0;
+    uint64_t nsecs = 0;
+};
+
+/// Current time in nanoseconds, from a monotonic clock
+inline uint64_t now_nsec()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Time spent in a phase of the work of a Step, like decoding values, that is
+ * too fine grained to be traced with a Step of its own
+ */
+struct Phase
+{
+    /// Number of times the phase has been run
+    unsigned count = 0;
+    /// Number of heap objects allocated in the phase, as counted by the caller
+    unsigned allocs = 0;
+    /// Total time spent in the phase
+    uint64_t nsecs = 0;
 };
 
 
@@ -40,10 +65,12 @@ protected:
     std::string detail;
     /// Number of database rows affected
     unsigned rows = 0;
-    /// Timing start
-    clock_t start = 0;
-    /// Timing end
-    clock_t end = 0;
+    /// Timing start, in nanoseconds
+    uint64_t start = 0;
+    /// Timing end, in nanoseconds
+    uint64_t end = 0;
+    /// Time spent in phases of this operation, by phase name
+    std::vector<std::pair<std::string, Phase>> phases;
 
     template<typename T>
     void add_sibling(T* step)
@@ -75,13 +102,28 @@ protected:
         return sibling->last_sibling(name, last);
     }
 
+    void _aggregate_phase(const char* name, Phase& agg) const
+    {
+        for (const auto& p: phases)
+            if (p.first == name)
+            {
+                agg.count += p.second.count;
+                agg.allocs += p.second.allocs;
+                agg.nsecs += p.second.nsecs;
+            }
+        if (sibling) sibling->_aggregate_phase(name, agg);
+        if (child) child->_aggregate_phase(name, agg);
+    }
+
+    void to_folded(const std::string& stack, std::ostream& out) const;
+
     void _aggregate(const std::string& name, Aggregate& agg)
     {
         if (this->name == name)
         {
             ++agg.count;
             agg.rows += rows;
-            agg.ticks += end - start;
+            agg.nsecs += elapsed_nsec();
         }
         if (sibling) sibling->_aggregate(name, agg);
         if (child) child->_aggregate(name, agg);
@@ -94,9 +136,28 @@ public:
 
     void done();
     unsigned elapsed_usec() const;
+    uint64_t elapsed_nsec() const;
 
     void to_json(core::JSONWriter& writer) const;
 
+    /**
+     * Write the timings of this step and all its children in the folded
+     * stack format used by flame graph tools: one line per step or phase,
+     * with the semicolon-separated names of its stack and the nanoseconds
+     * spent in it and not in its children
+     */
+    void to_folded(std::ostream& out) const;
+
+    /// Return the accounting for the phase with the given name, creating it if missing
+    Phase& phase(const char* name)
+    {
+        for (auto& p: phases)
+            if (p.first == name)
+                return p.second;
+        phases.emplace_back(name, Phase());
+        return phases.back().second;
+    }
+
     // Remove all children accumulated so far
     void clear()
     {
@@ -111,6 +172,21 @@ public:
         return res;
     }
 
+    /// Sum the accounting of a phase in this step and all its children
+    Phase aggregate_phase(const char* name) const
+    {
+        Phase res;
+        for (const auto& p: phases)
+            if (p.first == name)
+            {
+                res.count += p.second.count;
+                res.allocs += p.second.allocs;
+                res.nsecs += p.second.nsecs;
+            }
+        if (child) child->_aggregate_phase(name, res);
+        return res;
+    }
+
     Step* first_child(const std::string& name)
     {
         if (!child) return nullptr;
@@ -168,6 +244,38 @@ public:
 };
 
 
+/**
+ * Account the time from construction to destruction to a phase of a Step.
+ *
+ * It does nothing if the tracer is not active.
+ */
+class PhaseTimer
+{
+protected:
+    Phase* phase;
+    uint64_t start;
+
+public:
+    PhaseTimer(Tracer<>& trc, const char* name)
+        : phase(trc ? &trc->phase(name) : nullptr), start(phase ? now_nsec() : 0)
+    {
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    ~PhaseTimer()
+    {
+        if (!phase) return;
+        phase->nsecs += now_nsec() - start;
+        ++phase->count;
+    }
+
+    /// Count heap objects allocated in this phase
+    void add_allocs(unsigned amount=1)
+    {
+        if (phase) phase->allocs += amount;
+    }
+};
+
 class Transaction : public Step
 {
 public:
@@ -220,6 +328,11 @@ class QuietCollectTrace : public Trace
 {
 protected:
     std::vector<trace::Step*> steps;
+    /// Protects steps when transactions are traced from multiple threads
+    std::mutex steps_mutex;
+
+    /// Append a step to steps, returning it
+    trace::Step* add_step(trace::Step* step);
 
 public:
     QuietCollectTrace() = default;
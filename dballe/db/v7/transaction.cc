@@ -7,6 +7,7 @@
 #include "repinfo.h"
 #include "batch.h"
 #include "trace.h"
+#include "pool.h"
 #include "dballe/core/query.h"
 #include "dballe/core/data.h"
 #include "dballe/sql/sql.h"
@@ -21,13 +22,26 @@ namespace db {
 namespace v7 {
 
 Transaction::Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction)
-    : db(db), sql_transaction(std::move(sql_transaction)), batch(*this), trc(db->trace->trace_transaction())
+    : m_driver(&db->driver()), db(db), conn(db->conn), sql_transaction(std::move(sql_transaction)), batch(*this), trc(db->trace->trace_transaction())
 {
-    m_repinfo = db->driver().create_repinfo(*this).release();
-    m_station = db->driver().create_station(*this).release();
-    m_levtr = db->driver().create_levtr(*this).release();
-    m_station_data = db->driver().create_station_data(*this).release();
-    m_data = db->driver().create_data(*this).release();
+    m_repinfo = driver().create_repinfo(*this).release();
+    m_station = driver().create_station(*this).release();
+    m_levtr = driver().create_levtr(*this).release();
+    m_station_data = driver().create_station_data(*this).release();
+    m_data = driver().create_data(*this).release();
+    load_caches();
+}
+
+Transaction::Transaction(std::shared_ptr<v7::DB> db, std::shared_ptr<PooledConnection> pooled, bool readonly)
+    : m_driver(pooled->driver.get()), db(db), pooled(pooled), conn(pooled->conn), readonly(readonly),
+      sql_transaction(pooled->conn->transaction(readonly)), batch(*this), trc(db->trace->trace_transaction())
+{
+    m_repinfo = driver().create_repinfo(*this).release();
+    m_station = driver().create_station(*this).release();
+    m_levtr = driver().create_levtr(*this).release();
+    m_station_data = driver().create_station_data(*this).release();
+    m_data = driver().create_data(*this).release();
+    load_caches();
 }
 
 Transaction::~Transaction()
@@ -40,6 +54,25 @@ Transaction::~Transaction()
     delete m_repinfo;
 }
 
+void Transaction::load_caches()
+{
+    // Read-only transactions cannot change repinfo, and can reuse what other
+    // transactions on the same pool have already read
+    if (pooled && readonly && db->pool->load_snapshot(*this))
+        return;
+    repinfo().read_cache();
+}
+
+void Transaction::save_snapshot() noexcept
+{
+    if (!pooled) return;
+    try {
+        db->pool->save_snapshot(*this);
+    } catch (std::exception&) {
+        // The snapshot is only an optimization
+    }
+}
+
 v7::Repinfo& Transaction::repinfo()
 {
     return *m_repinfo;
@@ -68,7 +101,13 @@ v7::Data& Transaction::data()
 void Transaction::commit()
 {
     if (fired) return;
+    if (!data().summary_changes.empty())
+    {
+        Tracer<> trc_flush(trc ? trc->trace_func("flush_summary") : nullptr);
+        data().flush_summary(trc_flush);
+    }
     sql_transaction->commit();
+    save_snapshot();
     clear_cached_state();
     fired = true;
     trc.done();
@@ -78,6 +117,7 @@ void Transaction::rollback()
 {
     if (fired) return;
     sql_transaction->rollback();
+    if (readonly) save_snapshot();
     clear_cached_state();
     fired = true;
     trc.done();
@@ -87,6 +127,7 @@ void Transaction::rollback_nothrow() noexcept
 {
     if (fired) return;
     sql_transaction->rollback_nothrow();
+    if (readonly) save_snapshot();
     clear_cached_state();
     fired = true;
     trc.done();
@@ -94,11 +135,13 @@ void Transaction::rollback_nothrow() noexcept
 
 void Transaction::clear_cached_state()
 {
-    repinfo().read_cache();
     levtr().clear_cache();
+    station().clear_cache();
     station_data().clear_cache();
     data().clear_cache();
+    data().summary_changes.clear();
     batch.clear();
+    load_caches();
 }
 
 Transaction& Transaction::downcast(dballe::db::Transaction& transaction)
@@ -111,7 +154,7 @@ Transaction& Transaction::downcast(dballe::db::Transaction& transaction)
 void Transaction::remove_all()
 {
     auto trc = db->trace->trace_remove_all();
-    db->driver().remove_all_v7(); // TODO: pass trace step
+    driver().remove_all_v7(); // TODO: pass trace step
     clear_cached_state();
 }
 
@@ -201,6 +244,8 @@ void Transaction::remove_station_data_by_id(int id)
 void Transaction::remove_data_by_id(int id)
 {
     Tracer<> trc(this->trc ? this->trc->trace_remove_data_by_id(id) : nullptr);
+    if (driver().has_data_summary())
+        data().summary_remove_by_id(trc, id);
     data().remove_by_id(trc, id);
     batch.clear();
 }
@@ -229,6 +274,7 @@ std::unique_ptr<dballe::CursorData> Transaction::query_data(const Query& query)
 std::unique_ptr<dballe::CursorSummary> Transaction::query_summary(const Query& query)
 {
     Tracer<> trc(this->trc ? this->trc->trace_query_summary(query) : nullptr);
+    data().flush_summary(trc);
     auto res = cursor::run_summary_query(trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()), core::Query::downcast(query), db->explain_queries);
     return res;
 }
@@ -266,33 +312,13 @@ void Transaction::attr_insert_data(int data_id, const Values& attrs)
 void Transaction::attr_remove_station(int data_id, const db::AttrList& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_station") : nullptr);
-    if (attrs.empty())
-    {
-        // Delete all attributes
-        char buf[64];
-        snprintf(buf, 64, "UPDATE station_data SET attrs=NULL WHERE id=%d", data_id);
-        Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
-    } else {
-        auto& d = station_data();
-        d.remove_attrs(trc, data_id, attrs);
-    }
+    station_data().remove_attrs(trc, data_id, attrs);
 }
 
 void Transaction::attr_remove_data(int data_id, const db::AttrList& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_data") : nullptr);
-    if (attrs.empty())
-    {
-        // Delete all attributes
-        char buf[64];
-        snprintf(buf, 64, "UPDATE data SET attrs=NULL WHERE id=%d", data_id);
-        Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
-    } else {
-        auto& d = data();
-        d.remove_attrs(trc, data_id, attrs);
-    }
+    data().remove_attrs(trc, data_id, attrs);
 }
 
 void Transaction::update_repinfo(const char* repinfo_file, int* added, int* deleted, int* updated)
@@ -25,6 +25,13 @@ protected:
     v7::StationData* m_station_data = nullptr;
     /// Variable data
     v7::Data* m_data = nullptr;
+    /// Backend driver for conn
+    v7::Driver* m_driver;
+
+    /// Fill the repinfo and levtr caches
+    void load_caches();
+    /// Update the pool snapshot with the contents of the caches
+    void save_snapshot() noexcept;
 
     void add_msg_to_batch(Tracer<>& trc, const Message& message, const dballe::DBImportOptions& opts);
 
@@ -32,6 +39,12 @@ public:
     typedef v7::DB DB;
 
     std::shared_ptr<v7::DB> db;
+    /// Pooled connection used by this transaction, if db has a connection pool
+    std::shared_ptr<PooledConnection> pooled;
+    /// Database connection used by this transaction
+    std::shared_ptr<dballe::sql::Connection> conn;
+    /// True if the transaction was started as read only
+    bool readonly = false;
     /// SQL-side transaction
     std::shared_ptr<dballe::sql::Transaction> sql_transaction;
     /// True if commit or rollback have already been called on this transaction
@@ -42,12 +55,15 @@ public:
     v7::Tracer<v7::trace::Transaction> trc;
 
     Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction);
+    Transaction(std::shared_ptr<v7::DB> db, std::shared_ptr<PooledConnection> pooled, bool readonly);
     Transaction(const Transaction&) = delete;
     Transaction(Transaction&&) = delete;
     Transaction& operator=(const Transaction&) = delete;
     Transaction& operator=(Transaction&&) = delete;
     ~Transaction();
 
+    /// Access the backend driver for the connection used by this transaction
+    v7::Driver& driver() { return *m_driver; }
     /// Access the repinfo table
     v7::Repinfo& repinfo();
     /// Access the station table
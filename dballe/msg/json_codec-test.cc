@@ -1,7 +1,9 @@
 #include "tests.h"
 #include "json_codec.h"
+#include "msg.h"
 #include <wreport/options.h>
 #include <cstring>
+#include <sstream>
 
 using namespace std;
 using namespace dballe;
@@ -32,6 +34,43 @@ add_method("read", []() {
     wassert(actual(count) == 5);
 });
 
+add_method("write", []() {
+    auto msg = make_shared<impl::Message>();
+    msg->type = MessageType::SYNOP;
+    msg->station_data.set(newvar(WR_VAR(0, 1, 194), (const char*)"synop"));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 1), 2020));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 2), 1));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 3), 2));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 4), 3));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 5), 4));
+    msg->station_data.set(newvar(WR_VAR(0, 4, 6), 5));
+    msg->station_data.set(newvar(WR_VAR(0, 5, 1), 45.0));
+    msg->station_data.set(newvar(WR_VAR(0, 6, 1), 11.0));
+    msg->set(Level(1), Trange::instant(), newvar(WR_VAR(0, 12, 101), 280.15));
+    impl::Messages msgs;
+    msgs.emplace_back(msg);
+
+    std::string expected =
+        R"({"version":"0.1","network":"synop","ident":null,"lon":1100000,"lat":4500000,"date":"2020-01-02T03:04:05Z",)"
+        R"("data":[{"vars":{"B01194":{"v":"synop"},"B04001":{"v":2020},"B04002":{"v":1},"B04003":{"v":2},)"
+        R"("B04004":{"v":3},"B04005":{"v":4},"B04006":{"v":5},"B05001":{"v":45.00000},"B06001":{"v":11.00000}}},)"
+        R"({"timerange":[254,0,0],"level":[1,null,null,null],"vars":{"B12101":{"v":280.15}}}]})" "\n";
+
+    impl::msg::JsonExporter exporter;
+    std::stringstream out;
+    exporter.write(msgs, out);
+    wassert(actual(out.str()) == expected);
+    wassert(actual(exporter.to_binary(msgs)) == expected);
+
+    // Decoding and encoding again gives the same JSON
+    BinaryMessage raw(Encoding::JSON);
+    raw.data = expected;
+    impl::msg::JsonImporter importer;
+    impl::Messages decoded = importer.from_binary(raw);
+    wassert(actual(decoded.size()) == 1u);
+    wassert(actual(exporter.to_binary(decoded)) == expected);
+});
+
 add_method("domain_throw", []() {
     auto file = File::create(Encoding::JSON, tests::datafile("json/issue241.json"), "r");
     auto options = ImporterOptions::create();
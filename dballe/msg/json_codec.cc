@@ -62,10 +62,11 @@ struct JSONMsgReader : public core::JSONReader
 
     bool parse_msgs(const std::string& buf, std::function<bool(std::unique_ptr<impl::Message>)> cb)
     {
-        std::stringstream in(buf);
-        while (!in.eof())
+        const char* cur = buf.data();
+        const char* end = cur + buf.size();
+        while (cur != end)
         {
-            parse(in);
+            cur = parse(cur, end);
             if (not state.empty() && state.top() == MSG_END) {
                 state.pop();
                 if (!cb(std::move(msg)))
@@ -310,12 +311,16 @@ struct JSONMsgReader : public core::JSONReader
                 state.pop();
                 break;
             case MSG_DATA_LIST_ITEM_VARS_MAPPING_VAR_KEY:
+            {
                 // Var::seti on decimal vars is considered as the value
                 // with the scale already applied
-                var->setf(std::to_string(val).c_str());
+                char buf[16];
+                snprintf(buf, sizeof(buf), "%d", val);
+                var->setf(buf);
                 ctx->values.set(*var);
                 state.pop();
                 break;
+            }
             case MSG_DATA_LIST_ITEM_VARS_MAPPING_ATTR_MAPPING_VAR_KEY:
                 state.pop();
                 attr->set(val);
@@ -451,35 +456,44 @@ JsonExporter::~JsonExporter() {}
 std::string JsonExporter::to_binary(const std::vector<std::shared_ptr<dballe::Message>>& msgs) const
 {
     std::stringstream buf;
-    core::JSONWriter json(buf);
+    write(msgs, buf);
+    return buf.str();
+}
+
+void JsonExporter::write(const std::vector<std::shared_ptr<dballe::Message>>& msgs, std::ostream& out) const
+{
+    core::JSONWriter json(out);
 
     for (const auto& mi: msgs) {
-        auto msg = impl::Message::downcast(mi);
+        const impl::Message& msg = impl::Message::downcast(*mi);
         json.start_mapping();
         json.add("version");
         json.add(DBALLE_JSON_VERSION);
         json.add("network");
-        json.add(msg->get_rep_memo_var() ? msg->get_rep_memo_var()->enqc() : dballe::impl::Message::repmemo_from_type(msg->type));
+        json.add(msg.get_rep_memo_var() ? msg.get_rep_memo_var()->enqc() : dballe::impl::Message::repmemo_from_type(msg.type));
         json.add("ident");
-        if (msg->get_ident_var() != NULL)
-            json.add(msg->get_ident_var()->enqc());
+        if (msg.get_ident_var() != NULL)
+            json.add(msg.get_ident_var()->enqc());
         else
             json.add_null();
         json.add("lon");
-        json.add_int(msg->get_longitude_var()->enqi());
+        json.add_int(msg.get_longitude_var()->enqi());
         json.add("lat");
-        json.add_int(msg->get_latitude_var()->enqi());
+        json.add_int(msg.get_latitude_var()->enqi());
         json.add("date");
-        std::stringstream ss;
-        msg->get_datetime().to_stream_iso8601(ss, 'T', "Z");
-        json.add(ss.str().c_str());
+        Datetime dt = msg.get_datetime();
+        char date[32];
+        snprintf(date, sizeof(date), "%04u-%02u-%02uT%02u:%02u:%02uZ",
+                (unsigned)dt.year, (unsigned)dt.month, (unsigned)dt.day,
+                (unsigned)dt.hour, (unsigned)dt.minute, (unsigned)dt.second);
+        json.add(date);
         json.add("data");
         json.start_list();
             json.start_mapping();
             json.add("vars");
-            json.add(msg->station_data);
+            json.add(msg.station_data);
             json.end_mapping();
-            for (const auto& ctx: msg->data) {
+            for (const auto& ctx: msg.data) {
                 json.start_mapping();
                 json.add("timerange");
                 json.add(ctx.trange);
@@ -493,10 +507,7 @@ std::string JsonExporter::to_binary(const std::vector<std::shared_ptr<dballe::Me
         json.end_mapping();
         json.add_break();
     }
-
-    return buf.str();
 }
-
 }
 }
 }
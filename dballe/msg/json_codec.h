@@ -5,6 +5,7 @@
 #include <dballe/importer.h>
 #include <dballe/exporter.h>
 #include <dballe/message.h>
+#include <ostream>
 
 #define DBALLE_JSON_VERSION "0.1"
 
@@ -31,6 +32,12 @@ public:
     ~JsonExporter();
 
     std::string to_binary(const std::vector<std::shared_ptr<dballe::Message>>& msgs) const override;
+
+    /**
+     * Write the messages to \a out as they are encoded, one JSON line per
+     * message
+     */
+    void write(const std::vector<std::shared_ptr<dballe::Message>>& msgs, std::ostream& out) const;
 };
 
 }
@@ -79,6 +79,87 @@ add_method("ordering", []() {
     wassert(actual(msg.get(lev1, Trange(3, 3, 3), WR_VAR(0, 1, 1))) == (Var*)0);
 });
 
+add_method("ordering_large", []() {
+    // Messages with many contexts set through the public API stay sorted
+    auto msg = make_shared<impl::Message>();
+    msg->set_datetime(Datetime(2020, 10, 8, 0, 0, 0));
+    msg->set_rep_memo("test");
+    msg->set_longitude(12.12345);
+    msg->set_latitude(43.12345);
+    const int count = msg::Contexts::index_threshold * 4;
+    for (int i = count; i > 0; --i)
+        msg->set(Level(100, i * 100), Trange::instant(), newvar(WR_VAR(0, 12, 101), 200.0 + i));
+    for (int i = 1; i <= count; i += 3)
+        msg->obtain_context(Level(100, i * 100 + 50), Trange::instant()).values.set(newvar(WR_VAR(0, 11, 1), i));
+    wassert(actual(msg->data.size()) == (size_t)count + (count + 2) / 3);
+    wassert(actual(msg->data.is_sorted()).istrue());
+
+    const impl::Message& cmsg = *msg;
+    wassert(msg_is_sorted(cmsg));
+    wassert(actual(cmsg.data.begin()->level) == Level(100, 100));
+    wassert(actual(cmsg.get(Level(100, 400), Trange::instant(), WR_VAR(0, 12, 101))->enqd()) == 204.0);
+
+    // Copies compare the same
+    impl::Message copy(cmsg);
+    wassert(msg_is_sorted(copy));
+    wassert(actual(cmsg.diff(copy)) == 0u);
+
+    // The message can be encoded, and decodes with the same values
+    auto exporter = Exporter::create(Encoding::BUFR);
+    BinaryMessage bmsg(Encoding::BUFR);
+    bmsg.data = exporter->to_binary({msg});
+    auto imported = Importer::create(Encoding::BUFR)->from_binary(bmsg);
+    wassert(actual(imported.size()) == 1u);
+    const impl::Message& decoded = impl::Message::downcast(*imported[0]);
+    wassert(msg_is_sorted(decoded));
+    for (int i = 1; i <= count; ++i)
+        wassert(actual(decoded.get(Level(100, i * 100), Trange::instant(), WR_VAR(0, 12, 101))->enqd()) == 200.0 + i);
+});
+
+add_method("ordering_bulk", []() {
+    // Contexts added during a bulk insert are indexed by hash, and sorted at
+    // the end
+    impl::Message msg;
+    const int count = msg::Contexts::index_threshold * 4;
+    {
+        msg::Contexts::BulkInsert bulk(msg.data);
+        for (int i = count; i > 0; --i)
+            msg.set(Level(100, i * 100), Trange::instant(), newvar(WR_VAR(0, 12, 101), 200.0 + i));
+        // Setting values in existing contexts finds them in the index
+        for (int i = 1; i <= count; i += 3)
+            msg.set(Level(100, i * 100), Trange::instant(), newvar(WR_VAR(0, 11, 1), i));
+        wassert(actual(msg.data.size()) == (size_t)count);
+        wassert(actual(msg.data.is_sorted()).isfalse());
+
+        const wreport::Var* var = msg.get(Level(100, 100), Trange::instant(), WR_VAR(0, 12, 101));
+        wassert(actual(var) != (const wreport::Var*)0);
+        wassert(actual(var->enqd()) == 201.0);
+
+        wassert(actual(msg.remove_context(Level(100, 200), Trange::instant())).istrue());
+        wassert(actual(msg.remove_context(Level(100, 200), Trange::instant())).isfalse());
+        wassert(actual(msg.data.size()) == (size_t)count - 1);
+        wassert(actual(msg.get(Level(100, 300), Trange::instant(), WR_VAR(0, 12, 101))->enqd()) == 203.0);
+
+        // Copies made meanwhile are sorted
+        impl::Message copy(msg);
+        wassert(actual(copy.data.is_sorted()).istrue());
+        wassert(msg_is_sorted(copy));
+    }
+
+    wassert(actual(msg.data.is_sorted()).istrue());
+    wassert(msg_is_sorted(msg));
+    const impl::Message& cmsg = msg;
+    const msg::Context* ctx = cmsg.find_context(Level(100, 500), Trange::instant());
+    wassert(actual(ctx->values.maybe_var(WR_VAR(0, 12, 101))->enqd()) == 205.0);
+    wassert(actual(msg.get(Level(100, 400), Trange::instant(), WR_VAR(0, 11, 1))->enqi()) == 4);
+
+    // New contexts after the bulk insert are inserted sorted
+    msg.set(Level(100, 150), Trange::instant(), newvar(WR_VAR(0, 12, 101), 150.0));
+    wassert(actual(msg.data.is_sorted()).istrue());
+    wassert(msg_is_sorted(msg));
+    wassert(actual(msg.get(Level(100, 150), Trange::instant(), WR_VAR(0, 12, 101))->enqd()) == 150.0);
+});
+
 add_method("compose", []() {
     // Try to write a generic message from scratch
     auto msg = make_shared<impl::Message>();
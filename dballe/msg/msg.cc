@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -22,13 +23,60 @@ namespace impl {
 
 namespace msg {
 
+size_t Contexts::LevTrHash::operator()(const std::pair<Level, Trange>& key) const noexcept
+{
+    return std::hash<Level>()(key.first) * 31 + std::hash<Trange>()(key.second);
+}
+
+Contexts::Contexts(const Contexts& o)
+    : m_contexts(o.m_contexts), m_sorted(o.m_sorted), m_index(o.m_index)
+{
+    sort();
+}
+
+Contexts::Contexts(Contexts&& o)
+    : m_contexts(std::move(o.m_contexts)), m_sorted(o.m_sorted), m_index(std::move(o.m_index))
+{
+    o.clear();
+    sort();
+}
+
+Contexts& Contexts::operator=(const Contexts& o)
+{
+    if (this == &o) return *this;
+    m_contexts = o.m_contexts;
+    m_sorted = o.m_sorted;
+    m_index = o.m_index;
+    if (!m_bulk) sort();
+    return *this;
+}
+
+Contexts& Contexts::operator=(Contexts&& o)
+{
+    if (this == &o) return *this;
+    m_contexts = std::move(o.m_contexts);
+    m_sorted = o.m_sorted;
+    m_index = std::move(o.m_index);
+    o.clear();
+    if (!m_bulk) sort();
+    return *this;
+}
+
 Contexts::const_iterator Contexts::find(const Level& level, const Trange& trange) const
 {
+    // Look among the contexts that are not sorted yet
+    if (!m_index.empty())
+    {
+        auto i = m_index.find(std::make_pair(level, trange));
+        if (i != m_index.end())
+            return m_contexts.begin() + i->second;
+    }
+
     /* Binary search */
-    if (m_contexts.empty())
+    if (m_sorted == 0)
         return m_contexts.end();
 
-    const_iterator low = m_contexts.begin(), high = (m_contexts.end() - 1);
+    const_iterator low = m_contexts.begin(), high = (m_contexts.begin() + m_sorted - 1);
     while (low <= high)
     {
         const_iterator middle = low + (high - low) / 2;
@@ -45,11 +93,19 @@ Contexts::const_iterator Contexts::find(const Level& level, const Trange& trange
 
 Contexts::iterator Contexts::find(const Level& level, const Trange& trange)
 {
+    // Look among the contexts that are not sorted yet
+    if (!m_index.empty())
+    {
+        auto i = m_index.find(std::make_pair(level, trange));
+        if (i != m_index.end())
+            return m_contexts.begin() + i->second;
+    }
+
     /* Binary search */
-    if (m_contexts.empty())
+    if (m_sorted == 0)
         return m_contexts.end();
 
-    iterator low = m_contexts.begin(), high = (m_contexts.end() - 1);
+    iterator low = m_contexts.begin(), high = (m_contexts.begin() + m_sorted - 1);
     while (low <= high)
     {
         iterator middle = low + (high - low) / 2;
@@ -69,6 +125,14 @@ Contexts::iterator Contexts::insert_new(const Level& level, const Trange& trange
     // Enlarge the buffer
     m_contexts.emplace_back(level, trange);
 
+    if (m_bulk && (m_contexts.size() > index_threshold || m_sorted + 1 != m_contexts.size()))
+    {
+        // Large message: append unsorted, to be sorted all at once at the
+        // end of the bulk insert
+        m_index.emplace(std::make_pair(level, trange), m_contexts.size() - 1);
+        return m_contexts.end() - 1;
+    }
+
     // Insertionsort
     iterator pos;
     for (pos = m_contexts.end() - 1; pos > m_contexts.begin(); --pos)
@@ -78,6 +142,7 @@ Contexts::iterator Contexts::insert_new(const Level& level, const Trange& trange
         else
             break;
     }
+    ++m_sorted;
     return pos;
 }
 
@@ -94,10 +159,41 @@ bool Contexts::drop(const Level& level, const Trange& trange)
     iterator pos = find(level, trange);
     if (pos == end())
         return false;
-    m_contexts.erase(pos);
+    erase(pos);
     return true;
 }
 
+Contexts::iterator Contexts::erase(iterator pos)
+{
+    size_t idx = pos - m_contexts.begin();
+    iterator res = m_contexts.erase(pos);
+    if (idx < m_sorted)
+        --m_sorted;
+    if (!m_index.empty())
+        reindex();
+    return res;
+}
+
+void Contexts::reindex()
+{
+    m_index.clear();
+    for (size_t i = m_sorted; i < m_contexts.size(); ++i)
+        m_index.emplace(std::make_pair(m_contexts[i].level, m_contexts[i].trange), i);
+}
+
+void Contexts::sort()
+{
+    if (is_sorted())
+        return;
+
+    auto cmp = [](const Context& a, const Context& b) { return a.compare(b) < 0; };
+    auto middle = m_contexts.begin() + m_sorted;
+    std::sort(middle, m_contexts.end(), cmp);
+    std::inplace_merge(m_contexts.begin(), middle, m_contexts.end(), cmp);
+    m_sorted = m_contexts.size();
+    m_index.clear();
+}
+
 
 Messages messages_from_csv(CSVReader& in)
 {
@@ -513,6 +609,7 @@ bool Message::from_csv(CSVReader& in)
 
     string old_lat, old_lon, old_rep, old_date;
     bool first = true;
+    msg::Contexts::BulkInsert bulk(data);
     while (true)
     {
         // If there are empty lines, use them as separators
@@ -909,14 +1006,17 @@ const char* Message::repmemo_from_type(MessageType type)
 void Message::sounding_pack_levels()
 {
     msg::Contexts new_data;
-    for (auto& ctx: data)
     {
-        if (ctx.find_vsig())
-            // FIXME: shouldn't this also set significance bits in the output level?
-            new_data.obtain(Level(ctx.level.ltype1, ctx.level.l1), ctx.trange)->values.merge(std::move(ctx.values));
-        else
-            // If it is not a sounding level, just copy it
-            new_data.obtain(ctx.level, ctx.trange)->values = std::move(ctx.values);
+        msg::Contexts::BulkInsert bulk(new_data);
+        for (auto& ctx: data)
+        {
+            if (ctx.find_vsig())
+                // FIXME: shouldn't this also set significance bits in the output level?
+                new_data.obtain(Level(ctx.level.ltype1, ctx.level.l1), ctx.trange)->values.merge(std::move(ctx.values));
+            else
+                // If it is not a sounding level, just copy it
+                new_data.obtain(ctx.level, ctx.trange)->values = std::move(ctx.values);
+        }
     }
     data = std::move(new_data);
 }
@@ -11,8 +11,11 @@
 #include <dballe/importer.h>
 #include <dballe/exporter.h>
 #include <stdio.h>
+#include <cassert>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <iosfwd>
 
 namespace dballe {
@@ -78,6 +81,18 @@ unsigned messages_diff(const Messages& msgs1, const Messages& msgs2);
 void messages_print(const Messages& msgs, FILE* out);
 
 
+/**
+ * Contexts of a message, sorted by level and time range.
+ *
+ * Contexts are kept sorted as they are added. Code that adds many contexts,
+ * like importers of soundings with hundreds of levels, can create a
+ * BulkInsert while it does so: contexts are then appended unsorted and found
+ * through a hash index, and are sorted all at once when the BulkInsert is
+ * destroyed. This keeps building large messages from taking quadratic time.
+ *
+ * Const access never reorders contexts, so pointers to contexts of a const
+ * message stay valid. Adding contexts invalidates them.
+ */
 class Contexts
 {
 public:
@@ -86,25 +101,60 @@ public:
     typedef std::vector<msg::Context>::const_reverse_iterator const_reverse_iterator;
     typedef std::vector<msg::Context>::reverse_iterator reverse_iterator;
 
+    /// Number of contexts after which new contexts are hash indexed
+    static const size_t index_threshold = 32;
+
+    /**
+     * Add contexts unsorted while this object exists, and sort them when it
+     * is destroyed.
+     *
+     * Contexts must not be iterated through a const reference meanwhile.
+     */
+    class BulkInsert
+    {
+        Contexts& contexts;
+
+    public:
+        BulkInsert(Contexts& contexts) : contexts(contexts) { ++contexts.m_bulk; }
+        BulkInsert(const BulkInsert&) = delete;
+        BulkInsert& operator=(const BulkInsert&) = delete;
+        ~BulkInsert() { if (--contexts.m_bulk == 0) contexts.sort(); }
+    };
+
 protected:
+    struct LevTrHash
+    {
+        size_t operator()(const std::pair<Level, Trange>& key) const noexcept;
+    };
+
     std::vector<msg::Context> m_contexts;
+    /// Number of contexts at the start of m_contexts that are sorted
+    size_t m_sorted = 0;
+    /// Position in m_contexts of the contexts that are not sorted yet
+    std::unordered_map<std::pair<Level, Trange>, size_t, LevTrHash> m_index;
+    /// Number of active BulkInsert objects
+    unsigned m_bulk = 0;
 
     iterator insert_new(const Level& level, const Trange& trange);
 
+    /// Rebuild m_index after contexts have been removed
+    void reindex();
+
 public:
     Contexts() = default;
-    Contexts(const Contexts&) = default;
-    Contexts(Contexts&&) = default;
-    Contexts& operator=(const Contexts&) = default;
-    Contexts& operator=(Contexts&&) = default;
+    /// Copies are sorted, even if \a o is being bulk inserted into
+    Contexts(const Contexts& o);
+    Contexts(Contexts&& o);
+    Contexts& operator=(const Contexts& o);
+    Contexts& operator=(Contexts&& o);
 
-    const_iterator begin() const { return m_contexts.begin(); }
+    const_iterator begin() const { assert(is_sorted()); return m_contexts.begin(); }
     const_iterator end() const { return m_contexts.end(); }
-    iterator begin() { return m_contexts.begin(); }
+    iterator begin() { sort(); return m_contexts.begin(); }
     iterator end() { return m_contexts.end(); }
-    const_reverse_iterator rbegin() const { return m_contexts.rbegin(); }
+    const_reverse_iterator rbegin() const { assert(is_sorted()); return m_contexts.rbegin(); }
     const_reverse_iterator rend() const { return m_contexts.rend(); }
-    const_iterator cbegin() const { return m_contexts.cbegin(); }
+    const_iterator cbegin() const { assert(is_sorted()); return m_contexts.cbegin(); }
     const_iterator cend() const { return m_contexts.cend(); }
 
     const_iterator find(const Level& level, const Trange& trange) const;
@@ -113,11 +163,26 @@ public:
     iterator obtain(const Level& level, const Trange& trange);
     bool drop(const Level& level, const Trange& trange);
 
+    /**
+     * Sort the contexts that have been added unsorted by a BulkInsert.
+     *
+     * Iterating a non-const Contexts sorts automatically.
+     */
+    void sort();
+
+    /// Check if all contexts are sorted
+    bool is_sorted() const { return m_sorted == m_contexts.size(); }
+
     size_t size() const { return m_contexts.size(); }
     bool empty() const { return m_contexts.empty(); }
-    void clear() { return m_contexts.clear(); }
+    void clear()
+    {
+        m_contexts.clear();
+        m_sorted = 0;
+        m_index.clear();
+    }
     void reserve(typename std::vector<Value>::size_type size) { m_contexts.reserve(size); }
-    iterator erase(iterator pos) { return m_contexts.erase(pos); }
+    iterator erase(iterator pos);
     // iterator erase(const_iterator pos) { return m_contexts.erase(pos); }
 };
 
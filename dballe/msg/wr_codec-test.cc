@@ -128,5 +128,27 @@ add_method("domain_tag", []() {
 });
 #endif
 
+add_method("preload_tables", []() {
+    for (const char* name: { "bufr/obs3-3.1.bufr", "bufr/ed4.bufr", "crex/test-synop0.crex" })
+    {
+        Encoding encoding = name[0] == 'b' ? Encoding::BUFR : Encoding::CREX;
+        auto file = File::create(encoding, tests::datafile(name), "r");
+        BinaryMessage bmsg = file->read();
+        wassert_true(bmsg);
+        wassert_true(impl::msg::preload_tables(bmsg));
+        // Tables are only loaded once
+        wassert_true(impl::msg::preload_tables(bmsg));
+    }
+
+    // Truncated headers are left to the decoder
+    BinaryMessage truncated(Encoding::BUFR);
+    truncated.data = std::string("BUFR\0\0\x10\x04", 8);
+    wassert_false(impl::msg::preload_tables(truncated));
+
+    // Other encodings do not use wreport tables
+    BinaryMessage json(Encoding::JSON);
+    wassert_true(impl::msg::preload_tables(json));
+});
+
 }
 }
@@ -8,6 +8,9 @@
 #include <wreport/bulletin.h>
 #include <wreport/vartable.h>
 #include <wreport/options.h>
+#include <condition_variable>
+#include <mutex>
+#include <set>
 
 using namespace wreport;
 using namespace std;
@@ -39,6 +42,152 @@ bool CrexImporter::foreach_decoded(const BinaryMessage& msg, std::function<bool(
     return foreach_decoded_bulletin(*bulletin, dest);
 }
 
+namespace {
+
+/// State of TablesLock, preferring writers so that they are not starved
+struct TablesLockState
+{
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned readers = 0;
+    unsigned writers_waiting = 0;
+    bool writer = false;
+    /// Header keys of the messages whose tables have been preloaded
+    std::set<std::string> preloaded;
+};
+
+TablesLockState& tables_lock_state()
+{
+    static TablesLockState state;
+    return state;
+}
+
+/**
+ * Build a key out of the parts of the header of a BUFR or CREX message that
+ * select its tables.
+ *
+ * Returns an empty string if the header cannot be read.
+ */
+std::string table_header_key(const BinaryMessage& msg)
+{
+    const std::string& data = msg.data;
+    switch (msg.encoding)
+    {
+        case Encoding::BUFR:
+        {
+            // Section 0 is "BUFR", 3 bytes of length and the edition number
+            if (data.size() < 8 || data.compare(0, 4, "BUFR") != 0)
+                return std::string();
+            unsigned edition = (unsigned char)data[7];
+            // Section 1 from the master table number to the local table
+            // version: octets 4 to 12 up to edition 3, 4 to 15 in edition 4
+            size_t size;
+            switch (edition)
+            {
+                case 2: case 3: size = 9; break;
+                case 4: size = 12; break;
+                default: return std::string();
+            }
+            if (data.size() < 8 + 3 + size)
+                return std::string();
+            return data.substr(7, 1) + data.substr(8 + 3, size);
+        }
+        case Encoding::CREX:
+        {
+            // Section 1 starts with the edition and table versions: Ttteevv
+            size_t start = data.find("++");
+            if (start == std::string::npos) return std::string();
+            start = data.find('T', start);
+            if (start == std::string::npos) return std::string();
+            size_t end = data.find_first_of(" \r\n", start);
+            if (end == std::string::npos) return std::string();
+            return data.substr(start, end - start);
+        }
+        default:
+            return std::string();
+    }
+}
+
+}
+
+void TablesLock::lock_shared()
+{
+    TablesLockState& s = tables_lock_state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    s.cond.wait(lock, [&] { return !s.writer && s.writers_waiting == 0; });
+    ++s.readers;
+}
+
+void TablesLock::unlock_shared()
+{
+    TablesLockState& s = tables_lock_state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (--s.readers == 0)
+        s.cond.notify_all();
+}
+
+void TablesLock::lock()
+{
+    TablesLockState& s = tables_lock_state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+    ++s.writers_waiting;
+    s.cond.wait(lock, [&] { return !s.writer && s.readers == 0; });
+    --s.writers_waiting;
+    s.writer = true;
+}
+
+void TablesLock::unlock()
+{
+    TablesLockState& s = tables_lock_state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.writer = false;
+    s.cond.notify_all();
+}
+
+bool preload_tables(const BinaryMessage& msg)
+{
+    if (msg.encoding != Encoding::BUFR && msg.encoding != Encoding::CREX)
+        return true;
+
+    std::string key = table_header_key(msg);
+    if (key.empty())
+        return false;
+
+    TablesLockState& s = tables_lock_state();
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.preloaded.find(key) != s.preloaded.end())
+            return true;
+    }
+
+    ExclusiveTablesLock lock;
+    try {
+        std::unique_ptr<Bulletin> bulletin;
+        if (msg.encoding == Encoding::BUFR)
+            bulletin = BufrBulletin::decode_header(msg.data);
+        else
+            bulletin = CrexBulletin::decode_header(msg.data);
+        bulletin->load_tables();
+    } catch (std::exception&) {
+        // Decoding will report the error
+        return false;
+    }
+
+    std::lock_guard<std::mutex> state_lock(s.mutex);
+    s.preloaded.insert(key);
+    return true;
+}
+
+namespace wr {
+
+void load_tables(wreport::Bulletin& bulletin)
+{
+    ExclusiveTablesLock lock;
+    bulletin.load_tables();
+}
+
+}
+
 Messages WRImporter::from_bulletin(const wreport::Bulletin& msg) const
 {
     Messages res;
@@ -95,6 +244,9 @@ bool WRImporter::foreach_decoded_bulletin(const wreport::Bulletin& msg, std::fun
     MessageType type = importer->scanType(msg);
     for (unsigned i = 0; i < msg.subsets.size(); ++i)
     {
+        // Messages are allocated one by one and not from an arena: dest
+        // owns them and can keep them, and their variables are wreport::Var
+        // objects that wreport allocates individually
         std::unique_ptr<Message> newmsg(new Message);
         newmsg->type = type;
         importer->import(msg.subsets[i], *newmsg);
@@ -183,46 +335,51 @@ extern void register_flight(TemplateRegistry&);
 extern void register_generic(TemplateRegistry&);
 extern void register_pollution(TemplateRegistry&);
 
-static TemplateRegistry* registry = NULL;
+static TemplateRegistry* create_registry()
+{
+    TemplateRegistry* registry = new TemplateRegistry;
+
+    registry->register_factory(MISSING_INT, "wmo", "WMO style templates (autodetect)",
+            [](const dballe::ExporterOptions& opts, const Messages& msgs) {
+                auto msg = Message::downcast(msgs[0]);
+                string tpl;
+                switch (msg->type)
+                {
+                    case MessageType::TEMP_SHIP: tpl = "temp-wmo"; break;
+                    default:
+                        tpl = format_message_type(msg->type);
+                        tpl += "-wmo";
+                        break;
+                }
+                const wr::TemplateFactory& fac = wr::TemplateRegistry::get(tpl);
+                return fac.factory(opts, msgs);
+            });
+
+    // Populate it
+    register_synop(*registry);
+    register_ship(*registry);
+    register_buoy(*registry);
+    register_metar(*registry);
+    register_temp(*registry);
+    register_flight(*registry);
+    register_generic(*registry);
+    register_pollution(*registry);
+
+    // registry->insert("synop", ...)
+    // registry->insert("synop-high", ...)
+    // registry->insert("wmo-synop", ...)
+    // registry->insert("wmo-synop-high", ...)
+    // registry->insert("ecmwf-synop", ...)
+    // registry->insert("ecmwf-synop-high", ...)
+
+    return registry;
+}
+
 const TemplateRegistry& TemplateRegistry::get()
 {
-    if (!registry)
-    {
-        registry = new TemplateRegistry;
-
-        registry->register_factory(MISSING_INT, "wmo", "WMO style templates (autodetect)",
-                [](const dballe::ExporterOptions& opts, const Messages& msgs) {
-                    auto msg = Message::downcast(msgs[0]);
-                    string tpl;
-                    switch (msg->type)
-                    {
-                        case MessageType::TEMP_SHIP: tpl = "temp-wmo"; break;
-                        default:
-                            tpl = format_message_type(msg->type);
-                            tpl += "-wmo";
-                            break;
-                    }
-                    const wr::TemplateFactory& fac = wr::TemplateRegistry::get(tpl);
-                    return fac.factory(opts, msgs);
-                });
-
-        // Populate it
-        register_synop(*registry);
-        register_ship(*registry);
-        register_buoy(*registry);
-        register_metar(*registry);
-        register_temp(*registry);
-        register_flight(*registry);
-        register_generic(*registry);
-        register_pollution(*registry);
-
-        // registry->insert("synop", ...)
-        // registry->insert("synop-high", ...)
-        // registry->insert("wmo-synop", ...)
-        // registry->insert("wmo-synop-high", ...)
-        // registry->insert("ecmwf-synop", ...)
-        // registry->insert("ecmwf-synop-high", ...)
-    }
+    // The initialization of function-local statics is thread safe, and
+    // exporters can run in multiple threads
+    static TemplateRegistry* registry = create_registry();
     return *registry;
 }
 
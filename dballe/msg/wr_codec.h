@@ -67,8 +67,58 @@ public:
     bool foreach_decoded(const BinaryMessage& msg, std::function<bool(std::unique_ptr<dballe::Message>)> dest) const override;
 };
 
+/**
+ * Lock on the wreport table caches.
+ *
+ * wreport loads BUFR and CREX tables lazily into process-wide caches, without
+ * locking. Threads that decode messages concurrently hold a shared lock, after
+ * the tables for their messages have been loaded by preload_tables(). Tables
+ * are only loaded while holding the exclusive lock.
+ */
+struct TablesLock
+{
+    static void lock_shared();
+    static void unlock_shared();
+    static void lock();
+    static void unlock();
+};
+
+/// Hold a shared TablesLock for the lifetime of the object
+struct SharedTablesLock
+{
+    SharedTablesLock() { TablesLock::lock_shared(); }
+    ~SharedTablesLock() { TablesLock::unlock_shared(); }
+    SharedTablesLock(const SharedTablesLock&) = delete;
+    SharedTablesLock& operator=(const SharedTablesLock&) = delete;
+};
+
+/// Hold the exclusive TablesLock for the lifetime of the object
+struct ExclusiveTablesLock
+{
+    ExclusiveTablesLock() { TablesLock::lock(); }
+    ~ExclusiveTablesLock() { TablesLock::unlock(); }
+    ExclusiveTablesLock(const ExclusiveTablesLock&) = delete;
+    ExclusiveTablesLock& operator=(const ExclusiveTablesLock&) = delete;
+};
+
+/**
+ * Load the tables needed to decode the BUFR or CREX message \a msg.
+ *
+ * The header of the message is decoded, and its tables are loaded while
+ * holding the exclusive TablesLock, the first time a table version is seen.
+ * Messages in other encodings do not use wreport tables.
+ *
+ * Returns true if the message can then be decoded holding a shared
+ * TablesLock, false if its header could not be read, and decoding it may
+ * need to load tables.
+ */
+bool preload_tables(const BinaryMessage& msg);
+
 namespace wr {
 class Template;
+
+/// Load the tables of \a bulletin while holding the exclusive TablesLock
+void load_tables(wreport::Bulletin& bulletin);
 }
 
 class WRExporter : public BulletinExporter
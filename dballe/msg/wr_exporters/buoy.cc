@@ -75,7 +75,7 @@ struct Buoy : public Template
                 bulletin.datadesc.push_back(WR_VAR(0, 33,   7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
     void to_subset(const Message& msg, wreport::Subset& subset) override
     {
@@ -153,7 +153,7 @@ struct Airep : public FlightBase
             bulletin.datadesc.push_back(WR_VAR(0, 33,   7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -248,7 +248,7 @@ struct AmdarWMO : public FlightBase
         bulletin.datadesc.push_back(WR_VAR(0,  2,  65));
         bulletin.datadesc.push_back(WR_VAR(0,  7,   4));
         bulletin.datadesc.push_back(WR_VAR(0, 33,  26));
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -356,7 +356,7 @@ struct Acars : public FlightBase
             bulletin.datadesc.push_back(WR_VAR(0, 33,   7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
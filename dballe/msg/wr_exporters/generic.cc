@@ -79,7 +79,7 @@ struct Generic : public Template
         // The data descriptor section will be generated later, as it depends
         // on the contents of the message
 
-        bulletin.load_tables();
+        load_tables(bulletin);
 
         // Store a pointer to it because we modify it later
         this->bulletin = &bulletin;
@@ -94,7 +94,7 @@ struct Pollution : public Template
         bulletin.datadesc.push_back(WR_VAR(0,  8,  90));
         bulletin.datadesc.push_back(WR_VAR(0, 33,   3));
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
     void to_subset(const Message& msg, wreport::Subset& subset) override
     {
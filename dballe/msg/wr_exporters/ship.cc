@@ -179,7 +179,7 @@ struct ShipAbbr : public ShipECMWFBase
         ShipECMWFBase::setupBulletin(bulletin);
         bulletin.data_subcategory_local = 9;
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 };
 
@@ -196,7 +196,7 @@ struct ShipPlain : public ShipECMWFBase
         ShipECMWFBase::setupBulletin(bulletin);
         bulletin.data_subcategory_local = 11;
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 };
 
@@ -213,7 +213,7 @@ struct ShipAuto : public ShipECMWFBase
         ShipECMWFBase::setupBulletin(bulletin);
         bulletin.data_subcategory_local = 13;
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 };
 
@@ -230,7 +230,7 @@ struct ShipReduced : public ShipECMWFBase
         ShipECMWFBase::setupBulletin(bulletin);
         bulletin.data_subcategory_local = 19;
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 };
 
@@ -255,7 +255,7 @@ struct ShipECMWFSecondRecord : public ShipBase
         bulletin.data_category = 1;
         bulletin.data_subcategory = 255;
         bulletin.data_subcategory_local = 12;
-        bulletin.load_tables();
+        load_tables(bulletin);
 
         // Data descriptor section
         bulletin.datadesc.clear();
@@ -355,7 +355,7 @@ struct ShipWMO : public ShipBase
         bulletin.datadesc.clear();
         bulletin.datadesc.push_back(WR_VAR(3,  8,   9));
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
     void to_subset(const Message& msg, wreport::Subset& subset) override
     {
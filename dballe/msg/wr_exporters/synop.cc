@@ -208,7 +208,7 @@ struct SynopECMWFLand : public SynopECMWF
             bulletin.datadesc.push_back(WR_VAR(0, 33,  7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -285,7 +285,7 @@ struct SynopECMWFLandHigh : public SynopECMWF
             bulletin.datadesc.push_back(WR_VAR(0, 33,  7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -366,7 +366,7 @@ struct SynopWMO : public Synop
         // Data descriptor section
         bulletin.datadesc.clear();
         bulletin.datadesc.push_back(WR_VAR(3, 7, 80));
-        bulletin.load_tables();
+        load_tables(bulletin);
 
         cur_bulletin = &bulletin;
     }
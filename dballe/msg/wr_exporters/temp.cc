@@ -208,7 +208,7 @@ struct TempWMO : public TempBase
         // Data descriptor section
         bulletin.datadesc.clear();
         bulletin.datadesc.push_back(WR_VAR(3, 9, 52));
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void do_D03054(const msg::Context& c)
@@ -369,7 +369,7 @@ struct TempRadar : public TempBase
         bulletin.datadesc.push_back(WR_VAR(0, 11,   6));
         bulletin.datadesc.push_back(WR_VAR(0, 33,   2));
         bulletin.datadesc.push_back(WR_VAR(0, 11,  50));
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -451,7 +451,7 @@ struct TempEcmwfLand : public TempBase
                 bulletin.datadesc.push_back(WR_VAR(0, 33,   7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -533,7 +533,7 @@ struct TempEcmwfShip : public TempBase
                 bulletin.datadesc.push_back(WR_VAR(0, 33,  7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -623,7 +623,7 @@ struct PilotWMO : public TempBase
             bulletin.datadesc.push_back(WR_VAR(3, 9, 50)); // For pressure levels
         else
             bulletin.datadesc.push_back(WR_VAR(3, 9, 51)); // For height levels
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
 
     void to_subset(const Message& msg, wreport::Subset& subset) override
@@ -755,7 +755,7 @@ struct PilotEcmwf : public TempBase
                 bulletin.datadesc.push_back(WR_VAR(0, 33,  7));
         }
 
-        bulletin.load_tables();
+        load_tables(bulletin);
     }
     void to_subset(const Message& msg, wreport::Subset& subset) override
     {
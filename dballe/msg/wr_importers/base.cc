@@ -34,6 +34,9 @@ void Importer::import(const wreport::Subset& subset, Message& msg)
     this->subset = &subset;
     this->msg = &msg;
     init();
+    // Sort contexts once the message is built, to import large soundings
+    // quickly
+    Contexts::BulkInsert bulk(msg.data);
     run();
 }
 
@@ -570,6 +570,12 @@ int MySQLConnection::get_last_insert_id()
     return mysql_insert_id(db);
 }
 
+unsigned MySQLConnection::changes()
+{
+    check_connection();
+    return mysql_affected_rows(db);
+}
+
 bool MySQLConnection::has_table(const std::string& name)
 {
     using namespace dballe::sql::mysql;
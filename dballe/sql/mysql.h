@@ -207,6 +207,9 @@ public:
      * If not supported, an exception is thrown.
      */
     int get_last_insert_id();
+
+    /// Return the number of rows changed by the last INSERT, UPDATE or DELETE
+    unsigned changes();
 };
 
 }
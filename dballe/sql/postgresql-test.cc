@@ -142,6 +142,48 @@ class Tests : public FixtureTestCase<ConnectorFixture>
             wassert(actual(val[3]) == 0x00);
         });
 
+        add_method("copy_binary", [](Fixture& f) {
+            // Test COPY FROM STDIN in binary format
+            auto& conn = f.conn;
+            conn->drop_table_if_exists("dballe_testcopy");
+            conn->exec_no_data("CREATE TABLE dballe_testcopy (id INTEGER NOT NULL, dt TIMESTAMP, val VARCHAR(255), attrs BYTEA)");
+
+            postgresql::CopyBuffer buf;
+            buf.start_row(4);
+            buf.add_int4(1);
+            buf.add_timestamp(Datetime(2018, 6, 1, 12, 30, 15));
+            buf.add_string("test");
+            buf.add_bytea(std::vector<uint8_t>{ 0x00, 0x11, 0xEE, 0xFF });
+            buf.start_row(4);
+            buf.add_int4(-2);
+            buf.add_null();
+            buf.add_string("");
+            buf.add_null();
+            buf.finish();
+            wassert(actual(buf.rows) == 2u);
+
+            conn->copy_from_stdin("COPY dballe_testcopy (id, dt, val, attrs) FROM STDIN (FORMAT binary)", buf);
+
+            auto s = conn->exec("SELECT id, dt, val, attrs FROM dballe_testcopy ORDER BY id DESC");
+            wassert(actual(s.rowcount()) == 2);
+            wassert(actual((int)s.get_int4(0, 0)) == 1);
+            wassert(actual(s.get_timestamp(0, 1)) == Datetime(2018, 6, 1, 12, 30, 15));
+            wassert(actual(s.get_string(0, 2)) == "test");
+            wassert(actual(s.get_bytea(0, 3).size()) == 4u);
+            wassert(actual(s.get_bytea(0, 3)[2]) == 0xEE);
+            wassert(actual((int)s.get_int4(1, 0)) == -2);
+            wassert(actual(s.is_null(1, 1)).istrue());
+            wassert(actual(s.get_string(1, 2)) == "");
+            wassert(actual(s.is_null(1, 3)).istrue());
+
+            // Errors from the server are reported
+            postgresql::CopyBuffer bad;
+            bad.start_row(1);
+            bad.add_int4(1);
+            bad.finish();
+            wassert_throws(error_postgresql, conn->copy_from_stdin("COPY dballe_testcopy (id, dt) FROM STDIN (FORMAT binary)", bad));
+        });
+
         add_method("has_tables", [](Fixture& f) {
             // Test has_tables
             auto& conn = f.conn;
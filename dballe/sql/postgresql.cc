@@ -35,6 +35,68 @@ int64_t encode_datetime(const Datetime& arg)
     return (int64_t)htobe64(encoded);
 }
 
+CopyBuffer::CopyBuffer()
+{
+    // Signature, flags, header extension length
+    buf.append("PGCOPY\n\377\r\n\0", 11);
+    add_raw("\0\0\0\0\0\0\0\0", 8);
+}
+
+void CopyBuffer::add_raw(const void* data, size_t size)
+{
+    buf.append((const char*)data, size);
+}
+
+void CopyBuffer::start_row(uint16_t fields)
+{
+    uint16_t encoded = htons(fields);
+    add_raw(&encoded, 2);
+    ++rows;
+}
+
+void CopyBuffer::add_null()
+{
+    uint32_t len = htonl((uint32_t)-1);
+    add_raw(&len, 4);
+}
+
+void CopyBuffer::add_int4(int32_t val)
+{
+    uint32_t len = htonl(4);
+    uint32_t encoded = htonl((uint32_t)val);
+    add_raw(&len, 4);
+    add_raw(&encoded, 4);
+}
+
+void CopyBuffer::add_timestamp(const Datetime& val)
+{
+    uint32_t len = htonl(8);
+    int64_t encoded = encode_datetime(val);
+    add_raw(&len, 4);
+    add_raw(&encoded, 8);
+}
+
+void CopyBuffer::add_string(const char* val)
+{
+    size_t size = strlen(val);
+    uint32_t len = htonl(size);
+    add_raw(&len, 4);
+    add_raw(val, size);
+}
+
+void CopyBuffer::add_bytea(const std::vector<uint8_t>& val)
+{
+    uint32_t len = htonl(val.size());
+    add_raw(&len, 4);
+    add_raw(val.data(), val.size());
+}
+
+void CopyBuffer::finish()
+{
+    uint16_t trailer = htons((uint16_t)-1);
+    add_raw(&trailer, 2);
+}
+
 void Result::expect_no_data(const std::string& query)
 {
     switch (PQresultStatus(res))
@@ -89,6 +151,12 @@ void Result::expect_success(const std::string& query)
     }
 }
 
+unsigned Result::affected_rows() const
+{
+    // PQcmdTuples returns an empty string for commands that do not change rows
+    return strtoul(PQcmdTuples(res), nullptr, 10);
+}
+
 /// Return a result value, transmitted in binary as a 4 bit integer
 uint64_t Result::get_int8(unsigned row, unsigned col) const
 {
@@ -369,6 +437,47 @@ void PostgreSQLConnection::discard_all_input_nothrow() noexcept
     }
 }
 
+void PostgreSQLConnection::copy_from_stdin(const std::string& query, const postgresql::CopyBuffer& data)
+{
+    using namespace dballe::sql::postgresql;
+
+    check_connection();
+    {
+        Result res(PQexec(db, query.c_str()));
+        if (PQresultStatus(res) != PGRES_COPY_IN)
+            throw error_postgresql(res, "starting " + query);
+    }
+
+    // Send the data in chunks, to avoid libpq making a copy of all of it
+    static const size_t chunk_size = 1024 * 1024;
+    for (size_t pos = 0; pos < data.buf.size(); pos += chunk_size)
+    {
+        size_t size = min(chunk_size, data.buf.size() - pos);
+        if (PQputCopyData(db, data.buf.data() + pos, size) != 1)
+        {
+            string errmsg(PQerrorMessage(db));
+            PQputCopyEnd(db, "cannot send data");
+            discard_all_input_nothrow();
+            throw error_postgresql(errmsg, "sending data for " + query);
+        }
+    }
+
+    if (PQputCopyEnd(db, nullptr) != 1)
+        throw error_postgresql(db, "terminating " + query);
+
+    // Collect the result of the COPY, and anything that might follow it
+    string errmsg;
+    while (true)
+    {
+        Result res(PQgetResult(db));
+        if (!res) break;
+        if (PQresultStatus(res) != PGRES_COMMAND_OK && errmsg.empty())
+            errmsg = PQresultErrorMessage(res);
+    }
+    if (!errmsg.empty())
+        throw error_postgresql(errmsg, "executing " + query);
+}
+
 void PostgreSQLConnection::run_single_row_mode(const std::string& query_desc, std::function<void(const postgresql::Result&)> dest)
 {
     using namespace dballe::sql::postgresql;
@@ -148,6 +148,44 @@ protected:
     }
 };
 
+/**
+ * Buffer with rows encoded for COPY ... FROM STDIN (FORMAT binary).
+ *
+ * Values are appended in the same order as the columns of the COPY
+ * statement, and every row starts with a call to start_row().
+ */
+struct CopyBuffer
+{
+    std::string buf;
+    unsigned rows = 0;
+
+    CopyBuffer();
+
+    /// Start a new row with the given number of fields
+    void start_row(uint16_t fields);
+
+    /// Append a NULL value
+    void add_null();
+
+    /// Append a value for an INTEGER column
+    void add_int4(int32_t val);
+
+    /// Append a value for a TIMESTAMP column
+    void add_timestamp(const Datetime& val);
+
+    /// Append a value for a VARCHAR or TEXT column
+    void add_string(const char* val);
+
+    /// Append a value for a BYTEA column
+    void add_bytea(const std::vector<uint8_t>& val);
+
+    /// Append the end of data marker
+    void finish();
+
+protected:
+    void add_raw(const void* data, size_t size);
+};
+
 /// Wrap a PGresult, taking care of its memory management
 struct Result
 {
@@ -187,6 +225,9 @@ struct Result
     /// Get the number of rows in the result
     unsigned rowcount() const { return PQntuples(res); }
 
+    /// Get the number of rows changed by an INSERT, UPDATE or DELETE
+    unsigned affected_rows() const;
+
     /// Check if a result value is null
     bool is_null(unsigned row, unsigned col) const
     {
@@ -479,6 +520,20 @@ public:
      */
     void pqexec_nothrow(const std::string& query) noexcept;
 
+    /**
+     * Minimum number of rows for which bulk inserts use COPY ... FROM STDIN
+     * instead of a multi-row INSERT. 0 means never use COPY.
+     */
+    unsigned copy_min_rows = 64;
+
+    /**
+     * Run a COPY ... FROM STDIN (FORMAT binary) query, sending it the
+     * contents of data.
+     *
+     * data must have been finalised with CopyBuffer::finish().
+     */
+    void copy_from_stdin(const std::string& query, const postgresql::CopyBuffer& data);
+
     /// Retrieve query results in single row mode
     void run_single_row_mode(const std::string& query_desc, std::function<void(const postgresql::Result&)> dest);
 
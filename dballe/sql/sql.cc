@@ -12,6 +12,7 @@
 #endif
 #include <cstring>
 #include <cstdlib>
+#include <mutex>
 
 using namespace std;
 using namespace wreport;
@@ -32,6 +33,7 @@ const char* format_server_type(ServerType type)
         case ServerType::SQLITE: return "sqlite";
         case ServerType::ORACLE: return "oracle";
         case ServerType::POSTGRES: return "postgresql";
+        case ServerType::MEMORY: return "memory";
         default: return "unknown";
     }
 }
@@ -45,9 +47,14 @@ Connection::~Connection()
 }
 
 static std::vector<std::weak_ptr<Connection>> atfork_connections;
+/// Protects atfork_connections, which can be modified from multiple threads
+static std::mutex atfork_mutex;
 
 void Connection::atfork_prepare_hook()
 {
+    // Held until after the fork, so that atfork_connections does not change
+    // while the hooks use it
+    atfork_mutex.lock();
     try {
         for (auto& c: atfork_connections)
             if (!c.expired())
@@ -66,6 +73,7 @@ void Connection::atfork_parent_hook()
     } catch (std::exception& e) {
         fprintf(stderr, "post-fork parent error: %s\n", e.what());
     }
+    atfork_mutex.unlock();
 }
 
 void Connection::atfork_child_hook()
@@ -77,10 +85,12 @@ void Connection::atfork_child_hook()
     } catch (std::exception& e) {
         fprintf(stderr, "post-fork child error: %s\n", e.what());
     }
+    atfork_mutex.unlock();
 }
 
 void Connection::register_atfork()
 {
+    std::lock_guard<std::mutex> lock(atfork_mutex);
     for (auto& c: atfork_connections)
         if (c.expired())
         {
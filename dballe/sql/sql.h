@@ -43,6 +43,8 @@ enum class ServerType
     SQLITE,
     ORACLE,
     POSTGRES,
+    /// In-memory storage, without SQL
+    MEMORY,
 };
 
 /// Return a string description for a ServerType value
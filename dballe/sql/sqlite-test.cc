@@ -152,6 +152,29 @@ add_method("bytes", [](Fixture& f) {
     wassert(actual(val[3]) == 0x00);
 });
 
+add_method("datetime", [](Fixture& f) {
+    // Datetimes are read back both from text and from packed integers
+    auto& conn = f.conn;
+    conn->drop_table_if_exists("dballe_testdt");
+    conn->exec("CREATE TABLE dballe_testdt (val)");
+    auto s = conn->sqlitestatement("INSERT INTO dballe_testdt VALUES (?)");
+    s->bind_val(1, Datetime(2001, 2, 3, 4, 5, 6));
+    s->execute();
+    conn->packed_datetime = true;
+    s->bind_val(1, Datetime(2002, 3, 4, 5, 6, 7));
+    s->execute();
+    conn->packed_datetime = false;
+
+    std::vector<Datetime> vals;
+    s = conn->sqlitestatement("SELECT val FROM dballe_testdt ORDER BY rowid");
+    s->execute([&]() {
+        vals.push_back(s->column_datetime(0));
+    });
+    wassert(actual(vals.size()) == 2u);
+    wassert(actual(vals[0]) == Datetime(2001, 2, 3, 4, 5, 6));
+    wassert(actual(vals[1]) == Datetime(2002, 3, 4, 5, 6, 7));
+});
+
 add_method("query_has_tables", [](Fixture& f) {
     // Test has_tables
     wassert(actual(f.conn->has_table("this_should_not_exist")).isfalse());
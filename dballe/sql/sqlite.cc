@@ -41,6 +41,21 @@ static int trace_callback(unsigned T, void* C, void* P,void* X)
 }
 #endif
 
+/// Pack a Datetime into a YYYYMMDDhhmmss integer, which sorts like the text form
+sqlite3_int64 pack_datetime(const Datetime& dt)
+{
+    return ((((dt.year * 100LL + dt.month) * 100 + dt.day) * 100 + dt.hour) * 100 + dt.minute) * 100 + dt.second;
+}
+
+/// Parse a fixed number of decimal digits
+inline unsigned parse_digits(const char* s, unsigned len)
+{
+    unsigned res = 0;
+    for (unsigned i = 0; i < len; ++i)
+        res = res * 10 + (s[i] - '0');
+    return res;
+}
+
 }
 
 
@@ -244,6 +259,13 @@ void SQLiteConnection::explain(const std::string& query, FILE* out)
     });
 }
 
+void SQLiteConnection::add_datetime(Querybuf& qb, const Datetime& dt) const
+{
+    if (!packed_datetime)
+        return Connection::add_datetime(qb, dt);
+    qb.appendf("%lld", (long long)pack_datetime(dt));
+}
+
 struct SQLiteTransaction : public Transaction
 {
     SQLiteConnection& conn;
@@ -385,10 +407,28 @@ SQLiteStatement::~SQLiteStatement()
 Datetime SQLiteStatement::column_datetime(int col)
 {
     Datetime res;
-    string dt = column_string(col);
-    sscanf(dt.c_str(), "%04hu-%02hhu-%02hhu %02hhu:%02hhu:%02hhu",
-            &res.year, &res.month, &res.day,
-            &res.hour, &res.minute, &res.second);
+    if (sqlite3_column_type(stm, col) == SQLITE_INTEGER)
+    {
+        sqlite3_int64 val = sqlite3_column_int64(stm, col);
+        res.second = val % 100; val /= 100;
+        res.minute = val % 100; val /= 100;
+        res.hour = val % 100; val /= 100;
+        res.day = val % 100; val /= 100;
+        res.month = val % 100; val /= 100;
+        res.year = val;
+        return res;
+    }
+
+    // Decode the fixed-width "YYYY-MM-DD hh:mm:ss" text in place
+    const char* dt = column_string(col);
+    if (sqlite3_column_bytes(stm, col) < 19)
+        error_consistency::throwf("cannot parse '%s' as a datetime", dt ? dt : "(null)");
+    res.year = parse_digits(dt, 4);
+    res.month = parse_digits(dt + 5, 2);
+    res.day = parse_digits(dt + 8, 2);
+    res.hour = parse_digits(dt + 11, 2);
+    res.minute = parse_digits(dt + 14, 2);
+    res.second = parse_digits(dt + 17, 2);
     return res;
 }
 
@@ -444,6 +484,22 @@ void SQLiteStatement::execute_one(std::function<void()> on_row)
     }
 }
 
+bool SQLiteStatement::step()
+{
+    switch (sqlite3_step(stm))
+    {
+        case SQLITE_ROW:
+            return true;
+        case SQLITE_DONE:
+            wrap_sqlite3_reset();
+            return false;
+        case SQLITE_BUSY:
+        case SQLITE_MISUSE:
+        default:
+            reset_and_throw("cannot execute the query " + query);
+    }
+}
+
 void SQLiteStatement::execute()
 {
     while (true)
@@ -488,6 +544,13 @@ void SQLiteStatement::bind_val(int idx, unsigned short val)
 
 void SQLiteStatement::bind_val(int idx, const Datetime& val)
 {
+    if (conn.packed_datetime)
+    {
+        if (sqlite3_bind_int64(stm, idx, pack_datetime(val)) != SQLITE_OK)
+            throw error_sqlite(conn, "cannot bind an int64 (from Datetime) input column");
+        return;
+    }
+
     char* buf;
     int size = asprintf(&buf, "%04d-%02d-%02d %02d:%02d:%02d",
             val.year, val.month, val.day,
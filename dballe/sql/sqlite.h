@@ -57,6 +57,20 @@ protected:
     void reopen();
 
 public:
+    /**
+     * Maximum number of rows that bulk inserts put in a single INSERT
+     * statement. 1 means one INSERT statement per row.
+     */
+    unsigned max_rows_per_insert = 128;
+
+    /**
+     * Bind and format datetimes as YYYYMMDDhhmmss integers instead of text.
+     *
+     * This is used for databases whose datetime columns are INTEGER.
+     * column_datetime reads both forms.
+     */
+    bool packed_datetime = false;
+
     SQLiteConnection(const SQLiteConnection&) = delete;
     SQLiteConnection(const SQLiteConnection&&) = delete;
     ~SQLiteConnection();
@@ -80,6 +94,7 @@ public:
     void drop_settings() override;
     void execute(const std::string& query) override;
     void explain(const std::string& query, FILE* out) override;
+    void add_datetime(Querybuf& qb, const Datetime& dt) const override;
 
     /**
      * Delete a table in the database if it exists, otherwise do nothing.
@@ -162,6 +177,15 @@ struct SQLiteStatement
      */
     void execute_one(std::function<void()> on_row);
 
+    /**
+     * Advance the query by one row, for iterating results incrementally.
+     *
+     * @return true if a new row is available, false if the end of the results
+     * has been reached. In that case, or in case an exception is thrown, the
+     * statement is reset.
+     */
+    bool step();
+
     /// Read the int value of a column in the result set (0-based)
     int column_int(int col) { return sqlite3_column_int(stm, col); }
 
@@ -181,7 +205,10 @@ struct SQLiteStatement
         return std::vector<uint8_t>(val, val + size);
     }
 
-    /// Read the string value of a column and parse it as a Datetime
+    /**
+     * Read a Datetime from a column, stored either as YYYYMMDDhhmmss integer
+     * or as "YYYY-MM-DD hh:mm:ss" text
+     */
     Datetime column_datetime(int col);
 
     /// Check if a column has a NULL value (0-based)
@@ -6,27 +6,31 @@ using namespace std;
 using namespace wreport;
 
 namespace {
-const Vartable* local = nullptr;
+
+/// Return the dballe local B table, loaded once with thread safe initialization
+const Vartable* local()
+{
+    static const Vartable* table = Vartable::get_bufr("dballe");
+    return table;
+}
+
 }
 
 namespace dballe {
 
 wreport::Varinfo varinfo(wreport::Varcode code)
 {
-    if (!local) local = Vartable::get_bufr("dballe");
-    return local->query(code);
+    return local()->query(code);
 }
 
 wreport::Varinfo varinfo(const char* code)
 {
-    if (!local) local = Vartable::get_bufr("dballe");
-    return local->query(resolve_varcode(code));
+    return local()->query(resolve_varcode(code));
 }
 
 wreport::Varinfo varinfo(const std::string& code)
 {
-    if (!local) local = Vartable::get_bufr("dballe");
-    return local->query(resolve_varcode(code));
+    return local()->query(resolve_varcode(code));
 }
 
 wreport::Varcode resolve_varcode(const char* name)
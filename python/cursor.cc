@@ -9,6 +9,9 @@
 #include "dballe/core/data.h"
 #include "dballe/db/v7/cursor.h"
 #include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstring>
 #include "utils/type.h"
 
 using namespace std;
@@ -450,6 +453,178 @@ struct enqf : MethKwargs<enqf<Impl>, Impl>
     }
 };
 
+namespace {
+
+/// Columns of query_data results, used to build numpy arrays
+struct DataColumns
+{
+    std::vector<int32_t> ana_id;
+    std::vector<double> lat;
+    std::vector<double> lon;
+    std::vector<int64_t> datetime;
+    std::vector<int32_t> leveltype1;
+    std::vector<int32_t> l1;
+    std::vector<int32_t> leveltype2;
+    std::vector<int32_t> l2;
+    std::vector<int32_t> pindicator;
+    std::vector<int32_t> p1;
+    std::vector<int32_t> p2;
+    std::vector<char> var;
+    std::vector<double> value;
+
+    /// Read all the remaining rows of cur
+    void drain(dballe::CursorData& cur)
+    {
+        // Julian day of 1970-01-01
+        static const int64_t epoch_julian = 2440588;
+
+        if (cur.remaining() > 0)
+            reserve(cur.remaining());
+
+        while (cur.next())
+        {
+            DBStation station = cur.get_station();
+            ana_id.push_back(station.id);
+            lat.push_back(station.coords.dlat());
+            lon.push_back(station.coords.dlon());
+
+            Datetime dt = cur.get_datetime();
+            datetime.push_back((dt.to_julian() - epoch_julian) * 86400 + dt.hour * 3600 + dt.minute * 60 + dt.second);
+
+            Level level = cur.get_level();
+            leveltype1.push_back(level.ltype1);
+            l1.push_back(level.l1);
+            leveltype2.push_back(level.ltype2);
+            l2.push_back(level.l2);
+
+            Trange trange = cur.get_trange();
+            pindicator.push_back(trange.pind);
+            p1.push_back(trange.p1);
+            p2.push_back(trange.p2);
+
+            wreport::Var v = cur.get_var();
+            char code[7];
+            format_code(v.code(), code);
+            var.insert(var.end(), code, code + 6);
+            if (v.isset() && !v.info()->is_string())
+                value.push_back(v.enqd());
+            else
+                value.push_back(NAN);
+        }
+    }
+
+    void reserve(size_t size)
+    {
+        ana_id.reserve(size);
+        lat.reserve(size);
+        lon.reserve(size);
+        datetime.reserve(size);
+        leveltype1.reserve(size);
+        l1.reserve(size);
+        leveltype2.reserve(size);
+        l2.reserve(size);
+        pindicator.reserve(size);
+        p1.reserve(size);
+        p2.reserve(size);
+        var.reserve(size * 6);
+        value.reserve(size);
+    }
+};
+
+/// Build numpy arrays from the contents of std::vectors
+struct ArrayBuilder
+{
+    pyo_unique_ptr numpy;
+    pyo_unique_ptr frombuffer;
+    pyo_unique_ptr masked_equal;
+
+    ArrayBuilder()
+        : numpy(throw_ifnull(PyImport_ImportModule("numpy"))),
+          frombuffer(throw_ifnull(PyObject_GetAttrString(numpy, "frombuffer")))
+    {
+        pyo_unique_ptr ma(throw_ifnull(PyImport_ImportModule("numpy.ma")));
+        masked_equal.reset(throw_ifnull(PyObject_GetAttrString(ma, "masked_equal")));
+    }
+
+    /// Copy size bytes from data into a new numpy array of the given dtype
+    pyo_unique_ptr make(const void* data, size_t size, const char* dtype)
+    {
+        pyo_unique_ptr buf(throw_ifnull(PyByteArray_FromStringAndSize(nullptr, size)));
+        if (size)
+            memcpy(PyByteArray_AS_STRING(buf.get()), data, size);
+        return throw_ifnull(PyObject_CallFunction(frombuffer, "Os", buf.get(), dtype));
+    }
+
+    template<typename T>
+    pyo_unique_ptr make(const std::vector<T>& data, const char* dtype)
+    {
+        return make(data.data(), data.size() * sizeof(T), dtype);
+    }
+
+    /// Add an array to a dict
+    void add(PyObject* dict, const char* key, pyo_unique_ptr arr)
+    {
+        set_dict(dict, key, arr);
+    }
+
+    /// Build an int32 numpy array, with MISSING_INT values masked
+    pyo_unique_ptr make_masked(const std::vector<int32_t>& data)
+    {
+        pyo_unique_ptr arr(make(data, "int32"));
+        return throw_ifnull(PyObject_CallFunction(masked_equal, "Oi", arr.get(), MISSING_INT));
+    }
+};
+
+}
+
+template<typename Impl>
+struct to_numpy : MethNoargs<to_numpy<Impl>, Impl>
+{
+    constexpr static const char* name = "to_numpy";
+    constexpr static const char* returns = "Dict[str, numpy.ndarray]";
+    constexpr static const char* summary = "Read all the remaining results into numpy arrays";
+    constexpr static const char* doc = R"(
+Return a dict mapping column names to arrays with one element per
+result: ``ana_id`` (int32), ``lat``, ``lon`` (float64), ``datetime``
+(datetime64[s]), ``leveltype1``, ``l1``, ``leveltype2``, ``l2``,
+``pindicator``, ``p1``, ``p2`` (masked int32 arrays, masked where the
+value is missing), ``var`` (bytes varcodes, like ``b"B12101"``) and
+``value`` (float64, NaN for string variables).
+
+This is much faster than iterating the cursor from Python. The cursor is
+left at the end of its results.
+)";
+    static PyObject* run(Impl* self)
+    {
+        try {
+            ensure_valid_cursor(self);
+
+            DataColumns cols;
+            {
+                ReleaseGIL gil;
+                cols.drain(*self->cur);
+            }
+
+            ArrayBuilder builder;
+            pyo_unique_ptr res(throw_ifnull(PyDict_New()));
+            builder.add(res, "ana_id", builder.make(cols.ana_id, "int32"));
+            builder.add(res, "lat", builder.make(cols.lat, "float64"));
+            builder.add(res, "lon", builder.make(cols.lon, "float64"));
+            builder.add(res, "datetime", builder.make(cols.datetime, "datetime64[s]"));
+            builder.add(res, "leveltype1", builder.make_masked(cols.leveltype1));
+            builder.add(res, "l1", builder.make_masked(cols.l1));
+            builder.add(res, "leveltype2", builder.make_masked(cols.leveltype2));
+            builder.add(res, "l2", builder.make_masked(cols.l2));
+            builder.add(res, "pindicator", builder.make_masked(cols.pindicator));
+            builder.add(res, "p1", builder.make_masked(cols.p1));
+            builder.add(res, "p2", builder.make_masked(cols.p2));
+            builder.add(res, "var", builder.make(cols.var, "S6"));
+            builder.add(res, "value", builder.make(cols.value, "float64"));
+            return res.release();
+        } DBALLE_CATCH_RETURN_PYO
+    }
+};
+
 template<typename Impl>
 struct __exit__ : MethVarargs<__exit__<Impl>, Impl>
 {
@@ -657,7 +832,7 @@ For example::
 )";
 
     GetSetters<remaining<Impl>, query<Impl>, data<Impl>, data_dict<Impl>> getsetters;
-    Methods<MethGenericEnter<Impl>, __exit__<Impl>, enqi<Impl>, enqd<Impl>, enqs<Impl>, enqf<Impl>> methods;
+    Methods<MethGenericEnter<Impl>, __exit__<Impl>, enqi<Impl>, enqd<Impl>, enqs<Impl>, enqf<Impl>, to_numpy<Impl>> methods;
 };
 
 
@@ -684,7 +859,7 @@ For example::
 )";
 
     GetSetters<remaining<Impl>, query<Impl>, data<Impl>, data_dict<Impl>> getsetters;
-    Methods<MethGenericEnter<Impl>, __exit__<Impl>, remove<Impl>, query_attrs<Impl>, insert_attrs<Impl>, remove_attrs<Impl>, enqi<Impl>, enqd<Impl>, enqs<Impl>, enqf<Impl>> methods;
+    Methods<MethGenericEnter<Impl>, __exit__<Impl>, remove<Impl>, query_attrs<Impl>, insert_attrs<Impl>, remove_attrs<Impl>, enqi<Impl>, enqd<Impl>, enqs<Impl>, enqf<Impl>, to_numpy<Impl>> methods;
 };
 
 
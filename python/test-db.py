@@ -164,6 +164,22 @@ class CommonDBTestMixin(DballeDBMixin):
             # FIXME: this should trigger a query: how do we test it?
             self.assertEqual({k: v.enq() for k, v in result.query_attrs().items()}, expected[idx]["attrs"])
 
+    def testQueryDataToNumpy(self):
+        import numpy
+        with self.transaction() as tr:
+            with tr.query_data({"latmin": 10.0}) as cur:
+                arrays = cur.to_numpy()
+                self.assertEqual(cur.remaining, 0)
+        self.assertEqual(len(arrays["ana_id"]), 2)
+        self.assertEqual(arrays["lat"][0], 12.34560)
+        self.assertEqual(arrays["lon"][0], 76.54320)
+        self.assertEqual(arrays["datetime"][0], numpy.datetime64("1945-04-25T08:00:00"))
+        self.assertEqual(list(arrays["l1"]), [11, 11])
+        self.assertEqual(list(arrays["p2"]), [222, 222])
+        self.assertEqual(list(arrays["var"]), [b"B01011", b"B01012"])
+        self.assertTrue(numpy.isnan(arrays["value"][0]))
+        self.assertEqual(arrays["value"][1], 500.0)
+
     def testQueryDataCursorAccess(self):
         def assertResultIntEqual(result, name, value):
             self.assertEqual(result[name], value)
@@ -9,6 +9,7 @@
 #include <wreport/options.h>
 #include <wreport/utils/string.h>
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
@@ -36,6 +37,7 @@ int op_full_pseudoana = 0;
 int op_verbose = 0;
 int op_precise_import = 0;
 int op_wipe_disappear = 0;
+int op_jobs = 1;
 
 
 struct poptOption grepTable[] = {
@@ -289,6 +291,8 @@ struct ImportCmd : public DatabaseCmd
             "import messages using precise contexts instead of standard ones", 0 });
         opts.push_back({ "varlist", 0, POPT_ARG_STRING, &op_varlist, 0,
             "only import variables with the given varcode(s)", "varlist" });
+        opts.push_back({ "jobs", 'j', POPT_ARG_INT, &readeropts.jobs, 0,
+            "decode input messages using this many threads (default: 1)", "num" });
         opts.push_back({ "domain-errors", 0, POPT_ARG_STRING, &op_domain_errors, 0,
             "recovery strategy to use when importing values outside a variable domain."
             " Possible values: 'unset' (ignore error and consider the value as unset)"
@@ -383,6 +387,8 @@ struct ExportCmd : public DatabaseCmd
             "template of the data in output (autoselect if not specified, 'list' gives a list)", "name" });
         opts.push_back({ "dump", 0, POPT_ARG_NONE, &op_dump, 0,
             "dump data to be encoded instead of encoding it", 0 });
+        opts.push_back({ "jobs", 'j', POPT_ARG_INT, &op_jobs, 0,
+            "encode output messages using this many threads (default: 1)", "num" });
     }
 
     int main(poptContext optCon) override
@@ -413,7 +419,7 @@ struct ExportCmd : public DatabaseCmd
         } else {
             Encoding type = File::parse_encoding(op_output_type);
             auto file = File::create(type, stdout, false, "w");
-            return dbadb.do_export(query, *file, op_output_template, forced_repmemo);
+            return dbadb.do_export(query, *file, op_output_template, forced_repmemo, op_jobs > 1 ? op_jobs : 1);
         }
     }
 };
@@ -450,6 +456,111 @@ struct DeleteCmd : public DatabaseCmd
     }
 };
 
+struct ExplainCmd : public DatabaseCmd
+{
+    ExplainCmd()
+    {
+        names.push_back("explain");
+        usage = "explain [options] [queryparm1=val1 [queryparm2=val2 [...]]]";
+        desc = "Show the query plans of the database queries for the given query parameters";
+        longdesc = "The queries used by station, station data, data, best"
+            " value and summary lookups are explained by the database, and"
+            " the plans that need a temporary sort of their results are"
+            " reported.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        core::Query query;
+        dba_cmdline_get_query(optCon, query);
+
+        auto db = connect();
+        Dbadb dbadb(*db);
+
+        return dbadb.do_explain(query, stdout);
+    }
+};
+
+struct CoveringIndexCmd : public DatabaseCmd
+{
+    CoveringIndexCmd()
+    {
+        names.push_back("covering-index");
+        usage = "covering-index [options]";
+        desc = "Add an index covering data queries to an existing database";
+        longdesc = "The index holds all the columns read by data queries, in"
+            " the order used to sort their results, so that they can be"
+            " answered from the index alone. It makes the data table"
+            " considerably larger and slower to insert into. Running it on a"
+            " database that already has it does nothing.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        auto db = connect();
+        Dbadb dbadb(*db);
+        return dbadb.do_covering_index(stdout);
+    }
+};
+
+struct TypedValuesCmd : public DatabaseCmd
+{
+    TypedValuesCmd()
+    {
+        names.push_back("typed-values");
+        usage = "typed-values [options]";
+        desc = "Add typed numeric values to an existing database";
+        longdesc = "Numeric values are also stored as integers in an indexed"
+            " column, which is kept up to date on insert and update, so that"
+            " data_filter and ana_filter queries can use an index. Running"
+            " it on a database that already has them does nothing.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        auto db = connect();
+        Dbadb dbadb(*db);
+        return dbadb.do_typed_values(stdout);
+    }
+};
+
+struct DropPartitionsCmd : public DatabaseCmd
+{
+    DropPartitionsCmd()
+    {
+        names.push_back("drop-partitions");
+        usage = "drop-partitions [options] YYYY-MM";
+        desc = "Remove all data before the given month, dropping whole partitions";
+        longdesc = "This only works on PostgreSQL databases created with"
+            " DBA_POSTGRESQL_PARTITIONED set, whose data table is partitioned"
+            " by month. Removing old data this way takes the same short time"
+            " regardless of how much data there is. Stations left without"
+            " data are removed by the cleanup command.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        const char* arg = poptGetArg(optCon);
+        if (arg == NULL)
+            dba_cmdline_error(optCon, "you need to specify the month of the oldest data to keep");
+
+        int year, month;
+        char tail;
+        if (sscanf(arg, "%d-%d%c", &year, &month, &tail) != 2 || month < 1 || month > 12)
+            dba_cmdline_error(optCon, "cannot parse month '%s': it should be in the form YYYY-MM", arg);
+
+        auto db = connect();
+        Dbadb dbadb(*db);
+        return dbadb.do_drop_partitions(Datetime(year, month, 1), stdout);
+    }
+};
+
 struct InfoCmd : public DatabaseCmd
 {
     InfoCmd()
@@ -493,6 +604,10 @@ int main (int argc, const char* argv[])
     dbadb.add_subcommand(new ExportCmd);
     dbadb.add_subcommand(new DeleteCmd);
     dbadb.add_subcommand(new InfoCmd);
+    dbadb.add_subcommand(new ExplainCmd);
+    dbadb.add_subcommand(new CoveringIndexCmd);
+    dbadb.add_subcommand(new TypedValuesCmd);
+    dbadb.add_subcommand(new DropPartitionsCmd);
 
     return dbadb.main(argc, argv);
 }
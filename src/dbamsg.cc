@@ -65,6 +65,12 @@ struct poptOption grepTable[] = {
         "match only messages that can be parsed", 0 },
     { "index", 0, POPT_ARG_STRING, &readeropts.index_filter, 0,
         "match messages with the index in the given range (ex.: 1-5,9,22-30)", "expr" },
+    { "mmap", 0, 0, &readeropts.mmap, 0,
+        "read BUFR files through a memory map, skipping messages excluded by --index without reading them", 0 },
+    { "mmap-index", 0, 0, &readeropts.mmap_index, 0,
+        "like --mmap, and keep the message offsets of each BUFR file in a .idx file next to it, to avoid scanning it again next time", 0 },
+    { "jobs", 'j', POPT_ARG_INT, &readeropts.jobs, 0,
+        "decode and process input messages using this many threads, keeping output in input order (default: 1)", "num" },
     POPT_TABLEEND
 };
 